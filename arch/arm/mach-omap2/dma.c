@@ -32,6 +32,8 @@
 #include <linux/interrupt.h>
 #include <linux/irq.h>
 #include <linux/device.h>
+#include <linux/dma-mapping.h>
+#include <linux/platform_device.h>
 
 #include <plat/irqs.h>
 #include <plat/omap_hwmod.h>
@@ -1421,13 +1423,27 @@ static int __init omap2_system_dma_init_dev(struct omap_hwmod *oh, void *user)
 	return 0;
 }
 
+/* dmaengine interface on top of the logical channels, drivers/dma */
+static u64 omap2_dma_engine_dmamask = DMA_BIT_MASK(32);
+
+static struct platform_device omap2_dma_engine_device = {
+	.name	= "omap-dma-engine",
+	.id	= -1,
+	.dev	= {
+		.dma_mask		= &omap2_dma_engine_dmamask,
+		.coherent_dma_mask	= DMA_BIT_MASK(32),
+	},
+};
+
 static int __init omap2_system_dma_init(void)
 {
 	int ret;
 
 	ret = omap_hwmod_for_each_by_class("dma",
 			omap2_system_dma_init_dev, NULL);
+	if (ret)
+		return ret;
 
-	return ret;
+	return platform_device_register(&omap2_dma_engine_device);
 }
 arch_initcall(omap2_system_dma_init);
@@ -17,6 +17,11 @@
 #ifndef DMM_H
 #define DMM_H
 
+#include <linux/types.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+
 #define DMM_BASE 0x4E000000
 #define DMM_SIZE 0x800
 
@@ -54,6 +59,20 @@
 #define DMM_PEG_PRIO          0x620
 #define DMM_PEG_PRIO_PAT      0x640
 
+/* PAT engine 0 interrupt status bits */
+#define DMM_PAT_IRQ_FILL_DSC0 0x01
+#define DMM_PAT_IRQ_FILL_LST0 0x02
+#define DMM_PAT_IRQ_ERR0      0xFC
+
+/* Number of descriptors in the PAT refill ring */
+#define DMM_PAT_RING_SIZE     256
+/* Number of descriptor chains that can be queued on the refill engine */
+#define DMM_PAT_MAX_CHAINS    32
+/* Number of failed refills remembered for dmm_pat_sync() */
+#define DMM_PAT_MAX_FAIL      8
+/* Time to wait for a chain to complete before giving up (ms) */
+#define DMM_PAT_TIMEOUT_MS    100
+
 /**
  * PAT refill programming mode.
  */
@@ -93,11 +112,60 @@ struct pat {
 	u32 data;
 };
 
+/**
+ * PAT descriptor as fetched by the refill engine in AUTO mode.  Must be
+ * 16-byte aligned.  next_pa is the physical address of the next descriptor
+ * in the chain, or 0 for the last one.
+ */
+struct pat_descr {
+	u32 next_pa;
+	struct pat_area area;
+	struct pat_ctrl ctrl;
+	u32 data;
+};
+
+/**
+ * Descriptor chain queued on the refill engine.
+ */
+struct dmm_chain {
+	u32 seq;			/* sequence number of this chain */
+	u16 first;			/* first descriptor in the ring */
+	u16 count;			/* number of descriptors */
+	bool last;			/* last chain of a refill */
+};
+
+/**
+ * Failed refill, keyed by the sequence number of its last chain
+ */
+struct dmm_fail {
+	u32 seq;
+	s32 err;
+};
+
 /**
  * DMM device data
  */
 struct dmm {
 	void __iomem *base;
+
+	/* descriptor-chained refill engine */
+	s32 irq;			/* PAT irq, negative if MANUAL only */
+	spinlock_t lock;		/* protects the fields below */
+	wait_queue_head_t wait;		/* chain completion and ring space */
+	struct pat_descr *descr;	/* descriptor ring */
+	dma_addr_t descr_pa;
+	u16 d_head;			/* next free descriptor */
+	u16 d_free;			/* number of free descriptors */
+	struct dmm_chain chain[DMM_PAT_MAX_CHAINS];
+	u32 c_head;			/* next chain to queue */
+	u32 c_tail;			/* oldest queued chain */
+	bool busy;			/* chain at c_tail is being refilled */
+	u32 seq;			/* sequence of last queued chain */
+	u32 done;			/* sequence of last completed chain */
+	s32 req_err;			/* error of the refill being retired */
+	struct dmm_fail fail[DMM_PAT_MAX_FAIL];	/* recently failed refills */
+	u32 n_fail;
+	struct mutex q_mtx;		/* keeps the chains of a refill together */
 };
 
 /**
@@ -116,6 +184,25 @@ struct dmm *dmm_pat_init(u32 id);
  */
 s32 dmm_pat_refill(struct dmm *dmm, struct pat *desc, enum pat_mode mode);
 
+/**
+ * Queue a chain of PAT descriptors (linked via their next field) on the
+ * refill engine without waiting for it to complete.  The data pointed to by
+ * the descriptors must remain valid until the refill has completed.
+ * @param dmm   Device data
+ * @param desc  first PAT descriptor of the chain
+ * @param seq   where to store the sequence number to wait for
+ * @return an error status.
+ */
+s32 dmm_pat_refill_async(struct dmm *dmm, struct pat *desc, u32 *seq);
+
+/**
+ * Wait until a refill queued by dmm_pat_refill_async() has completed.
+ * @param dmm   Device data
+ * @param seq   sequence number returned by dmm_pat_refill_async()
+ * @return an error status.
+ */
+s32 dmm_pat_sync(struct dmm *dmm, u32 seq);
+
 /**
  * Clean up the physical address translator.
  * @param dmm    Device data
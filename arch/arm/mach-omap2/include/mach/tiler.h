@@ -24,6 +24,14 @@
 #define TILER_BLOCK_HEIGHT 64
 #define TILER_LENGTH (TILER_WIDTH * TILER_HEIGHT * TILER_PAGE)
 
+/* container views in the system space, one per access mode */
+#define TILER_VIEW_SIZE	(1u << 27)
+#define TILVIEW_8BIT	0x60000000u
+#define TILVIEW_16BIT	(TILVIEW_8BIT + TILER_VIEW_SIZE)
+#define TILVIEW_32BIT	(TILVIEW_16BIT + TILER_VIEW_SIZE)
+#define TILVIEW_PAGE	(TILVIEW_32BIT + TILER_VIEW_SIZE)
+#define TILVIEW_END	(TILVIEW_PAGE + TILER_VIEW_SIZE)
+
 #define TILER_MAX_NUM_BLOCKS 16
 
 #define TILIOC_GBUF  _IOWR('z', 100, u32)
@@ -35,6 +43,8 @@
 #define TILIOC_RBUF  _IOWR('z', 106, u32)
 #define TILIOC_URBUF _IOWR('z', 107, u32)
 #define TILIOC_QUERY_BLK _IOWR('z', 108, u32)
+#define TILIOC_PABUF _IOWR('z', 109, u32)	/* map exported pages; in: ptr
+						   is the export handle */
 
 enum tiler_fmt {
 	TILFMT_MIN     = -1,
@@ -85,6 +95,16 @@ static inline u32 tilfmt_bpp(enum tiler_fmt fmt)
 
 /* Event types */
 #define TILER_DEVICE_CLOSE	0
+#define TILER_BLOCK_MOVED	1	/* data is struct tiler_block_move */
+
+/* a block was moved in the container; both addresses are valid during the
+   notification, the old one is unmapped afterwards */
+struct tiler_block_move {
+	pid_t pid;			/* owner process */
+	u32 gid;			/* owner group */
+	u32 old_ssptr;
+	u32 new_ssptr;
+};
 
 /**
  * Registers a notifier block with TILER driver.
@@ -177,6 +197,51 @@ s32 tiler_map(enum tiler_fmt fmt, u32 width, u32 height, u32 *sys_addr,
 s32 tiler_mapx(enum tiler_fmt fmt, u32 width, u32 height,
 			u32 gid, pid_t pid, u32 *sys_addr, u32 usr_addr);
 
+/* a set of pinned pages exported by a driver, see tiler_export_pa() */
+struct tiler_pa_info {
+	u32 num_pg;			/* number of pages */
+	u32 *mem;			/* physical address of each page */
+	/* called once the pages are no longer exported or mapped */
+	void (*release)(struct tiler_pa_info *pa);
+};
+
+/**
+ * Exports a set of pinned pages (e.g. a video frame of another
+ * driver), so that it can be mapped into a 1D TILER block without
+ * copying: by tiler_map_pa(), or by the TILIOC_PABUF ioctl of the
+ * given process.  The pages must remain valid until pa->release is
+ * called.
+ *
+ * @param pa		pages to export
+ * @param pid		process allowed to map the pages via TILIOC_PABUF,
+ *			or 0 if only kernel users may map them
+ * @param handle	pointer where the export handle will be stored
+ *
+ * @return error status
+ */
+s32 tiler_export_pa(struct tiler_pa_info *pa, pid_t pid, u32 *handle);
+
+/**
+ * Withdraws an export.  Existing mappings remain valid, and
+ * pa->release is called once the last of them is freed.
+ *
+ * @param handle	export handle
+ */
+void tiler_unexport_pa(u32 handle);
+
+/**
+ * Maps exported pages into a 1D TILER block.
+ *
+ * @param handle	export handle
+ * @param gid		group ID
+ * @param pid		process ID
+ * @param sys_addr	pointer where system space (L3) address
+ *			will be stored.
+ *
+ * @return error status
+ */
+s32 tiler_map_pa(u32 handle, u32 gid, pid_t pid, u32 *sys_addr);
+
 /**
  * Free TILER memory.
  *
@@ -189,6 +189,13 @@ static int omap2_mbox_fifo_full(struct omap_mbox *mbox)
 	return mbox_read_reg(fifo->fifo_stat);
 }
 
+static int omap2_mbox_fifo_pending(struct omap_mbox *mbox)
+{
+	struct omap_mbox2_fifo *fifo =
+		&((struct omap_mbox2_priv *)mbox->priv)->tx_fifo;
+	return mbox_read_reg(fifo->msg_stat);
+}
+
 /* Mailbox IRQ handle functions */
 static void omap2_mbox_enable_irq(struct omap_mbox *mbox,
 		omap_mbox_type_t irq)
@@ -281,6 +288,7 @@ static struct omap_mbox_ops omap2_mbox_ops = {
 	.fifo_write	= omap2_mbox_fifo_write,
 	.fifo_empty	= omap2_mbox_fifo_empty,
 	.fifo_full	= omap2_mbox_fifo_full,
+	.fifo_pending	= omap2_mbox_fifo_pending,
 	.enable_irq	= omap2_mbox_enable_irq,
 	.disable_irq	= omap2_mbox_disable_irq,
 	.ack_irq	= omap2_mbox_ack_irq,
@@ -302,6 +310,7 @@ static struct omap_mbox2_priv omap2_mbox_dsp_priv = {
 	.tx_fifo = {
 		.msg		= MAILBOX_MESSAGE(0),
 		.fifo_stat	= MAILBOX_FIFOSTATUS(0),
+		.msg_stat	= MAILBOX_MSGSTATUS(0),
 	},
 	.rx_fifo = {
 		.msg		= MAILBOX_MESSAGE(1),
@@ -322,6 +331,7 @@ static struct omap_mbox2_priv omap2_mbox_1_priv = {
 	.tx_fifo = {
 		.msg		= MAILBOX_MESSAGE(0),
 		.fifo_stat	= MAILBOX_FIFOSTATUS(0),
+		.msg_stat	= MAILBOX_MSGSTATUS(0),
 	},
 	.rx_fifo = {
 		.msg		= MAILBOX_MESSAGE(1),
@@ -352,6 +362,7 @@ static struct omap_mbox2_priv omap2_mbox_2_priv = {
 	.tx_fifo = {
 		.msg		= MAILBOX_MESSAGE(3),
 		.fifo_stat	= MAILBOX_FIFOSTATUS(3),
+		.msg_stat	= MAILBOX_MSGSTATUS(3),
 	},
 	.rx_fifo = {
 		.msg		= MAILBOX_MESSAGE(2),
@@ -377,6 +388,7 @@ static struct omap_mbox2_priv omap2_mbox_iva_priv = {
 	.tx_fifo = {
 		.msg		= MAILBOX_MESSAGE(2),
 		.fifo_stat	= MAILBOX_FIFOSTATUS(2),
+		.msg_stat	= MAILBOX_MSGSTATUS(2),
 	},
 	.rx_fifo = {
 		.msg		= MAILBOX_MESSAGE(3),
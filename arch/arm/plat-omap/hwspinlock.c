@@ -47,6 +47,11 @@
  *      ACQUIRED.  This is a non-blocking function
  * int hwspinlock_unlock(struct hwspinlock *);
  *      Unlock a hardware spinlock.
+ * int hwspinlock_lock_prepare(struct hwspinlock *);
+ * int hwspinlock_lock_poll(struct hwspinlock *);
+ *      For callers waiting on a lock their own way: prepare powers the
+ *      module once, then each poll is a single attempt, returning BUSY or
+ *      ACQUIRED like trylock.  Once acquired, unlock as usual.
  *
  * struct hwspinlock *hwspinlock_request(void);
  *      Provides for "dynamic allocation" of a hardware spinlock.  It returns
@@ -152,6 +157,30 @@ int hwspinlock_trylock(struct hwspinlock *handle)
 }
 EXPORT_SYMBOL(hwspinlock_trylock);
 
+/* Power the module for hwspinlock_lock_poll(), until the next unlock */
+int hwspinlock_lock_prepare(struct hwspinlock *handle)
+{
+	if (WARN_ON(handle == NULL))
+		return -EINVAL;
+
+	if (WARN_ON(in_irq()))
+		return -EPERM;
+
+	if (pm_runtime_get_sync(&handle->pdev->dev) < 0)
+		return -ENODEV;
+
+	return 0;
+}
+EXPORT_SYMBOL(hwspinlock_lock_prepare);
+
+/* Attempt to acquire a spinlock once, after hwspinlock_lock_prepare() */
+int hwspinlock_lock_poll(struct hwspinlock *handle)
+{
+	/* Attempt to acquire the lock by reading from it */
+	return readl(handle->lock_reg);
+}
+EXPORT_SYMBOL(hwspinlock_lock_poll);
+
 /* Release a spinlock */
 int hwspinlock_unlock(struct hwspinlock *handle)
 {
@@ -566,6 +566,12 @@ struct omap_overlay_manager {
 	int (*wait_for_go)(struct omap_overlay_manager *mgr);
 	int (*wait_for_vsync)(struct omap_overlay_manager *mgr);
 
+	/* queued apply: returns a fence done once the configuration is in
+	 * use, without waiting for the previous one */
+	int (*apply_async)(struct omap_overlay_manager *mgr, u32 *fence);
+	bool (*fence_done)(struct omap_overlay_manager *mgr, u32 fence);
+	int (*wait_for_fence)(struct omap_overlay_manager *mgr, u32 fence);
+
 	int (*enable)(struct omap_overlay_manager *mgr);
 	int (*disable)(struct omap_overlay_manager *mgr);
 };
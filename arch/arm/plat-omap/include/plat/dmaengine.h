@@ -0,0 +1,51 @@
+/*
+ * arch/arm/plat-omap/include/plat/dmaengine.h
+ *
+ * dmaengine interface of the OMAP system DMA
+ *
+ * Copyright (C) 2010 Texas Instruments
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __ASM_ARCH_OMAP_DMAENGINE_H
+#define __ASM_ARCH_OMAP_DMAENGINE_H
+
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+
+#include <plat/dma.h>
+
+/*
+ * Slave configuration of an "omap-dma-engine" channel.  A client sets it
+ * as chan->private from its dma_request_channel() filter function; it
+ * must stay valid until the channel is released.
+ */
+struct omap_dma_slave {
+	int dma_req;		/* sDMA request line, e.g. OMAP44XX_DMA_... */
+	dma_addr_t dev_addr;	/* physical address of the device FIFO */
+	int data_type;		/* OMAP_DMA_DATA_TYPE_S8/S16/S32 */
+	int sync_mode;		/* OMAP_DMA_SYNC_ELEMENT or _FRAME */
+	u32 frame_len;		/* elements per request in frame sync */
+	enum omap_dma_burst_mode burst_mode;	/* memory side burst */
+};
+
+/**
+ * omap_dma_prep_cyclic - prepare a cyclic slave transfer
+ * @chan:	slave channel of the "omap-dma-engine" provider
+ * @buf_addr:	DMA address of the ring buffer
+ * @buf_len:	length of the ring buffer, a multiple of @period_len
+ * @period_len:	length of one period
+ * @direction:	DMA_TO_DEVICE or DMA_FROM_DEVICE
+ *
+ * The transfer wraps around the ring buffer until it is terminated with
+ * DMA_TERMINATE_ALL, and the descriptor callback is called once per
+ * period.  Submit and issue it like any other descriptor.
+ */
+struct dma_async_tx_descriptor *omap_dma_prep_cyclic(struct dma_chan *chan,
+		dma_addr_t buf_addr, size_t buf_len, size_t period_len,
+		enum dma_data_direction direction);
+
+#endif /* __ASM_ARCH_OMAP_DMAENGINE_H */
@@ -21,6 +21,8 @@ struct hwspinlock;
 int hwspinlock_lock(struct hwspinlock *handle);
 int hwspinlock_trylock(struct hwspinlock *handle);
 int hwspinlock_unlock(struct hwspinlock *handle);
+int hwspinlock_lock_prepare(struct hwspinlock *handle);
+int hwspinlock_lock_poll(struct hwspinlock *handle);
 
 struct hwspinlock *hwspinlock_request(void);
 struct hwspinlock *hwspinlock_request_specific(unsigned int id);
@@ -170,7 +170,10 @@ extern void flush_iotlb_range(struct iommu *obj, u32 start, u32 end);
 extern void flush_iotlb_all(struct iommu *obj);
 
 extern int iopgtable_store_entry(struct iommu *obj, struct iotlb_entry *e);
+extern int iopgtable_store_entries(struct iommu *obj, struct iotlb_entry *e,
+				   int n);
 extern size_t iopgtable_clear_entry(struct iommu *obj, u32 iova);
+extern size_t iopgtable_clear_range(struct iommu *obj, u32 start, u32 end);
 extern void iopgtable_clear_entry_all(struct iommu *obj);
 
 extern struct iommu *iommu_get(const char *name);
@@ -23,6 +23,19 @@ typedef int __bitwise omap_mbox_type_t;
 
 #define MBOX_KFIFO_SIZE        (256)
 
+#define MBOX_HIST_BUCKETS	16
+#define MBOX_TX_DEPTH		4	/* messages in the mailbox tx fifo */
+
+/* latency histograms: bucket n > 0 counts [2^(n-1), 2^n) us */
+struct omap_mbox_stats {
+	u32	rx_lat[MBOX_HIST_BUCKETS];	/* rx interrupt to callback */
+	u32	tx_lat[MBOX_HIST_BUCKETS];	/* send to read by the remote */
+	u32	rx;		/* messages delivered by the irq thread */
+	u32	rx_deferred;	/* messages delivered from the workqueue */
+	u32	tx_direct;	/* messages written by omap_mbox_msg_send */
+	u32	tx_queued;	/* messages written by the tx tasklet */
+};
+
 struct omap_mbox_ops {
 	omap_mbox_type_t	type;
 	int		(*startup)(struct omap_mbox *mbox);
@@ -32,6 +45,8 @@ struct omap_mbox_ops {
 	void		(*fifo_write)(struct omap_mbox *mbox, mbox_msg_t msg);
 	int		(*fifo_empty)(struct omap_mbox *mbox);
 	int		(*fifo_full)(struct omap_mbox *mbox);
+	/* messages not yet read from the tx fifo, optional */
+	int		(*fifo_pending)(struct omap_mbox *mbox);
 	/* irq */
 	void		(*enable_irq)(struct omap_mbox *mbox,
 						omap_mbox_irq_t irq);
@@ -52,6 +67,7 @@ struct omap_mbox_queue {
 	int	(*callback)(void *);
 	struct omap_mbox	*mbox;
 	bool full;
+	bool overflow;		/* rx: the work delivers, not the irq thread */
 };
 
 struct omap_mbox {
@@ -75,6 +91,13 @@ struct omap_mbox {
 	int			nr_mbox_users;
 	int			nr_mbox;
 	struct blocking_notifier_head	notifier;
+
+	spinlock_t		stats_lock;
+	struct omap_mbox_stats	stats;
+	/* send stamps of the messages in the tx fifo, under txq->lock */
+	u32			tx_stamp[MBOX_TX_DEPTH];
+	unsigned int		tx_head, tx_inflight;
+	struct dentry		*dbgfs;
 };
 
 int omap_mbox_msg_send(struct omap_mbox *, mbox_msg_t msg);
@@ -27,10 +27,21 @@
 #define OMAP_VRAM_MEMTYPE_SRAM		1
 #define OMAP_VRAM_MEMTYPE_MAX		1
 
+/* callbacks of an allocation the VRAM manager may move, see
+ * omap_vram_set_migratable() */
+struct omap_vram_migrate_ops {
+	/* stop using the memory, or return an error if it is busy */
+	int (*prepare)(void *data);
+	/* use the memory at paddr, where it has been copied, from now on */
+	void (*done)(void *data, unsigned long paddr);
+};
+
 extern int omap_vram_add_region(unsigned long paddr, size_t size);
 extern int omap_vram_free(unsigned long paddr, size_t size);
 extern int omap_vram_alloc(int mtype, size_t size, unsigned long *paddr);
 extern int omap_vram_reserve(unsigned long paddr, size_t size);
+extern int omap_vram_set_migratable(unsigned long paddr,
+		const struct omap_vram_migrate_ops *ops, void *data);
 extern void omap_vram_get_info(unsigned long *vram, unsigned long *free_vram,
 		unsigned long *largest_free_block);
 
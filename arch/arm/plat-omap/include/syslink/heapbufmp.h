@@ -165,6 +165,15 @@ struct heapbufmp_extended_stats {
 	/* maximum number of blocks allocated from this heap instance */
 	u32 num_allocated_blocks;
 	/* total number of blocks currently allocated from this heap instance*/
+	/* The fields below are not returned to user space */
+	u32 num_cached_blocks;
+	/* number of free blocks held in the per-CPU caches of this processor */
+	u32 cache_hits;
+	/* number of allocs and frees served by the per-CPU caches */
+	u32 cache_refills;
+	/* number of batches moved from the shared free list to a cache */
+	u32 cache_flushes;
+	/* number of batches moved from a cache to the shared free list */
 };
 
 /* =============================================================================
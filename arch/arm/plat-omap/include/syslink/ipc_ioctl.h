@@ -34,7 +34,7 @@ enum ipc_command_count {
 	SHAREDREGION_CMD_NOS = 13,
 	GATEMP_CMD_NOS = 13,
 	LISTMP_CMD_NOS = 19,
-	MESSAGEQ_CMD_NOS = 19,
+	MESSAGEQ_CMD_NOS = 20,
 	IPC_CMD_NOS = 5,
 	SYSMEMMGR_CMD_NOS = 6,
 	HEAPMEMMP_CMD_NOS = 15,
@@ -137,6 +137,12 @@ int listmp_put_head(void *listmp_handle, struct listmp_elem *elem);
 /* Function to put tail element into list */
 int listmp_put_tail(void *listmp_handle, struct listmp_elem *elem);
 
+/* Function to get up to n elements from the head of the list at once */
+int listmp_get_head_many(void *listmp_handle, void **elems, u32 n);
+
+/* Function to put n elements at the tail of the list at once */
+int listmp_put_tail_many(void *listmp_handle, void **elems, u32 n);
+
 /* Function to traverse to remove element from list */
 int listmp_remove(void *listmp_handle, struct listmp_elem *elem);
 
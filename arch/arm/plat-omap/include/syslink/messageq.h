@@ -367,6 +367,12 @@ void messageq_static_msg_init(messageq_msg msg, u32 size);
 /* Place a message onto a message queue */
 int messageq_put(u32 queueId, messageq_msg msg);
 
+/* Put several messages in the same queue.  Each run of remote messages
+ * whose priority selects the same transport is passed to it in one go,
+ * which notifies the remote processor at most once if it supports it.
+ * Returns the number of messages put. */
+int messageq_put_many(u32 queue_id, messageq_msg *msgs, u32 n);
+
 /* Gets a message for a message queue and blocks if the queue is empty */
 int messageq_get(void *messageq_handle, messageq_msg *msg, u32 timeout);
 
@@ -434,10 +440,23 @@ void messageq_set_msg_pri(messageq_msg msg, u32 priority);
  *  APIs called internally by MessageQ transports
  * =============================================================================
  */
-/* Register a transport with MessageQ */
+/* Functions through which MessageQ uses a transport */
+struct messageq_transport_fxns {
+	int (*put)(void *handle, void *msg);
+	/*!< Send one message */
+	int (*put_many)(void *handle, void **msgs, u32 n);
+	/*!< Optional: send several messages, returns the number sent */
+};
+
+/* Register a shared memory list transport (transportshm) with MessageQ */
 int messageq_register_transport(void *imessageq_transport_handle,
 					u16 proc_id, u32 priority);
 
+/* Register a transport with its own functions with MessageQ */
+int messageq_register_transport_fxns(void *imessageq_transport_handle,
+				u16 proc_id, u32 priority,
+				const struct messageq_transport_fxns *fxns);
+
 /* Unregister a transport with MessageQ */
 void messageq_unregister_transport(u16 proc_id, u32 priority);
 
@@ -51,7 +51,8 @@ enum messageq_drv_cmd {
 	MESSAGEQ_DETACH,
 	MESSAGEQ_GET,
 	MESSAGEQ_SHAREDMEMREQ,
-	MESSAGEQ_UNBLOCK
+	MESSAGEQ_UNBLOCK,
+	MESSAGEQ_PUTMANY
 };
 
 /*  ----------------------------------------------------------------------------
@@ -121,6 +122,11 @@ enum messageq_drv_cmd {
 			_IOWR(MESSAGEQ_IOC_MAGIC, MESSAGEQ_PUT, \
 			struct messageq_cmd_args)
 
+/* Command for messageq_put_many */
+#define CMD_MESSAGEQ_PUTMANY \
+			_IOWR(MESSAGEQ_IOC_MAGIC, MESSAGEQ_PUTMANY, \
+			struct messageq_cmd_args)
+
 /* Command for messageq_unblock */
 #define CMD_MESSAGEQ_UNBLOCK \
 			_IOWR(MESSAGEQ_IOC_MAGIC, MESSAGEQ_UNBLOCK, \
@@ -221,6 +227,13 @@ struct messageq_cmd_args {
 			u32 *msg_srptr;
 		} put;
 
+		struct {
+			u32 queue_id;
+			u32 **msg_srptrs;
+			u32 num_msgs;
+			u32 num_put;
+		} put_many;
+
 		struct {
 			void *heap_handle;
 			u16 heap_id;
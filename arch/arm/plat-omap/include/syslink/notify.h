@@ -134,6 +134,10 @@ void notify_restore(u16 proc_id, u16 line_id, u32 key);
 int notify_send_event(u16 proc_id, u16 line_id, u32 event_id, u32 payload,
 			bool wait_clear);
 
+/* Function to send several events to other processor at once */
+int notify_send_events(u16 proc_id, u16 line_id, u32 *event_ids,
+			u32 *payloads, u32 num_events, bool wait_clear);
+
 /* Function to unregister an event */
 int notify_unregister_event(u16 proc_id, u16 line_id, u32 event_id,
 			notify_fn_notify_cbck notify_callback_fxn,
@@ -53,6 +53,9 @@ struct notify_driver_fxn_table {
 	int (*send_event)(struct notify_driver_object *handle, u32 event_id,
 						u32 payload, bool wait_clear);
 	/* interface function send_event */
+	int (*send_events)(struct notify_driver_object *handle, u32 *event_ids,
+				u32 *payloads, u32 num_events, bool wait_clear);
+	/* interface function send_events, NULL if the driver cannot batch */
 	u32 (*disable)(struct notify_driver_object *handle);
 	/* interface function disable */
 	void (*enable)(struct notify_driver_object *handle);
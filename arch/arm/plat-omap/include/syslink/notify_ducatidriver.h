@@ -123,6 +123,11 @@ int notify_ducatidrv_unregister_event(struct notify_driver_object *handle,
 int notify_ducatidrv_send_event(struct notify_driver_object *handle,
 				u32 event_id, u32 payload, bool wait_clear);
 
+/* Send several events with a single interrupt to the remote processor. */
+int notify_ducatidrv_send_events(struct notify_driver_object *handle,
+				u32 *event_ids, u32 *payloads, u32 num_events,
+				bool wait_clear);
+
 /* Disable all events for this Notify driver. */
 int notify_ducatidrv_disable(struct notify_driver_object *handle);
 
@@ -157,6 +157,57 @@ struct proc_mgr_proc_info {
 	/* Configuration of memory regions */
 };
 
+/*
+ * Maximum number of segments loaded by one proc_mgr_load_segments() call.
+ */
+#define PROCMGR_MAX_LOAD_SEGMENTS	64
+
+/*
+ * Flag for proc_mgr_load_segments(): release the slave from reset once all
+ * the segments are loaded.
+ */
+#define PROC_MGR_LOAD_START		0x1
+
+/*
+ *   Segment of a slave executable to be loaded by the kernel.
+ */
+struct proc_mgr_load_segment {
+	u32 da;
+	/* Slave virtual address the segment is loaded at */
+	u32 size;
+	/* Size of the segment in the slave memory, in bytes */
+	void *buffer;
+	/* User space buffer holding the initialized part of the segment, may
+	 * be NULL if the segment is all zeroes. */
+	u32 buffer_size;
+	/* Bytes taken from buffer, the rest of the segment is zero filled */
+};
+
+/*
+ *   Duration of each phase of the last proc_mgr_load_segments() call, in
+ *   microseconds.
+ */
+struct proc_mgr_load_stats {
+	u32 map_us;
+	/* Mapping the memory regions in the slave MMU */
+	u32 copy_us;
+	/* Copying the segments, not counting cache maintenance */
+	u32 flush_us;
+	/* Cleaning the staging buffers out of the CPU caches */
+	u32 reset_us;
+	/* Releasing the slave from reset */
+	u32 total_us;
+	/* Whole call */
+	u32 num_segments;
+	/* Number of segments loaded */
+	u32 num_bytes;
+	/* Number of bytes written to the slave memory */
+	u32 num_map_entries;
+	/* Slave MMU entries written, 0 if the regions were already mapped */
+	u32 dma;
+	/* Non-zero if the segments were copied by sDMA rather than the CPU */
+};
+
 
 /*
  * Function pointer type that is passed to the proc_mgr_registerNotify function
@@ -241,4 +292,23 @@ int proc_mgr_get_proc_info(void *handle, struct proc_mgr_proc_info *proc_info);
 int proc_mgr_virt_to_phys(void *handle, u32 da, u32 *mapped_entries,
 						u32 num_of_entries);
 
+/* Function that returns the processor ID of a ProcMgr instance */
+u16 proc_mgr_get_proc_id(void *handle);
+
+/* Function to load the segments of a slave executable and optionally
+ * release the slave from reset.
+ */
+int proc_mgr_load_segments(void *handle, struct proc_mgr_load_segment *segs,
+			u32 num_segs, u32 flags, struct proc_mgr_load_stats *stats);
+
+/* Function that returns the phase timings of the last load of the slave */
+int proc_mgr_get_load_stats(void *handle, struct proc_mgr_load_stats *stats);
+
+/* Function to remove the slave MMU entries written by the loader */
+void proc_mgr_load_unmap(u16 proc_id);
+
+/* Functions to set up and tear down the in-kernel loader */
+void proc_mgr_load_init(void);
+void proc_mgr_load_exit(void);
+
 #endif
@@ -0,0 +1,88 @@
+/*
+ *  transportring.h
+ *
+ *  Shared memory ring based physical transport for
+ *  communication with the remote processor.
+ *
+ *  Messages are passed by their SharedRegion pointer through one
+ *  single-producer/single-consumer ring per direction, so neither the
+ *  message nor a shared list gate is touched on the way.  The remote
+ *  processor is only notified when its ring goes from empty to non-empty,
+ *  and several messages can be queued with a single notification.
+ *
+ *  The remote processor must run the matching ring transport on the same
+ *  notify event; the shared memory layout is described in transportring.c.
+ *
+ *  Copyright (C) 2010 Texas Instruments, Inc.
+ *
+ *  This package is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ *  WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE.
+ */
+
+#ifndef _TRANSPORTRING_H_
+#define _TRANSPORTRING_H_
+
+/* Standard headers */
+#include <linux/types.h>
+
+/* =============================================================================
+ * Structures & Enums
+ * =============================================================================
+ */
+/*
+ *  Structure defining config parameters for the transport instances.
+ */
+struct transportring_params {
+	u32 priority;
+	/*<  Priority of messages supported by this transport */
+	void *shared_addr;
+	/*<  Address of the shared memory. The creator must supply the shared
+	*    memory that this will use for maintain shared state information.
+	*/
+	u32 notify_event_id;
+	/*<  Notify event number to be used by the transport */
+	u32 num_slots;
+	/*<  Number of messages each ring can hold, must be a power of 2 */
+};
+
+/* =============================================================================
+ *  APIs called by applications
+ * =============================================================================
+ */
+/* Get the default parameters for the ring transport. */
+void transportring_params_init(struct transportring_params *params);
+
+/* Create an instance of the ring transport. */
+void *transportring_create(u16 proc_id,
+			const struct transportring_params *params);
+
+/* Delete an instance of the ring transport. */
+int transportring_delete(void **handle_ptr);
+
+/* Open a created ring transport instance by address */
+int transportring_open_by_addr(void *shared_addr, void **handle_ptr);
+
+/* Close an opened instance */
+int transportring_close(void **handle_ptr);
+
+/* Get the shared memory requirements for the ring transport. */
+u32 transportring_shared_mem_req(const struct transportring_params *params);
+
+/* =============================================================================
+ *  APIs called internally by MessageQ
+ * =============================================================================
+ */
+/* Put msg to the remote ring */
+int transportring_put(void *handle, void *msg);
+
+/* Put several msgs to the remote ring, notifying the remote at most once.
+ * Returns the number of messages queued. */
+int transportring_put_many(void *handle, void **msgs, u32 n);
+
+#endif /* _TRANSPORTRING_H_ */
@@ -340,17 +340,43 @@ EXPORT_SYMBOL_GPL(flush_iotlb_page);
  * @start:	iommu device virtual address(start)
  * @end:	iommu device virtual address(end)
  *
- * Clear an iommu tlb entry which includes 'da' address.
+ * Clear all iommu tlb entries which overlap [start, end).  The tlb is
+ * walked once whatever the size of the range, and each entry is matched
+ * with the size of the page it maps, so that 64KB, 1MB and 16MB entries
+ * covering the range are dropped as well.
  **/
 void flush_iotlb_range(struct iommu *obj, u32 start, u32 end)
 {
-	u32 da = start;
+	int i;
+	struct cr_regs cr;
+	struct iotlb_lock l;
 
-	while (da < end) {
-		flush_iotlb_page(obj, da);
-		/* FIXME: Optimize for multiple page size */
-		da += IOPTE_SIZE;
+	if (start >= end)
+		return;
+
+	iotlb_lock_get(obj, &l);
+
+	for_each_iotlb_cr(obj, obj->nr_tlb_entries, i, cr) {
+		u32 s;
+		size_t bytes;
+
+		if (!iotlb_cr_valid(&cr))
+			continue;
+
+		s = iotlb_cr_to_virt(&cr);
+		bytes = iopgsz_to_bytes(cr.cam & 3);
+
+		/* compare last addresses, ranges may end at 4GB */
+		if (s <= end - 1 && start <= s + bytes - 1) {
+			dev_dbg(obj->dev, "%s: %08x(%x) in %08x-%08x\n",
+				__func__, s, bytes, start, end);
+			iotlb_load_cr(obj, &cr);
+			iommu_write_reg(obj, 1, MMU_FLUSH_ENTRY);
+		}
 	}
+
+	/* the walk moved the victim, put it back for load_iotlb_entry() */
+	iotlb_lock_set(obj, &l);
 }
 EXPORT_SYMBOL_GPL(flush_iotlb_range);
 
@@ -701,6 +727,38 @@ int iopgtable_store_entry(struct iommu *obj, struct iotlb_entry *e)
 }
 EXPORT_SYMBOL_GPL(iopgtable_store_entry);
 
+/**
+ * iopgtable_store_entries - Make a batch of iommu pte entries
+ * @obj:	target iommu
+ * @e:		array of iommu tlb entry info, in increasing 'da' order
+ * @n:		number of entries
+ *
+ * Same as calling iopgtable_store_entry() for each entry, but the tlb
+ * is flushed once for the whole range spanned by the batch.  On error,
+ * the entries before the failing one stay mapped.
+ **/
+int iopgtable_store_entries(struct iommu *obj, struct iotlb_entry *e, int n)
+{
+	int i, err = 0;
+
+	if (!obj || !e || n <= 0)
+		return -EINVAL;
+
+	flush_iotlb_range(obj, e[0].da,
+			  e[n - 1].da + iopgsz_to_bytes(e[n - 1].pgsz));
+
+	for (i = 0; i < n; i++) {
+		err = iopgtable_store_entry_core(obj, &e[i]);
+		if (err)
+			break;
+#ifdef PREFETCH_IOTLB
+		load_iotlb_entry(obj, &e[i]);
+#endif
+	}
+	return err;
+}
+EXPORT_SYMBOL_GPL(iopgtable_store_entries);
+
 /**
  * iopgtable_lookup_entry - Lookup an iommu pte entry
  * @obj:	target iommu
@@ -792,6 +850,41 @@ size_t iopgtable_clear_entry(struct iommu *obj, u32 da)
 }
 EXPORT_SYMBOL_GPL(iopgtable_clear_entry);
 
+/**
+ * iopgtable_clear_range - Remove the iommu pte entries of a range
+ * @obj:	target iommu
+ * @start:	iommu device virtual address(start)
+ * @end:	iommu device virtual address(end)
+ *
+ * Remove all entries mapping [start, end), whatever their page size, and
+ * flush the tlb once for the whole range.  Returns the number of bytes
+ * which were unmapped.
+ **/
+size_t iopgtable_clear_range(struct iommu *obj, u32 start, u32 end)
+{
+	size_t bytes, total = 0;
+	u32 da = start;
+
+	while (da < end) {
+		spin_lock(&obj->page_table_lock);
+		bytes = iopgtable_clear_entry_core(obj, da);
+		spin_unlock(&obj->page_table_lock);
+
+		total += bytes;
+		/* step over the whole page, 'da' may not be its 1st address */
+		if (!bytes)
+			bytes = IOPTE_SIZE;
+		if ((da & ~(bytes - 1)) + bytes <= da)
+			break;		/* wrapped at 4GB */
+		da = (da & ~(bytes - 1)) + bytes;
+	}
+
+	flush_iotlb_range(obj, start, end);
+
+	return total;
+}
+EXPORT_SYMBOL_GPL(iopgtable_clear_range);
+
 void iopgtable_clear_entry_all(struct iommu *obj)
 {
 	int i;
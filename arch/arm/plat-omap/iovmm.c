@@ -85,6 +85,47 @@ static size_t sgtable_len(const struct sg_table *sgt)
 }
 #define sgtable_ok(x)	(!!sgtable_len(x))
 
+/* largest iommu page size mapping 'pa' at 'da' within 'len' bytes */
+static size_t iopgsz_fit(u32 da, u32 pa, size_t len)
+{
+	static const size_t pagesize[] = { SZ_16M, SZ_1M, SZ_64K, SZ_4K, };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pagesize); i++)
+		if (len >= pagesize[i] && IS_ALIGNED(da | pa, pagesize[i]))
+			return pagesize[i];
+	return 0;
+}
+
+/* length of the physically contiguous run of sg entries starting at 'sg' */
+static size_t sgtable_run(struct scatterlist **sg, unsigned int *i,
+			  unsigned int nents)
+{
+	u32 pa = sg_phys(*sg);
+	size_t len = sg_dma_len(*sg);
+
+	while (*i + 1 < nents && sg_phys(sg_next(*sg)) == pa + len) {
+		*sg = sg_next(*sg);
+		(*i)++;
+		len += sg_dma_len(*sg);
+	}
+	return len;
+}
+
+/*
+ * da alignment which lets the first physically contiguous run of 'sgt'
+ * be mapped with the largest iommu pages
+ */
+static u32 sgtable_align(const struct sg_table *sgt)
+{
+	struct scatterlist *sg = sgt->sgl;
+	unsigned int i = 0;
+	u32 pa = sg_phys(sg);
+
+	return max_t(u32, iopgsz_fit(pa, pa, sgtable_run(&sg, &i, sgt->nents)),
+		     PAGE_SIZE);
+}
+
 /*
  * calculate the optimal number sg elements from total bytes based on
  * iommu superpages
@@ -259,7 +300,7 @@ EXPORT_SYMBOL_GPL(find_iovm_area);
  * in iovmas mmap, and returns the new allocated iovma.
  */
 static struct iovm_struct *alloc_iovm_area(struct iommu *obj, u32 da,
-					   size_t bytes, u32 flags)
+					   size_t bytes, u32 flags, u32 align)
 {
 	struct iovm_struct *new, *tmp;
 	u32 start, prev_end, alignement;
@@ -275,6 +316,8 @@ static struct iovm_struct *alloc_iovm_area(struct iommu *obj, u32 da,
 		start = PAGE_SIZE;
 		if (flags & IOVMF_LINEAR)
 			alignement = iopgsz_max(bytes);
+		else
+			alignement = align;
 		start = roundup(start, alignement);
 	}
 	tmp = NULL;
@@ -434,13 +477,27 @@ static inline void sgtable_drain_kmalloc(struct sg_table *sgt)
 	BUG_ON(!sgt);
 }
 
-/* create 'da' <-> 'pa' mapping from 'sgt' */
+/*
+ * Entries are stored in batches of this size, which bounds the stack use
+ * and the number of tlb flushes alike.
+ */
+#define IOVM_MAP_BATCH	16
+
+/*
+ * create 'da' <-> 'pa' mapping from 'sgt'
+ *
+ * Physically contiguous sg entries are merged, and each run is mapped
+ * with the largest pages the alignment of 'da' and 'pa' allows, so that a
+ * buffer made of 4KB entries still gets 64KB, 1MB or 16MB tlb entries
+ * wherever possible.
+ */
 static int map_iovm_area(struct iommu *obj, struct iovm_struct *new,
 			 const struct sg_table *sgt, u32 flags)
 {
-	int err = 0;
-	unsigned int i, j;
+	int err = 0, n = 0;
+	unsigned int i;
 	struct scatterlist *sg;
+	struct iotlb_entry e[IOVM_MAP_BATCH];
 	u32 da = new->da_start;
 
 	if (!obj || !sgt)
@@ -448,73 +505,56 @@ static int map_iovm_area(struct iommu *obj, struct iovm_struct *new,
 
 	BUG_ON(!sgtable_ok(sgt));
 
-	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
-		u32 pa;
-		int pgsz;
-		size_t bytes;
-		struct iotlb_entry e;
+	for (i = 0, sg = sgt->sgl; i < sgt->nents; i++, sg = sg_next(sg)) {
+		u32 pa = sg_phys(sg);
+		size_t len = sgtable_run(&sg, &i, sgt->nents);
 
-		pa = sg_phys(sg);
-		bytes = sg_dma_len(sg);
+		while (len) {
+			size_t bytes = iopgsz_fit(da, pa, len);
 
-		flags &= ~IOVMF_PGSZ_MASK;
-		pgsz = bytes_to_iopgsz(bytes);
-		if (pgsz < 0)
-			goto err_out;
-		flags |= pgsz;
+			flags &= ~IOVMF_PGSZ_MASK;
+			flags |= bytes_to_iopgsz(bytes);
+
+			pr_debug("%s: [%d] %08x %08x(%x)\n", __func__,
+				 i, da, pa, bytes);
 
-		pr_debug("%s: [%d] %08x %08x(%x)\n", __func__,
-			 i, da, pa, bytes);
+			iotlb_init_entry(&e[n++], da, pa, flags);
+			da += bytes;
+			pa += bytes;
+			len -= bytes;
 
-		iotlb_init_entry(&e, da, pa, flags);
-		err = iopgtable_store_entry(obj, &e);
+			if (n == IOVM_MAP_BATCH) {
+				err = iopgtable_store_entries(obj, e, n);
+				if (err)
+					goto err_out;
+				n = 0;
+			}
+		}
+	}
+	if (n) {
+		err = iopgtable_store_entries(obj, e, n);
 		if (err)
 			goto err_out;
-
-		da += bytes;
 	}
 	return 0;
 
 err_out:
-	da = new->da_start;
-
-	for_each_sg(sgt->sgl, sg, i, j) {
-		size_t bytes;
-
-		bytes = iopgtable_clear_entry(obj, da);
-
-		BUG_ON(!iopgsz_ok(bytes));
-
-		da += bytes;
-	}
+	/* the range is reserved for us, so unmapped holes are harmless */
+	iopgtable_clear_range(obj, new->da_start, da);
 	return err;
 }
 
 /* release 'da' <-> 'pa' mapping */
 static void unmap_iovm_area(struct iommu *obj, struct iovm_struct *area)
 {
-	u32 start;
 	size_t total = area->da_end - area->da_start;
 
 	BUG_ON((!total) || !IS_ALIGNED(total, PAGE_SIZE));
 
-	start = area->da_start;
-	while (total > 0) {
-		size_t bytes;
-
-		bytes = iopgtable_clear_entry(obj, start);
-		if (bytes == 0)
-			bytes = PAGE_SIZE;
-		else
-			dev_dbg(obj->dev, "%s: unmap %08x(%x) %08x\n",
-				__func__, start, bytes, area->flags);
+	dev_dbg(obj->dev, "%s: unmap %08x(%x) %08x\n",
+		__func__, area->da_start, total, area->flags);
 
-		BUG_ON(!IS_ALIGNED(bytes, PAGE_SIZE));
-
-		total -= bytes;
-		start += bytes;
-	}
-	BUG_ON(total);
+	iopgtable_clear_range(obj, area->da_start, area->da_end);
 }
 
 /* template function for all unmapping */
@@ -564,10 +604,15 @@ static u32 map_iommu_region(struct iommu *obj, u32 da,
 {
 	int err = -ENOMEM;
 	struct iovm_struct *new;
+	u32 align = PAGE_SIZE;
+
+	/* let anonymous mappings start on a large page boundary */
+	if ((flags & IOVMF_DA_ANON) && sgt)
+		align = sgtable_align(sgt);
 
 	mutex_lock(&obj->mmap_lock);
 
-	new = alloc_iovm_area(obj, da, bytes, flags);
+	new = alloc_iovm_area(obj, da, bytes, flags, align);
 	if (IS_ERR(new)) {
 		err = PTR_ERR(new);
 		goto err_alloc_iovma;
@@ -28,15 +28,54 @@
 #include <linux/slab.h>
 #include <linux/kfifo.h>
 #include <linux/notifier.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
 
 #include <plat/mailbox.h>
 
 static struct workqueue_struct *mboxd;
 static struct omap_mbox *mboxes;
 static DEFINE_MUTEX(mboxes_lock);
+static struct dentry *mbox_dbgfs;
 
 static int mbox_configured;
 
+static uint rx_budget = 8;
+module_param(rx_budget, uint, 0644);
+MODULE_PARM_DESC(rx_budget, "Messages delivered per wakeup of the irq thread "
+		 "before the rest are handed to the workqueue");
+
+/* queued message, with the time it was received or sent */
+struct mbox_entry {
+	mbox_msg_t msg;
+	u32 stamp;		/* us */
+};
+
+static inline u32 mbox_stamp(void)
+{
+	return (u32) ktime_to_us(ktime_get());
+}
+
+/* count a message and/or its latency, from any context */
+static void mbox_account(struct omap_mbox *mbox, u32 *count, u32 *hist,
+			 u32 stamp)
+{
+	unsigned long flags;
+	u32 bucket = 0;
+
+	if (hist)
+		bucket = min(fls(mbox_stamp() - stamp), MBOX_HIST_BUCKETS - 1);
+
+	spin_lock_irqsave(&mbox->stats_lock, flags);
+	if (count)
+		(*count)++;
+	if (hist)
+		hist[bucket]++;
+	spin_unlock_irqrestore(&mbox->stats_lock, flags);
+}
+
 /* Mailbox FIFO handle functions */
 static inline mbox_msg_t mbox_fifo_read(struct omap_mbox *mbox)
 {
@@ -55,6 +94,42 @@ static inline int mbox_fifo_full(struct omap_mbox *mbox)
 	return mbox->ops->fifo_full(mbox);
 }
 
+/*
+ * The mailbox has no interrupt for a message being read, only one for
+ * the fifo leaving the full state: a sent message is taken as acked the
+ * first time it is found gone from the tx fifo, from the tx interrupt, the
+ * rx thread or the next write.  Called with the txq lock held.
+ */
+static void mbox_tx_ack(struct omap_mbox *mbox)
+{
+	int pending;
+
+	if (!mbox->ops->fifo_pending)
+		return;
+
+	pending = mbox->ops->fifo_pending(mbox);
+	while (mbox->tx_inflight > pending) {
+		mbox_account(mbox, NULL, mbox->stats.tx_lat,
+			     mbox->tx_stamp[mbox->tx_head]);
+		mbox->tx_head = (mbox->tx_head + 1) % MBOX_TX_DEPTH;
+		mbox->tx_inflight--;
+	}
+}
+
+/* Called with the txq lock held */
+static void mbox_tx_write(struct omap_mbox *mbox, struct mbox_entry *e)
+{
+	unsigned int tail;
+
+	mbox_tx_ack(mbox);
+	mbox_fifo_write(mbox, e->msg);
+
+	if (!mbox->ops->fifo_pending || mbox->tx_inflight == MBOX_TX_DEPTH)
+		return;
+	tail = (mbox->tx_head + mbox->tx_inflight++) % MBOX_TX_DEPTH;
+	mbox->tx_stamp[tail] = e->stamp;
+}
+
 /* Mailbox IRQ handle functions */
 static inline void ack_mbox_irq(struct omap_mbox *mbox, omap_mbox_irq_t irq)
 {
@@ -86,16 +161,27 @@ static int __mbox_poll_for_space(struct omap_mbox *mbox)
 int omap_mbox_msg_send(struct omap_mbox *mbox, mbox_msg_t msg)
 {
 	struct omap_mbox_queue *mq = mbox->txq;
+	struct mbox_entry e = { .msg = msg, .stamp = mbox_stamp() };
+	unsigned long flags;
 	int ret = 0, len;
 
-	spin_lock_bh(&mq->lock);
-	if (kfifo_avail(&mq->fifo) < sizeof(msg)) {
+	/* callers may run in interrupt context */
+	spin_lock_irqsave(&mq->lock, flags);
+
+	/* nothing queued ahead and room in the mailbox: skip the tasklet */
+	if (kfifo_is_empty(&mq->fifo) && !mbox_fifo_full(mbox)) {
+		mbox_tx_write(mbox, &e);
+		mbox_account(mbox, &mbox->stats.tx_direct, NULL, 0);
+		goto out;
+	}
+
+	if (kfifo_avail(&mq->fifo) < sizeof(e)) {
 		ret = -ENOMEM;
 		goto out;
 	}
 
-	len = kfifo_in(&mq->fifo, (unsigned char *)&msg, sizeof(msg));
-	if (unlikely(len != sizeof(msg))) {
+	len = kfifo_in(&mq->fifo, (unsigned char *)&e, sizeof(e));
+	if (unlikely(len != sizeof(e))) {
 		pr_err("%s: kfifo_in anomaly\n", __func__);
 		ret = -ENOMEM;
 	}
@@ -103,7 +189,7 @@ int omap_mbox_msg_send(struct omap_mbox *mbox, mbox_msg_t msg)
 	tasklet_schedule(&mbox->txq->tasklet);
 
 out:
-	spin_unlock_bh(&mq->lock);
+	spin_unlock_irqrestore(&mq->lock, flags);
 	return ret;
 }
 EXPORT_SYMBOL(omap_mbox_msg_send);
@@ -112,52 +198,108 @@ static void mbox_tx_tasklet(unsigned long tx_data)
 {
 	struct omap_mbox *mbox = (struct omap_mbox *)tx_data;
 	struct omap_mbox_queue *mq = mbox->txq;
-	mbox_msg_t msg;
+	struct mbox_entry e;
 	int ret;
 
-	spin_lock(&mq->lock);
+	spin_lock_irq(&mq->lock);
 	while (kfifo_len(&mq->fifo)) {
 		if (__mbox_poll_for_space(mbox)) {
 			omap_mbox_enable_irq(mbox, IRQ_TX);
 			break;
 		}
 
-		ret = kfifo_out(&mq->fifo, (unsigned char *)&msg,
-								sizeof(msg));
-		if (unlikely(ret != sizeof(msg)))
+		ret = kfifo_out(&mq->fifo, (unsigned char *)&e, sizeof(e));
+		if (unlikely(ret != sizeof(e)))
 			pr_err("%s: kfifo_out anomaly\n", __func__);
 
-		mbox_fifo_write(mbox, msg);
-
-
+		mbox_tx_write(mbox, &e);
+		mbox_account(mbox, &mbox->stats.tx_queued, NULL, 0);
 	}
-	spin_unlock(&mq->lock);
+	spin_unlock_irq(&mq->lock);
 }
 
 /*
- * Message receiver(workqueue)
+ * Message receiver: deliver up to budget queued messages, in order.
+ * Returns false if messages are left over.
  */
-static void mbox_rx_work(struct work_struct *work)
+static bool mbox_rx_deliver(struct omap_mbox_queue *mq, u32 *count,
+			    unsigned int budget)
 {
-	struct omap_mbox_queue *mq =
-			container_of(work, struct omap_mbox_queue, work);
-	mbox_msg_t msg;
+	struct omap_mbox *mbox = mq->mbox;
+	struct mbox_entry e;
 	int len;
 
-	while (kfifo_len(&mq->fifo) >= sizeof(msg)) {
-		len = kfifo_out(&mq->fifo, (unsigned char *)&msg, sizeof(msg));
-		if (unlikely(len != sizeof(msg)))
+	while (kfifo_len(&mq->fifo) >= sizeof(e)) {
+		if (!budget--)
+			return false;
+
+		len = kfifo_out(&mq->fifo, (unsigned char *)&e, sizeof(e));
+		if (unlikely(len != sizeof(e)))
 			pr_err("%s: kfifo_out anomaly detected\n", __func__);
 
-		blocking_notifier_call_chain(&mq->mbox->notifier, len,
-							(void *)msg);
+		blocking_notifier_call_chain(&mbox->notifier,
+					sizeof(e.msg), (void *)e.msg);
+		mbox_account(mbox, count, mbox->stats.rx_lat, e.stamp);
 		spin_lock_irq(&mq->lock);
 		if (mq->full) {
 			mq->full = false;
-			omap_mbox_enable_irq(mq->mbox, IRQ_RX);
+			omap_mbox_enable_irq(mbox, IRQ_RX);
 		}
 		spin_unlock_irq(&mq->lock);
 	}
+	return true;
+}
+
+/*
+ * Message receiver(irq thread).  Receivers may sleep, so messages are
+ * delivered here rather than in the interrupt; a burst over rx_budget is
+ * handed to the workqueue, which then delivers until the queue drains.
+ */
+static irqreturn_t mbox_rx_thread(int irq, void *p)
+{
+	struct omap_mbox *mbox = p;
+	struct omap_mbox_queue *mq = mbox->rxq;
+	bool overflow;
+
+	/* a reply means the remote has read what was sent before it */
+	spin_lock_irq(&mbox->txq->lock);
+	mbox_tx_ack(mbox);
+	spin_unlock_irq(&mbox->txq->lock);
+
+	spin_lock_irq(&mq->lock);
+	overflow = mq->overflow;
+	spin_unlock_irq(&mq->lock);
+	if (overflow)
+		return IRQ_HANDLED;
+
+	if (!mbox_rx_deliver(mq, &mbox->stats.rx, rx_budget)) {
+		spin_lock_irq(&mq->lock);
+		mq->overflow = true;
+		spin_unlock_irq(&mq->lock);
+		queue_work(mboxd, &mq->work);
+	}
+	return IRQ_HANDLED;
+}
+
+/*
+ * Message receiver(workqueue), for the overflow of the irq thread
+ */
+static void mbox_rx_work(struct work_struct *work)
+{
+	struct omap_mbox_queue *mq =
+			container_of(work, struct omap_mbox_queue, work);
+	bool done;
+
+	do {
+		mbox_rx_deliver(mq, &mq->mbox->stats.rx_deferred, UINT_MAX);
+
+		/* hand delivery back to the irq thread once drained */
+		spin_lock_irq(&mq->lock);
+		done = kfifo_is_empty(&mq->fifo);
+		if (done)
+			mq->overflow = false;
+		spin_unlock_irq(&mq->lock);
+	} while (!done);
 }
 
 /*
@@ -167,6 +309,7 @@ static void __mbox_tx_interrupt(struct omap_mbox *mbox)
 {
 	struct omap_mbox **tmp;
 	struct omap_mbox *mbox_curr;
+	unsigned long flags;
 
 	tmp = &mboxes;
 	while (*tmp) {
@@ -174,6 +317,9 @@ static void __mbox_tx_interrupt(struct omap_mbox *mbox)
 		if (!mbox_fifo_full(mbox_curr)) {
 			omap_mbox_disable_irq(mbox_curr, IRQ_TX);
 			ack_mbox_irq(mbox_curr, IRQ_TX);
+			spin_lock_irqsave(&mbox_curr->txq->lock, flags);
+			mbox_tx_ack(mbox_curr);
+			spin_unlock_irqrestore(&mbox_curr->txq->lock, flags);
 			tasklet_schedule(&mbox_curr->txq->tasklet);
 		}
 		tmp = &(*tmp)->next;
@@ -183,11 +329,12 @@ static void __mbox_tx_interrupt(struct omap_mbox *mbox)
 static void __mbox_rx_interrupt(struct omap_mbox *mbox)
 {
 	struct omap_mbox_queue *mq;
-	mbox_msg_t msg;
+	struct mbox_entry e;
 	int len;
 	struct omap_mbox **tmp;
 	struct omap_mbox *mbox_curr;
 	bool msg_rx;
+	u32 stamp = mbox_stamp();
 
 	tmp = &mboxes;
 	while (*tmp) {
@@ -196,17 +343,18 @@ static void __mbox_rx_interrupt(struct omap_mbox *mbox)
 		msg_rx = false;
 		while (!mbox_fifo_empty(mbox_curr)) {
 			msg_rx = true;
-			if (unlikely(kfifo_avail(&mq->fifo) < sizeof(msg))) {
+			if (unlikely(kfifo_avail(&mq->fifo) < sizeof(e))) {
 				omap_mbox_disable_irq(mbox_curr, IRQ_RX);
 				mq->full = true;
 				goto nomem;
 			}
 
-			msg = mbox_fifo_read(mbox_curr);
+			e.msg = mbox_fifo_read(mbox_curr);
+			e.stamp = stamp;
 
-			len = kfifo_in(&mq->fifo, (unsigned char *)&msg,
-								sizeof(msg));
-			if (unlikely(len != sizeof(msg)))
+			len = kfifo_in(&mq->fifo, (unsigned char *)&e,
+								sizeof(e));
+			if (unlikely(len != sizeof(e)))
 				pr_err("%s: kfifo_in anomaly detected\n",
 								__func__);
 			if (mbox->ops->type == OMAP_MBOX_TYPE1)
@@ -216,8 +364,6 @@ static void __mbox_rx_interrupt(struct omap_mbox *mbox)
 		if (msg_rx)
 			ack_mbox_irq(mbox_curr, IRQ_RX);
 nomem:
-		queue_work(mboxd, &mbox->rxq->work);
-
 		tmp = &(*tmp)->next;
 	}
 }
@@ -232,12 +378,16 @@ static irqreturn_t mbox_interrupt(int irq, void *p)
 	if (is_mbox_irq(mbox, IRQ_RX))
 		__mbox_rx_interrupt(mbox);
 
+	/* other mailboxes are woken by their own handlers on this line */
+	if (!kfifo_is_empty(&mbox->rxq->fifo))
+		return IRQ_WAKE_THREAD;
 	return IRQ_HANDLED;
 }
 
 static struct omap_mbox_queue *mbox_queue_alloc(struct omap_mbox *mbox,
 					void (*work) (struct work_struct *),
-					void (*tasklet)(unsigned long))
+					void (*tasklet)(unsigned long),
+					unsigned int size)
 {
 	struct omap_mbox_queue *mq;
 
@@ -247,7 +397,7 @@ static struct omap_mbox_queue *mbox_queue_alloc(struct omap_mbox *mbox,
 
 	spin_lock_init(&mq->lock);
 
-	if (kfifo_alloc(&mq->fifo, MBOX_KFIFO_SIZE, GFP_KERNEL))
+	if (kfifo_alloc(&mq->fifo, size, GFP_KERNEL))
 		goto error;
 
 	if (work)
@@ -285,36 +435,41 @@ static int omap_mbox_startup(struct omap_mbox *mbox)
 	}
 
 	if (!mbox->use_count++) {
-		ret = request_irq(mbox->irq, mbox_interrupt, IRQF_SHARED,
-					mbox->name, mbox);
-		if (unlikely(ret)) {
-			printk(KERN_ERR
-			"failed to register mailbox interrupt:%d\n", ret);
-			goto fail_request_irq;
-		}
-		mq = mbox_queue_alloc(mbox, NULL, mbox_tx_tasklet);
+		mq = mbox_queue_alloc(mbox, NULL, mbox_tx_tasklet,
+				      2 * MBOX_KFIFO_SIZE);
 		if (!mq) {
 			ret = -ENOMEM;
 			goto fail_alloc_txq;
 		}
 		mbox->txq = mq;
 
-		mq = mbox_queue_alloc(mbox, mbox_rx_work, NULL);
+		mq = mbox_queue_alloc(mbox, mbox_rx_work, NULL,
+				      4 * MBOX_KFIFO_SIZE);
 		if (!mq) {
 			ret = -ENOMEM;
 			goto fail_alloc_rxq;
 		}
 		mbox->rxq = mq;
 		mq->mbox = mbox;
+		mbox->tx_head = mbox->tx_inflight = 0;
+
+		ret = request_threaded_irq(mbox->irq, mbox_interrupt,
+					   mbox_rx_thread, IRQF_SHARED,
+					   mbox->name, mbox);
+		if (unlikely(ret)) {
+			printk(KERN_ERR
+			"failed to register mailbox interrupt:%d\n", ret);
+			goto fail_request_irq;
+		}
 	}
 	mutex_unlock(&mboxes_lock);
 	return 0;
 
+ fail_request_irq:
+	mbox_queue_free(mbox->rxq);
  fail_alloc_rxq:
 	mbox_queue_free(mbox->txq);
  fail_alloc_txq:
-	free_irq(mbox->irq, mbox);
- fail_request_irq:
 	if (likely(mbox->ops->shutdown))
 		mbox->ops->shutdown(mbox);
 	mbox_configured--;
@@ -328,15 +483,17 @@ static void omap_mbox_fini(struct omap_mbox *mbox)
 	mutex_lock(&mboxes_lock);
 
 	if (!--mbox->use_count) {
+		/* the handler and its thread use this mailbox's queues */
+		free_irq(mbox->irq, mbox);
+		cancel_work_sync(&mbox->rxq->work);
+		tasklet_kill(&mbox->txq->tasklet);
 		mbox_queue_free(mbox->txq);
 		mbox_queue_free(mbox->rxq);
 	}
 
 	if (likely(mbox->ops->shutdown)) {
-		if (!--mbox_configured) {
-			free_irq(mbox->irq, mbox);
+		if (!--mbox_configured)
 			mbox->ops->shutdown(mbox);
-		}
 	}
 
 	mutex_unlock(&mboxes_lock);
@@ -386,6 +543,54 @@ void omap_mbox_put(struct omap_mbox *mbox, struct notifier_block *nb)
 }
 EXPORT_SYMBOL(omap_mbox_put);
 
+static int mbox_stats_show(struct seq_file *s, void *unused)
+{
+	struct omap_mbox *mbox = s->private;
+	struct omap_mbox_stats st;
+	int i;
+
+	spin_lock_irq(&mbox->stats_lock);
+	st = mbox->stats;
+	spin_unlock_irq(&mbox->stats_lock);
+
+	seq_printf(s, "rx: %u irq thread, %u deferred\n", st.rx,
+		   st.rx_deferred);
+	seq_printf(s, "tx: %u direct, %u queued\n", st.tx_direct,
+		   st.tx_queued);
+	seq_printf(s, "\n  latency (us)         rx         tx\n");
+	for (i = 0; i < MBOX_HIST_BUCKETS; i++)
+		seq_printf(s, "%13u%s %10u %10u\n", i ? 1 << (i - 1) : 0,
+			   i == MBOX_HIST_BUCKETS - 1 ? "+" : " ",
+			   st.rx_lat[i], st.tx_lat[i]);
+	return 0;
+}
+
+static int mbox_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mbox_stats_show, inode->i_private);
+}
+
+/* any write resets the statistics */
+static ssize_t mbox_stats_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct omap_mbox *mbox = s->private;
+
+	spin_lock_irq(&mbox->stats_lock);
+	memset(&mbox->stats, 0, sizeof(mbox->stats));
+	spin_unlock_irq(&mbox->stats_lock);
+	return count;
+}
+
+static const struct file_operations mbox_stats_fops = {
+	.open		= mbox_stats_open,
+	.read		= seq_read,
+	.write		= mbox_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 int omap_mbox_register(struct device *parent, struct omap_mbox *mbox)
 {
 	int ret = 0;
@@ -405,6 +610,14 @@ int omap_mbox_register(struct device *parent, struct omap_mbox *mbox)
 	}
 	*tmp = mbox;
 	BLOCKING_INIT_NOTIFIER_HEAD(&mbox->notifier);
+	spin_lock_init(&mbox->stats_lock);
+
+	if (!mbox_dbgfs)
+		mbox_dbgfs = debugfs_create_dir("mailbox", NULL);
+	if (!IS_ERR_OR_NULL(mbox_dbgfs))
+		mbox->dbgfs = debugfs_create_file(mbox->name,
+				S_IRUGO | S_IWUSR, mbox_dbgfs, mbox,
+				&mbox_stats_fops);
 	mutex_unlock(&mboxes_lock);
 
 	return 0;
@@ -424,6 +637,8 @@ int omap_mbox_unregister(struct omap_mbox *mbox)
 		if (mbox == *tmp) {
 			*tmp = mbox->next;
 			mbox->next = NULL;
+			debugfs_remove(mbox->dbgfs);
+			mbox->dbgfs = NULL;
 			mutex_unlock(&mboxes_lock);
 			return 0;
 		}
@@ -447,6 +662,7 @@ module_init(omap_mbox_init);
 
 static void __exit omap_mbox_exit(void)
 {
+	debugfs_remove_recursive(mbox_dbgfs);
 	destroy_workqueue(mboxd);
 }
 module_exit(omap_mbox_exit);
@@ -11,6 +11,8 @@
 #include <linux/dmaengine.h>
 #include <linux/init.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/random.h>
@@ -235,6 +237,9 @@ static int dmatest_func(void *data)
 	unsigned int		error_count;
 	unsigned int		failed_tests = 0;
 	unsigned int		total_tests = 0;
+	u64			total_len = 0;
+	s64			runtime = 0;
+	ktime_t			start;
 	dma_cookie_t		cookie;
 	enum dma_status		status;
 	enum dma_ctrl_flags 	flags;
@@ -380,6 +385,7 @@ static int dmatest_func(void *data)
 		init_completion(&cmp);
 		tx->callback = dmatest_callback;
 		tx->callback_param = &cmp;
+		start = ktime_get();
 		cookie = tx->tx_submit(tx);
 
 		if (dma_submit_error(cookie)) {
@@ -395,6 +401,7 @@ static int dmatest_func(void *data)
 
 		tmo = wait_for_completion_timeout(&cmp, tmo);
 		status = dma_async_is_tx_complete(chan, cookie, NULL, NULL);
+		runtime += ktime_us_delta(ktime_get(), start);
 
 		if (tmo == 0) {
 			pr_warning("%s: #%u: test timed out\n",
@@ -449,6 +456,7 @@ static int dmatest_func(void *data)
 				"src_off=0x%x dst_off=0x%x len=0x%x\n",
 				thread_name, total_tests - 1,
 				src_off, dst_off, len);
+			total_len += len;
 		}
 	}
 
@@ -465,6 +473,12 @@ err_srcbuf:
 err_srcs:
 	pr_notice("%s: terminating after %u tests, %u failures (status %d)\n",
 			thread_name, total_tests, failed_tests, ret);
+	/* time from submission to completion, excluding verification */
+	if (runtime > 0)
+		pr_notice("%s: %llu bytes in %lld us (%llu KB/s)\n",
+			thread_name, (unsigned long long)total_len,
+			(long long)runtime, div64_u64(total_len * USEC_PER_SEC,
+						      (u64)runtime * 1024));
 
 	if (iterations > 0)
 		while (!kthread_should_stop()) {
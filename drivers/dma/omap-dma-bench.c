@@ -0,0 +1,301 @@
+/*
+ * Memcpy benchmark of the OMAP system DMA
+ *
+ * Runs one set of random memcpy transfers on an "omap-dma-engine"
+ * dmaengine channel and on a logical channel of the legacy
+ * omap_request_dma() API, programmed with the same data type, burst and
+ * synchronisation as omap-dma uses, and reports the throughput of both.
+ *
+ * Copyright (C) 2010 Texas Instruments
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/completion.h>
+#include <linux/device.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include <plat/dma.h>
+
+#define OMAP_DMA_BENCH_TIMEOUT	msecs_to_jiffies(3000)
+
+static unsigned int test_buf_size = 16384;
+module_param(test_buf_size, uint, S_IRUGO);
+MODULE_PARM_DESC(test_buf_size, "Size of the memcpy test buffer");
+
+static unsigned int iterations = 1000;
+module_param(iterations, uint, S_IRUGO);
+MODULE_PARM_DESC(iterations, "Number of transfers per path (default: 1000)");
+
+struct omap_dma_bench_test {
+	unsigned int src_off;
+	unsigned int dst_off;
+	unsigned int len;
+};
+
+struct omap_dma_bench {
+	struct omap_dma_bench_test *tests;
+	u8 *src;
+	u8 *dst;
+	dma_addr_t src_dma;
+	dma_addr_t dst_dma;
+	struct completion cmp;
+	u16 status;
+};
+
+struct omap_dma_bench_result {
+	unsigned int failed;
+	u64 total_len;
+	s64 runtime;
+};
+
+static void omap_dma_bench_report(const char *name,
+				  struct omap_dma_bench_result *res)
+{
+	pr_notice("omap-dma-bench: %s: %u tests, %u failures\n", name,
+		  iterations, res->failed);
+	if (res->runtime > 0)
+		pr_notice("omap-dma-bench: %s: %llu bytes in %lld us "
+			  "(%llu KB/s)\n", name,
+			  (unsigned long long)res->total_len,
+			  (long long)res->runtime,
+			  div64_u64(res->total_len * USEC_PER_SEC,
+				    (u64)res->runtime * 1024));
+}
+
+static bool omap_dma_bench_check(struct omap_dma_bench *b,
+				 struct omap_dma_bench_test *t)
+{
+	bool ok = !memcmp(b->dst + t->dst_off, b->src + t->src_off, t->len);
+
+	memset(b->dst, 0, test_buf_size);
+	return ok;
+}
+
+static void omap_dma_bench_legacy_callback(int lch, u16 ch_status,
+					   void *data)
+{
+	struct omap_dma_bench *b = data;
+
+	b->status = ch_status;
+	complete(&b->cmp);
+}
+
+/* Program the channel the way omap_dma_start_seg() does for memcpy */
+static void omap_dma_bench_legacy_start(struct omap_dma_bench *b, int lch,
+					struct omap_dma_bench_test *t)
+{
+	enum omap_dma_burst_mode burst = OMAP_DMA_DATA_BURST_16;
+	int data_type = OMAP_DMA_DATA_TYPE_S32;
+
+	if ((t->src_off | t->dst_off | t->len) & 3) {
+		data_type = OMAP_DMA_DATA_TYPE_S8;
+		burst = OMAP_DMA_DATA_BURST_DIS;
+	}
+
+	omap_set_dma_transfer_params(lch, data_type, t->len >> data_type, 1,
+				     OMAP_DMA_SYNC_ELEMENT, 0,
+				     OMAP_DMA_DST_SYNC);
+	omap_set_dma_src_params(lch, 0, OMAP_DMA_AMODE_POST_INC,
+				b->src_dma + t->src_off, 0, 0);
+	omap_set_dma_dest_params(lch, 0, OMAP_DMA_AMODE_POST_INC,
+				 b->dst_dma + t->dst_off, 0, 0);
+	omap_set_dma_src_burst_mode(lch, burst);
+	omap_set_dma_dest_burst_mode(lch, burst);
+	omap_start_dma(lch);
+}
+
+static int omap_dma_bench_legacy(struct omap_dma_bench *b,
+				 struct omap_dma_bench_result *res)
+{
+	struct omap_dma_bench_test *t;
+	ktime_t start;
+	unsigned int i;
+	int lch, ret;
+
+	ret = omap_request_dma(OMAP_DMA_NO_DEVICE, "omap-dma-bench",
+			       omap_dma_bench_legacy_callback, b, &lch);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < iterations; i++) {
+		t = &b->tests[i];
+
+		INIT_COMPLETION(b->cmp);
+		start = ktime_get();
+		omap_dma_bench_legacy_start(b, lch, t);
+		if (!wait_for_completion_timeout(&b->cmp,
+						 OMAP_DMA_BENCH_TIMEOUT)) {
+			pr_warning("omap-dma-bench: legacy: #%u: timed out\n",
+				   i);
+			omap_stop_dma(lch);
+			res->failed += iterations - i;
+			break;
+		}
+		res->runtime += ktime_us_delta(ktime_get(), start);
+
+		if (!omap_dma_bench_check(b, t) ||
+		    !(b->status & OMAP_DMA_BLOCK_IRQ)) {
+			res->failed++;
+			continue;
+		}
+		res->total_len += t->len;
+	}
+
+	omap_free_dma(lch);
+	return 0;
+}
+
+static void omap_dma_bench_engine_callback(void *data)
+{
+	struct omap_dma_bench *b = data;
+
+	complete(&b->cmp);
+}
+
+static bool omap_dma_bench_filter(struct dma_chan *chan, void *param)
+{
+	return !strcmp(dev_driver_string(chan->device->dev),
+		       "omap-dma-engine");
+}
+
+static int omap_dma_bench_engine(struct omap_dma_bench *b,
+				 struct omap_dma_bench_result *res)
+{
+	struct dma_async_tx_descriptor *tx;
+	struct omap_dma_bench_test *t;
+	struct dma_device *dev;
+	struct dma_chan *chan;
+	dma_cap_mask_t mask;
+	dma_cookie_t cookie;
+	ktime_t start;
+	unsigned int i;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_MEMCPY, mask);
+	chan = dma_request_channel(mask, omap_dma_bench_filter, NULL);
+	if (!chan)
+		return -ENODEV;
+	dev = chan->device;
+
+	for (i = 0; i < iterations; i++) {
+		t = &b->tests[i];
+
+		INIT_COMPLETION(b->cmp);
+		start = ktime_get();
+		tx = dev->device_prep_dma_memcpy(chan,
+				b->dst_dma + t->dst_off,
+				b->src_dma + t->src_off, t->len,
+				DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
+		if (!tx) {
+			res->failed++;
+			continue;
+		}
+		tx->callback = omap_dma_bench_engine_callback;
+		tx->callback_param = b;
+		cookie = tx->tx_submit(tx);
+		dma_async_issue_pending(chan);
+
+		if (!wait_for_completion_timeout(&b->cmp,
+						 OMAP_DMA_BENCH_TIMEOUT)) {
+			pr_warning("omap-dma-bench: dmaengine: #%u: timed "
+				   "out\n", i);
+			dev->device_control(chan, DMA_TERMINATE_ALL, 0);
+			res->failed += iterations - i;
+			break;
+		}
+		res->runtime += ktime_us_delta(ktime_get(), start);
+
+		if (!omap_dma_bench_check(b, t) ||
+		    dma_async_is_tx_complete(chan, cookie, NULL, NULL) !=
+		    DMA_SUCCESS) {
+			res->failed++;
+			continue;
+		}
+		res->total_len += t->len;
+	}
+
+	dma_release_channel(chan);
+	return 0;
+}
+
+static int __init omap_dma_bench_init(void)
+{
+	struct omap_dma_bench_result res;
+	struct omap_dma_bench b;
+	unsigned int i, r;
+	int ret = -ENOMEM;
+
+	if (!iterations || !test_buf_size || test_buf_size > 0xffffff)
+		return -EINVAL;
+
+	memset(&b, 0, sizeof(b));
+	init_completion(&b.cmp);
+
+	/* both paths run the same transfers */
+	b.tests = kcalloc(iterations, sizeof(*b.tests), GFP_KERNEL);
+	if (!b.tests)
+		goto err;
+	for (i = 0; i < iterations; i++) {
+		struct omap_dma_bench_test *t = &b.tests[i];
+
+		get_random_bytes(&r, sizeof(r));
+		t->len = r % test_buf_size + 1;
+		get_random_bytes(&r, sizeof(r));
+		t->src_off = r % (test_buf_size - t->len + 1);
+		get_random_bytes(&r, sizeof(r));
+		t->dst_off = r % (test_buf_size - t->len + 1);
+	}
+
+	b.src = dma_alloc_coherent(NULL, test_buf_size, &b.src_dma,
+				   GFP_KERNEL);
+	b.dst = dma_alloc_coherent(NULL, test_buf_size, &b.dst_dma,
+				   GFP_KERNEL);
+	if (!b.src || !b.dst)
+		goto err;
+	get_random_bytes(b.src, test_buf_size);
+	memset(b.dst, 0, test_buf_size);
+
+	memset(&res, 0, sizeof(res));
+	ret = omap_dma_bench_engine(&b, &res);
+	if (ret) {
+		pr_warning("omap-dma-bench: no omap-dma-engine channel\n");
+		goto err;
+	}
+	omap_dma_bench_report("dmaengine", &res);
+
+	memset(&res, 0, sizeof(res));
+	ret = omap_dma_bench_legacy(&b, &res);
+	if (ret) {
+		pr_warning("omap-dma-bench: no logical channel\n");
+		goto err;
+	}
+	omap_dma_bench_report("legacy", &res);
+
+err:
+	if (b.dst)
+		dma_free_coherent(NULL, test_buf_size, b.dst, b.dst_dma);
+	if (b.src)
+		dma_free_coherent(NULL, test_buf_size, b.src, b.src_dma);
+	kfree(b.tests);
+	return ret;
+}
+module_init(omap_dma_bench_init);
+
+static void __exit omap_dma_bench_exit(void)
+{
+}
+module_exit(omap_dma_bench_exit);
+
+MODULE_DESCRIPTION("OMAP sDMA memcpy benchmark");
+MODULE_LICENSE("GPL v2");
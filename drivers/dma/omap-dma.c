@@ -0,0 +1,823 @@
+/*
+ * omap-dma.c - dmaengine driver for the OMAP system DMA
+ *
+ * Copyright (C) 2010 Texas Instruments
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * The channels of this driver are a pool on top of the logical channels of
+ * plat-omap/dma.c: a logical channel is requested when a client allocates a
+ * dmaengine channel, and given back when the client releases it.
+ *
+ * A descriptor is a list of segments, each of them one block transfer of
+ * the logical channel.  The block interrupt programs the next segment, or
+ * the first one of the next issued descriptor, so queued transfers run
+ * back to back without a round trip through the client.  Completion
+ * callbacks are called from a tasklet.
+ */
+
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+#include <linux/init.h>
+#include <linux/interrupt.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+
+#include <plat/dma.h>
+#include <plat/dmaengine.h>
+
+#define DRIVER_NAME		"omap-dma-engine"
+
+/* largest element and frame counts of a block */
+#define OMAP_DMA_MAX_ELEMS	0xffffff
+#define OMAP_DMA_MAX_FRAMES	0xffff
+
+/* segments allocated with each pooled descriptor */
+#define OMAP_DMA_DESC_SEGS	4
+
+#define OMAP_DMA_ERR_IRQS	(OMAP_DMA_DROP_IRQ | OMAP2_DMA_TRANS_ERR_IRQ | \
+				 OMAP2_DMA_SECURE_ERR_IRQ | \
+				 OMAP2_DMA_SUPERVISOR_ERR_IRQ | \
+				 OMAP2_DMA_MISALIGNED_ERR_IRQ)
+
+static unsigned int channels = 8;
+module_param(channels, uint, S_IRUGO);
+MODULE_PARM_DESC(channels, "Number of dmaengine channels (default: 8)");
+
+static unsigned int descs_per_chan = 16;
+module_param(descs_per_chan, uint, S_IRUGO);
+MODULE_PARM_DESC(descs_per_chan,
+		"Descriptors allocated with each channel (default: 16)");
+
+/* one block transfer of the logical channel */
+struct omap_dma_seg {
+	dma_addr_t src;		/* source start address */
+	dma_addr_t dst;		/* destination start address */
+	u32 elem_count;		/* elements per frame */
+	u32 frame_count;	/* frames per block */
+};
+
+struct omap_dma_desc {
+	struct dma_async_tx_descriptor txd;
+	struct list_head node;
+	struct omap_dma_seg *segs;	/* segments of the transfer */
+	unsigned int nsegs;		/* segments in use */
+	unsigned int max_segs;		/* segments allocated */
+	unsigned int cur;		/* segment in progress */
+	size_t len;			/* length of the transfer in bytes */
+	int data_type;			/* OMAP_DMA_DATA_TYPE_* */
+	int src_amode;			/* source addressing mode */
+	int dst_amode;			/* destination addressing mode */
+	bool slave;			/* synchronized to the slave request */
+	bool cyclic;			/* wraps around to the first segment */
+};
+
+struct omap_dma_chan {
+	struct dma_chan chan;
+	spinlock_t lock;		/* lists and logical channel state */
+	int lch;			/* logical channel, -1 if none */
+	struct omap_dma_slave *slave;	/* slave config, NULL for memcpy */
+	dma_cookie_t completed;		/* last completed cookie */
+	dma_cookie_t error;		/* last failed cookie */
+	bool busy;			/* a block transfer is programmed */
+	unsigned int periods;		/* cyclic periods not yet reported */
+	struct list_head queue;		/* submitted, not yet issued */
+	struct list_head active;	/* issued, the first is in progress */
+	struct list_head done;		/* completed, callback pending */
+	struct list_head free;		/* descriptor pool */
+	struct tasklet_struct tasklet;
+};
+
+struct omap_dma_engine {
+	struct dma_device dma;
+	struct omap_dma_chan *chans;
+};
+
+static inline struct omap_dma_chan *to_omap_dma_chan(struct dma_chan *chan)
+{
+	return container_of(chan, struct omap_dma_chan, chan);
+}
+
+static inline struct omap_dma_desc *to_omap_dma_desc(
+					struct dma_async_tx_descriptor *txd)
+{
+	return container_of(txd, struct omap_dma_desc, txd);
+}
+
+static struct device *chan2dev(struct dma_chan *chan)
+{
+	return &chan->dev->device;
+}
+
+static inline size_t omap_dma_seg_len(struct omap_dma_desc *d,
+				      struct omap_dma_seg *seg)
+{
+	return (size_t)seg->elem_count * seg->frame_count << d->data_type;
+}
+
+/* Must be called with the lock held */
+static void omap_dma_start_seg(struct omap_dma_chan *c,
+			       struct omap_dma_desc *d)
+{
+	struct omap_dma_seg *seg = &d->segs[d->cur];
+	int sync_mode = OMAP_DMA_SYNC_ELEMENT, trigger = 0;
+	int synch = OMAP_DMA_DST_SYNC;
+	enum omap_dma_burst_mode burst = OMAP_DMA_DATA_BURST_DIS;
+
+	if (d->slave) {
+		sync_mode = c->slave->sync_mode;
+		trigger = c->slave->dma_req;
+		burst = c->slave->burst_mode;
+		if (d->src_amode == OMAP_DMA_AMODE_CONSTANT)
+			synch = OMAP_DMA_SRC_SYNC;
+	} else if (d->data_type == OMAP_DMA_DATA_TYPE_S32) {
+		burst = OMAP_DMA_DATA_BURST_16;
+	}
+
+	omap_set_dma_transfer_params(c->lch, d->data_type, seg->elem_count,
+				     seg->frame_count, sync_mode, trigger,
+				     synch);
+	omap_set_dma_src_params(c->lch, 0, d->src_amode, seg->src, 0, 0);
+	omap_set_dma_dest_params(c->lch, 0, d->dst_amode, seg->dst, 0, 0);
+	omap_set_dma_src_burst_mode(c->lch, burst);
+	omap_set_dma_dest_burst_mode(c->lch, burst);
+	omap_start_dma(c->lch);
+	c->busy = true;
+}
+
+/* Must be called with the lock held */
+static void omap_dma_start_next(struct omap_dma_chan *c)
+{
+	struct omap_dma_desc *d;
+
+	if (c->busy || list_empty(&c->active))
+		return;
+
+	d = list_first_entry(&c->active, struct omap_dma_desc, node);
+	d->cur = 0;
+	omap_dma_start_seg(c, d);
+}
+
+/* block interrupt of the logical channel, in IRQ context */
+static void omap_dma_callback(int lch, u16 ch_status, void *data)
+{
+	struct omap_dma_chan *c = data;
+	struct omap_dma_desc *d;
+
+	spin_lock(&c->lock);
+
+	/* the channel may have been terminated meanwhile */
+	if (!c->busy || list_empty(&c->active))
+		goto out;
+	d = list_first_entry(&c->active, struct omap_dma_desc, node);
+
+	if (unlikely(ch_status & OMAP_DMA_ERR_IRQS)) {
+		dev_err(chan2dev(&c->chan), "transfer %d failed (0x%04x)\n",
+			d->txd.cookie, ch_status);
+		omap_stop_dma(lch);
+		c->error = d->txd.cookie;
+		d->cyclic = false;
+		d->cur = d->nsegs;
+	} else if (!(ch_status & OMAP_DMA_BLOCK_IRQ)) {
+		goto out;
+	} else {
+		d->cur++;
+	}
+	c->busy = false;
+
+	if (d->cyclic) {
+		if (d->cur == d->nsegs)
+			d->cur = 0;
+		omap_dma_start_seg(c, d);
+		c->periods++;
+	} else if (d->cur < d->nsegs) {
+		omap_dma_start_seg(c, d);
+		goto out;
+	} else {
+		c->completed = d->txd.cookie;
+		list_move_tail(&d->node, &c->done);
+		omap_dma_start_next(c);
+	}
+	tasklet_schedule(&c->tasklet);
+out:
+	spin_unlock(&c->lock);
+}
+
+static void omap_dma_unmap(struct omap_dma_chan *c, struct omap_dma_desc *d)
+{
+	struct device *dev = c->chan.device->dev;
+	enum dma_ctrl_flags flags = d->txd.flags;
+
+	if (!(flags & DMA_COMPL_SKIP_DEST_UNMAP)) {
+		if (flags & DMA_COMPL_DEST_UNMAP_SINGLE)
+			dma_unmap_single(dev, d->segs[0].dst, d->len,
+					 DMA_FROM_DEVICE);
+		else
+			dma_unmap_page(dev, d->segs[0].dst, d->len,
+				       DMA_FROM_DEVICE);
+	}
+	if (!(flags & DMA_COMPL_SKIP_SRC_UNMAP)) {
+		if (flags & DMA_COMPL_SRC_UNMAP_SINGLE)
+			dma_unmap_single(dev, d->segs[0].src, d->len,
+					 DMA_TO_DEVICE);
+		else
+			dma_unmap_page(dev, d->segs[0].src, d->len,
+				       DMA_TO_DEVICE);
+	}
+}
+
+static void omap_dma_tasklet(unsigned long data)
+{
+	struct omap_dma_chan *c = (struct omap_dma_chan *)data;
+	struct omap_dma_desc *d;
+	dma_async_tx_callback callback = NULL;
+	void *param = NULL;
+	unsigned int periods;
+	unsigned long flags;
+	LIST_HEAD(list);
+
+	spin_lock_irqsave(&c->lock, flags);
+	list_splice_init(&c->done, &list);
+	periods = c->periods;
+	c->periods = 0;
+	if (periods && !list_empty(&c->active)) {
+		d = list_first_entry(&c->active, struct omap_dma_desc, node);
+		if (d->cyclic) {
+			callback = d->txd.callback;
+			param = d->txd.callback_param;
+		}
+	}
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	while (callback && periods--)
+		callback(param);
+
+	list_for_each_entry(d, &list, node) {
+		struct dma_async_tx_descriptor *txd = &d->txd;
+
+		if (!d->slave)
+			omap_dma_unmap(c, d);
+		if (txd->callback)
+			txd->callback(txd->callback_param);
+		dma_run_dependencies(txd);
+	}
+
+	spin_lock_irqsave(&c->lock, flags);
+	list_splice_tail(&list, &c->free);
+	spin_unlock_irqrestore(&c->lock, flags);
+}
+
+static dma_cookie_t omap_dma_tx_submit(struct dma_async_tx_descriptor *txd)
+{
+	struct omap_dma_chan *c = to_omap_dma_chan(txd->chan);
+	struct omap_dma_desc *d = to_omap_dma_desc(txd);
+	dma_cookie_t cookie;
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->lock, flags);
+
+	cookie = c->chan.cookie;
+	if (++cookie < 0)
+		cookie = 1;
+	c->chan.cookie = cookie;
+	txd->cookie = cookie;
+
+	list_add_tail(&d->node, &c->queue);
+
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	return cookie;
+}
+
+static struct omap_dma_desc *omap_dma_desc_alloc(struct omap_dma_chan *c,
+						 gfp_t gfp)
+{
+	struct omap_dma_desc *d;
+
+	d = kzalloc(sizeof(*d), gfp);
+	if (!d)
+		return NULL;
+
+	d->segs = kmalloc(OMAP_DMA_DESC_SEGS * sizeof(*d->segs), gfp);
+	if (!d->segs) {
+		kfree(d);
+		return NULL;
+	}
+	d->max_segs = OMAP_DMA_DESC_SEGS;
+
+	dma_async_tx_descriptor_init(&d->txd, &c->chan);
+	d->txd.tx_submit = omap_dma_tx_submit;
+	d->txd.flags = DMA_CTRL_ACK;
+	INIT_LIST_HEAD(&d->node);
+
+	return d;
+}
+
+static void omap_dma_desc_free(struct omap_dma_desc *d)
+{
+	kfree(d->segs);
+	kfree(d);
+}
+
+static void omap_dma_desc_put(struct omap_dma_chan *c,
+			      struct omap_dma_desc *d)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->lock, flags);
+	list_add(&d->node, &c->free);
+	spin_unlock_irqrestore(&c->lock, flags);
+}
+
+/* Take a descriptor with room for nsegs segments from the pool */
+static struct omap_dma_desc *omap_dma_desc_get(struct omap_dma_chan *c,
+					       unsigned int nsegs)
+{
+	struct omap_dma_desc *d, *ret = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->lock, flags);
+	list_for_each_entry(d, &c->free, node) {
+		if (async_tx_test_ack(&d->txd)) {
+			list_del(&d->node);
+			ret = d;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	/* prep may be called in atomic context */
+	if (!ret) {
+		ret = omap_dma_desc_alloc(c, GFP_NOWAIT);
+		if (!ret)
+			return NULL;
+	}
+
+	if (ret->max_segs < nsegs) {
+		struct omap_dma_seg *segs;
+
+		segs = kmalloc(nsegs * sizeof(*segs), GFP_NOWAIT);
+		if (!segs) {
+			omap_dma_desc_put(c, ret);
+			return NULL;
+		}
+		kfree(ret->segs);
+		ret->segs = segs;
+		ret->max_segs = nsegs;
+	}
+
+	ret->nsegs = nsegs;
+	ret->cur = 0;
+	ret->len = 0;
+	ret->slave = false;
+	ret->cyclic = false;
+
+	return ret;
+}
+
+static int omap_dma_alloc_chan_resources(struct dma_chan *chan)
+{
+	struct omap_dma_chan *c = to_omap_dma_chan(chan);
+	struct omap_dma_slave *slave = chan->private;
+	struct omap_dma_desc *d;
+	unsigned long flags;
+	int i, ret;
+
+	ret = omap_request_dma(slave ? slave->dma_req : OMAP_DMA_NO_DEVICE,
+			       DRIVER_NAME, omap_dma_callback, c, &c->lch);
+	if (ret) {
+		dev_err(chan2dev(chan), "no free logical channel\n");
+		c->lch = -1;
+		return ret;
+	}
+
+	for (i = 0; i < descs_per_chan; i++) {
+		d = omap_dma_desc_alloc(c, GFP_KERNEL);
+		if (!d)
+			break;
+		omap_dma_desc_put(c, d);
+	}
+	if (!i) {
+		omap_free_dma(c->lch);
+		c->lch = -1;
+		return -ENOMEM;
+	}
+
+	spin_lock_irqsave(&c->lock, flags);
+	c->slave = slave;
+	c->completed = chan->cookie = 1;
+	c->error = 0;
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	dev_dbg(chan2dev(chan), "logical channel %d, %d descriptors\n",
+		c->lch, i);
+
+	return i;
+}
+
+static int omap_dma_control(struct dma_chan *chan, enum dma_ctrl_cmd cmd,
+			    unsigned long arg)
+{
+	struct omap_dma_chan *c = to_omap_dma_chan(chan);
+	unsigned long flags;
+
+	if (cmd != DMA_TERMINATE_ALL)
+		return -ENXIO;
+
+	spin_lock_irqsave(&c->lock, flags);
+	if (c->busy) {
+		omap_stop_dma(c->lch);
+		c->busy = false;
+	}
+	list_splice_tail_init(&c->active, &c->free);
+	list_splice_tail_init(&c->queue, &c->free);
+	c->periods = 0;
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	return 0;
+}
+
+static void omap_dma_free_chan_resources(struct dma_chan *chan)
+{
+	struct omap_dma_chan *c = to_omap_dma_chan(chan);
+	struct omap_dma_desc *d, *_d;
+	unsigned long flags;
+	LIST_HEAD(list);
+
+	omap_dma_control(chan, DMA_TERMINATE_ALL, 0);
+	tasklet_kill(&c->tasklet);
+
+	omap_free_dma(c->lch);
+	c->lch = -1;
+
+	spin_lock_irqsave(&c->lock, flags);
+	list_splice_init(&c->done, &list);
+	list_splice_init(&c->free, &list);
+	c->slave = NULL;
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	list_for_each_entry_safe(d, _d, &list, node)
+		omap_dma_desc_free(d);
+}
+
+/* Must be called with the lock held */
+static size_t omap_dma_residue(struct omap_dma_chan *c, dma_cookie_t cookie)
+{
+	struct omap_dma_desc *d;
+	struct omap_dma_seg *seg;
+	dma_addr_t pos, start;
+	size_t residue;
+	unsigned int i;
+
+	list_for_each_entry(d, &c->queue, node)
+		if (d->txd.cookie == cookie)
+			return d->len;
+
+	list_for_each_entry(d, &c->active, node) {
+		if (d->txd.cookie != cookie)
+			continue;
+		if (!c->busy || d != list_first_entry(&c->active,
+						struct omap_dma_desc, node))
+			return d->len;
+
+		residue = 0;
+		for (i = d->cur; i < d->nsegs; i++)
+			residue += omap_dma_seg_len(d, &d->segs[i]);
+
+		/* the position is 0 until the first element moved */
+		seg = &d->segs[d->cur];
+		if (d->dst_amode == OMAP_DMA_AMODE_POST_INC) {
+			pos = omap_get_dma_dst_pos(c->lch);
+			start = seg->dst;
+		} else {
+			pos = omap_get_dma_src_pos(c->lch);
+			start = seg->src;
+		}
+		if (pos > start && pos - start < omap_dma_seg_len(d, seg))
+			residue -= pos - start;
+		return residue;
+	}
+
+	return 0;
+}
+
+static enum dma_status omap_dma_tx_status(struct dma_chan *chan,
+					  dma_cookie_t cookie,
+					  struct dma_tx_state *txstate)
+{
+	struct omap_dma_chan *c = to_omap_dma_chan(chan);
+	dma_cookie_t last_used, last_complete;
+	enum dma_status ret;
+	size_t residue = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->lock, flags);
+	last_complete = c->completed;
+	last_used = chan->cookie;
+
+	ret = dma_async_is_complete(cookie, last_complete, last_used);
+	if (ret == DMA_SUCCESS && cookie == c->error)
+		ret = DMA_ERROR;
+	else if (ret != DMA_SUCCESS && txstate)
+		residue = omap_dma_residue(c, cookie);
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	dma_set_tx_state(txstate, last_complete, last_used, residue);
+
+	return ret;
+}
+
+static void omap_dma_issue_pending(struct dma_chan *chan)
+{
+	struct omap_dma_chan *c = to_omap_dma_chan(chan);
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->lock, flags);
+	list_splice_tail_init(&c->queue, &c->active);
+	omap_dma_start_next(c);
+	spin_unlock_irqrestore(&c->lock, flags);
+}
+
+static struct dma_async_tx_descriptor *omap_dma_prep_memcpy(
+		struct dma_chan *chan, dma_addr_t dest, dma_addr_t src,
+		size_t len, unsigned long flags)
+{
+	struct omap_dma_chan *c = to_omap_dma_chan(chan);
+	struct omap_dma_desc *d;
+	int data_type = OMAP_DMA_DATA_TYPE_S32;
+	size_t elems;
+	unsigned int i;
+
+	/* slave channels keep their request line programmed */
+	if (!len || c->slave)
+		return NULL;
+
+	/* move words if possible */
+	if ((dest | src | len) & 3)
+		data_type = OMAP_DMA_DATA_TYPE_S8;
+	elems = len >> data_type;
+
+	d = omap_dma_desc_get(c, DIV_ROUND_UP(elems, OMAP_DMA_MAX_ELEMS));
+	if (!d)
+		return NULL;
+
+	for (i = 0; i < d->nsegs; i++) {
+		struct omap_dma_seg *seg = &d->segs[i];
+
+		seg->elem_count = min_t(size_t, elems, OMAP_DMA_MAX_ELEMS);
+		seg->frame_count = 1;
+		seg->src = src;
+		seg->dst = dest;
+
+		src += seg->elem_count << data_type;
+		dest += seg->elem_count << data_type;
+		elems -= seg->elem_count;
+	}
+
+	d->len = len;
+	d->data_type = data_type;
+	d->src_amode = OMAP_DMA_AMODE_POST_INC;
+	d->dst_amode = OMAP_DMA_AMODE_POST_INC;
+	d->txd.flags = flags;
+
+	return &d->txd;
+}
+
+/* Fill a segment moving len bytes between addr and the slave FIFO */
+static int omap_dma_slave_seg(struct omap_dma_chan *c,
+			      struct omap_dma_seg *seg, dma_addr_t addr,
+			      size_t len, enum dma_data_direction direction)
+{
+	struct omap_dma_slave *slave = c->slave;
+	size_t elems = len >> slave->data_type;
+
+	if (!len || len & ((1 << slave->data_type) - 1))
+		return -EINVAL;
+
+	if (slave->sync_mode == OMAP_DMA_SYNC_FRAME) {
+		if (!slave->frame_len || elems % slave->frame_len)
+			return -EINVAL;
+		seg->elem_count = slave->frame_len;
+		seg->frame_count = elems / slave->frame_len;
+	} else {
+		seg->elem_count = elems;
+		seg->frame_count = 1;
+	}
+	if (seg->elem_count > OMAP_DMA_MAX_ELEMS ||
+	    seg->frame_count > OMAP_DMA_MAX_FRAMES)
+		return -EINVAL;
+
+	if (direction == DMA_TO_DEVICE) {
+		seg->src = addr;
+		seg->dst = slave->dev_addr;
+	} else {
+		seg->src = slave->dev_addr;
+		seg->dst = addr;
+	}
+	return 0;
+}
+
+static struct omap_dma_desc *omap_dma_slave_desc(struct omap_dma_chan *c,
+		unsigned int nsegs, enum dma_data_direction direction)
+{
+	struct omap_dma_desc *d;
+
+	if (!c->slave || !nsegs) {
+		dev_err(chan2dev(&c->chan), "no slave configuration\n");
+		return NULL;
+	}
+	if (direction != DMA_TO_DEVICE && direction != DMA_FROM_DEVICE)
+		return NULL;
+
+	d = omap_dma_desc_get(c, nsegs);
+	if (!d)
+		return NULL;
+
+	d->slave = true;
+	d->data_type = c->slave->data_type;
+	if (direction == DMA_TO_DEVICE) {
+		d->src_amode = OMAP_DMA_AMODE_POST_INC;
+		d->dst_amode = OMAP_DMA_AMODE_CONSTANT;
+	} else {
+		d->src_amode = OMAP_DMA_AMODE_CONSTANT;
+		d->dst_amode = OMAP_DMA_AMODE_POST_INC;
+	}
+	return d;
+}
+
+static struct dma_async_tx_descriptor *omap_dma_prep_slave_sg(
+		struct dma_chan *chan, struct scatterlist *sgl,
+		unsigned int sg_len, enum dma_data_direction direction,
+		unsigned long flags)
+{
+	struct omap_dma_chan *c = to_omap_dma_chan(chan);
+	struct omap_dma_desc *d;
+	struct scatterlist *sg;
+	unsigned int i;
+
+	d = omap_dma_slave_desc(c, sg_len, direction);
+	if (!d)
+		return NULL;
+
+	for_each_sg(sgl, sg, sg_len, i) {
+		if (omap_dma_slave_seg(c, &d->segs[i], sg_dma_address(sg),
+				       sg_dma_len(sg), direction)) {
+			dev_err(chan2dev(chan), "bad sg element %u\n", i);
+			omap_dma_desc_put(c, d);
+			return NULL;
+		}
+		d->len += sg_dma_len(sg);
+	}
+	d->txd.flags = flags;
+
+	return &d->txd;
+}
+
+struct dma_async_tx_descriptor *omap_dma_prep_cyclic(struct dma_chan *chan,
+		dma_addr_t buf_addr, size_t buf_len, size_t period_len,
+		enum dma_data_direction direction)
+{
+	struct omap_dma_chan *c = to_omap_dma_chan(chan);
+	struct omap_dma_desc *d;
+	unsigned int i;
+
+	if (chan->device->device_prep_slave_sg != omap_dma_prep_slave_sg)
+		return NULL;
+	if (!period_len || buf_len % period_len)
+		return NULL;
+
+	d = omap_dma_slave_desc(c, buf_len / period_len, direction);
+	if (!d)
+		return NULL;
+
+	for (i = 0; i < d->nsegs; i++) {
+		if (omap_dma_slave_seg(c, &d->segs[i],
+				       buf_addr + i * period_len, period_len,
+				       direction)) {
+			dev_err(chan2dev(chan), "bad period length %zu\n",
+				period_len);
+			omap_dma_desc_put(c, d);
+			return NULL;
+		}
+	}
+	d->len = buf_len;
+	d->cyclic = true;
+	d->txd.flags = DMA_CTRL_ACK;
+
+	return &d->txd;
+}
+EXPORT_SYMBOL(omap_dma_prep_cyclic);
+
+static int __init omap_dma_probe(struct platform_device *pdev)
+{
+	struct omap_dma_engine *od;
+	int i, ret;
+
+	if (!channels)
+		return -EINVAL;
+
+	od = kzalloc(sizeof(*od), GFP_KERNEL);
+	if (!od)
+		return -ENOMEM;
+
+	od->chans = kcalloc(channels, sizeof(*od->chans), GFP_KERNEL);
+	if (!od->chans) {
+		ret = -ENOMEM;
+		goto err_chans;
+	}
+
+	INIT_LIST_HEAD(&od->dma.channels);
+	for (i = 0; i < channels; i++) {
+		struct omap_dma_chan *c = &od->chans[i];
+
+		c->chan.device = &od->dma;
+		c->lch = -1;
+		spin_lock_init(&c->lock);
+		INIT_LIST_HEAD(&c->queue);
+		INIT_LIST_HEAD(&c->active);
+		INIT_LIST_HEAD(&c->done);
+		INIT_LIST_HEAD(&c->free);
+		tasklet_init(&c->tasklet, omap_dma_tasklet, (unsigned long)c);
+		list_add_tail(&c->chan.device_node, &od->dma.channels);
+	}
+
+	/* only handed out through dma_request_channel(), not to async_tx
+	 * or net_dma, which would hold logical channels for good */
+	dma_cap_set(DMA_MEMCPY, od->dma.cap_mask);
+	dma_cap_set(DMA_SLAVE, od->dma.cap_mask);
+	dma_cap_set(DMA_PRIVATE, od->dma.cap_mask);
+	od->dma.dev = &pdev->dev;
+	od->dma.device_alloc_chan_resources = omap_dma_alloc_chan_resources;
+	od->dma.device_free_chan_resources = omap_dma_free_chan_resources;
+	od->dma.device_prep_dma_memcpy = omap_dma_prep_memcpy;
+	od->dma.device_prep_slave_sg = omap_dma_prep_slave_sg;
+	od->dma.device_control = omap_dma_control;
+	od->dma.device_tx_status = omap_dma_tx_status;
+	od->dma.device_issue_pending = omap_dma_issue_pending;
+
+	ret = dma_async_device_register(&od->dma);
+	if (ret) {
+		dev_err(&pdev->dev, "failed to register dma device\n");
+		goto err_register;
+	}
+
+	platform_set_drvdata(pdev, od);
+	dev_info(&pdev->dev, "%u channels\n", channels);
+
+	return 0;
+
+err_register:
+	for (i = 0; i < channels; i++)
+		tasklet_kill(&od->chans[i].tasklet);
+	kfree(od->chans);
+err_chans:
+	kfree(od);
+	return ret;
+}
+
+static int __devexit omap_dma_remove(struct platform_device *pdev)
+{
+	struct omap_dma_engine *od = platform_get_drvdata(pdev);
+	int i;
+
+	dma_async_device_unregister(&od->dma);
+	for (i = 0; i < channels; i++)
+		tasklet_kill(&od->chans[i].tasklet);
+
+	platform_set_drvdata(pdev, NULL);
+	kfree(od->chans);
+	kfree(od);
+
+	return 0;
+}
+
+static struct platform_driver omap_dma_driver = {
+	.remove		= __devexit_p(omap_dma_remove),
+	.driver		= {
+		.name	= DRIVER_NAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init omap_dma_init(void)
+{
+	return platform_driver_probe(&omap_dma_driver, omap_dma_probe);
+}
+subsys_initcall(omap_dma_init);
+
+static void __exit omap_dma_exit(void)
+{
+	platform_driver_unregister(&omap_dma_driver);
+}
+module_exit(omap_dma_exit);
+
+MODULE_AUTHOR("Texas Instruments");
+MODULE_DESCRIPTION("OMAP system DMA dmaengine driver");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:" DRIVER_NAME);
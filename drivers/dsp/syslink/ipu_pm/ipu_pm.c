@@ -33,6 +33,8 @@
 #include <linux/clk.h>
 #include <linux/uaccess.h>
 #include <linux/irq.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/platform_device.h>
 #include <syslink/notify.h>
@@ -267,6 +269,16 @@ static inline int ipu_pm_rel_cstr(struct ipu_pm_object *handle,
 				  struct rcb_block *rcb_p,
 				  struct ipu_pm_params *params);
 
+/* Request a set of resources and constraints on behalf of an IPU client */
+static int ipu_pm_req_set(struct ipu_pm_object *handle,
+			  struct rcb_block *rcb_p,
+			  struct ipu_pm_params *params);
+
+/* Release a set of resources and constraints on behalf of an IPU client */
+static int ipu_pm_rel_set(struct ipu_pm_object *handle,
+			  struct rcb_block *rcb_p,
+			  struct ipu_pm_params *params);
+
 /* Hibernate and watch dog timer interrupt */
 static irqreturn_t ipu_pm_timer_interrupt(int irq,
 					void *dev_id);
@@ -304,6 +316,47 @@ struct work_struct clean;
 static DECLARE_COMPLETION(ipu_clean_up_comp);
 static bool recover;
 
+/* Constraints requested by each RCB, and the aggregate of them applied
+ * to omap-pm for each resource. Only changed aggregates are applied.
+ */
+struct ipu_pm_cstr {
+	int res;
+	u32 flags;
+	int perf;
+	int lat;
+	int bw;
+};
+static struct ipu_pm_cstr ipu_pm_rcb_cstr[RCB_MAX];
+/* Constraints of each RCB before a request, to roll a failed one back */
+static struct ipu_pm_cstr ipu_pm_rcb_cstr_prev[RCB_MAX];
+static struct ipu_pm_cstr ipu_pm_res_cstr[PM_NUM_RES_W_CSTRS];
+static u32 ipu_pm_cstr_dirty[PM_NUM_RES_W_CSTRS];
+static DEFINE_MUTEX(ipu_pm_cstr_lock);
+
+/* Request latency statistics, per message type, and trace */
+struct ipu_pm_msg_stats {
+	u32 count;
+	u32 failed;
+	u64 total_us;
+	u32 max_us;
+};
+
+struct ipu_pm_trace_entry {
+	ktime_t stamp;
+	u16 proc_id;
+	u8 rcb_num;
+	u8 msg_type;
+	u8 res;
+	s8 result;
+	u32 queue_us;
+	u32 total_us;
+};
+
+static struct ipu_pm_msg_stats ipu_pm_stats[16];
+static struct ipu_pm_trace_entry ipu_pm_trace[PM_TRACE_MAX];
+static u32 ipu_pm_trace_next;
+static struct dentry *ipu_pm_dbgfs;
+
 /* Latency cstrs */
 #ifdef CONFIG_OMAP_PM
 static struct pm_qos_request_list *pm_qos_handle;
@@ -599,6 +652,98 @@ static struct notifier_block ipu_pm_notify_nb_iommu_ducati = {
 	.notifier_call = ipu_pm_iommu_notifier_call,
 };
 
+static inline u32 ipu_pm_us_since(ktime_t start)
+{
+	return (u32) ktime_to_us(ktime_sub(ktime_get(), start));
+}
+
+/*
+  Account the latency of a message, from its notify callback
+  to the reply, in the statistics and the trace
+ *
+ */
+static void ipu_pm_trace_msg(struct ipu_pm_msg *im, struct rcb_block *rcb_p,
+			     ktime_t start)
+{
+	struct ipu_pm_msg_stats *st = &ipu_pm_stats[rcb_p->msg_type];
+	struct ipu_pm_trace_entry *te;
+	union message_slicer pm_msg;
+	u32 us = ipu_pm_us_since(im->stamp);
+
+	pm_msg.whole = im->pm_msg;
+	st->count++;
+	if (pm_msg.fields.msg_type == PM_FAIL)
+		st->failed++;
+	st->total_us += us;
+	if (us > st->max_us)
+		st->max_us = us;
+
+	te = &ipu_pm_trace[ipu_pm_trace_next++ % PM_TRACE_MAX];
+	te->stamp = im->stamp;
+	te->proc_id = im->proc_id;
+	te->rcb_num = rcb_p->rcb_num;
+	te->msg_type = rcb_p->msg_type;
+	te->res = rcb_p->sub_type;
+	te->result = (s8)pm_msg.fields.parm;
+	te->queue_us = (u32) ktime_to_us(ktime_sub(start, im->stamp));
+	te->total_us = us;
+}
+
+static int ipu_pm_stats_show(struct seq_file *s, void *unused)
+{
+	struct ipu_pm_msg_stats *st;
+	struct ipu_pm_trace_entry *te;
+	u32 first;
+	u32 i;
+
+	seq_printf(s, "times in us\n%8s %10s %10s %10s %10s\n",
+		   "msg_type", "count", "failed", "avg", "max");
+	for (i = 0; i < ARRAY_SIZE(ipu_pm_stats); i++) {
+		st = &ipu_pm_stats[i];
+		if (!st->count)
+			continue;
+		seq_printf(s, "%8u %10u %10u %10u %10u\n", i, st->count,
+			   st->failed, (u32) div_u64(st->total_us, st->count),
+			   st->max_us);
+	}
+
+	seq_printf(s, "\nlast requests\n%14s %4s %4s %8s %4s %6s %10s %10s\n",
+		   "time", "proc", "rcb", "msg_type", "res", "result",
+		   "queued", "total");
+	first = (ipu_pm_trace_next > PM_TRACE_MAX) ?
+				ipu_pm_trace_next - PM_TRACE_MAX : 0;
+	for (i = first; i < ipu_pm_trace_next; i++) {
+		te = &ipu_pm_trace[i % PM_TRACE_MAX];
+		seq_printf(s, "%14llu %4u %4u %8u %4u %6d %10u %10u\n",
+			   (unsigned long long) ktime_to_us(te->stamp),
+			   te->proc_id, te->rcb_num, te->msg_type, te->res,
+			   te->result, te->queue_us, te->total_us);
+	}
+	return 0;
+}
+
+static int ipu_pm_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ipu_pm_stats_show, inode->i_private);
+}
+
+/* any write resets the statistics and the trace */
+static ssize_t ipu_pm_stats_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	memset(ipu_pm_stats, 0, sizeof(ipu_pm_stats));
+	ipu_pm_trace_next = 0;
+	return count;
+}
+
+static const struct file_operations ipu_pm_stats_fops = {
+	.open		= ipu_pm_stats_open,
+	.read		= seq_read,
+	.write		= ipu_pm_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /*
   Work Function to req/rel a resource
  *
@@ -615,6 +760,7 @@ static void ipu_pm_work(struct work_struct *work)
 	int res;
 	int rcb_num;
 	int retval;
+	ktime_t start;
 
 	if (WARN_ON(handle == NULL))
 		return;
@@ -629,6 +775,7 @@ static void ipu_pm_work(struct work_struct *work)
 		spin_lock_irq(&handle->lock);
 		kfifo_out(&handle->fifo, &im, sizeof(im));
 		spin_unlock_irq(&handle->lock);
+		start = ktime_get();
 
 		/* Get the payload */
 		pm_msg.whole = im.pm_msg;
@@ -642,6 +789,14 @@ static void ipu_pm_work(struct work_struct *work)
 		/* Get the type of resource and the actions required */
 		action = rcb_p->msg_type;
 		res = rcb_p->sub_type;
+		/* A set has no resource of its own */
+		if (action == PM_REQUEST_RESOURCE_SET) {
+			retval = ipu_pm_req_set(handle, rcb_p, params);
+			goto send_msg;
+		} else if (action == PM_RELEASE_RESOURCE_SET) {
+			retval = ipu_pm_rel_set(handle, rcb_p, params);
+			goto send_msg;
+		}
 		if (!_is_res(res)) {
 			pr_err("Invalid res number: %d\n", res);
 			/* No need to continue, send error back */
@@ -692,6 +847,8 @@ send_msg:
 					true);
 		if (retval < 0)
 			pr_err("Error sending notify event\n");
+
+		ipu_pm_trace_msg(&im, rcb_p, start);
 	}
 }
 
@@ -709,6 +866,7 @@ void ipu_pm_callback(u16 proc_id, u16 line_id, u32 event_id,
 
 	im.proc_id = proc_id;
 	im.pm_msg = payload;
+	im.stamp = ktime_get();
 
 	spin_lock_irq(&handle->lock);
 	if (kfifo_avail(&handle->fifo) >= sizeof(im)) {
@@ -1959,84 +2117,173 @@ error:
 }
 
 /*
-  Request a FDIF constraint on behalf of an IPU client
+  Target of a constraint of a resource, as expected by the
+  ipu_pm_module_set_* functions
  *
  */
-static inline int ipu_pm_req_cstr(struct ipu_pm_object *handle,
-				  struct rcb_block *rcb_p,
-				  struct ipu_pm_params *params)
+static unsigned ipu_pm_cstr_target(int res, u32 cstr)
 {
-	int perf;
-	int lat;
-	int bw;
-	int retval;
-	unsigned temp_rsrc;
-	u32 cstr_flags;
-
-	/* Get the configurable constraints */
-	cstr_flags = rcb_p->data[0];
-
-	/* TODO: call the baseport APIs */
-	if (cstr_flags & PM_CSTR_PERF_MASK) {
-		switch (rcb_p->sub_type) {
+	if (cstr == PM_CSTR_PERF_MASK) {
+		switch (res) {
 		case MPU:
-			temp_rsrc = IPU_PM_MPU;
-			break;
+			return IPU_PM_MPU;
 		case IPU:
 		case ISS:
 		case FDIF:
-			temp_rsrc = IPU_PM_CORE;
-			break;
+			return IPU_PM_CORE;
 		default:
-			temp_rsrc = rcb_p->sub_type;
-			break;
+			return res;
 		}
-		perf = rcb_p->data[1];
-		pr_debug("Request perfomance Cstr %d\n", perf);
-		retval = ipu_pm_module_set_rate(rcb_p->sub_type,
-						temp_rsrc,
-						perf);
-		if (retval)
-			return PM_UNSUPPORTED;
-	}
-
-	if (cstr_flags & PM_CSTR_LAT_MASK) {
-		switch (rcb_p->sub_type) {
+	} else if (cstr == PM_CSTR_LAT_MASK) {
+		switch (res) {
 		case MPU:
-			temp_rsrc = IPU_PM_MPU;
-			break;
+			return IPU_PM_MPU;
 		case IPU:
 		case L3_BUS:
-			temp_rsrc = IPU_PM_CORE;
-			break;
+			return IPU_PM_CORE;
 		case ISS:
 		case FDIF:
-			temp_rsrc = IPU_PM_SELF;
-			break;
+			return IPU_PM_SELF;
 		default:
-			temp_rsrc = rcb_p->sub_type;
-			break;
+			return res;
 		}
-		lat = rcb_p->data[2];
-		pr_debug("Request latency Cstr %d\n", lat);
-		retval = ipu_pm_module_set_latency(rcb_p->sub_type,
-						   temp_rsrc,
-						   lat);
-		if (retval)
-			return PM_UNSUPPORTED;
 	}
+	return res;
+}
 
-	if (cstr_flags & PM_CSTR_BW_MASK) {
-		bw = rcb_p->data[3];
-		pr_debug("Request bandwidth Cstr L3bus:%d\n", bw);
-		retval = ipu_pm_module_set_bandwidth(rcb_p->sub_type,
-						     rcb_p->sub_type,
-						     bw);
-		if (retval)
-			return PM_UNSUPPORTED;
+/*
+  Record the constraints of an RCB, or forget them if flags is 0,
+  and mark the aggregates they take part in for update
+ *
+ */
+static void ipu_pm_cstr_record(int rcb_num, int res, u32 flags,
+			       int perf, int lat, int bw)
+{
+	struct ipu_pm_cstr *c = &ipu_pm_rcb_cstr[rcb_num];
+
+	if (c->flags)
+		ipu_pm_cstr_dirty[c->res] |= c->flags;
+	c->res = res;
+	c->flags = flags;
+	c->perf = perf;
+	c->lat = lat;
+	c->bw = bw;
+	if (c->flags)
+		ipu_pm_cstr_dirty[c->res] |= c->flags;
+}
+
+/*
+  Apply to omap-pm the aggregated constraints that changed: the
+  highest rate and bandwidth, and the lowest latency, requested
+  for each resource
+ *
+ */
+static int ipu_pm_cstr_apply(void)
+{
+	struct ipu_pm_cstr agg;
+	struct ipu_pm_cstr *c;
+	struct ipu_pm_cstr *cur;
+	int retval = 0;
+	int err;
+	u32 dirty;
+	int res;
+	int i;
+
+	for (res = PM_FIRST_RES; res < PM_NUM_RES_W_CSTRS; res++) {
+		dirty = ipu_pm_cstr_dirty[res];
+		if (!dirty)
+			continue;
+		ipu_pm_cstr_dirty[res] = 0;
+
+		agg.perf = NO_FREQ_CONSTRAINT;
+		agg.lat = NO_LAT_CONSTRAINT;
+		agg.bw = NO_BW_CONSTRAINT;
+		for (i = 0; i < RCB_MAX; i++) {
+			c = &ipu_pm_rcb_cstr[i];
+			if (!c->flags || c->res != res)
+				continue;
+			if ((c->flags & PM_CSTR_PERF_MASK) && c->perf > agg.perf)
+				agg.perf = c->perf;
+			if ((c->flags & PM_CSTR_LAT_MASK) && c->lat >= 0 &&
+			    (agg.lat < 0 || c->lat < agg.lat))
+				agg.lat = c->lat;
+			if ((c->flags & PM_CSTR_BW_MASK) && c->bw > agg.bw)
+				agg.bw = c->bw;
+		}
+
+		cur = &ipu_pm_res_cstr[res];
+		if ((dirty & PM_CSTR_PERF_MASK) && agg.perf != cur->perf) {
+			pr_debug("Set res:%d perfomance Cstr %d\n", res,
+				 agg.perf);
+			err = ipu_pm_module_set_rate(res,
+				ipu_pm_cstr_target(res, PM_CSTR_PERF_MASK),
+				agg.perf);
+			if (err)
+				retval = err;
+			else
+				cur->perf = agg.perf;
+		}
+		if ((dirty & PM_CSTR_LAT_MASK) && agg.lat != cur->lat) {
+			pr_debug("Set res:%d latency Cstr %d\n", res, agg.lat);
+			err = ipu_pm_module_set_latency(res,
+				ipu_pm_cstr_target(res, PM_CSTR_LAT_MASK),
+				agg.lat);
+			if (err)
+				retval = err;
+			else
+				cur->lat = agg.lat;
+		}
+		if ((dirty & PM_CSTR_BW_MASK) && agg.bw != cur->bw) {
+			pr_debug("Set res:%d bandwidth Cstr %d\n", res, agg.bw);
+			err = ipu_pm_module_set_bandwidth(res, res, agg.bw);
+			if (err)
+				retval = err;
+			else
+				cur->bw = agg.bw;
+		}
 	}
+	return retval;
+}
 
-	return PM_SUCCESS;
+/* Record the constraints requested in an RCB, saving the previous ones */
+static inline void ipu_pm_cstr_record_rcb(struct rcb_block *rcb_p)
+{
+	ipu_pm_rcb_cstr_prev[rcb_p->rcb_num] = ipu_pm_rcb_cstr[rcb_p->rcb_num];
+	ipu_pm_cstr_record(rcb_p->rcb_num, rcb_p->sub_type,
+			   rcb_p->data[0] & (PM_CSTR_PERF_MASK |
+				PM_CSTR_LAT_MASK | PM_CSTR_BW_MASK),
+			   rcb_p->data[1], rcb_p->data[2], rcb_p->data[3]);
+}
+
+/* Put back the constraints an RCB had before ipu_pm_cstr_record_rcb */
+static inline void ipu_pm_cstr_restore(int rcb_num)
+{
+	struct ipu_pm_cstr *prev = &ipu_pm_rcb_cstr_prev[rcb_num];
+
+	ipu_pm_cstr_record(rcb_num, prev->res, prev->flags, prev->perf,
+			   prev->lat, prev->bw);
+}
+
+/*
+  Request a FDIF constraint on behalf of an IPU client
+ *
+ */
+static inline int ipu_pm_req_cstr(struct ipu_pm_object *handle,
+				  struct rcb_block *rcb_p,
+				  struct ipu_pm_params *params)
+{
+	int retval = PM_SUCCESS;
+
+	mutex_lock(&ipu_pm_cstr_lock);
+	ipu_pm_cstr_record_rcb(rcb_p);
+	if (ipu_pm_cstr_apply()) {
+		/* Back to the constraints in place before the request */
+		ipu_pm_cstr_restore(rcb_p->rcb_num);
+		ipu_pm_cstr_apply();
+		retval = PM_UNSUPPORTED;
+	}
+	mutex_unlock(&ipu_pm_cstr_lock);
+	return retval;
 }
 
 /*
@@ -2047,71 +2294,137 @@ static inline int ipu_pm_rel_cstr(struct ipu_pm_object *handle,
 				  struct rcb_block *rcb_p,
 				  struct ipu_pm_params *params)
 {
-	u32 cstr_flags;
-	unsigned temp_rsrc;
 	int retval;
 
-	/* Get the configurable constraints */
-	cstr_flags = rcb_p->data[0];
+	mutex_lock(&ipu_pm_cstr_lock);
+	ipu_pm_cstr_record(rcb_p->rcb_num, 0, 0, 0, 0, 0);
+	retval = ipu_pm_cstr_apply();
+	mutex_unlock(&ipu_pm_cstr_lock);
+	return retval ? PM_UNSUPPORTED : PM_SUCCESS;
+}
 
-	/* TODO: call the baseport APIs */
-	if (cstr_flags & PM_CSTR_PERF_MASK) {
-		switch (rcb_p->sub_type) {
-		case MPU:
-			temp_rsrc = IPU_PM_MPU;
-			break;
-		case IPU:
-		case ISS:
-		case FDIF:
-			temp_rsrc = IPU_PM_CORE;
-			break;
-		default:
-			temp_rsrc = rcb_p->sub_type;
-			break;
-		}
-		pr_debug("Release perfomance Cstr\n");
-		retval = ipu_pm_module_set_rate(rcb_p->sub_type,
-						temp_rsrc,
-						NO_FREQ_CONSTRAINT);
-		if (retval)
-			return PM_UNSUPPORTED;
-	}
+/*
+  Members of a set RCB, without the RCB itself and the invalid ones
+ *
+ */
+static u32 ipu_pm_set_members(struct rcb_block *rcb_p)
+{
+	u32 mask = rcb_p->data[PM_SET_MEMBERS];
 
-	if (cstr_flags & PM_CSTR_LAT_MASK) {
-		switch (rcb_p->sub_type) {
-		case MPU:
-			temp_rsrc = IPU_PM_MPU;
-			break;
-		case IPU:
-		case L3_BUS:
-			temp_rsrc = IPU_PM_CORE;
-			break;
-		case ISS:
-		case FDIF:
-			temp_rsrc = IPU_PM_SELF;
-			break;
-		default:
-			temp_rsrc = rcb_p->sub_type;
-			break;
+	mask &= ~((1 << RCB_MIN) - 1);
+	mask &= ~(1 << rcb_p->rcb_num);
+	return mask;
+}
+
+/*
+  Request a set of resources and constraints on behalf of an IPU
+  client. Either every member is granted or none is; the constraints
+  of the set are applied to omap-pm in one update.
+ *
+ */
+static int ipu_pm_req_set(struct ipu_pm_object *handle,
+			  struct rcb_block *rcb_p,
+			  struct ipu_pm_params *params)
+{
+	u32 members = ipu_pm_set_members(rcb_p);
+	u32 granted = 0;
+	u32 cstrs = 0;
+	struct rcb_block *m;
+	int retval = PM_SUCCESS;
+	int res;
+	int i;
+
+	mutex_lock(&ipu_pm_cstr_lock);
+	for (i = RCB_MIN; i < RCB_MAX; i++) {
+		if (!(members & (1 << i)))
+			continue;
+		m = &handle->rcb_table->rcb[i];
+		res = m->sub_type;
+		if (m->msg_type == PM_REQUEST_RESOURCE && _is_res(res) &&
+		    request_fxn[res]) {
+			retval = request_fxn[res](handle, m, params);
+			if (retval != PM_SUCCESS)
+				goto undo;
+			granted |= 1 << i;
+		} else if (m->msg_type == PM_REQUEST_CONSTRAINTS &&
+			   _has_cstrs(res)) {
+			ipu_pm_cstr_record_rcb(m);
+			cstrs |= 1 << i;
+		} else {
+			retval = PM_UNSUPPORTED;
+			goto undo;
 		}
-		pr_debug("Release latency Cstr\n");
-		retval = ipu_pm_module_set_latency(rcb_p->sub_type,
-						   temp_rsrc,
-						   NO_LAT_CONSTRAINT);
-		if (retval)
-			return PM_UNSUPPORTED;
 	}
+	i = 0;
+	if (ipu_pm_cstr_apply()) {
+		retval = PM_UNSUPPORTED;
+		goto undo;
+	}
+	mutex_unlock(&ipu_pm_cstr_lock);
+	return PM_SUCCESS;
 
-	if (cstr_flags & PM_CSTR_BW_MASK) {
-		pr_debug("Release bandwidth Cstr\n");
-		retval = ipu_pm_module_set_bandwidth(rcb_p->sub_type,
-						     rcb_p->sub_type,
-						     NO_BW_CONSTRAINT);
-		if (retval)
-			return PM_UNSUPPORTED;
+undo:
+	pr_err("Request of res set rcb:%d failed at rcb:%d\n",
+	       rcb_p->rcb_num, i);
+	rcb_p->data[PM_SET_FAILED_RCB] = i;
+	for (i = RCB_MIN; i < RCB_MAX; i++) {
+		if (cstrs & (1 << i))
+			ipu_pm_cstr_restore(i);
+	}
+	if (cstrs)
+		ipu_pm_cstr_apply();
+	for (i = RCB_MAX - 1; i >= RCB_MIN; i--) {
+		if (!(granted & (1 << i)))
+			continue;
+		m = &handle->rcb_table->rcb[i];
+		if (release_fxn[m->sub_type](handle, m, params))
+			pr_err("Can't release resource: %d\n", m->sub_type);
 	}
+	mutex_unlock(&ipu_pm_cstr_lock);
+	return retval;
+}
 
-	return PM_SUCCESS;
+/*
+  Release a set of resources and constraints on behalf of an IPU
+  client. Every member is released even if some fail; the first
+  failure is returned.
+ *
+ */
+static int ipu_pm_rel_set(struct ipu_pm_object *handle,
+			  struct rcb_block *rcb_p,
+			  struct ipu_pm_params *params)
+{
+	u32 members = ipu_pm_set_members(rcb_p);
+	struct rcb_block *m;
+	int retval = PM_SUCCESS;
+	int err;
+	int res;
+	int i;
+
+	mutex_lock(&ipu_pm_cstr_lock);
+	for (i = RCB_MAX - 1; i >= RCB_MIN; i--) {
+		if (!(members & (1 << i)))
+			continue;
+		m = &handle->rcb_table->rcb[i];
+		res = m->sub_type;
+		if (m->msg_type == PM_RELEASE_RESOURCE && _is_res(res) &&
+		    release_fxn[res]) {
+			err = release_fxn[res](handle, m, params);
+		} else if (m->msg_type == PM_RELEASE_CONSTRAINTS &&
+			   _has_cstrs(res)) {
+			ipu_pm_cstr_record(i, 0, 0, 0, 0, 0);
+			err = PM_SUCCESS;
+		} else
+			err = PM_UNSUPPORTED;
+		if (err != PM_SUCCESS && retval == PM_SUCCESS) {
+			retval = err;
+			rcb_p->data[PM_SET_FAILED_RCB] = i;
+		}
+	}
+	if (ipu_pm_cstr_apply() && retval == PM_SUCCESS)
+		retval = PM_UNSUPPORTED;
+	mutex_unlock(&ipu_pm_cstr_lock);
+	return retval;
 }
 
 /*
@@ -2675,6 +2988,7 @@ int ipu_pm_setup(struct ipu_pm_config *cfg)
 	struct ipu_pm_config tmp_cfg;
 	int retval = 0;
 	struct mutex *lock = NULL;
+	int i;
 
 	/* This sets the ref_count variable is not initialized, upper 16 bits is
 	  written with module Id to ensure correctness of refCount variable.
@@ -2715,6 +3029,17 @@ int ipu_pm_setup(struct ipu_pm_config *cfg)
 	sys_rproc = NULL;
 	app_rproc = NULL;
 
+	/* Nothing applied to omap-pm yet */
+	memset(ipu_pm_rcb_cstr, 0, sizeof(ipu_pm_rcb_cstr));
+	memset(ipu_pm_cstr_dirty, 0, sizeof(ipu_pm_cstr_dirty));
+	for (i = PM_FIRST_RES; i < PM_NUM_RES_W_CSTRS; i++) {
+		ipu_pm_res_cstr[i].perf = NO_FREQ_CONSTRAINT;
+		ipu_pm_res_cstr[i].lat = NO_LAT_CONSTRAINT;
+		ipu_pm_res_cstr[i].bw = NO_BW_CONSTRAINT;
+	}
+	ipu_pm_dbgfs = debugfs_create_file("ipu_pm", S_IRUGO | S_IWUSR,
+					   NULL, NULL, &ipu_pm_stats_fops);
+
 	memcpy(&ipu_pm_state.cfg, cfg, sizeof(struct ipu_pm_config));
 	ipu_pm_state.is_setup = true;
 
@@ -2996,6 +3321,10 @@ int ipu_pm_destroy(void)
 	destroy_workqueue(ipu_resources);
 	destroy_workqueue(ipu_clean_up);
 
+	if (!IS_ERR_OR_NULL(ipu_pm_dbgfs))
+		debugfs_remove(ipu_pm_dbgfs);
+	ipu_pm_dbgfs = NULL;
+
 	first_time = 1;
 	iounmap(sysm3Idle);
 #ifdef SR_WA
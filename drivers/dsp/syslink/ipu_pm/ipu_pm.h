@@ -90,6 +90,7 @@
 #include <linux/semaphore.h>
 #include <linux/workqueue.h>
 #include <linux/kfifo.h>
+#include <linux/ktime.h>
 
 /* Suspend/resume/other... */
 #define NUMBER_PM_EVENTS 4
@@ -283,9 +284,26 @@ enum pm_msgtype_codes{PM_FAIL,
 	PM_DISABLE_RESOURCE,
 	PM_REQUEST_CONSTRAINTS,
 	PM_RELEASE_CONSTRAINTS,
-	PM_NOTIFY_HIBERNATE
+	PM_NOTIFY_HIBERNATE,
+	PM_REQUEST_RESOURCE_SET,
+	PM_RELEASE_RESOURCE_SET
 };
 
+/* Maximum number of messages kept in the request trace */
+#define PM_TRACE_MAX	32
+
+/*
+ * PM_REQUEST_RESOURCE_SET and PM_RELEASE_RESOURCE_SET act on several RCBs
+ * with a single message. data[0] of the RCB of the message is the mask of
+ * the member RCBs, each of which holds a PM_REQUEST_RESOURCE or
+ * PM_REQUEST_CONSTRAINTS (resp. PM_RELEASE_*) in its msg_type. A request
+ * grants either all the members or none of them; on failure data[1] is
+ * set to the number of the member RCB that failed, or 0 if the combined
+ * constraints of the set could not be applied.
+ */
+#define PM_SET_MEMBERS		0
+#define PM_SET_FAILED_RCB	1
+
 enum pm_regulator_action{PM_SET_VOLTAGE,
 	PM_SET_CURRENT,
 	PM_SET_MODE,
@@ -473,6 +491,7 @@ struct ipu_pm_module_object {
 struct ipu_pm_msg {
 	u16 proc_id;
 	int pm_msg;
+	ktime_t stamp;
 };
 
 /* ipu_pm handle one for each proc SYSM3/APPM3 */
@@ -21,6 +21,11 @@
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
+#include <linux/delay.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <plat/hwspinlock.h>
 
 #include <syslink/atomic_linux.h>
@@ -41,6 +46,38 @@
 /* Macro to make a correct module magic number with refCount */
 #define GATEHWSPINLOCK_MAKE_MAGICSTAMP(x) ((GATEHWSPINLOCK_MODULEID << 12u)  \
 					| (x))
+
+/* Longest busy wait in us between two rounds of spinning on a lock */
+#define GATEHWSPINLOCK_BACKOFF_MAX_US	64
+
+/*
+ *  Number of attempts to take a busy lock before backing off. After each
+ *  round the gate waits 1, 2, 4... up to GATEHWSPINLOCK_BACKOFF_MAX_US us,
+ *  then gives the CPU away for a tick between rounds if the caller can
+ *  sleep. 0 spins on the lock until it is free.
+ */
+static uint spin_count = 64;
+module_param(spin_count, uint, 0644);
+MODULE_PARM_DESC(spin_count, "Attempts on a busy HW spinlock before backing "
+		"off, 0 spins until the lock is free");
+
+/*
+ *  Contention statistics of a lock, shown in debugfs
+ */
+struct gatehwspinlock_stats {
+	u32 acquired;
+	/* Number of times the lock was taken */
+	u32 contended;
+	/* Number of times the lock was busy on the first attempt */
+	u64 spins;
+	/* Total number of failed attempts */
+	u32 sleeps;
+	/* Number of times the CPU was given away while waiting */
+	u32 max_wait_us;
+	/* Longest wait for the lock */
+	u32 max_hold_us;
+	/* Longest time the lock was held */
+};
 /*
  *  structure for gatehwspinlock module state
  */
@@ -55,6 +92,10 @@ struct gatehwspinlock_module_object {
 	u32 num_reserved; /* Number of reserved locks */
 	struct hwspinlock **hw_lock_handles;
 	/* Array of hwspinlock handles controlled by gatemp */
+	struct gatehwspinlock_stats *stats;
+	/* Array of contention statistics of each lock */
+	struct dentry *dbgfs;
+	/* debugfs file showing the statistics */
 };
 
 /*
@@ -67,6 +108,8 @@ struct gatehwspinlock_object {
 	u32 nested;
 	void *local_gate;
 	struct hwspinlock *hwhandle;
+	struct gatehwspinlock_stats *stats;
+	ktime_t acquired;
 };
 
 /*
@@ -98,6 +141,133 @@ static struct gatehwspinlock_module_object *gatehwspinlock_module =
 #define gate_enter_system() (int *)0
 #define gate_leave_system(key) {}
 
+/*
+ * ======== gatehwspinlock_acquire ========
+ *  Purpose:
+ *  Take the HW spinlock of a gate, spinning spin_count times before
+ *  backing off exponentially so that a lock held for long by a remote
+ *  processor does not keep the A9 busy.
+ */
+static int gatehwspinlock_acquire(struct gatehwspinlock_object *obj)
+{
+	struct gatehwspinlock_stats *st = obj->stats;
+	u32 delay = 1;
+	u32 spins = 0;
+	ktime_t start;
+	u32 wait_us;
+	uint count;
+	uint i;
+	int retval;
+
+	/* One PM reference for the whole wait, dropped on release */
+	retval = hwspinlock_lock_prepare(obj->hwhandle);
+	if (retval < 0)
+		return retval;
+	if (likely(hwspinlock_lock_poll(obj->hwhandle) != HWSPINLOCK_BUSY))
+		goto exit;
+
+	start = ktime_get();
+	st->contended++;
+	count = spin_count;
+	if (count == 0) {
+		while (hwspinlock_lock_poll(obj->hwhandle) == HWSPINLOCK_BUSY)
+			cpu_relax();
+		goto wait_done;
+	}
+
+	for (;;) {
+		for (i = 0; i < count; i++) {
+			if (hwspinlock_lock_poll(obj->hwhandle) !=
+							HWSPINLOCK_BUSY)
+				goto spin_done;
+			cpu_relax();
+		}
+		spins += count;
+
+		/* The local gate is a mutex, so a caller holding it can
+		 * sleep while the remote processor owns the lock */
+		if (delay <= GATEHWSPINLOCK_BACKOFF_MAX_US) {
+			udelay(delay);
+			delay <<= 1;
+		} else if (obj->local_gate != NULL) {
+			schedule_timeout_uninterruptible(1);
+			st->sleeps++;
+		} else
+			udelay(GATEHWSPINLOCK_BACKOFF_MAX_US);
+	}
+
+spin_done:
+	spins += i;
+	st->spins += spins;
+wait_done:
+	wait_us = (u32) ktime_us_delta(ktime_get(), start);
+	if (wait_us > st->max_wait_us)
+		st->max_wait_us = wait_us;
+exit:
+	st->acquired++;
+	obj->acquired = ktime_get();
+	return 0;
+}
+
+/*
+ * ======== gatehwspinlock_release ========
+ *  Purpose:
+ *  Release the HW spinlock of a gate and account the hold time.
+ */
+static int gatehwspinlock_release(struct gatehwspinlock_object *obj)
+{
+	u32 hold_us = (u32) ktime_us_delta(ktime_get(), obj->acquired);
+
+	if (hold_us > obj->stats->max_hold_us)
+		obj->stats->max_hold_us = hold_us;
+	return hwspinlock_unlock(obj->hwhandle);
+}
+
+static int gatehwspinlock_stats_show(struct seq_file *s, void *unused)
+{
+	struct gatehwspinlock_stats *st;
+	u32 i;
+
+	seq_printf(s, "times in us\n%4s %10s %10s %12s %8s %10s %10s\n",
+		   "lock", "acquired", "contended", "spins", "sleeps",
+		   "max_wait", "max_hold");
+	for (i = gatehwspinlock_module->num_reserved;
+	     i < gatehwspinlock_module->num_locks; i++) {
+		st = &gatehwspinlock_module->stats[i];
+		if (!st->acquired)
+			continue;
+		seq_printf(s, "%4u %10u %10u %12llu %8u %10u %10u\n", i,
+			   st->acquired, st->contended,
+			   (unsigned long long) st->spins, st->sleeps,
+			   st->max_wait_us, st->max_hold_us);
+	}
+	return 0;
+}
+
+static int gatehwspinlock_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, gatehwspinlock_stats_show, inode->i_private);
+}
+
+/* any write resets the statistics */
+static ssize_t gatehwspinlock_stats_write(struct file *file,
+					  const char __user *buf,
+					  size_t count, loff_t *ppos)
+{
+	memset(gatehwspinlock_module->stats, 0,
+	       gatehwspinlock_module->num_locks *
+				sizeof(struct gatehwspinlock_stats));
+	return count;
+}
+
+static const struct file_operations gatehwspinlock_stats_fops = {
+	.open		= gatehwspinlock_stats_open,
+	.read		= seq_read,
+	.write		= gatehwspinlock_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /* =============================================================================
  * APIS
  * =============================================================================
@@ -178,6 +348,12 @@ int gatehwspinlock_setup(const struct gatehwspinlock_config *config)
 
 	gatehwspinlock_module->base_addr = (void *)config->base_addr;
 	gatehwspinlock_module->num_locks = config->num_locks;
+	gatehwspinlock_module->stats = kzalloc(gatehwspinlock_module->num_locks *
+				sizeof(struct gatehwspinlock_stats), GFP_KERNEL);
+	if (gatehwspinlock_module->stats == NULL) {
+		retval = -ENOMEM;
+		goto exit;
+	}
 	for (i = gatehwspinlock_module->num_reserved;
 		i < gatehwspinlock_module->num_locks; i++) {
 			lock_handle = hwspinlock_request_specific(i);
@@ -189,6 +365,9 @@ int gatehwspinlock_setup(const struct gatehwspinlock_config *config)
 			}
 			gatehwspinlock_module->hw_lock_handles[i] = lock_handle;
 	}
+	gatehwspinlock_module->dbgfs = debugfs_create_file("gatehwspinlock",
+				S_IRUGO | S_IWUSR, NULL, NULL,
+				&gatehwspinlock_stats_fops);
 	return 0;
 
 spinlock_request_fail:
@@ -197,6 +376,8 @@ spinlock_request_fail:
 		gatehwspinlock_module->hw_lock_handles[i] = NULL;
 	}
 exit:
+	kfree(gatehwspinlock_module->stats);
+	gatehwspinlock_module->stats = NULL;
 	kfree(gatehwspinlock_module->hw_lock_handles);
 	atomic_dec_return(&gatehwspinlock_module->ref_count);
 	if (retval < 0)
@@ -234,6 +415,10 @@ int gatehwspinlock_destroy(void)
 	}
 	gate_leave_system(key);
 
+	if (!IS_ERR_OR_NULL(gatehwspinlock_module->dbgfs))
+		debugfs_remove(gatehwspinlock_module->dbgfs);
+	gatehwspinlock_module->dbgfs = NULL;
+
 	for (i = gatehwspinlock_module->num_reserved;
 		i < gatehwspinlock_module->num_locks; i++) {
 			lock_handle = gatehwspinlock_module->hw_lock_handles[i];
@@ -246,6 +431,8 @@ int gatehwspinlock_destroy(void)
 				sizeof(struct gatehwspinlock_config));
 	kfree(gatehwspinlock_module->hw_lock_handles);
 	gatehwspinlock_module->hw_lock_handles = NULL;
+	kfree(gatehwspinlock_module->stats);
+	gatehwspinlock_module->stats = NULL;
 	return 0;
 
 exit:
@@ -368,6 +555,7 @@ void *gatehwspinlock_create(enum igatempsupport_local_protect local_protect,
 	obj->nested   = 0;
 	obj->hwhandle = \
 		gatehwspinlock_module->hw_lock_handles[params->resource_id];
+	obj->stats = &gatehwspinlock_module->stats[params->resource_id];
 	if (obj->hwhandle == NULL) {
 		retval = -EBUSY;
 		pr_err("hwspinlock_request failed for id = %d",
@@ -467,7 +655,7 @@ int *gatehwspinlock_enter(void *gphandle)
 		return key;
 
 	/* Enter the spinlock */
-	retval = hwspinlock_lock(obj->hwhandle);
+	retval = gatehwspinlock_acquire(obj);
 	if (retval < 0) {
 		obj->nested--;
 		mutex_unlock((struct mutex *)obj->local_gate);
@@ -505,7 +693,7 @@ void gatehwspinlock_leave(void *gphandle, int *key)
 	obj->nested--;
 	/* Leave the spinlock if the leave() is not nested */
 	if (obj->nested == 0) {
-		retval = hwspinlock_unlock(obj->hwhandle);
+		retval = gatehwspinlock_release(obj);
 		if (retval < 0) {
 			obj->nested++;
 			goto exit;
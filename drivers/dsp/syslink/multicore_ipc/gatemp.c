@@ -975,11 +975,21 @@ exit:
 	return;
 }
 
+/*
+ * Gates protected by the system proxy, the HW spinlock on OMAP4, are by far
+ * the most used ones (ListMP, HeapBufMP...); call the proxy directly instead
+ * of through the IGateProvider function pointers.
+ */
 int *gatemp_enter(void *obj)
 {
 	int *key;
 	struct gatemp_object *gmp_handle = (struct gatemp_object *)obj;
 
+	if (likely(gmp_handle->remote_protect == GATEMP_REMOTEPROTECT_SYSTEM
+					&& gmp_handle->gate_handle != NULL))
+		return gatemp_remote_system_proxy_enter(
+						gmp_handle->gate_handle);
+
 	key = igateprovider_enter(gmp_handle->gate_handle);
 
 	return key;
@@ -989,6 +999,12 @@ void gatemp_leave(void *obj, int *key)
 {
 	struct gatemp_object *gmp_handle = (struct gatemp_object *)obj;
 
+	if (likely(gmp_handle->remote_protect == GATEMP_REMOTEPROTECT_SYSTEM
+					&& gmp_handle->gate_handle != NULL)) {
+		gatemp_remote_system_proxy_leave(gmp_handle->gate_handle, key);
+		return;
+	}
+
 	igateprovider_leave(gmp_handle->gate_handle, key);
 }
 
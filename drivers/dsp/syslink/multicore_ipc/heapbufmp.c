@@ -22,6 +22,7 @@
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
+#include <linux/percpu.h>
 
 #include <atomic_linux.h>
 #include <multiproc.h>
@@ -43,6 +44,20 @@
 
 #define ROUND_UP(a, b)	(((a) + ((b) - 1)) & (~((b) - 1)))
 
+/* Max number of blocks in a per-CPU cache */
+#define HEAPBUFMP_CACHE_MAX			32
+/* All the caches of an instance hold at most 1/4 of its blocks */
+#define HEAPBUFMP_CACHE_SHARE			4
+
+/*
+ *  Number of blocks each CPU keeps for every heapbufmp instance. Blocks
+ *  move between a cache and the shared free list half a cache at a time,
+ *  so the gate is entered once per batch instead of once per block.
+ */
+static uint cache_size = 16;
+module_param(cache_size, uint, 0444);
+MODULE_PARM_DESC(cache_size, "HeapBufMP blocks cached per CPU, 0 disables");
+
 /*
  *  Structure defining attribute parameters for the heapbufmp module
  */
@@ -100,6 +115,17 @@ static struct heapbufmp_module_object heapbufmp_state = {
 /* Pointer to module state */
 static struct heapbufmp_module_object *heapbufmp_module = &heapbufmp_state;
 
+/*
+ *  Structure for the per-CPU cache of free blocks of an instance
+ */
+struct heapbufmp_cache {
+	u32 count; /* Number of blocks in the cache */
+	u32 hits; /* Allocs and frees served by the cache */
+	u32 refills; /* Batches got from the shared free list */
+	u32 flushes; /* Batches put back on the shared free list */
+	void *blocks[HEAPBUFMP_CACHE_MAX]; /* Cached blocks, hottest last */
+};
+
 /*
  *  Structure for the handle for the heapbufmp
  */
@@ -118,6 +144,8 @@ struct heapbufmp_obj {
 	u32 num_blocks; /* Number of blocks in buffer */
 	bool exact; /* Exact match flag */
 	struct heapbufmp_proc_attrs owner; /* owner processor info */
+	struct heapbufmp_cache __percpu *cache; /* Per-CPU free blocks */
+	u32 cache_size; /* Max number of blocks in each cache */
 	void *top; /* Pointer to the top object */
 	struct heapbufmp_params params; /* The creation parameter structure */
 };
@@ -130,6 +158,17 @@ struct heapbufmp_obj {
  */
 static int heapbufmp_post_init(struct heapbufmp_object *handle);
 
+static void heapbufmp_cache_init(struct heapbufmp_obj *obj);
+
+static void heapbufmp_cache_drain(struct heapbufmp_obj *obj);
+
+static void *heapbufmp_cache_get(struct heapbufmp_obj *obj);
+
+static int heapbufmp_cache_put(struct heapbufmp_obj *obj, void *block);
+
+static void heapbufmp_cache_stats(struct heapbufmp_obj *obj,
+					struct heapbufmp_cache *sum);
+
 /* =============================================================================
  * APIs called directly by applications
  * =============================================================================
@@ -403,6 +442,8 @@ static int _heapbufmp_create(void **handle_ptr,
 
 	obj->ns_key	 = NULL;
 	obj->alloc_size = 0;
+	obj->cache = NULL;
+	obj->cache_size = 0;
 
 	/* Put in local ilst */
 	retval = mutex_lock_interruptible(heapbufmp_module->local_lock);
@@ -560,6 +601,8 @@ static int _heapbufmp_create(void **handle_ptr,
 		}
 	}
 
+	heapbufmp_cache_init(obj);
+
 	*handle_ptr = (void *)handle;
 	return retval;
 
@@ -708,6 +751,10 @@ int heapbufmp_delete(void **handle_ptr)
 		/* Release the shared lock */
 		gatemp_leave(obj->gate, key);
 
+		/* Cached blocks go away with the list */
+		free_percpu(obj->cache);
+		obj->cache = NULL;
+
 		if (obj->free_list != NULL)
 			/* Free the list */
 			listmp_delete(&obj->free_list);
@@ -885,6 +932,9 @@ int heapbufmp_close(void **handle_ptr)
 				&& (obj->owner.open_count == 0)) {
 			list_del(&obj->list_elem);
 
+			/* Give the cached blocks back to the other users */
+			heapbufmp_cache_drain(obj);
+
 			if (obj->free_list != NULL)
 				/* Close the list */
 				listmp_close(&obj->free_list);
@@ -962,6 +1012,15 @@ void *heapbufmp_alloc(void *hphandle, u32 size, u32 align)
 		goto error;
 	}
 
+	if (obj->cache != NULL) {
+		block = heapbufmp_cache_get(obj);
+		if (unlikely(block == NULL)) {
+			retval = -ENOMEM;
+			goto error;
+		}
+		return block;
+	}
+
 	/*key = gatemp_enter(obj->gate); gate protection acquired in listmp */
 	block = listmp_get_head((struct listmp_object *) obj->free_list);
 	if (unlikely(block == NULL)) {
@@ -1044,6 +1103,13 @@ int heapbufmp_free(void *hphandle, void *block, u32 size)
 		goto error;
 	}
 
+	if (obj->cache != NULL) {
+		retval = heapbufmp_cache_put(obj, block);
+		if (unlikely(retval < 0))
+			goto error;
+		return 0;
+	}
+
 	/* key = gatemp_enter(obj->gate); */
 	retval = listmp_put_tail(obj->free_list, block);
 	if (unlikely(retval < 0)) {
@@ -1093,6 +1159,7 @@ void heapbufmp_get_stats(void *hphandle, struct memory_stats *stats)
 {
 	struct heapbufmp_object *object = NULL;
 	struct heapbufmp_obj *obj = NULL;
+	struct heapbufmp_cache cached;
 	int *key;
 	s32 retval = 0;
 	u32 block_size;
@@ -1122,6 +1189,8 @@ void heapbufmp_get_stats(void *hphandle, struct memory_stats *stats)
 	block_size = obj->attrs->block_size;
 
 	if (unlikely(heapbufmp_module->cfg.track_allocs)) {
+		/* Blocks in the per-CPU caches are free too */
+		heapbufmp_cache_stats(obj, &cached);
 
 		key = gatemp_enter(obj->gate);
 #if 0
@@ -1134,9 +1203,9 @@ void heapbufmp_get_stats(void *hphandle, struct memory_stats *stats)
 		}
 #endif
 
-		stats->total_free_size = block_size * obj->attrs->
-							num_free_blocks;
-		stats->largest_free_size = (obj->attrs->num_free_blocks > 0) ?
+		stats->total_free_size = block_size * (obj->attrs->
+						num_free_blocks + cached.count);
+		stats->largest_free_size = (stats->total_free_size > 0) ?
 					block_size : 0; /* determined later */
 
 		gatemp_leave(obj->gate, key);
@@ -1192,6 +1261,7 @@ void heapbufmp_get_extended_stats(void *hphandle,
 	s32 retval = 0;
 	struct heapbufmp_object *object = NULL;
 	struct heapbufmp_obj *obj = NULL;
+	struct heapbufmp_cache cached;
 	int *key;
 
 	if (atomic_cmpmask_and_lt(&(heapbufmp_module->ref_count),
@@ -1251,6 +1321,20 @@ void heapbufmp_get_extended_stats(void *hphandle,
 
 	gatemp_leave(obj->gate, key);
 
+	/*
+	 * Blocks in the per-CPU caches of this processor left the shared free
+	 * list but are not allocated. They are still counted in
+	 * max_allocated_blocks, which is only updated as blocks leave the list.
+	 */
+	heapbufmp_cache_stats(obj, &cached);
+	if (heapbufmp_module->cfg.track_allocs &&
+		stats->num_allocated_blocks >= cached.count)
+		stats->num_allocated_blocks -= cached.count;
+	stats->num_cached_blocks = cached.count;
+	stats->cache_hits = cached.hits;
+	stats->cache_refills = cached.refills;
+	stats->cache_flushes = cached.flushes;
+
 	return;
 
 error:
@@ -1553,3 +1637,188 @@ error:
 	pr_err("heapmem_post_init status: %x\n", retval);
 	return retval;
 }
+
+/*
+ * ======== heapbufmp_cache_init ========
+ *  Purpose:
+ *  Set up the per-CPU caches of an instance, unless it has too few blocks
+ *  to spare for them
+ */
+static void heapbufmp_cache_init(struct heapbufmp_obj *obj)
+{
+	u32 size;
+
+	size = min_t(u32, cache_size, HEAPBUFMP_CACHE_MAX);
+	size = min_t(u32, size, obj->num_blocks /
+			(HEAPBUFMP_CACHE_SHARE * num_possible_cpus()));
+	if (size < 2)
+		return;
+
+	obj->cache = alloc_percpu(struct heapbufmp_cache);
+	if (obj->cache != NULL)
+		obj->cache_size = size;
+}
+
+/*
+ * ======== heapbufmp_cache_track ========
+ *  Purpose:
+ *  Account for blocks leaving (delta < 0) or joining the shared free list
+ */
+static void heapbufmp_cache_track(struct heapbufmp_obj *obj, int delta)
+{
+	int *key;
+
+	if (likely(!heapbufmp_module->cfg.track_allocs))
+		return;
+
+	key = gatemp_enter(obj->gate);
+	obj->attrs->num_free_blocks += delta;
+	if (obj->attrs->num_free_blocks < obj->attrs->min_free_blocks) {
+		/* save the new minimum */
+		obj->attrs->min_free_blocks = obj->attrs->num_free_blocks;
+	}
+	gatemp_leave(obj->gate, key);
+}
+
+/*
+ * ======== heapbufmp_cache_return ========
+ *  Purpose:
+ *  Put a batch of blocks back on the shared free list
+ */
+static int heapbufmp_cache_return(struct heapbufmp_obj *obj, void **blocks,
+					u32 n)
+{
+	int put;
+
+	put = listmp_put_tail_many(obj->free_list, blocks, n);
+	if (put > 0)
+		heapbufmp_cache_track(obj, put);
+
+	return (put == n) ? 0 : -EFAULT;
+}
+
+/*
+ * ======== heapbufmp_cache_get ========
+ *  Purpose:
+ *  Alloc a block from the cache of this CPU, refilling it from the shared
+ *  free list when it is empty
+ */
+static void *heapbufmp_cache_get(struct heapbufmp_obj *obj)
+{
+	struct heapbufmp_cache *cache;
+	void *batch[HEAPBUFMP_CACHE_MAX];
+	void *block;
+	int n;
+	int i;
+
+	cache = per_cpu_ptr(obj->cache, get_cpu());
+	if (likely(cache->count > 0)) {
+		block = cache->blocks[--cache->count];
+		cache->hits++;
+		put_cpu();
+		return block;
+	}
+	put_cpu();
+
+	/* The gate may sleep, so the list is accessed with preemption on */
+	n = listmp_get_head_many(obj->free_list, batch, obj->cache_size / 2);
+	if (n <= 0)
+		return NULL;
+	heapbufmp_cache_track(obj, -n);
+	block = batch[--n];
+
+	/* We may have moved to another CPU, or its cache been refilled */
+	cache = per_cpu_ptr(obj->cache, get_cpu());
+	cache->refills++;
+	i = min_t(int, n, obj->cache_size - cache->count);
+	memcpy(&cache->blocks[cache->count], &batch[n - i], i * sizeof(void *));
+	cache->count += i;
+	n -= i;
+	put_cpu();
+
+	if (n > 0)
+		heapbufmp_cache_return(obj, batch, n);
+
+	return block;
+}
+
+/*
+ * ======== heapbufmp_cache_put ========
+ *  Purpose:
+ *  Free a block to the cache of this CPU, moving the coldest half of the
+ *  cache to the shared free list when it is full
+ */
+static int heapbufmp_cache_put(struct heapbufmp_obj *obj, void *block)
+{
+	struct heapbufmp_cache *cache;
+	void *batch[HEAPBUFMP_CACHE_MAX];
+	u32 n;
+
+	cache = per_cpu_ptr(obj->cache, get_cpu());
+	if (likely(cache->count < obj->cache_size)) {
+		cache->blocks[cache->count++] = block;
+		cache->hits++;
+		put_cpu();
+		return 0;
+	}
+
+	n = obj->cache_size / 2;
+	memcpy(batch, cache->blocks, n * sizeof(void *));
+	cache->count -= n;
+	memmove(cache->blocks, &cache->blocks[n],
+		cache->count * sizeof(void *));
+	cache->blocks[cache->count++] = block;
+	cache->flushes++;
+	put_cpu();
+
+	return heapbufmp_cache_return(obj, batch, n);
+}
+
+/*
+ * ======== heapbufmp_cache_drain ========
+ *  Purpose:
+ *  Put all the cached blocks back on the shared free list and free the
+ *  caches. Called when no more allocs or frees can happen on the instance.
+ */
+static void heapbufmp_cache_drain(struct heapbufmp_obj *obj)
+{
+	struct heapbufmp_cache *cache;
+	int cpu;
+
+	if (obj->cache == NULL)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(obj->cache, cpu);
+		if (cache->count > 0)
+			heapbufmp_cache_return(obj, cache->blocks,
+						cache->count);
+		cache->count = 0;
+	}
+	free_percpu(obj->cache);
+	obj->cache = NULL;
+}
+
+/*
+ * ======== heapbufmp_cache_stats ========
+ *  Purpose:
+ *  Sum up the counters of the per-CPU caches
+ */
+static void heapbufmp_cache_stats(struct heapbufmp_obj *obj,
+					struct heapbufmp_cache *sum)
+{
+	struct heapbufmp_cache *cache;
+	int cpu;
+
+	memset(sum, 0, offsetof(struct heapbufmp_cache, blocks));
+	if (obj->cache == NULL)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(obj->cache, cpu);
+		sum->count += cache->count;
+		sum->hits += cache->hits;
+		sum->refills += cache->refills;
+		sum->flushes += cache->flushes;
+	}
+}
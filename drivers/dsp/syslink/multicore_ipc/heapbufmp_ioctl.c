@@ -391,9 +391,11 @@ static int heapbufmp_ioctl_get_extended_stats(struct heapbufmp_cmd_args *cargs)
 							handle, &stats);
 	cargs->api_status = 0;
 
+	/* The user side structure ends before the cache statistics */
 	size = copy_to_user((void __user *)cargs->args.get_extended_stats.stats,
 				&stats,
-				sizeof(struct heapbufmp_extended_stats));
+				offsetof(struct heapbufmp_extended_stats,
+					num_cached_blocks));
 	if (size)
 		status = -EFAULT;
 
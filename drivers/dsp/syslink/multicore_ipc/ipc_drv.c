@@ -26,6 +26,7 @@
 #include <linux/uaccess.h>
 #include <linux/slab.h>
 #include <linux/notifier.h>
+#include <linux/rcupdate.h>
 #include <ipc_ioctl.h>
 #include <ipc.h>
 #include <drv_notify.h>
@@ -428,6 +429,8 @@ static void __exit ipc_exit(void)
 	dev_t devno;
 
 	ipc_modules_exit();
+	/* nameserver entries are freed from RCU callbacks in this module */
+	rcu_barrier();
 	devno = MKDEV(ipc_major, ipc_minor);
 	if (ipc_device) {
 		cdev_del(&ipc_device->cdev);
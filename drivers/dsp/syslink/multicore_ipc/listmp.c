@@ -1018,6 +1018,94 @@ exit:
 	return status;
 }
 
+/* Function to get up to n elements from the head of a shared memory list,
+ * entering the list gate only once. Returns the number of elements got. */
+int listmp_get_head_many(void *listmp_handle, void **elems, u32 n)
+{
+	struct listmp_object *obj = NULL;
+	struct listmp_elem *head = NULL;
+	struct listmp_elem *elem = NULL;
+	struct listmp_elem *local_next = NULL;
+	int *key;
+	u32 i = 0;
+
+	if (WARN_ON(unlikely(atomic_cmpmask_and_lt(&(listmp_module->ref_count),
+				LISTMP_MAKE_MAGICSTAMP(0),
+				LISTMP_MAKE_MAGICSTAMP(1)) == true)))
+		return -ENODEV;
+	if (WARN_ON(unlikely(listmp_handle == NULL || elems == NULL)))
+		return -EINVAL;
+
+	obj = (struct listmp_object *)listmp_handle;
+	head = (struct listmp_elem *)&obj->attrs->head;
+
+	key = gatemp_enter(obj->gatemp_handle);
+	while (i < n) {
+		elem = sharedregion_get_ptr((u32 *)head->next);
+		dsb();
+		/* Stop when the list is empty */
+		if (WARN_ON(elem == NULL) || elem == head)
+			break;
+		local_next = sharedregion_get_ptr((u32 *)elem->next);
+		if (WARN_ON(local_next == NULL))
+			break;
+
+		/* Unlink elem, as listmp_get_head() does */
+		head->next = elem->next;
+		dsb();
+		local_next->prev = elem->prev;
+		elems[i++] = elem;
+	}
+	gatemp_leave(obj->gatemp_handle, key);
+
+	return i;
+}
+
+/* Function to put n elements at the tail of a shared memory list,
+ * entering the list gate only once. Returns the number of elements put. */
+int listmp_put_tail_many(void *listmp_handle, void **elems, u32 n)
+{
+	struct listmp_object *obj = NULL;
+	struct listmp_elem *elem = NULL;
+	struct listmp_elem *shared_elem = NULL;
+	struct listmp_elem *local_prev_elem = NULL;
+	int *key;
+	u32 i;
+
+	if (WARN_ON(unlikely(atomic_cmpmask_and_lt(&(listmp_module->ref_count),
+				LISTMP_MAKE_MAGICSTAMP(0),
+				LISTMP_MAKE_MAGICSTAMP(1)) == true)))
+		return -ENODEV;
+	if (WARN_ON(unlikely(listmp_handle == NULL || elems == NULL)))
+		return -EINVAL;
+
+	obj = (struct listmp_object *)listmp_handle;
+
+	key = gatemp_enter(obj->gatemp_handle);
+	for (i = 0; i < n; i++) {
+		elem = (struct listmp_elem *)elems[i];
+		shared_elem = (struct listmp_elem *)sharedregion_get_srptr(
+					(void *)elem, sharedregion_get_id(elem));
+		if (WARN_ON((u32 *)shared_elem == SHAREDREGION_INVALIDSRPTR))
+			break;
+
+		elem->prev = obj->attrs->head.prev;
+		dsb();
+		local_prev_elem = sharedregion_get_ptr((u32 *)elem->prev);
+		if (WARN_ON(local_prev_elem == NULL))
+			break;
+		dsb();
+
+		/* Add the new elem into the list */
+		elem->next = local_prev_elem->next;
+		local_prev_elem->next = shared_elem;
+		obj->attrs->head.prev = shared_elem;
+	}
+	gatemp_leave(obj->gatemp_handle, key);
+
+	return i;
+}
+
 /* Function to insert an element into a shared memory list */
 int listmp_insert(void *listmp_handle, struct listmp_elem *new_elem,
 			struct listmp_elem *cur_elem)
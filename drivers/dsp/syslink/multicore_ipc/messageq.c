@@ -151,6 +151,10 @@ struct messageq_module_object {
 	/* Default instance creation parameters */
 	void *transports[MULTIPROC_MAXPROCESSORS][MESSAGEQ_NUM_PRIORITY_QUEUES];
 	/* Transport to be set in messageq_register_transport */
+	const struct messageq_transport_fxns
+		*transport_fxns[MULTIPROC_MAXPROCESSORS]
+			[MESSAGEQ_NUM_PRIORITY_QUEUES];
+	/* Functions of each registered transport */
 	void **queues; /*messageq_handle *queues;*/
 	/* Grow option */
 	void **heaps; /*Heap_Handle *heaps; */
@@ -184,6 +188,11 @@ struct messageq_object {
 };
 
 
+/* Functions of the shared memory list transport */
+static const struct messageq_transport_fxns messageq_transportshm_fxns = {
+	.put = transportshm_put,
+};
+
 static struct messageq_module_object messageq_state = {
 				.ns_handle = NULL,
 				.gate_handle = NULL,
@@ -1015,6 +1024,24 @@ exit:
 }
 EXPORT_SYMBOL(messageq_free);
 
+/* Find the transport for a message to a remote processor */
+static void *_messageq_get_transport(u16 dst_proc_id, messageq_msg msg,
+				const struct messageq_transport_fxns **fxns)
+{
+	u32 priority;
+	void *transport;
+
+	priority = (u32)((msg->flags) & MESSAGEQ_TRANSPORTPRIORITYMASK);
+	transport = messageq_module->transports[dst_proc_id][priority];
+	if (transport == NULL) {
+		/* Try the other transport */
+		priority = !priority;
+		transport = messageq_module->transports[dst_proc_id][priority];
+	}
+	*fxns = messageq_module->transport_fxns[dst_proc_id][priority];
+	return transport;
+}
+
 /* Put a message in the queue */
 int messageq_put(u32 queue_id, messageq_msg msg)
 {
@@ -1022,7 +1049,7 @@ int messageq_put(u32 queue_id, messageq_msg msg)
 	u16 dst_proc_id = (u16)(queue_id >> 16);
 	struct messageq_object *obj = NULL;
 	void *transport = NULL;
-	u32 priority;
+	const struct messageq_transport_fxns *fxns = NULL;
 
 	if (WARN_ON(unlikely(atomic_cmpmask_and_lt(
 				&(messageq_module->ref_count),
@@ -1049,21 +1076,13 @@ int messageq_put(u32 queue_id, messageq_msg msg)
 			goto exit;
 		}
 
-		priority = (u32)((msg->flags) & MESSAGEQ_TRANSPORTPRIORITYMASK);
 		/* Call the transport associated with this message queue */
-		transport = messageq_module->transports[dst_proc_id][priority];
-		if (transport == NULL) {
-			/* Try the other transport */
-			priority = !priority;
-			transport =
-			messageq_module->transports[dst_proc_id][priority];
-		}
-
+		transport = _messageq_get_transport(dst_proc_id, msg, &fxns);
 		if (unlikely(transport == NULL)) {
 			status = -ENODEV;
 			goto exit;
 		}
-		status = transportshm_put(transport, msg);
+		status = fxns->put(transport, msg);
 		if (unlikely(status < 0))
 			goto exit;
 	} else {
@@ -1113,6 +1132,93 @@ exit:
 }
 EXPORT_SYMBOL(messageq_put);
 
+/* Put several messages in the same queue */
+int messageq_put_many(u32 queue_id, messageq_msg *msgs, u32 n)
+{
+	int status = 0;
+	u16 dst_proc_id = (u16)(queue_id >> 16);
+	void *transport = NULL;
+	const struct messageq_transport_fxns *fxns = NULL;
+	const struct messageq_transport_fxns *next_fxns;
+	u32 i, done, run;
+
+	if (WARN_ON(unlikely(atomic_cmpmask_and_lt(
+				&(messageq_module->ref_count),
+				MESSAGEQ_MAKE_MAGICSTAMP(0),
+				MESSAGEQ_MAKE_MAGICSTAMP(1)) == true))) {
+		status = -ENODEV;
+		goto exit;
+	}
+	if (WARN_ON(unlikely(queue_id == MESSAGEQ_INVALIDMESSAGEQ))) {
+		status = -EINVAL;
+		goto exit;
+	}
+	if (WARN_ON(unlikely(msgs == NULL || n == 0))) {
+		status = -EINVAL;
+		goto exit;
+	}
+
+	if (unlikely(dst_proc_id == multiproc_self()) ||
+	    unlikely(dst_proc_id >= multiproc_get_num_processors())) {
+		/* local queue, or let messageq_put() report the error */
+		for (i = 0; i < n; i++) {
+			status = messageq_put(queue_id, msgs[i]);
+			if (status < 0)
+				break;
+		}
+		return i ? i : status;
+	}
+
+	/* each run of messages for the same transport is passed in one go */
+	for (done = 0; done < n; done += run) {
+		transport = _messageq_get_transport(dst_proc_id, msgs[done],
+						    &fxns);
+		if (unlikely(transport == NULL)) {
+			status = -ENODEV;
+			break;
+		}
+		for (run = 1; done + run < n; run++)
+			if (_messageq_get_transport(dst_proc_id,
+					msgs[done + run], &next_fxns) !=
+								transport)
+				break;
+
+		if (fxns->put_many == NULL) {
+			/* the transport sends one at a time */
+			for (i = 0; i < run; i++) {
+				status = messageq_put(queue_id,
+						      msgs[done + i]);
+				if (status < 0)
+					break;
+			}
+			status = i ? i : status;
+		} else {
+			for (i = 0; i < run; i++) {
+				msgs[done + i]->dst_id = (u16)(queue_id);
+				msgs[done + i]->dst_proc = dst_proc_id;
+			}
+			status = fxns->put_many(transport,
+					(void **)(msgs + done), run);
+		}
+
+		/* stop at the first message that could not be put */
+		if (status < 0)
+			break;
+		if (status < run) {
+			done += status;
+			break;
+		}
+	}
+	if (done)
+		return done;
+
+exit:
+	if (status < 0)
+		pr_err("messageq_put_many failed! status = 0x%x\n", status);
+	return status;
+}
+EXPORT_SYMBOL(messageq_put_many);
+
 /* Register a heap */
 int messageq_register_heap(void *heap_handle, u16 heap_id)
 {
@@ -1226,6 +1332,16 @@ exit:
 /* Register a transport */
 int messageq_register_transport(void *messageq_transportshm_handle,
 				 u16 proc_id, u32 priority)
+{
+	return messageq_register_transport_fxns(messageq_transportshm_handle,
+				proc_id, priority, &messageq_transportshm_fxns);
+}
+EXPORT_SYMBOL(messageq_register_transport);
+
+/* Register a transport with its own functions */
+int messageq_register_transport_fxns(void *messageq_transportshm_handle,
+				u16 proc_id, u32 priority,
+				const struct messageq_transport_fxns *fxns)
 {
 	int  status = 0;
 
@@ -1240,6 +1356,10 @@ int messageq_register_transport(void *messageq_transportshm_handle,
 		status = -EINVAL;
 		goto exit;
 	}
+	if (WARN_ON(unlikely(fxns == NULL || fxns->put == NULL))) {
+		status = -EINVAL;
+		goto exit;
+	}
 	if (WARN_ON(unlikely(proc_id >= multiproc_get_num_processors()))) {
 		status = -EINVAL;
 		goto exit;
@@ -1249,6 +1369,7 @@ int messageq_register_transport(void *messageq_transportshm_handle,
 	if (status)
 		goto exit;
 	if (messageq_module->transports[proc_id][priority] == NULL) {
+		messageq_module->transport_fxns[proc_id][priority] = fxns;
 		messageq_module->transports[proc_id][priority] = \
 			messageq_transportshm_handle;
 	} else {
@@ -1265,7 +1386,7 @@ exit:
 	}
 	return status;
 }
-EXPORT_SYMBOL(messageq_register_transport);
+EXPORT_SYMBOL(messageq_register_transport_fxns);
 
 /* Unregister a transport */
 void messageq_unregister_transport(u16 proc_id, u32 priority)
@@ -123,6 +123,63 @@ exit:
 	return 0;
 }
 
+/* Number of messages handed to messageq_put_many() at a time */
+#define MESSAGEQ_PUTMANY_CHUNK	16
+
+/*
+ * ======== messageq_ioctl_put_many ========
+ *  Purpose:
+ *  This ioctl interface to messageq_put_many function.  Stops at the
+ *  first message that could not be put, and returns the number put.
+ */
+static int messageq_ioctl_put_many(struct messageq_cmd_args *cargs,
+				   bool user)
+{
+	u32 *srptrs[MESSAGEQ_PUTMANY_CHUNK];
+	messageq_msg msgs[MESSAGEQ_PUTMANY_CHUNK];
+	u32 **src = cargs->args.put_many.msg_srptrs;
+	u32 num = cargs->args.put_many.num_msgs;
+	u32 i, n, put = 0;
+	int status = -EINVAL;
+
+	while (put < num) {
+		n = min_t(u32, num - put, MESSAGEQ_PUTMANY_CHUNK);
+		if (user) {
+			if (copy_from_user(srptrs,
+					(u32 __user **)(src + put),
+					n * sizeof(*srptrs))) {
+				status = -EFAULT;
+				break;
+			}
+		} else {
+			memcpy(srptrs, src + put, n * sizeof(*srptrs));
+		}
+
+		for (i = 0; i < n; i++) {
+			msgs[i] = (messageq_msg) sharedregion_get_ptr(
+								srptrs[i]);
+			if (unlikely(msgs[i] == NULL))
+				break;
+		}
+		if (!i) {
+			status = -EINVAL;
+			break;
+		}
+
+		status = messageq_put_many(cargs->args.put_many.queue_id,
+					   msgs, i);
+		if (status < 0)
+			break;
+		put += status;
+		if (status < n)
+			break;
+	}
+
+	cargs->args.put_many.num_put = put;
+	cargs->api_status = put ? 0 : status;
+	return 0;
+}
+
 /*
  * ======== messageq_ioctl_get ========
  *  Purpose:
@@ -576,6 +633,10 @@ int messageq_ioctl(struct inode *inode, struct file *filp,
 		status = messageq_ioctl_put(&cargs);
 		break;
 
+	case CMD_MESSAGEQ_PUTMANY:
+		status = messageq_ioctl_put_many(&cargs, user);
+		break;
+
 	case CMD_MESSAGEQ_GET:
 		status = messageq_ioctl_get(&cargs);
 		break;
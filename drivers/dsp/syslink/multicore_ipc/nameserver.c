@@ -20,6 +20,7 @@
 #include <linux/types.h>
 #include <linux/string.h>
 #include <linux/list.h>
+#include <linux/rculist.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <syslink/atomic_linux.h>
@@ -32,6 +33,10 @@
 #define NS_MAX_RUNTIME_ENTRY			(~0)
 #define NS_MAX_VALUE_LEN			4
 
+/* Number of hash buckets in each instance table, a power of 2 */
+#define NS_HASH_BITS				6
+#define NS_HASH_SIZE				(1u << NS_HASH_BITS)
+
 /*
  *  The dynamic name/value table looks like the following. This approach allows
  *  each instance table to have different value and different name lengths.
@@ -102,6 +107,15 @@
  *  For dynamic creates, the freeList is populated in postInt and there are no
  *  entries placed on the namelist (this happens when the add is called).
  *
+ *  In this implementation the filled-in entries are kept in a hash table of
+ *  NS_HASH_SIZE buckets per instance, indexed by the low bits of the name
+ *  hash; names with the same hash simply share a bucket.  Each entry is a
+ *  single allocation holding the value followed by the name.
+ *
+ *  Lookups walk a bucket under rcu_read_lock() and never take the instance
+ *  gate, so any number of readers can look names up while another task
+ *  adds or removes entries.  Writers serialize on the instance gate, and a
+ *  removed entry is only freed once an RCU grace period has elapsed.
  */
 
 /* Macro to make a correct module magic number with refCount */
@@ -111,14 +125,12 @@
  *  A name/value table entry
  */
 struct nameserver_table_entry {
-	struct list_head elem; /* List element */
+	struct hlist_node elem; /* Hash bucket element */
 	u32 hash; /* Hash value */
 	char *name; /* Name portion of name/value pair */
 	u32 len; /* Length of the value field. */
 	void *buf; /* Value portion of name/value entry */
-	bool collide; /* Does the hash collides? */
-	struct nameserver_table_entry *next; /* Pointer to the next entry,
-					used incase of collision only */
+	struct rcu_head rcu; /* Deferred free after removal */
 };
 
 /*
@@ -127,8 +139,8 @@ struct nameserver_table_entry {
 struct nameserver_object {
 	struct list_head elem;
 	char *name; /* Name of the instance */
-	struct list_head name_list; /* Filled entries list */
-	struct mutex *gate_handle; /* Gate for critical regions */
+	struct hlist_head table[NS_HASH_SIZE]; /* Filled entries, hashed */
+	struct mutex *gate_handle; /* Gate for table updates */
 	struct nameserver_params params; /* The parameter structure */
 	u32 count; /* Counter for entries */
 };
@@ -219,21 +231,17 @@ static const u32 nameserver_crc_table[256u] = {
 /* Function to calculate hash for a string */
 static u32 _nameserver_string_hash(const char *string);
 
-#if 0
-/* This will return true if the entry is found in the table */
-static bool _nameserver_is_entry_found(const char *name, u32 hash,
-				struct list_head *list,
-				struct nameserver_table_entry **entry);
-#endif
+/* Function to initialize the hash table of an instance */
+static void _nameserver_table_init(struct nameserver_object *obj);
 
-/* This will return true if the hash is found in the table */
-static bool _nameserver_is_hash_found(const char *name, u32 hash,
-				struct list_head *list,
-				struct nameserver_table_entry **entry);
+/* Function to find an entry in the hash table of an instance */
+static struct nameserver_table_entry *_nameserver_find(
+				struct nameserver_object *obj,
+				const char *name, u32 hash);
 
-/* This will return true if entry is found in the hash collide list */
-static bool _nameserver_check_for_entry(const char *name,
-					struct nameserver_table_entry **entry);
+/* Function to unlink an entry and free it after a grace period */
+static void _nameserver_unlink(struct nameserver_object *obj,
+				struct nameserver_table_entry *entry);
 
 /* Function to get the default configuration for the NameServer module. */
 void nameserver_get_config(struct nameserver_config *cfg)
@@ -354,6 +362,8 @@ int nameserver_destroy(void)
 	kfree(lock);
 	kfree(nameserver_module->remote_handle_list);
 	nameserver_module->remote_handle_list = NULL;
+	/* Wait for the entries still queued by _nameserver_unlink */
+	rcu_barrier();
 	return 0;
 
 exit:
@@ -459,8 +469,8 @@ void *nameserver_create(const char *name,
 
 	mutex_init(new_obj->gate_handle);
 	new_obj->count = 0;
+	_nameserver_table_init(new_obj);
 	/* Put in the nameserver instance to local list */
-	INIT_LIST_HEAD(&new_obj->name_list);
 	INIT_LIST_HEAD(&new_obj->elem);
 	list_add(&new_obj->elem, &nameserver_module->obj_list);
 	mutex_unlock(nameserver_module->mod_gate_handle);
@@ -539,8 +549,8 @@ void nameserver_construct(void *handle, const char *name,
 	else
 		obj->params.max_value_len = params->max_value_len;
 
-	/* Construct the list */
-	INIT_LIST_HEAD(&obj->name_list);
+	/* Construct the table */
+	_nameserver_table_init(obj);
 
 	obj->gate_handle = kmalloc(sizeof(struct mutex), GFP_KERNEL);
 	if (obj->gate_handle == NULL) {
@@ -618,7 +628,6 @@ int nameserver_delete(void **handle)
 	temp_obj->name = NULL;
 
 	/* Free the memory used for handle */
-	INIT_LIST_HEAD(&temp_obj->name_list);
 	kfree(temp_obj);
 	*handle = NULL;
 	mutex_unlock(gate_handle);
@@ -679,9 +688,6 @@ void nameserver_destruct(void *handle)
 	kfree(obj->name);
 	obj->name = NULL;
 
-	/* Destruct the list */
-	INIT_LIST_HEAD(&obj->name_list);
-
 	/* Free the memory used for obj */
 	memset(obj, 0, sizeof(struct nameserver_object));
 
@@ -703,11 +709,8 @@ exit:
 void *nameserver_add(void *handle, const char *name,
 		void *buf, u32 len)
 {
-	struct nameserver_table_entry *node = NULL;
 	struct nameserver_table_entry *new_node = NULL;
 	struct nameserver_object *temp_obj = NULL;
-	bool found = false;
-	bool exact_entry = false;
 	u32 hash;
 	u32 name_len;
 	s32 retval = 0;
@@ -752,57 +755,35 @@ void *nameserver_add(void *handle, const char *name,
 		goto error;
 	}
 
-	/* TODO : hash and collide ?? */
 	hash = _nameserver_string_hash(name);
-	found = _nameserver_is_hash_found(name, hash,
-					&temp_obj->name_list, &node);
-	if (found == true)
-		exact_entry = _nameserver_check_for_entry(name, &node);
-
-	if (exact_entry == true && temp_obj->params.check_existing == true) {
+	if (temp_obj->params.check_existing == true &&
+		_nameserver_find(temp_obj, name, hash) != NULL) {
 		retval = -EEXIST;
 		goto error;
 	}
 
-	new_node = kmalloc(sizeof(struct nameserver_table_entry), GFP_KERNEL);
+	/* The value and the name are allocated along with the entry */
+	new_node = kmalloc(sizeof(struct nameserver_table_entry) + len +
+				name_len, GFP_KERNEL);
 	if (new_node == NULL) {
 		retval = -ENOMEM;
 		goto error;
 	}
 
-	new_node->hash    = hash;
-	new_node->collide = found;
-	new_node->len     = len;
-	new_node->next    = NULL;
-	new_node->name    = kmalloc(name_len, GFP_KERNEL);
-	if (new_node->name == NULL) {
-		retval = -ENOMEM;
-		goto error_name;
-	}
-	new_node->buf  = kmalloc(len, GFP_KERNEL);
-	if (new_node->buf == NULL) {
-		retval = -ENOMEM;
-		goto error_buf;
-	}
-
-	strncpy(new_node->name, name, name_len);
+	new_node->hash = hash;
+	new_node->len  = len;
+	new_node->buf  = new_node + 1;
+	new_node->name = (char *)new_node->buf + len;
 	memcpy(new_node->buf, buf, len);
-	if (found == true) {
-		/* If hash is found, need to stitch the list to link the
-		* new node to the existing node with the same hash. */
-		new_node->next = node->next;
-		node->next = new_node;
-		node->collide = found;
-	} else
-		list_add(&new_node->elem, &temp_obj->name_list);
+	strncpy(new_node->name, name, name_len);
+
+	/* Publish the entry only once it is filled in */
+	hlist_add_head_rcu(&new_node->elem,
+			&temp_obj->table[hash & (NS_HASH_SIZE - 1)]);
 	temp_obj->count++;
 	mutex_unlock(temp_obj->gate_handle);
 	return new_node;
 
-error_buf:
-	kfree(new_node->name);
-error_name:
-	kfree(new_node);
 error:
 	mutex_unlock(temp_obj->gate_handle);
 exit:
@@ -850,8 +831,6 @@ int nameserver_remove(void *handle, const char *name)
 {
 	struct nameserver_object *temp_obj = NULL;
 	struct nameserver_table_entry *entry = NULL;
-	struct nameserver_table_entry *prev = NULL;
-	bool found = false;
 	u32 hash;
 	u32 name_len;
 	s32 retval = 0;
@@ -884,55 +863,13 @@ int nameserver_remove(void *handle, const char *name)
 		goto exit;
 
 	hash = _nameserver_string_hash(name);
-	found = _nameserver_is_hash_found(name, hash,
-					&temp_obj->name_list, &entry);
-	if (found == false) {
+	entry = _nameserver_find(temp_obj, name, hash);
+	if (entry == NULL) {
 		retval = -ENOENT;
 		goto error;
 	}
 
-	if (entry->collide == true) {
-		if (strcmp(entry->name, name) == 0u) {
-			kfree(entry->buf);
-			kfree(entry->name);
-			entry->hash = entry->next->hash;
-			entry->name = entry->next->name;
-			entry->len = entry->next->len;
-			entry->buf = entry->next->buf;
-			entry->collide = entry->next->collide;
-			entry->next = entry->next->next;
-			kfree(entry->next);
-			temp_obj->count--;
-		} else {
-			found = false;
-			prev = entry;
-			entry = entry->next;
-			while (entry) {
-				if (strcmp(entry->name, name) == 0u) {
-					kfree(entry->buf);
-					kfree(entry->name);
-					prev->next = entry->next;
-					kfree(entry);
-					temp_obj->count--;
-					found = true;
-					break;
-				}
-				prev = entry;
-				entry = entry->next;
-			}
-			if (found == false) {
-				retval = -ENOENT;
-				goto error;
-			}
-		}
-	} else {
-		kfree(entry->buf);
-		kfree(entry->name);
-		list_del(&entry->elem);
-		kfree(entry);
-		temp_obj->count--;
-	}
-
+	_nameserver_unlink(temp_obj, entry);
 	mutex_unlock(temp_obj->gate_handle);
 	return 0;
 
@@ -973,11 +910,7 @@ int nameserver_remove_entry(void *nshandle, void *nsentry)
 	if (retval)
 		goto exit;
 
-	kfree(node->buf);
-	kfree(node->name);
-	list_del(&node->elem);
-	kfree(node);
-	obj->count--;
+	_nameserver_unlink(obj, node);
 	mutex_unlock(obj->gate_handle);
 	return 0;
 
@@ -995,7 +928,6 @@ int nameserver_get_local(void *handle, const char *name,
 {
 	struct nameserver_object *temp_obj = NULL;
 	struct nameserver_table_entry *entry = NULL;
-	bool found = false;
 	u32 hash;
 	u32 length = 0;
 	s32 retval = 0;
@@ -1030,26 +962,16 @@ int nameserver_get_local(void *handle, const char *name,
 
 	length = *len;
 	temp_obj = (struct nameserver_object *)handle;
-	retval = mutex_lock_interruptible(temp_obj->gate_handle);
-	if (retval)
-		goto exit;
-
 	hash = _nameserver_string_hash(name);
-	found = _nameserver_is_hash_found(name, hash,
-					&temp_obj->name_list, &entry);
-	if (found == false) {
+
+	/* The entry cannot be freed before rcu_read_unlock() */
+	rcu_read_lock();
+	entry = _nameserver_find(temp_obj, name, hash);
+	if (entry == NULL) {
 		retval = -ENOENT;
 		goto error;
 	}
 
-	if (entry->collide == true) {
-		found = _nameserver_check_for_entry(name, &entry);
-		if (found == false) {
-			retval = -ENOENT;
-			goto error;
-		}
-	}
-
 	if (entry->len >= length) {
 		memcpy(value, entry->buf, length);
 		*len = length;
@@ -1059,7 +981,7 @@ int nameserver_get_local(void *handle, const char *name,
 	}
 
 error:
-	mutex_unlock(temp_obj->gate_handle);
+	rcu_read_unlock();
 
 exit:
 	if (retval < 0)
@@ -1254,9 +1176,10 @@ int nameserver_match(void *handle, const char *name, u32 *value)
 {
 	struct nameserver_object *temp_obj = NULL;
 	struct nameserver_table_entry *node = NULL;
-	struct nameserver_table_entry *temp = NULL;
+	struct hlist_node *pos = NULL;
 	u32 len = 0;
 	u32 found_len = 0;
+	u32 i;
 	s32 retval = 0;
 
 	if (WARN_ON(unlikely(atomic_cmpmask_and_lt(
@@ -1280,23 +1203,19 @@ int nameserver_match(void *handle, const char *name, u32 *value)
 	}
 
 	temp_obj = (struct nameserver_object *)handle;
-	retval = mutex_lock_interruptible(temp_obj->gate_handle);
-	if (retval)
-		goto exit;
-	list_for_each_entry(node, &temp_obj->name_list, elem) {
-		temp = node;
-		while (temp) {
-			len = strlen(temp->name);
-			if (len > found_len) {
-				if (strncmp(temp->name, name, len) == 0u) {
-					*value = (u32)temp->buf;
-					found_len = len;
-				}
+	rcu_read_lock();
+	for (i = 0; i < NS_HASH_SIZE; i++) {
+		hlist_for_each_entry_rcu(node, pos, &temp_obj->table[i],
+					elem) {
+			len = strlen(node->name);
+			if (len > found_len &&
+				strncmp(node->name, name, len) == 0u) {
+				*value = (u32)node->buf;
+				found_len = len;
 			}
-			temp = temp->next;
 		}
 	}
-	mutex_unlock(temp_obj->gate_handle);
+	rcu_read_unlock();
 
 exit:
 	if (retval < 0)
@@ -1454,77 +1373,46 @@ static u32 _nameserver_string_hash(const char *string)
 	return hash;
 }
 
-#if 0
-/* This will return true if the entry is found in the table */
-static bool _nameserver_is_entry_found(const char *name, u32 hash,
-				struct list_head *list,
-				struct nameserver_table_entry **entry)
+/* Function to initialize the hash table of an instance */
+static void _nameserver_table_init(struct nameserver_object *obj)
 {
-	struct nameserver_table_entry *node = NULL;
-	bool hash_match = false;
-	bool name_match = false;
-
-	list_for_each_entry(node, list, elem) {
-		/* Hash not matches, take next node */
-		if (node->hash == hash)
-			hash_match = true;
-		else
-			continue;
-		/* If the name matches, incase hash is duplicate */
-		if (strcmp(node->name, name) == 0)
-			name_match = true;
-
-		if (hash_match && name_match) {
-			if (entry != NULL)
-				*entry = node;
-			return true;
-		}
+	u32 i;
 
-		hash_match = false;
-		name_match = false;
-	}
-	return false;
+	for (i = 0; i < NS_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&obj->table[i]);
 }
-#endif
 
-/* This will return true if the hash is found in the table */
-static bool _nameserver_is_hash_found(const char *name, u32 hash,
-				struct list_head *list,
-				struct nameserver_table_entry **entry)
+/* Function to find an entry in the hash table of an instance. The caller
+ * must either hold the instance gate or be in an RCU read-side section. */
+static struct nameserver_table_entry *_nameserver_find(
+				struct nameserver_object *obj,
+				const char *name, u32 hash)
 {
-	struct nameserver_table_entry *node = NULL;
+	struct nameserver_table_entry *entry = NULL;
+	struct hlist_node *pos = NULL;
 
 	/* No parameter checking as function is internal */
 
-	list_for_each_entry(node, list, elem) {
-		/* Hash not matches, take next node */
-		if (node->hash == hash) {
-			*entry = node;
-			return true;
-		}
+	hlist_for_each_entry_rcu(entry, pos,
+				&obj->table[hash & (NS_HASH_SIZE - 1)], elem) {
+		if (entry->hash == hash && strcmp(entry->name, name) == 0)
+			return entry;
 	}
-	return false;
+	return NULL;
 }
 
-/* This will return true if entry is found in the hash collide list */
-static bool _nameserver_check_for_entry(const char *name,
-					struct nameserver_table_entry **entry)
+/* RCU callback freeing a removed entry */
+static void _nameserver_free_entry(struct rcu_head *head)
 {
-	struct nameserver_table_entry *temp = NULL;
-	bool found = false;
-
-	/* No parameter checking as function is internal */
-
-	temp = *entry;
-	while (temp) {
-		if (strcmp(((struct nameserver_table_entry *)temp)->name,
-				name) == 0u) {
-			*entry = temp;
-			found = true;
-			break;
-		}
-		temp = temp->next;
-	}
+	kfree(container_of(head, struct nameserver_table_entry, rcu));
+}
 
-	return found;
+/* Function to unlink an entry and free it after a grace period. The caller
+ * must hold the instance gate. */
+static void _nameserver_unlink(struct nameserver_object *obj,
+				struct nameserver_table_entry *entry)
+{
+	hlist_del_rcu(&entry->elem);
+	obj->count--;
+	call_rcu(&entry->rcu, _nameserver_free_entry);
 }
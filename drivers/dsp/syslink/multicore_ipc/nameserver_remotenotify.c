@@ -18,12 +18,16 @@
 
 /* Standard headers */
 #include <linux/types.h>
+#include <linux/module.h>
 
 /* Utilities headers */
 #include <linux/string.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/semaphore.h>
+#include <linux/spinlock.h>
+#include <linux/jiffies.h>
+#include <linux/jhash.h>
 
 /* Syslink headers */
 #include <syslink/atomic_linux.h>
@@ -56,6 +60,29 @@
  */
 #define NAMESERVERREMOTENOTIFY_MAXVALUEBUFLEN	75
 
+/*
+ *  Maximum length of the instance name and of the name in a request,
+ *  including the terminating null character
+ */
+#define NAMESERVERREMOTENOTIFY_MAXNAMELEN	32
+
+/* Number of remote lookups cached per remote processor, a power of 2 */
+#define NAMESERVERREMOTENOTIFY_CACHE_BITS	5
+#define NAMESERVERREMOTENOTIFY_CACHE_SIZE	\
+			(1u << NAMESERVERREMOTENOTIFY_CACHE_BITS)
+
+/*
+ *  Time in ms a 32-bit value found on a remote processor is reused without
+ *  asking the remote processor again. The remote processor does not tell
+ *  us when it removes a name, so this bounds how long a stale value can be
+ *  returned after the remote side deleted and re-created an object.
+ *  Names that were not found are never cached.
+ */
+static uint cache_ttl_ms = 1000;
+module_param(cache_ttl_ms, uint, 0644);
+MODULE_PARM_DESC(cache_ttl_ms, "Lifetime in ms of cached remote NameServer "
+		"lookups, 0 disables the cache");
+
 /* Defines the nameserver_remotenotify state object, which contains all the
  * module specific information
  */
@@ -84,6 +111,18 @@ struct nameserver_remotenotify_message {
 		/* Supports up to 300-byte value */
 };
 
+/*
+ *  Cached result of a 32-bit lookup on the remote processor
+ */
+struct nameserver_remotenotify_cache_entry {
+	bool valid; /* Is the slot in use? */
+	u32 hash; /* Hash of the instance name and name */
+	unsigned long expires; /* Time in jiffies the value expires */
+	u32 value; /* Value found on the remote processor */
+	char instance_name[NAMESERVERREMOTENOTIFY_MAXNAMELEN];
+	char name[NAMESERVERREMOTENOTIFY_MAXNAMELEN];
+};
+
 /*
  *  NameServer remote transport state object definition
  */
@@ -97,6 +136,10 @@ struct nameserver_remotenotify_obj {
 	void *gatemp;
 	struct semaphore *sem_handle; /* Binary semaphore */
 	u16 notify_event_id;
+	spinlock_t cache_lock; /* Protects the lookup cache */
+	struct nameserver_remotenotify_cache_entry
+			cache[NAMESERVERREMOTENOTIFY_CACHE_SIZE];
+	/* Direct mapped cache of the remote lookups */
 };
 
 /*
@@ -383,6 +426,56 @@ exit:
 	return;
 }
 
+/* Hash of a lookup, used to pick its slot in the lookup cache */
+static u32 _nameserver_remotenotify_hash(const char *instance_name,
+					const char *name)
+{
+	return jhash(name, strlen(name),
+			jhash(instance_name, strlen(instance_name), 0));
+}
+
+/* Look a 32-bit value up in the cache of the remote lookups */
+static bool _nameserver_remotenotify_cache_get(
+				struct nameserver_remotenotify_obj *obj,
+				const char *instance_name, const char *name,
+				u32 hash, u32 *value)
+{
+	struct nameserver_remotenotify_cache_entry *entry;
+	bool found = false;
+
+	entry = &obj->cache[hash & (NAMESERVERREMOTENOTIFY_CACHE_SIZE - 1)];
+	spin_lock(&obj->cache_lock);
+	if (entry->valid && entry->hash == hash &&
+		time_before(jiffies, entry->expires) &&
+		strcmp(entry->name, name) == 0 &&
+		strcmp(entry->instance_name, instance_name) == 0) {
+		*value = entry->value;
+		found = true;
+	}
+	spin_unlock(&obj->cache_lock);
+	return found;
+}
+
+/* Add a 32-bit value found on the remote processor to the cache */
+static void _nameserver_remotenotify_cache_put(
+				struct nameserver_remotenotify_obj *obj,
+				const char *instance_name, const char *name,
+				u32 hash, u32 value)
+{
+	struct nameserver_remotenotify_cache_entry *entry;
+
+	entry = &obj->cache[hash & (NAMESERVERREMOTENOTIFY_CACHE_SIZE - 1)];
+	spin_lock(&obj->cache_lock);
+	entry->valid = true;
+	entry->hash = hash;
+	entry->expires = jiffies + msecs_to_jiffies(cache_ttl_ms);
+	entry->value = value;
+	strncpy(entry->instance_name, instance_name,
+		NAMESERVERREMOTENOTIFY_MAXNAMELEN);
+	strncpy(entry->name, name, NAMESERVERREMOTENOTIFY_MAXNAMELEN);
+	spin_unlock(&obj->cache_lock);
+}
+
 /* This will get a remote name value pair */
 int nameserver_remotenotify_get(void *rhandle, const char *instance_name,
 				const char *name, void *value, u32 *value_len,
@@ -393,6 +486,8 @@ int nameserver_remotenotify_get(void *rhandle, const char *instance_name,
 	s32 offset = 0;
 	s32 len;
 	int *key;
+	bool cacheable;
+	u32 hash = 0;
 	s32 retval = 0;
 
 	if (WARN_ON(unlikely(atomic_cmpmask_and_lt(
@@ -433,6 +528,16 @@ int nameserver_remotenotify_get(void *rhandle, const char *instance_name,
 	if (multiproc_self() > obj->remote_proc_id)
 		offset = 1;
 
+	/* Only 32-bit values are cached, these are what MessageQ, the heaps
+	 * and GateMP look up when opening a remote object. */
+	cacheable = (cache_ttl_ms != 0 && *value_len == sizeof(u32));
+	if (cacheable) {
+		hash = _nameserver_remotenotify_hash(instance_name, name);
+		if (_nameserver_remotenotify_cache_get(obj, instance_name,
+						name, hash, value))
+			return 0;
+	}
+
 #if 0
 	if (obj->cache_enable) {
 		/* write back shared memory that was modified */
@@ -453,13 +558,13 @@ int nameserver_remotenotify_get(void *rhandle, const char *instance_name,
 	obj->msg[offset]->request_status = 0;
 	obj->msg[offset]->value_len = *value_len;
 	len = strlen(instance_name) + 1; /* Take termination null char */
-	if (len >= 32) {
+	if (len >= NAMESERVERREMOTENOTIFY_MAXNAMELEN) {
 		retval = -EINVAL;
 		goto inval_len_error;
 	}
 	strncpy((char *)obj->msg[offset]->instance_name, instance_name, len);
 	len = strlen(name) + 1;
-	if (len >= 32) {
+	if (len >= NAMESERVERREMOTENOTIFY_MAXNAMELEN) {
 		retval = -EINVAL;
 		goto inval_len_error;
 	}
@@ -505,6 +610,9 @@ int nameserver_remotenotify_get(void *rhandle, const char *instance_name,
 		memcpy((void *)value, (void *)&(obj->msg[offset]->value_buf),
 			obj->msg[offset]->value_len);
 	*value_len = obj->msg[offset]->value_len;
+	if (cacheable && *value_len == sizeof(u32))
+		_nameserver_remotenotify_cache_put(obj, instance_name, name,
+						hash, obj->msg[offset]->value);
 
 	obj->msg[offset]->request_status = false;
 	retval = 0;
@@ -591,6 +699,8 @@ void *nameserver_remotenotify_create(u16 remote_proc_id,
 				sizeof(struct nameserver_remotenotify_message));
 	obj->gatemp = params->gatemp;
 	obj->remote_proc_id = remote_proc_id;
+	/* The lookup cache starts out empty, obj is zeroed */
+	spin_lock_init(&obj->cache_lock);
 	obj->notify_event_id = \
 			nameserver_remotenotify_state.cfg.notify_event_id;
 	/* Clear out self shared structures */
@@ -20,6 +20,7 @@
 #include <linux/types.h>
 #include <linux/string.h>
 #include <linux/slab.h>
+#include <linux/rcupdate.h>
 #include <syslink/atomic_linux.h>
 
 #include <multiproc.h>
@@ -34,6 +35,14 @@
 
 #define ROUND_UP(a, b)	(((a) + ((b) - 1)) & (~((b) - 1)))
 
+/* Size of the address space slice covered by one translation index entry */
+#define SHAREDREGION_INDEX_SHIFT	20
+#define SHAREDREGION_INDEX_SIZE		(1 << (32 - SHAREDREGION_INDEX_SHIFT))
+
+/* Index entry values other than a region id */
+#define SHAREDREGION_INDEX_NONE		0xff
+#define SHAREDREGION_INDEX_MANY		0xfe
+
 /* Module state object */
 struct sharedregion_module_object {
 	atomic_t ref_count; /* Reference count */
@@ -44,6 +53,10 @@ struct sharedregion_module_object {
 	u32 num_offset_bits;
 	/* no. of bits for the offset for a SRPtr. This value is calculated */
 	u32 offset_mask; /* offset bitmask using for generating a SRPtr */
+	u8 *index;
+	/* Region id for each slice of the address space, or
+	 * SHAREDREGION_INDEX_NONE/MANY. Replaced under local_lock whenever an
+	 * entry is set or cleared, read under rcu_read_lock(). */
 };
 
 /* Shared region state object variable with default settings */
@@ -68,6 +81,15 @@ static int _sharedregion_check_overlap(void *base, u32 len);
 /* Return the number of offsetBits bits */
 static u32 _sharedregion_get_num_offset_bits(void);
 
+/* Rebuild the address translation index, called with local_lock held */
+static void _sharedregion_update_index(void);
+
+/* Mark a region invalid after a failed sharedregion_set_entry */
+static void _sharedregion_invalidate(struct sharedregion_region *region);
+
+/* Return the id of the region containing addr, without taking any lock */
+static u16 _sharedregion_lookup(void *addr);
+
 /* This will get the sharedregion module configuration */
 int sharedregion_get_config(struct sharedregion_config *config)
 {
@@ -144,6 +166,16 @@ int sharedregion_setup(const struct sharedregion_config *config)
 	sharedregion_module->regions[0].entry.create_heap = true;
 	sharedregion_module->regions[0].entry.owner_proc_id = multiproc_self();
 
+	/* Without an index, lookups fall back to scanning the regions */
+	if (sharedregion_module->cfg.num_entries < SHAREDREGION_INDEX_MANY) {
+		sharedregion_module->index = kmalloc(SHAREDREGION_INDEX_SIZE,
+							GFP_KERNEL);
+		if (sharedregion_module->index != NULL)
+			memset(sharedregion_module->index,
+				SHAREDREGION_INDEX_NONE,
+				SHAREDREGION_INDEX_SIZE);
+	}
+
 	sharedregion_module->num_offset_bits = \
 					_sharedregion_get_num_offset_bits();
 	sharedregion_module->offset_mask =
@@ -160,6 +192,8 @@ int sharedregion_setup(const struct sharedregion_config *config)
 	return 0;
 
 gate_create_fail:
+	kfree(sharedregion_module->index);
+	sharedregion_module->index = NULL;
 	kfree(sharedregion_module->regions);
 
 error:
@@ -192,6 +226,8 @@ int sharedregion_destroy(void)
 	if (retval)
 		goto error;
 	kfree(sharedregion_module->regions);
+	kfree(sharedregion_module->index);
+	sharedregion_module->index = NULL;
 	memset(&sharedregion_module->cfg, 0,
 		sizeof(struct sharedregion_config));
 	sharedregion_module->num_offset_bits = 0;
@@ -826,6 +862,7 @@ u16 sharedregion_get_num_regions(void)
 {
 	return sharedregion_module->cfg.num_entries;
 }
+EXPORT_SYMBOL(sharedregion_get_num_regions);
 
 /* Sets the table information entry in the table */
 int sharedregion_set_entry(u16 id, struct sharedregion_entry *entry)
@@ -885,6 +922,7 @@ int sharedregion_set_entry(u16 id, struct sharedregion_entry *entry)
 	/* set specified region id to entry values */
 	memcpy((void *)&(region->entry), (void *)entry,
 		sizeof(struct sharedregion_entry));
+	_sharedregion_update_index();
 	mutex_unlock(sharedregion_module->local_lock);
 
 	if (entry->owner_proc_id == multiproc_self()) {
@@ -908,7 +946,7 @@ int sharedregion_set_entry(u16 id, struct sharedregion_entry *entry)
 
 			heap_handle = heapmemmp_create(&params);
 			if (heap_handle == NULL) {
-				region->entry.is_valid = false;
+				_sharedregion_invalidate(region);
 				retval = -ENOMEM;
 				goto error;
 			} else
@@ -928,7 +966,7 @@ int sharedregion_set_entry(u16 id, struct sharedregion_entry *entry)
 			retval = heapmemmp_open_by_addr(shared_addr, (void **)
 							heap_handle_ptr);
 			if (retval < 0) {
-				region->entry.is_valid = false;
+				_sharedregion_invalidate(region);
 				retval = -1;
 				goto error;
 			}
@@ -992,6 +1030,7 @@ int sharedregion_clear_entry(u16 id)
 	region->entry.name = NULL;
 	region->reserved_size = 0u;
 	region->heap = NULL;
+	_sharedregion_update_index();
 	mutex_unlock(sharedregion_module->local_lock);
 
 	/* Delete or close previous created heap outside the gate */
@@ -1120,9 +1159,7 @@ error:
 /* This will return the id for the specified address pointer. */
 u16 sharedregion_get_id(void *addr)
 {
-	struct sharedregion_region *region = NULL;
 	u16 region_id = SHAREDREGION_INVALIDREGIONID;
-	u16 i;
 	s32 retval = -ENOENT;
 
 	if (WARN_ON(atomic_cmpmask_and_lt(&(sharedregion_module->ref_count),
@@ -1137,22 +1174,9 @@ u16 sharedregion_get_id(void *addr)
 		goto error;
 	}
 
-	retval = mutex_lock_interruptible(sharedregion_module->local_lock);
-	if (retval) {
-		retval = -ENODEV;
-		goto error;
-	}
-	for (i = 0; i < sharedregion_module->cfg.num_entries; i++) {
-		region = &(sharedregion_module->regions[i]);
-		if (region->entry.is_valid && (addr >= region->entry.base) &&
-			(addr < (void *)((u32)region->entry.base + \
-			(region->entry.len)))) {
-			region_id = i;
-			retval = 0;
-			break;
-		}
-	}
-	mutex_unlock(sharedregion_module->local_lock);
+	region_id = _sharedregion_lookup(addr);
+	if (region_id != SHAREDREGION_INVALIDREGIONID)
+		retval = 0;
 
 error:
 	if (retval < 0)
@@ -1238,6 +1262,7 @@ error:
 	pr_err("sharedregion_get_entry failed: status = 0x%x", retval);
 	return retval;
 }
+EXPORT_SYMBOL(sharedregion_get_entry);
 
 /* Get cache line size */
 uint sharedregion_get_cache_line_size(u16 id)
@@ -1489,6 +1514,96 @@ error:
 	return retval;
 }
 
+/* Rebuild the address translation index, called with local_lock held.
+ * A new index is built and published so that readers always see either
+ * the old or the new one in full. */
+static void _sharedregion_update_index(void)
+{
+	struct sharedregion_region *region = NULL;
+	u8 *index;
+	u8 *old_index;
+	u32 i;
+	u32 slice;
+	u32 last;
+
+	old_index = sharedregion_module->index;
+	if (old_index == NULL)
+		return;
+
+	index = kmalloc(SHAREDREGION_INDEX_SIZE, GFP_KERNEL);
+	if (index != NULL) {
+		memset(index, SHAREDREGION_INDEX_NONE, SHAREDREGION_INDEX_SIZE);
+		for (i = 0; i < sharedregion_module->cfg.num_entries; i++) {
+			region = &(sharedregion_module->regions[i]);
+			if (!region->entry.is_valid || region->entry.len == 0)
+				continue;
+			slice = (u32) region->entry.base >>
+						SHAREDREGION_INDEX_SHIFT;
+			last = ((u32) region->entry.base +
+				region->entry.len - 1) >>
+						SHAREDREGION_INDEX_SHIFT;
+			for (; slice <= last; slice++)
+				index[slice] =
+					(index[slice] == SHAREDREGION_INDEX_NONE) ?
+					i : SHAREDREGION_INDEX_MANY;
+		}
+	} else
+		pr_warn("sharedregion: no memory for the translation index, "
+			"using region scans\n");
+
+	rcu_assign_pointer(sharedregion_module->index, index);
+	synchronize_rcu();
+	kfree(old_index);
+}
+
+/* Mark a region invalid after a failed sharedregion_set_entry */
+static void _sharedregion_invalidate(struct sharedregion_region *region)
+{
+	mutex_lock(sharedregion_module->local_lock);
+	region->entry.is_valid = false;
+	_sharedregion_update_index();
+	mutex_unlock(sharedregion_module->local_lock);
+}
+
+/* Return the id of the region containing addr, without taking any lock.
+ * The index narrows the search to a single region unless the slice of addr
+ * is shared by several regions. */
+static u16 _sharedregion_lookup(void *addr)
+{
+	struct sharedregion_region *region = NULL;
+	u16 region_id = SHAREDREGION_INVALIDREGIONID;
+	u8 *index;
+	u32 first = 0;
+	u32 end = sharedregion_module->cfg.num_entries;
+	u32 i;
+
+	rcu_read_lock();
+	index = rcu_dereference(sharedregion_module->index);
+	if (index != NULL) {
+		i = index[(u32) addr >> SHAREDREGION_INDEX_SHIFT];
+		if (i == SHAREDREGION_INDEX_NONE)
+			goto exit;
+		if (i != SHAREDREGION_INDEX_MANY) {
+			first = i;
+			end = i + 1;
+		}
+	}
+
+	for (i = first; i < end; i++) {
+		region = &(sharedregion_module->regions[i]);
+		if (region->entry.is_valid && (addr >= region->entry.base) &&
+			(addr < (void *)((u32)region->entry.base + \
+			(region->entry.len)))) {
+			region_id = i;
+			break;
+		}
+	}
+
+exit:
+	rcu_read_unlock();
+	return region_id;
+}
+
 /* Return the number of offset_bits bits */
 static u32 _sharedregion_get_num_offset_bits(void)
 {
@@ -1580,6 +1695,7 @@ int _sharedregion_set_entry(u16 id, struct sharedregion_entry *entry)
 	/* set specified region id to entry values */
 	memcpy((void *)&(region->entry), (void *)entry,
 		sizeof(struct sharedregion_entry));
+	_sharedregion_update_index();
 	mutex_unlock(sharedregion_module->local_lock);
 	return 0;
 
@@ -0,0 +1,209 @@
+/*
+ *  sharedregion_bench.c
+ *
+ *  Microbenchmark for the address translations done on every MessageQ
+ *  message and every buffer handed to the remote processor: SharedRegion
+ *  address <-> SRPtr conversion, and ProcMgr slave to master address
+ *  translation.
+ *
+ *  The SharedRegion translations are also timed with a plain scan of the
+ *  regions, which is how sharedregion_get_id() used to find them, so the
+ *  gain of the translation index can be read from a single run.  Results
+ *  are printed when the module is loaded; load it once the remote
+ *  processor is running and the regions are set up.
+ *
+ *  Copyright (C) 2010 Texas Instruments, Inc.
+ *
+ *  This package is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ *  WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE.
+ */
+#include <linux/module.h>
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+
+#include <multiproc.h>
+#include <sharedregion.h>
+#include <procmgr.h>
+
+/* Number of translations timed for each method */
+static uint iterations = 1000000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Number of translations per measurement");
+
+/* Processor whose ProcMgr translations are timed */
+static char *proc_name = "SysM3";
+module_param(proc_name, charp, 0444);
+MODULE_PARM_DESC(proc_name, "Processor for the ProcMgr translations");
+
+/* Distance between consecutive addresses translated within a region */
+#define BENCH_STRIDE	4096
+
+#define BENCH_MAX_REGIONS	16
+
+struct bench_region {
+	u32 base;
+	u32 len;
+};
+
+static struct bench_region regions[BENCH_MAX_REGIONS];
+static u16 num_regions;
+static u16 region_ids[BENCH_MAX_REGIONS];
+
+/* Address used by iteration i, spread over all the regions */
+static inline void *bench_addr(u32 i)
+{
+	struct bench_region *r = &regions[i % num_regions];
+
+	return (void *)(r->base + (i / num_regions * BENCH_STRIDE) % r->len);
+}
+
+/* Region scan, as done by sharedregion_get_id() without an index */
+static u16 bench_scan_id(void *addr)
+{
+	u16 i;
+
+	for (i = 0; i < num_regions; i++) {
+		if ((u32)addr >= regions[i].base &&
+			(u32)addr < regions[i].base + regions[i].len)
+			return region_ids[i];
+	}
+	return SHAREDREGION_INVALIDREGIONID;
+}
+
+/* Translations per second, given the time taken for 'iterations' */
+static u32 bench_rate(s64 ns)
+{
+	if (ns <= 0)
+		return 0;
+	return (u32)div64_u64((u64)iterations * NSEC_PER_SEC, ns);
+}
+
+static void bench_sharedregion(void)
+{
+	struct sharedregion_entry entry;
+	ktime_t start;
+	s64 ns_scan;
+	s64 ns_index;
+	u32 errors = 0;
+	void *addr;
+	u32 *srptr;
+	u16 id;
+	u16 n;
+	u32 i;
+
+	n = sharedregion_get_num_regions();
+	for (id = 0; id < n && num_regions < BENCH_MAX_REGIONS; id++) {
+		if (sharedregion_get_entry(id, &entry) < 0 || !entry.is_valid ||
+			entry.len == 0)
+			continue;
+		regions[num_regions].base = (u32)entry.base;
+		regions[num_regions].len = entry.len;
+		region_ids[num_regions] = id;
+		num_regions++;
+	}
+	if (num_regions == 0) {
+		pr_info("sharedregion_bench: no valid SharedRegion\n");
+		return;
+	}
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		addr = bench_addr(i);
+		id = bench_scan_id(addr);
+		srptr = sharedregion_get_srptr(addr, id);
+		if (sharedregion_get_ptr(srptr) != addr)
+			errors++;
+	}
+	ns_scan = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		addr = bench_addr(i);
+		id = sharedregion_get_id(addr);
+		srptr = sharedregion_get_srptr(addr, id);
+		if (sharedregion_get_ptr(srptr) != addr)
+			errors++;
+	}
+	ns_index = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	pr_info("sharedregion_bench: %u regions, addr->srptr->addr per "
+		"second: region scan %u, index %u%s\n", num_regions,
+		bench_rate(ns_scan), bench_rate(ns_index),
+		errors ? " (translation errors!)" : "");
+}
+
+static void bench_procmgr(void)
+{
+	struct proc_mgr_proc_info *info;
+	struct proc_mgr_addr_info *e;
+	void *handle = NULL;
+	ktime_t start;
+	s64 ns;
+	u32 errors = 0;
+	void *dst;
+	u16 proc_id;
+	u32 i;
+
+	proc_id = multiproc_get_id(proc_name);
+	if (proc_id == MULTIPROC_INVALIDID)
+		return;
+	if (proc_mgr_open(&handle, proc_id) < 0 || handle == NULL)
+		return;
+
+	info = kmalloc(sizeof(*info), GFP_KERNEL);
+	if (info == NULL)
+		goto exit;
+	if (proc_mgr_get_proc_info(handle, info) < 0 ||
+		info->num_mem_entries == 0) {
+		pr_info("sharedregion_bench: %s is not attached\n", proc_name);
+		goto exit;
+	}
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		e = &info->mem_entries[i % info->num_mem_entries];
+		if (proc_mgr_translate_addr(handle, &dst,
+			PROC_MGR_ADDRTYPE_MASTERKNLVIRT,
+			(void *)(e->addr[PROC_MGR_ADDRTYPE_SLAVEVIRT] +
+				(i * BENCH_STRIDE) % e->size),
+			PROC_MGR_ADDRTYPE_SLAVEVIRT) < 0)
+			errors++;
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	pr_info("sharedregion_bench: %s, %u mem entries, slave->master per "
+		"second: %u%s\n", proc_name, info->num_mem_entries,
+		bench_rate(ns), errors ? " (translation errors!)" : "");
+
+exit:
+	kfree(info);
+	proc_mgr_close(handle);
+}
+
+static int __init sharedregion_bench_init(void)
+{
+	if (iterations == 0)
+		return -EINVAL;
+
+	bench_sharedregion();
+	bench_procmgr();
+	return 0;
+}
+module_init(sharedregion_bench_init);
+
+static void __exit sharedregion_bench_exit(void)
+{
+}
+module_exit(sharedregion_bench_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("SharedRegion and ProcMgr address translation benchmark");
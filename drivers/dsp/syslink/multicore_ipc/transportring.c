@@ -0,0 +1,544 @@
+/*
+ *  transportring.c
+ *
+ *  Shared memory ring transport for MessageQ
+ *
+ *  Copyright (C) 2010 Texas Instruments, Inc.
+ *
+ *  This package is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ *  WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE.
+ */
+
+/*
+ *  Shared memory layout, each part starting on its own cache line:
+ *
+ *	attrs[0], attrs[1]	of the creator and of the opener
+ *	ring[0], ring[1]	messages to the lower / higher proc id:
+ *		head		next slot to fill, written by the producer only
+ *		tail		next slot to empty, written by the consumer only
+ *		slots[num_slots] SharedRegion pointers of the messages
+ *
+ *  head and tail are free running counters.  The producer publishes slots
+ *  by advancing head and then reads tail; the consumer frees slots by
+ *  advancing tail and then reads head again.  With a full barrier between
+ *  each write and read, either the producer sees that the consumer has
+ *  caught up (and notifies it), or the consumer sees the new head (and
+ *  keeps draining), so no notification is lost even though only the
+ *  transition from empty to non-empty is signalled.
+ */
+
+/* Standard headers */
+#include <linux/types.h>
+#include <linux/module.h>
+
+/* Utilities headers */
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+/* Module level headers */
+#include <multiproc.h>
+#include <sharedregion.h>
+#include <notify.h>
+#include <messageq.h>
+#include <transportring.h>
+
+/* =============================================================================
+ * Globals
+ * =============================================================================
+ */
+
+/* Indicates that the transport is up. */
+#define TRANSPORTRING_UP	0xBADC0FFF
+
+/* Default number of slots per ring */
+#define TRANSPORTRING_NUM_SLOTS	256
+
+#define ROUND_UP(a, b)	(((a) + ((b) - 1)) & (~((b) - 1)))
+
+/* =============================================================================
+ * Structures & Enums
+ * =============================================================================
+ */
+/*
+ * Structure of attributes in shared memory
+ */
+struct transportring_attrs {
+	VOLATILE u32 flag;		/* flag */
+	VOLATILE u32 creator_proc_id;	/* Creator processor ID */
+	VOLATILE u32 notify_event_id;	/* Notify event number */
+	VOLATILE u16 priority;		/* priority */
+	VOLATILE u16 num_slots;		/* slots in each ring */
+};
+
+/*
+ * One direction of the transport
+ */
+struct transportring_ring {
+	VOLATILE u32 *head;
+	/* Next slot to fill, written by the producer */
+	VOLATILE u32 *tail;
+	/* Next slot to empty, written by the consumer */
+	VOLATILE u32 *slots;
+	/* SharedRegion pointers of the queued messages */
+};
+
+/*
+ * Structure defining the ring transport instances.
+ */
+struct transportring_object {
+	VOLATILE struct transportring_attrs *self;
+	/* Attributes of the creator in shared memory */
+	VOLATILE struct transportring_attrs *other;
+	/* Attributes of the opener in shared memory */
+	struct transportring_ring rx;
+	/* Messages from the remote processor */
+	struct transportring_ring tx;
+	/* Messages to the remote processor */
+	spinlock_t tx_lock;
+	/* Serializes the local producers */
+	bool kick;
+	/* Notify the remote on the next put, the last notify failed */
+	bool creator;
+	/* Whether this processor created the instance */
+	u32 num_slots;
+	/* Slots in each ring */
+	u32 notify_event_id;
+	/* Notify event to be used */
+	u16 remote_proc_id;
+	/* dst proc id */
+	u32 priority;
+	/* Priority of messages supported by this transport */
+	u32 sent;
+	/* Messages sent */
+	u32 notified;
+	/* Notifications sent */
+	u32 received;
+	/* Messages received */
+};
+
+/* Functions through which MessageQ uses this transport */
+static const struct messageq_transport_fxns transportring_fxns = {
+	.put = transportring_put,
+	.put_many = transportring_put_many,
+};
+
+/* =============================================================================
+ * Internal functions
+ * =============================================================================
+ */
+/* Alignment of each part of the shared memory */
+static u32 _transportring_align(u16 region_id)
+{
+	u32 min_align = 4;
+
+	if (sharedregion_get_cache_line_size(region_id) > min_align)
+		min_align = sharedregion_get_cache_line_size(region_id);
+	return min_align;
+}
+
+/* Shared memory of one ring */
+static u32 _transportring_ring_size(u32 num_slots, u32 min_align)
+{
+	return 2 * ROUND_UP(sizeof(u32), min_align) +
+		ROUND_UP(num_slots * sizeof(u32), min_align);
+}
+
+/* Carve out one ring from the shared memory */
+static void _transportring_init_ring(struct transportring_ring *ring,
+				     void *addr, u32 min_align)
+{
+	ring->head = addr;
+	ring->tail = addr + ROUND_UP(sizeof(u32), min_align);
+	ring->slots = addr + 2 * ROUND_UP(sizeof(u32), min_align);
+}
+
+/*
+ * ======== _transportring_notify_fxn ========
+ *  Purpose:
+ *  Callback function registered with the Notify module.  Drains the
+ *  receive ring and delivers each message to its local queue.
+ */
+static void _transportring_notify_fxn(u16 proc_id, u16 line_id, u32 event_no,
+					uint *arg, u32 payload)
+{
+	struct transportring_object *obj =
+			(struct transportring_object *)arg;
+	u32 mask, tail;
+	messageq_msg msg;
+
+	if (WARN_ON(obj == NULL))
+		return;
+
+	mask = obj->num_slots - 1;
+	tail = *obj->rx.tail;
+	do {
+		/* read the slots only after the head that published them */
+		while (tail != *obj->rx.head) {
+			rmb();
+			msg = (messageq_msg) sharedregion_get_ptr(
+					(u32 *) obj->rx.slots[tail & mask]);
+			tail++;
+			if (unlikely(msg == NULL)) {
+				pr_err("_transportring_notify_fxn: invalid "
+					"message in slot 0x%x\n", tail - 1);
+				continue;
+			}
+			obj->received++;
+			messageq_put(messageq_get_dst_queue(msg), msg);
+		}
+
+		/* free the slots, then check for messages queued meanwhile */
+		*obj->rx.tail = tail;
+		mb();
+	} while (tail != *obj->rx.head);
+}
+
+/*
+ * ========= _transportring_create =========
+ *  Purpose:
+ *  Internal function for create()/open()
+ */
+static int _transportring_create(struct transportring_object **handle_ptr,
+		u16 proc_id, const struct transportring_params *params,
+		bool create_flag)
+{
+	struct transportring_object *handle = NULL;
+	u16 region_id = sharedregion_get_id(params->shared_addr);
+	u32 min_align, attrs_size;
+	void *rings;
+	int local_index;
+	int status = 0;
+
+	if (region_id == SHAREDREGION_INVALIDREGIONID) {
+		status = -EFAULT;
+		goto exit;
+	}
+	min_align = _transportring_align(region_id);
+	if ((u32) params->shared_addr % min_align) {
+		status = -EFAULT;
+		goto exit;
+	}
+
+	/* The '0' ring carries messages to the lower multiproc id */
+	local_index = multiproc_self() < proc_id ? 0 : 1;
+
+	handle = kzalloc(sizeof(struct transportring_object), GFP_KERNEL);
+	if (handle == NULL) {
+		status = -ENOMEM;
+		goto exit;
+	}
+
+	attrs_size = ROUND_UP(sizeof(struct transportring_attrs), min_align);
+	handle->self = params->shared_addr;
+	handle->other = params->shared_addr + attrs_size;
+	handle->creator = create_flag;
+	handle->num_slots = params->num_slots;
+	handle->notify_event_id = params->notify_event_id;
+	handle->priority = params->priority;
+	handle->remote_proc_id = proc_id;
+	spin_lock_init(&handle->tx_lock);
+
+	rings = params->shared_addr + 2 * attrs_size;
+	_transportring_init_ring(local_index ? &handle->tx : &handle->rx,
+				 rings, min_align);
+	_transportring_init_ring(local_index ? &handle->rx : &handle->tx,
+			rings + _transportring_ring_size(handle->num_slots,
+							 min_align),
+			min_align);
+
+	if (create_flag == true) {
+		*handle->rx.head = *handle->rx.tail = 0;
+		*handle->tx.head = *handle->tx.tail = 0;
+		handle->other->flag = 0;
+	}
+
+	status = notify_register_event_single(proc_id,
+					0, /* lineId */
+					params->notify_event_id,
+					_transportring_notify_fxn,
+					handle);
+	if (status < 0) {
+		status = -EFAULT;
+		goto free;
+	}
+
+	/* Register the transport with MessageQ */
+	status = messageq_register_transport_fxns(handle, proc_id,
+					params->priority, &transportring_fxns);
+	if (status < 0) {
+		notify_unregister_event_single(proc_id, 0,
+					       params->notify_event_id);
+		status = -EFAULT;
+		goto free;
+	}
+
+	if (create_flag == true) {
+		handle->self->creator_proc_id = multiproc_self();
+		handle->self->notify_event_id = handle->notify_event_id;
+		handle->self->priority = handle->priority;
+		handle->self->num_slots = handle->num_slots;
+		wmb();
+		handle->self->flag = TRANSPORTRING_UP;
+	} else {
+		handle->other->flag = TRANSPORTRING_UP;
+	}
+
+	*handle_ptr = handle;
+	return 0;
+
+free:
+	kfree(handle);
+exit:
+	pr_err("_transportring_create failed: status = 0x%x\n", status);
+	return status;
+}
+
+/* Tear down a created or opened instance */
+static int _transportring_finalize(void **handle_ptr)
+{
+	struct transportring_object *obj;
+	int status = 0;
+
+	if (WARN_ON(handle_ptr == NULL || *handle_ptr == NULL))
+		return -EINVAL;
+
+	obj = (struct transportring_object *)(*handle_ptr);
+	if (obj->creator)
+		obj->self->flag = 0;
+	else
+		obj->other->flag = 0;
+
+	messageq_unregister_transport(obj->remote_proc_id, obj->priority);
+
+	status = notify_unregister_event_single(obj->remote_proc_id, 0,
+						obj->notify_event_id);
+	if (status < 0)
+		pr_warn("transportring: Failed to unregister notify event!\n");
+
+	kfree(obj);
+	*handle_ptr = NULL;
+	return status;
+}
+
+/* =============================================================================
+ * APIs called directly by applications
+ * =============================================================================
+ */
+/*
+ * ======== transportring_params_init ========
+ *  Purpose:
+ *  Get Instance parameters
+ */
+void transportring_params_init(struct transportring_params *params)
+{
+	if (WARN_ON(params == NULL))
+		return;
+
+	params->priority = MESSAGEQ_NORMALPRI;
+	params->shared_addr = NULL;
+	params->notify_event_id = (u32)(-1);
+	params->num_slots = TRANSPORTRING_NUM_SLOTS;
+}
+EXPORT_SYMBOL(transportring_params_init);
+
+/*
+ * ======== transportring_shared_mem_req ========
+ *  Purpose:
+ *  Get shared memory requirements.
+ */
+u32 transportring_shared_mem_req(const struct transportring_params *params)
+{
+	u16 region_id;
+	u32 min_align;
+
+	if (WARN_ON(params == NULL))
+		return 0;
+
+	region_id = sharedregion_get_id(params->shared_addr);
+	if (region_id == SHAREDREGION_INVALIDREGIONID) {
+		pr_err("transportring_shared_mem_req: invalid shared "
+			"address\n");
+		return 0;
+	}
+
+	min_align = _transportring_align(region_id);
+	return 2 * ROUND_UP(sizeof(struct transportring_attrs), min_align) +
+		2 * _transportring_ring_size(params->num_slots, min_align);
+}
+EXPORT_SYMBOL(transportring_shared_mem_req);
+
+/*
+ * ======== transportring_create ========
+ *  Purpose:
+ *  Create a transport instance. The remote processor opens it with
+ *  transportring_open_by_addr() on the same shared memory.
+ */
+void *transportring_create(u16 proc_id,
+			const struct transportring_params *params)
+{
+	struct transportring_object *handle = NULL;
+
+	if (WARN_ON(params == NULL || params->shared_addr == NULL))
+		return NULL;
+	if (WARN_ON(proc_id >= multiproc_get_num_processors()))
+		return NULL;
+	if (WARN_ON(params->priority >= MESSAGEQ_NUM_PRIORITY_QUEUES))
+		return NULL;
+	/* the ring indices wrap around at a multiple of the ring size */
+	if (WARN_ON(params->num_slots == 0 || params->num_slots > 0x8000 ||
+		    (params->num_slots & (params->num_slots - 1))))
+		return NULL;
+	if (WARN_ON(params->notify_event_id == (u32)(-1)))
+		return NULL;
+
+	_transportring_create(&handle, proc_id, params, true);
+	return handle;
+}
+EXPORT_SYMBOL(transportring_create);
+
+/*
+ * ======== transportring_delete ========
+ *  Purpose:
+ *  Delete a created instance
+ */
+int transportring_delete(void **handle_ptr)
+{
+	return _transportring_finalize(handle_ptr);
+}
+EXPORT_SYMBOL(transportring_delete);
+
+/*
+ * ========== transportring_open_by_addr ===========
+ * Open a transport instance created by the remote processor
+ */
+int transportring_open_by_addr(void *shared_addr, void **handle_ptr)
+{
+	struct transportring_attrs *attrs = shared_addr;
+	struct transportring_params params;
+
+	if (WARN_ON(shared_addr == NULL || handle_ptr == NULL))
+		return -EINVAL;
+
+	*handle_ptr = NULL;
+	if (unlikely(attrs->flag != TRANSPORTRING_UP))
+		return -EFAULT;
+	rmb();
+
+	transportring_params_init(&params);
+	params.shared_addr = shared_addr;
+	params.notify_event_id = attrs->notify_event_id | \
+						(NOTIFY_SYSTEMKEY << 16);
+	params.priority = attrs->priority;
+	params.num_slots = attrs->num_slots;
+
+	return _transportring_create((struct transportring_object **)
+				     handle_ptr, attrs->creator_proc_id,
+				     &params, false);
+}
+EXPORT_SYMBOL(transportring_open_by_addr);
+
+/*
+ * ========== transportring_close ===========
+ * Close an opened transport instance
+ */
+int transportring_close(void **handle_ptr)
+{
+	return _transportring_finalize(handle_ptr);
+}
+EXPORT_SYMBOL(transportring_close);
+
+/* =============================================================================
+ * APIs called internally by MessageQ
+ * =============================================================================
+ */
+/*
+ * ======== transportring_put_many ========
+ *  Purpose:
+ *  Queue as many of the messages as fit in the remote ring, and notify
+ *  the remote processor once if it had drained its ring.
+ */
+int transportring_put_many(void *handle, void **msgs, u32 n)
+{
+	struct transportring_object *obj =
+			(struct transportring_object *)handle;
+	unsigned long flags;
+	u32 head, mask, i;
+	u32 *srptr;
+	bool notify, invalid;
+	int status;
+
+	if (WARN_ON(obj == NULL || msgs == NULL))
+		return -EINVAL;
+
+	mask = obj->num_slots - 1;
+
+	spin_lock_irqsave(&obj->tx_lock, flags);
+	head = *obj->tx.head;
+	n = min(n, obj->num_slots - (head - *obj->tx.tail));
+	for (i = 0; i < n; i++) {
+		srptr = sharedregion_get_srptr(msgs[i],
+					       sharedregion_get_id(msgs[i]));
+		if (unlikely(srptr == SHAREDREGION_INVALIDSRPTR))
+			break;
+		obj->tx.slots[(head + i) & mask] = (u32) srptr;
+	}
+	invalid = i < n;
+	n = i;
+
+	/* publish the slots, then see whether the remote had caught up */
+	wmb();
+	*obj->tx.head = head + n;
+	mb();
+	notify = n && (*obj->tx.tail == head || obj->kick);
+	obj->kick = false;
+	obj->sent += n;
+	spin_unlock_irqrestore(&obj->tx_lock, flags);
+
+	if (!n)
+		return invalid ? -EFAULT : -ENOSPC;
+
+	if (notify) {
+		status = notify_send_event(obj->remote_proc_id, 0,
+					obj->notify_event_id, 0, false);
+		if (status < 0) {
+			/*
+			 * The messages are already visible to the remote, so
+			 * they cannot be taken back.  Retry the notification
+			 * on the next put.
+			 */
+			pr_err("transportring_put: Notification to remote "
+				"processor failed, status = 0x%x\n", status);
+			spin_lock_irqsave(&obj->tx_lock, flags);
+			obj->kick = true;
+			spin_unlock_irqrestore(&obj->tx_lock, flags);
+		} else {
+			spin_lock_irqsave(&obj->tx_lock, flags);
+			obj->notified++;
+			spin_unlock_irqrestore(&obj->tx_lock, flags);
+		}
+	}
+	return n;
+}
+EXPORT_SYMBOL(transportring_put_many);
+
+/*
+ * ======== transportring_put ========
+ *  Purpose:
+ *  Put msg to the remote ring
+ */
+int transportring_put(void *handle, void *msg)
+{
+	int status = transportring_put_many(handle, &msg, 1);
+
+	if (status < 0)
+		pr_err("transportring_put failed: status = 0x%x\n", status);
+	return status < 0 ? status : 0;
+}
+EXPORT_SYMBOL(transportring_put);
@@ -21,6 +21,7 @@
 /* Utilities headers */
 #include <linux/string.h>
 #include <linux/slab.h>
+#include <linux/module.h>
 
 /* Syslink headers */
 #include <syslink/atomic_linux.h>
@@ -35,6 +36,7 @@
 #include <gatemp.h>
 #include <transportshm.h>
 #include <transportshm_setup.h>
+#include <transportring.h>
 
 /* =============================================================================
  * Structures & Enums
@@ -44,6 +46,8 @@
 struct transportshm_setup_module_object {
 	void *handles[MULTIPROC_MAXPROCESSORS];
 	/* Store a handle per remote proc */
+	void *ring_handles[MULTIPROC_MAXPROCESSORS];
+	/* Ring transport per remote proc, if enabled */
 };
 
 
@@ -59,6 +63,87 @@ static struct transportshm_setup_module_object transportshm_setup_state = {
 static struct transportshm_setup_module_object *transportshm_setup_module =
 						&transportshm_setup_state;
 
+/*
+ * Notify event of the ring transport that carries high priority messages.
+ * The slave must run the matching ring transport, so it is off by default.
+ */
+static uint ring_event;
+module_param(ring_event, uint, 0444);
+MODULE_PARM_DESC(ring_event, "Notify event of the MessageQ ring transport "
+		 "for high priority messages (0 to disable)");
+
+
+/* =============================================================================
+ *  Internal functions
+ * =============================================================================
+ */
+/*
+ * Parameters of the ring transport.  Its shared memory follows that of
+ * the shared memory transport.
+ */
+static void _transportshm_setup_ring_params(u32 *shared_addr,
+					struct transportring_params *params)
+{
+	struct transportshm_params shm_params;
+	u16 region_id = sharedregion_get_id(shared_addr);
+	u32 offset;
+
+	transportshm_params_init(&shm_params);
+	shm_params.shared_addr = shared_addr;
+	offset = ALIGN(transportshm_shared_mem_req(&shm_params),
+		       max_t(u32, 4,
+			     sharedregion_get_cache_line_size(region_id)));
+
+	transportring_params_init(params);
+	params->shared_addr = (void *)shared_addr + offset;
+	params->priority = MESSAGEQ_HIGHPRI;
+	params->notify_event_id = ring_event | (NOTIFY_SYSTEMKEY << 16);
+}
+
+/*
+ * Attach the ring transport.  Without it, high priority messages use the
+ * shared memory transport, so a failure is not fatal.
+ */
+static void _transportshm_setup_ring_attach(u16 remote_proc_id,
+					    u32 *shared_addr)
+{
+	struct transportring_params params;
+	void *handle = NULL;
+	int status = 0;
+
+	_transportshm_setup_ring_params(shared_addr, &params);
+	if (multiproc_self() < remote_proc_id) {
+		handle = transportring_create(remote_proc_id, &params);
+		if (handle == NULL)
+			status = -EFAULT;
+	} else {
+		status = transportring_open_by_addr(params.shared_addr,
+						    &handle);
+	}
+
+	if (status < 0)
+		pr_warn("transportshm_setup: no ring transport to proc %d, "
+			"status = 0x%x\n", remote_proc_id, status);
+	else
+		transportshm_setup_module->ring_handles[remote_proc_id] =
+									handle;
+}
+
+/* Detach the ring transport, if it was attached */
+static void _transportshm_setup_ring_detach(u16 remote_proc_id)
+{
+	void *handle = transportshm_setup_module->ring_handles[remote_proc_id];
+
+	if (handle == NULL)
+		return;
+
+	if (multiproc_self() < remote_proc_id)
+		transportring_delete(&handle);
+	else
+		transportring_close(&handle);
+	transportshm_setup_module->ring_handles[remote_proc_id] = NULL;
+}
+
 
 /* =============================================================================
  *  Functions
@@ -109,6 +194,9 @@ int transportshm_setup_attach(u16 remote_proc_id, u32 *shared_addr)
 		transportshm_setup_module->handles[remote_proc_id] = handle;
 	}
 
+	if (ring_event)
+		_transportshm_setup_ring_attach(remote_proc_id, shared_addr);
+
 exit:
 	if (status < 0)
 		pr_err("transportshm_setup_attach failed! status "
@@ -137,6 +225,8 @@ int transportshm_setup_detach(u16 remote_proc_id)
 		goto exit;
 	}
 
+	_transportshm_setup_ring_detach(remote_proc_id);
+
 	if (multiproc_self() < remote_proc_id) {
 		/* Delete the transport */
 		status = transportshm_delete(&handle);
@@ -185,6 +275,16 @@ u32 transportshm_setup_shared_mem_req(u32 *shared_addr)
 		params.shared_addr = shared_addr;
 
 		mem_req += transportshm_shared_mem_req(&params);
+
+		if (ring_event) {
+			struct transportring_params ring_params;
+
+			_transportshm_setup_ring_params(shared_addr,
+							&ring_params);
+			mem_req = (u32)(ring_params.shared_addr -
+					(void *)shared_addr) +
+				  transportring_shared_mem_req(&ring_params);
+		}
 	}
 
 exit:
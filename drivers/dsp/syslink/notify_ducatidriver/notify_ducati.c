@@ -24,6 +24,10 @@
 #include <linux/io.h>
 #include <linux/module.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <plat/mailbox.h>
 
 #include <syslink/multiproc.h>
@@ -86,6 +90,27 @@ static struct omap_mbox *tesla_mbox;
 static int notify_shmdrv_isr(struct notifier_block *, unsigned long, void *);
 static bool notify_shmdrv_isr_callback(void *ref_data, void* ntfy_msg);
 
+/* debugfs directory holding the statistics of each driver instance */
+static struct dentry *notify_ducatidrv_dbgfs;
+
+/* Per event statistics of a driver instance, shown in debugfs */
+struct notify_ducatidrv_event_stats {
+	u32 sent;
+	/* Events posted to the remote processor */
+	u32 received;
+	/* Events received from the remote processor */
+	u32 max_wait_us;
+	/* Longest wait for the remote processor to clear the event */
+	u64 dispatch_us;
+	/* Total time from the mailbox interrupt to the callback */
+	u32 max_dispatch_us;
+	/* Longest time from the mailbox interrupt to the callback */
+	u64 cbck_us;
+	/* Total time spent in the callback */
+	u32 max_cbck_us;
+	/* Longest time spent in the callback */
+};
+
 
 /* Defines the notify_ducatidrv state object, which contains all
  * the module specific information. */
@@ -140,6 +165,14 @@ struct notify_ducatidrv_object {
 	/* Spacing between event entries   */
 	u32 num_events;
 	/* Number of events configured */
+	u32 mbox_writes;
+	/* Mailbox messages sent to the remote processor */
+	u32 isr_count;
+	/* Mailbox messages received from the remote processor */
+	struct notify_ducatidrv_event_stats stats[NOTIFY_MAXEVENTS];
+	/* Per event statistics */
+	struct dentry *dbgfs;
+	/* debugfs file showing the statistics */
 };
 
 
@@ -158,6 +191,65 @@ static struct notifier_block ducati_notify_nb = {
 	.notifier_call = notify_shmdrv_isr,
 };
 
+static inline u32 notify_ducatidrv_us_since(ktime_t start)
+{
+	return (u32) ktime_to_us(ktime_sub(ktime_get(), start));
+}
+
+static int notify_ducatidrv_stats_show(struct seq_file *s, void *unused)
+{
+	struct notify_ducatidrv_object *obj = s->private;
+	struct notify_ducatidrv_event_stats *st;
+	u32 i;
+
+	seq_printf(s, "mailbox: %u sent, %u received\n", obj->mbox_writes,
+		   obj->isr_count);
+	seq_printf(s, "\ntimes in us\n%5s %10s %10s %10s %10s %10s %10s %10s\n",
+		   "event", "sent", "received", "wait max", "dispatch",
+		   "max", "callback", "max");
+	for (i = 0; i < obj->num_events; i++) {
+		st = &obj->stats[i];
+		if (!st->sent && !st->received)
+			continue;
+		seq_printf(s, "%5u %10u %10u %10u %10u %10u %10u %10u\n", i,
+			   st->sent, st->received, st->max_wait_us,
+			   st->received ? (u32) div_u64(st->dispatch_us,
+						       st->received) : 0,
+			   st->max_dispatch_us,
+			   st->received ? (u32) div_u64(st->cbck_us,
+						       st->received) : 0,
+			   st->max_cbck_us);
+	}
+	return 0;
+}
+
+static int notify_ducatidrv_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, notify_ducatidrv_stats_show, inode->i_private);
+}
+
+/* any write resets the statistics */
+static ssize_t notify_ducatidrv_stats_write(struct file *file,
+				const char __user *buf, size_t count,
+				loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct notify_ducatidrv_object *obj = s->private;
+
+	obj->mbox_writes = 0;
+	obj->isr_count = 0;
+	memset(obj->stats, 0, sizeof(obj->stats));
+	return count;
+}
+
+static const struct file_operations notify_ducatidrv_stats_fops = {
+	.open		= notify_ducatidrv_stats_open,
+	.read		= seq_read,
+	.write		= notify_ducatidrv_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /* Get the default configuration for the notify_ducatidrv module. */
 void notify_ducatidrv_get_config(struct notify_ducatidrv_config *cfg)
 {
@@ -246,6 +338,8 @@ int notify_ducatidrv_setup(struct notify_ducatidrv_config *cfg)
 			goto error_mailbox_get_failed;
 		}
 	}
+
+	notify_ducatidrv_dbgfs = debugfs_create_dir("notify_ducati", NULL);
 	return 0;
 
 error_mailbox_get_failed:
@@ -305,6 +399,10 @@ int notify_ducatidrv_destroy(void)
 	omap_mbox_put(tesla_mbox, &ducati_notify_nb);
 	tesla_mbox = NULL;
 
+	if (!IS_ERR_OR_NULL(notify_ducatidrv_dbgfs))
+		debugfs_remove_recursive(notify_ducatidrv_dbgfs);
+	notify_ducatidrv_dbgfs = NULL;
+
 exit:
 	if (status < 0) {
 		pr_err("notify_ducatidrv_destroy failed! "
@@ -412,6 +510,7 @@ struct notify_ducatidrv_object *notify_ducatidrv_create(
 	fxn_table.register_event = (void *)&notify_ducatidrv_register_event;
 	fxn_table.unregister_event = (void *)&notify_ducatidrv_unregister_event;
 	fxn_table.send_event = (void *)&notify_ducatidrv_send_event;
+	fxn_table.send_events = (void *)&notify_ducatidrv_send_events;
 	fxn_table.disable = (void *)&notify_ducatidrv_disable;
 	fxn_table.enable = (void *)&notify_ducatidrv_enable;
 	fxn_table.disable_event = (void *)&notify_ducatidrv_disable_event;
@@ -533,6 +632,12 @@ struct notify_ducatidrv_object *notify_ducatidrv_create(
 	}
 #endif
 
+	if (!IS_ERR_OR_NULL(notify_ducatidrv_dbgfs))
+		obj->dbgfs = debugfs_create_file(
+				multiproc_get_name(obj->remote_proc_id),
+				S_IRUGO | S_IWUSR, notify_ducatidrv_dbgfs, obj,
+				&notify_ducatidrv_stats_fops);
+
 	drv_handle->is_init = NOTIFY_DRIVERINITSTATUS_DONE;
 	mutex_unlock(notify_ducatidriver_state.gate_handle);
 	return obj;
@@ -634,6 +739,8 @@ int notify_ducatidrv_delete(struct notify_ducatidrv_object **handle_ptr)
 			[obj->params.remote_proc_id][obj->params.line_id] = \
 									NULL;
 
+		if (!IS_ERR_OR_NULL(obj->dbgfs))
+			debugfs_remove(obj->dbgfs);
 		kfree(obj);
 		obj = NULL;
 	}
@@ -828,49 +935,10 @@ exit:
 	return status;
 }
 
-/* Send a notification event to the registered users for this
- * notification on the specified processor. */
-int notify_ducatidrv_send_event(struct notify_driver_object *handle,
-				u32 event_id, u32 payload, bool wait_clear)
+/* Check that the remote processor can receive an event. */
+static int _notify_ducatidrv_check_event(struct notify_ducatidrv_object *obj,
+					u32 event_id)
 {
-	int status = NOTIFY_S_SUCCESS;
-	struct notify_ducatidrv_object *obj;
-	struct omap_mbox *mbox;
-	VOLATILE struct notify_ducatidrv_event_entry *event_entry;
-	int max_poll_count;
-	int i = 0;
-	mbox_msg_t msg;
-
-	if (WARN_ON(unlikely(handle == NULL))) {
-		status = NOTIFY_E_INVALIDARG;
-		goto exit;
-	}
-	if (WARN_ON(unlikely(handle->is_init != \
-					NOTIFY_DRIVERINITSTATUS_DONE))) {
-		status = NOTIFY_E_INVALIDARG;
-		goto exit;
-	}
-	if (WARN_ON(unlikely(handle->notify_handle == NULL))) {
-		status = NOTIFY_E_INVALIDARG;
-		goto exit;
-	}
-	if (WARN_ON(unlikely(handle->notify_handle->driver_handle == NULL))) {
-		status = NOTIFY_E_DRIVERNOTREGISTERED;
-		goto exit;
-	}
-
-	obj = (struct notify_ducatidrv_object *)
-				handle->notify_handle->driver_handle;
-
-	mbox = (obj->remote_proc_id) ? ducati_mbox : tesla_mbox;
-	if (WARN_ON(unlikely(obj->reg_chart == NULL))) {
-		status = NOTIFY_E_FAIL;
-		goto exit;
-	}
-
-	dsb();
-	event_entry = EVENTENTRY(obj->other_event_chart, obj->event_entry_size,
-					event_id);
 #if 0
 	/* Invalidate cache for the other processor's procCtrl. */
 	if (obj->cache_enabled) {
@@ -879,31 +947,45 @@ int notify_ducatidrv_send_event(struct notify_driver_object *handle,
 			Cache_Type_ALL, true);
 	}
 #endif
-	max_poll_count = notify_state.cfg.send_event_poll_count;
-
 	/* Check whether driver on other processor is initialized */
 	if (obj->other_proc_ctrl->recv_init_status != \
 					NOTIFYDUCATIDRIVER_INIT_STAMP) {
 		/* This may be used for polling till other-side driver is ready,
 		 * so do not set failure reason. */
-		status = NOTIFY_E_NOTINITIALIZED;
-		goto exit;
+		return NOTIFY_E_NOTINITIALIZED;
 	}
 	/* Check if other side has registered to receive this event. */
 	if (!test_bit(event_id, (unsigned long *)
 				&obj->other_proc_ctrl->event_reg_mask)) {
-		status = NOTIFY_E_EVTNOTREGISTERED;
 		/* This may be used for polling till other-side is ready, so
 		* do not set failure reason. */
-		goto exit;
+		return NOTIFY_E_EVTNOTREGISTERED;
 	}
 	if (!test_bit(event_id, (unsigned long *)
 				&obj->other_proc_ctrl->event_enable_mask)) {
-		status = NOTIFY_E_EVTDISABLED;
 		/* This may be used for polling till other-side is ready, so
 		* do not set failure reason. */
-		goto exit;
+		return NOTIFY_E_EVTDISABLED;
 	}
+	return NOTIFY_S_SUCCESS;
+}
+
+/* Flag an event and its payload in the event chart of the remote processor,
+ * without interrupting it. Called with the module gate held; on failure the
+ * gate has been released. */
+static int _notify_ducatidrv_post_event(struct notify_ducatidrv_object *obj,
+				u32 event_id, u32 payload, bool wait_clear)
+{
+	int status = NOTIFY_S_SUCCESS;
+	VOLATILE struct notify_ducatidrv_event_entry *event_entry;
+	int max_poll_count;
+	ktime_t start;
+	u32 wait_us;
+	int i = 0;
+
+	event_entry = EVENTENTRY(obj->other_event_chart, obj->event_entry_size,
+					event_id);
+	max_poll_count = notify_state.cfg.send_event_poll_count;
 #if 0
 	if (obj->cache_enabled) {
 		Cache_inv((void *)event_entry,
@@ -912,12 +994,10 @@ int notify_ducatidrv_send_event(struct notify_driver_object *handle,
 	}
 #endif
 	dsb();
-	status = mutex_lock_interruptible(
-				notify_ducatidriver_state.gate_handle);
-	if (status)
-		goto exit;
 
-	if (wait_clear == true) {
+	if (wait_clear == true &&
+		event_entry->flag != NOTIFYDUCATIDRIVER_DOWN) {
+		start = ktime_get();
 		/*Wait for completion of prev
 		event from other side*/
 		while ((event_entry->flag != NOTIFYDUCATIDRIVER_DOWN) && \
@@ -945,30 +1025,120 @@ int notify_ducatidrv_send_event(struct notify_driver_object *handle,
 			status = mutex_lock_interruptible(
 					notify_ducatidriver_state.gate_handle);
 		}
+		wait_us = notify_ducatidrv_us_since(start);
+		if (wait_us > obj->stats[event_id].max_wait_us)
+			obj->stats[event_id].max_wait_us = wait_us;
+		if (status < 0)
+			return status;
 	}
 
-	if (status >= 0) {
-		/* Set the event bit field and payload. */
-		event_entry->payload = payload;
-		event_entry->flag = NOTIFYDUCATIDRIVER_UP;
+	/* Set the event bit field and payload. */
+	event_entry->payload = payload;
+	event_entry->flag = NOTIFYDUCATIDRIVER_UP;
+	obj->stats[event_id].sent++;
 
 #if 0
-		if (obj->cache_enabled) {
-			Cache_inv((void *)event_entry,
-			sizeof(struct notify_ducatidrv_event_entry),
-			Cache_Type_ALL, TRUE);
-		}
+	if (obj->cache_enabled) {
+		Cache_inv((void *)event_entry,
+		sizeof(struct notify_ducatidrv_event_entry),
+		Cache_Type_ALL, TRUE);
+	}
 #endif
+	return status;
+}
+
+/* Send a notification event to the registered users for this
+ * notification on the specified processor. */
+int notify_ducatidrv_send_event(struct notify_driver_object *handle,
+				u32 event_id, u32 payload, bool wait_clear)
+{
+	return notify_ducatidrv_send_events(handle, &event_id, &payload, 1,
+						wait_clear);
+}
+
+/* Send several events to the remote processor. All the events are flagged
+ * in its event chart before it is interrupted, once: its interrupt handler
+ * scans every registered event, not only the one named in the mailbox
+ * message. Stops at the first event that cannot be sent; the events
+ * flagged before it are still signalled. */
+int notify_ducatidrv_send_events(struct notify_driver_object *handle,
+				u32 *event_ids, u32 *payloads, u32 num_events,
+				bool wait_clear)
+{
+	int status = NOTIFY_S_SUCCESS;
+	int tmp_status;
+	struct notify_ducatidrv_object *obj;
+	struct omap_mbox *mbox;
+	u32 posted = 0;
+	u32 i;
+	mbox_msg_t msg;
+
+	if (WARN_ON(unlikely(handle == NULL))) {
+		status = NOTIFY_E_INVALIDARG;
+		goto exit;
+	}
+	if (WARN_ON(unlikely(handle->is_init != \
+					NOTIFY_DRIVERINITSTATUS_DONE))) {
+		status = NOTIFY_E_INVALIDARG;
+		goto exit;
+	}
+	if (WARN_ON(unlikely(handle->notify_handle == NULL))) {
+		status = NOTIFY_E_INVALIDARG;
+		goto exit;
+	}
+	if (WARN_ON(unlikely(handle->notify_handle->driver_handle == NULL))) {
+		status = NOTIFY_E_DRIVERNOTREGISTERED;
+		goto exit;
+	}
+	if (WARN_ON(unlikely((event_ids == NULL) || (payloads == NULL) ||
+				(num_events == 0)))) {
+		status = NOTIFY_E_INVALIDARG;
+		goto exit;
+	}
+
+	obj = (struct notify_ducatidrv_object *)
+				handle->notify_handle->driver_handle;
+
+	mbox = (obj->remote_proc_id) ? ducati_mbox : tesla_mbox;
+	if (WARN_ON(unlikely(obj->reg_chart == NULL))) {
+		status = NOTIFY_E_FAIL;
+		goto exit;
+	}
+
+	dsb();
+	for (i = 0; i < num_events; i++) {
+		status = _notify_ducatidrv_check_event(obj, event_ids[i]);
+		if (status < 0)
+			goto exit;
+	}
+
+	status = mutex_lock_interruptible(
+				notify_ducatidriver_state.gate_handle);
+	if (status)
+		goto exit;
+
+	for (i = 0; i < num_events && status >= 0; i++) {
+		status = _notify_ducatidrv_post_event(obj, event_ids[i],
+						payloads[i], wait_clear);
+		if (status >= 0)
+			posted++;
+	}
+
+	if (posted != 0) {
 		dsb();
 
 		/* Send an interrupt with the event information to the
 		 * remote processor */
-		msg = ((obj->remote_proc_id << 16) | event_id);
-		status = omap_mbox_msg_send(mbox, msg);
+		msg = ((obj->remote_proc_id << 16) | event_ids[posted - 1]);
+		tmp_status = omap_mbox_msg_send(mbox, msg);
+		obj->mbox_writes++;
+		if (status >= 0)
+			status = tmp_status;
+	}
 
-		/* Leave critical section protection. */
+	/* Leave critical section protection, unless it was left on failure */
+	if (posted == num_events)
 		mutex_unlock(notify_ducatidriver_state.gate_handle);
-	}
 
 exit:
 	if (status < 0) {
@@ -1307,45 +1477,38 @@ EXPORT_SYMBOL(notify_shmdrv_isr);
 
 static bool notify_shmdrv_isr_callback(void *ref_data, void *notify_msg)
 {
-	u32 payload = 0;
-	u32 i = 0;
 	VOLATILE struct notify_ducatidrv_event_entry  *event_entry;
 	struct notify_ducatidrv_object *obj;
+	struct notify_ducatidrv_event_stats *st;
+	u32 event_ids[NOTIFY_MAXEVENTS];
+	u32 payloads[NOTIFY_MAXEVENTS];
+	ktime_t start;
+	ktime_t cbck_start;
 	u32 event_id;
+	u32 count;
+	u32 us;
+	u32 i;
 
 	obj = (struct notify_ducatidrv_object *) ref_data;
-
-	dsb();
-	/* Execute the loop till no asserted event is found for one complete
-	 * loop through all registered events */
+	start = ktime_get();
+	obj->isr_count++;
+
+	/* Each pass goes once through all registered events, acknowledges all
+	 * those that are asserted and then executes their callbacks, in order
+	 * of priority. One mailbox message may signal several events. Passes
+	 * are repeated until one finds no asserted event, so that events
+	 * flagged meanwhile are not left behind. */
 	do {
-		/* Check if the entry is a valid registered event.*/
-		event_id = obj->reg_chart[i];
-		if (event_id == (u32) -1)
-			break;
-
-		event_entry = EVENTENTRY(obj->self_event_chart,
-					obj->event_entry_size, event_id);
-#if 0
-		if (obj->cache_enabled) {
-			Cache_inv((void *)event_entry,
-			sizeof(struct notify_ducatidrv_event_entry),
-			Cache_Type_ALL, TRUE);
-		}
-#endif
+		count = 0;
 		dsb();
+		for (i = 0; i < obj->num_events; i++) {
+			/* Check if the entry is a valid registered event.*/
+			event_id = obj->reg_chart[i];
+			if (event_id == (u32) -1)
+				break;
 
-		/* Determine the current high priority event.*/
-		/* Check if the event is set and enabled.*/
-		if (event_entry->flag == NOTIFYDUCATIDRIVER_UP &&
-			test_bit(event_id, (unsigned long *)
-				&obj->self_proc_ctrl->event_enable_mask)) {
-			payload = event_entry->payload;
-
-			/* Acknowledge the event. */
-			event_entry->flag = NOTIFYDUCATIDRIVER_DOWN;
-
-			/* Write back acknowledgement */
+			event_entry = EVENTENTRY(obj->self_event_chart,
+					obj->event_entry_size, event_id);
 #if 0
 			if (obj->cache_enabled) {
 				Cache_inv((void *)event_entry,
@@ -1353,18 +1516,40 @@ static bool notify_shmdrv_isr_callback(void *ref_data, void *notify_msg)
 				Cache_Type_ALL, TRUE);
 			}
 #endif
-			dsb();
+			/* Check if the event is set and enabled.*/
+			if (event_entry->flag == NOTIFYDUCATIDRIVER_UP &&
+				test_bit(event_id, (unsigned long *)
+				&obj->self_proc_ctrl->event_enable_mask)) {
+				payloads[count] = event_entry->payload;
+				event_ids[count++] = event_id;
 
-			/* Execute the callback function */
-			notify_exec(obj->drv_handle->notify_handle, event_id,
-					payload);
-			/* reinitialize the event check counter. */
-			i = 0;
-		} else {
-			/* check for next event. */
-			i++;
+				/* Acknowledge the event. */
+				event_entry->flag = NOTIFYDUCATIDRIVER_DOWN;
+			}
+		}
+
+		/* Write back acknowledgements */
+		dsb();
+
+		/* Execute the callback functions */
+		for (i = 0; i < count; i++) {
+			st = &obj->stats[event_ids[i]];
+			cbck_start = ktime_get();
+			us = (u32) ktime_to_us(ktime_sub(cbck_start, start));
+			st->dispatch_us += us;
+			if (us > st->max_dispatch_us)
+				st->max_dispatch_us = us;
+
+			notify_exec(obj->drv_handle->notify_handle,
+					event_ids[i], payloads[i]);
+
+			us = notify_ducatidrv_us_since(cbck_start);
+			st->cbck_us += us;
+			if (us > st->max_cbck_us)
+				st->max_cbck_us = us;
+			st->received++;
 		}
-	} while ((event_id != (u32) -1) && (i < obj->num_events));
+	} while (count != 0);
 
 	return true;
 }
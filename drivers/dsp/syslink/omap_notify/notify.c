@@ -708,6 +708,90 @@ exit:
 }
 EXPORT_SYMBOL(notify_send_event);
 
+/* This function sends several events to the specified processor. When the
+ * driver supports it, all the events are posted before the remote processor
+ * is interrupted, once; otherwise they are sent one by one. The events are
+ * sent in order, and sending stops at the first one that fails. */
+int notify_send_events(u16 proc_id, u16 line_id, u32 *event_ids,
+			u32 *payloads, u32 num_events, bool wait_clear)
+{
+	int status = NOTIFY_S_SUCCESS;
+	u32 stripped_event_ids[NOTIFY_MAXEVENTS];
+	struct notify_driver_object *driver_handle;
+	u32 i;
+
+	if (WARN_ON(unlikely(atomic_cmpmask_and_lt(&(notify_state.ref_count),
+				NOTIFY_MAKE_MAGICSTAMP(0),
+				NOTIFY_MAKE_MAGICSTAMP(1)) == true))) {
+		status = NOTIFY_E_INVALIDSTATE;
+		goto exit;
+	}
+	if (WARN_ON(unlikely(proc_id >= multiproc_get_num_processors()))) {
+		status = NOTIFY_E_INVALIDARG;
+		goto exit;
+	}
+	if (WARN_ON(unlikely(line_id >= NOTIFY_MAX_INTLINES))) {
+		status = NOTIFY_E_INVALIDARG;
+		goto exit;
+	}
+	if (WARN_ON(unlikely((event_ids == NULL) || (payloads == NULL)))) {
+		status = NOTIFY_E_INVALIDARG;
+		goto exit;
+	}
+	if (WARN_ON(unlikely((num_events == 0) ||
+				(num_events > NOTIFY_MAXEVENTS)))) {
+		status = NOTIFY_E_INVALIDARG;
+		goto exit;
+	}
+
+	for (i = 0; i < num_events; i++) {
+		stripped_event_ids[i] = event_ids[i] & NOTIFY_EVENT_MASK;
+		if (WARN_ON(unlikely((stripped_event_ids[i] >= \
+					notify_state.cfg.num_events)))) {
+			status = NOTIFY_E_EVTNOTREGISTERED;
+			goto exit;
+		}
+		if (WARN_ON(unlikely(!ISRESERVED(event_ids[i],
+				notify_state.cfg.reserved_events)))) {
+			status = NOTIFY_E_EVTRESERVED;
+			goto exit;
+		}
+	}
+
+	driver_handle = notify_get_driver_handle(proc_id, line_id);
+	if (WARN_ON(driver_handle == NULL)) {
+		status = NOTIFY_E_DRIVERNOTREGISTERED;
+		goto exit;
+	}
+	if (WARN_ON(driver_handle->is_init != NOTIFY_DRIVERINITSTATUS_DONE)) {
+		status = NOTIFY_E_FAIL;
+		goto exit;
+	}
+
+	/* Loopback events and drivers without batching go one by one */
+	if (proc_id == multiproc_self() ||
+		driver_handle->fxn_table.send_events == NULL) {
+		for (i = 0; i < num_events && status >= 0; i++)
+			status = notify_send_event(proc_id, line_id,
+					event_ids[i], payloads[i], wait_clear);
+		goto exit;
+	}
+
+	/* Same as notify_send_event(), once for the whole batch */
+	status = ipu_pm_restore_ctx(proc_id);
+	if (status)
+		goto exit;
+
+	status = driver_handle->fxn_table.send_events(driver_handle,
+				stripped_event_ids, payloads, num_events,
+				wait_clear);
+exit:
+	if (status < 0)
+		pr_err("notify_send_events failed! status = 0x%x", status);
+	return status;
+}
+EXPORT_SYMBOL(notify_send_events);
+
 /* This function disables all events. This is equivalent to global
  * interrupt disable, however restricted within interrupts handled by
  * the Notify module. All callbacks registered for all events are
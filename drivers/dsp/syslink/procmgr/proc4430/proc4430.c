@@ -24,6 +24,7 @@
 #include <linux/io.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
+#include <linux/rcupdate.h>
 
 /* Module level headers */
 #include "../procdefs.h"
@@ -45,6 +46,14 @@
 #define PG_MASK(pg_size) (~((pg_size)-1))
 #define PG_ALIGN_LOW(addr, pg_size) ((addr) & PG_MASK(pg_size))
 
+/* Size of the address space slice covered by one translation index entry */
+#define PROC4430_XLATE_SHIFT	20
+#define PROC4430_XLATE_SIZE	(1 << (32 - PROC4430_XLATE_SHIFT))
+
+/* Index entry values other than a mem_entries index */
+#define PROC4430_XLATE_NONE	0xff
+#define PROC4430_XLATE_MANY	0xfe
+
 /*OMAP4430 Module state object */
 struct proc4430_module_object {
 	u32 config_size;
@@ -70,6 +79,10 @@ struct proc4430_object {
 	/* Instance parameters (configuration values) */
 	atomic_t attach_count;
 	/* attach reference count */
+	u8 *xlate;
+	/* mem_entries index for each slice of the master kernel virtual
+	* address space, followed by the same for the slave virtual address
+	* space. Built on attach, read under rcu_read_lock(). */
 };
 
 
@@ -295,6 +308,7 @@ void *proc4430_create(u16 proc_id, const struct proc4430_params *params)
 		handle->object = vmalloc(sizeof(struct proc4430_object));
 		handle->proc_id = proc_id;
 		object = (struct proc4430_object *)handle->object;
+		object->xlate = NULL;
 		if (params != NULL) {
 			/* Copy params into instance object. */
 			memcpy(&(object->params), (void *)params,
@@ -360,6 +374,7 @@ int proc4430_delete(void **handle_ptr)
 			vfree(object->params.mem_entries);
 			object->params.mem_entries = NULL;
 		}
+		kfree(object->xlate);
 		vfree(handle->object);
 		handle->object = NULL;
 	}
@@ -437,6 +452,55 @@ EXPORT_SYMBOL(proc4430_close);
  * Function to initialize the slave processor
  *
  */
+/* Record entry i as covering [base, base + size) in a translation index */
+static void proc4430_xlate_add(u8 *xlate, u32 base, u32 size, u32 i)
+{
+	u32 slice = base >> PROC4430_XLATE_SHIFT;
+	u32 last = (base + size - 1) >> PROC4430_XLATE_SHIFT;
+
+	if (base + size - 1 < base)
+		last = PROC4430_XLATE_SIZE - 1;
+	for (; slice <= last; slice++)
+		xlate[slice] = (xlate[slice] == PROC4430_XLATE_NONE) ?
+						i : PROC4430_XLATE_MANY;
+}
+
+/*
+ * Replace the translation index of an instance. A NULL index makes
+ * proc4430_translate_addr() scan all the mem_entries.
+ */
+static void proc4430_set_xlate(struct proc4430_object *object, bool build)
+{
+	struct proc4430_mem_entry *entry;
+	u8 *xlate = NULL;
+	u8 *old_xlate;
+	u32 i;
+
+	if (build && object->params.num_mem_entries < PROC4430_XLATE_MANY)
+		xlate = kmalloc(2 * PROC4430_XLATE_SIZE, GFP_KERNEL);
+	if (xlate != NULL) {
+		memset(xlate, PROC4430_XLATE_NONE, 2 * PROC4430_XLATE_SIZE);
+		for (i = 0; i < object->params.num_mem_entries; i++) {
+			entry = &(object->params.mem_entries[i]);
+			if (entry->size == 0)
+				continue;
+			if (entry->master_virt_addr != (u32)-1)
+				proc4430_xlate_add(xlate,
+					entry->master_virt_addr,
+					entry->size, i);
+			proc4430_xlate_add(xlate + PROC4430_XLATE_SIZE,
+					entry->slave_virt_addr, entry->size, i);
+		}
+	}
+
+	old_xlate = object->xlate;
+	rcu_assign_pointer(object->xlate, xlate);
+	if (old_xlate != NULL) {
+		synchronize_rcu();
+		kfree(old_xlate);
+	}
+}
+
 int proc4430_attach(void *handle, struct processor_attach_params *params)
 {
 	int retval = 0;
@@ -513,6 +577,7 @@ int proc4430_attach(void *handle, struct processor_attach_params *params)
 		}
 	}
 	params->num_mem_entries = map_count;
+	proc4430_set_xlate(object, true);
 	return retval;
 }
 
@@ -549,6 +614,9 @@ int proc4430_detach(void *handle)
 		OMAP4430PROC_MAKE_MAGICSTAMP(0)))
 		return 1;
 
+	/* Stop translating through the mappings before they go away */
+	proc4430_set_xlate(object, false);
+
 	for (i = 0; (i < object->params.num_mem_entries); i++) {
 		if ((object->params.mem_entries[i].master_virt_addr > 0)
 		    && (object->params.mem_entries[i].shared == true)) {
@@ -673,6 +741,9 @@ int proc4430_translate_addr(void *handle,
 	bool found = false;
 	u32 fm_addr_base = (u32)NULL;
 	u32 to_addr_base = (u32)NULL;
+	u8 *xlate;
+	u32 first;
+	u32 end;
 	u32 i;
 
 	if (atomic_cmpmask_and_lt(&proc4430_state.ref_count,
@@ -708,7 +779,25 @@ int proc4430_translate_addr(void *handle,
 	proc_handle = (struct processor_object *)handle;
 	object = (struct proc4430_object *)proc_handle->object;
 	*dst_addr = NULL;
-	for (i = 0 ; i < object->params.num_mem_entries ; i++) {
+
+	/* Narrow the search down to the entry covering src_addr, unless
+	 * several entries share its slice of the address space */
+	first = 0;
+	end = object->params.num_mem_entries;
+	rcu_read_lock();
+	xlate = rcu_dereference(object->xlate);
+	if (xlate != NULL) {
+		if (src_addr_type != PROC_MGR_ADDRTYPE_MASTERKNLVIRT)
+			xlate += PROC4430_XLATE_SIZE;
+		i = xlate[(u32)src_addr >> PROC4430_XLATE_SHIFT];
+		if (i == PROC4430_XLATE_NONE)
+			end = 0;
+		else if (i != PROC4430_XLATE_MANY) {
+			first = i;
+			end = i + 1;
+		}
+	}
+	for (i = first ; i < end ; i++) {
 		entry = &(object->params.mem_entries[i]);
 		fm_addr_base =
 			(src_addr_type == PROC_MGR_ADDRTYPE_MASTERKNLVIRT) ?
@@ -725,6 +814,7 @@ int proc4430_translate_addr(void *handle,
 			break;
 		}
 	}
+	rcu_read_unlock();
 
 	/* This check must not be removed even with build optimize. */
 	if (WARN_ON(found == false)) {
@@ -493,6 +493,7 @@ int proc_mgr_detach(void *handle)
 		return -EFAULT;
 	}
 	BUG_ON(handle == NULL);
+	proc_mgr_load_unmap(proc_mgr_handle->proc_id);
 	WARN_ON(mutex_lock_interruptible(proc_mgr_obj_state.gate_handle));
 	/* Detach from the Processor. */
 	retval = processor_detach(proc_mgr_handle->proc_handle);
@@ -782,3 +783,16 @@ int proc_mgr_virt_to_phys(void *handle, u32 da, u32 *mapped_entries,
 	return retval;;
 }
 EXPORT_SYMBOL(proc_mgr_virt_to_phys);
+
+/*==================================
+ *  Function that returns the processor ID of a ProcMgr instance.
+ */
+u16 proc_mgr_get_proc_id(void *handle)
+{
+	struct proc_mgr_object *proc_mgr_handle =
+				(struct proc_mgr_object *)handle;
+
+	BUG_ON(handle == NULL);
+	return proc_mgr_handle->proc_id;
+}
+EXPORT_SYMBOL(proc_mgr_get_proc_id);
@@ -576,6 +576,72 @@ static int proc_mgr_drv_ioctl(struct inode *inode, struct file *filp,
 			goto func_exit;
 	}
 	break;
+
+	case CMD_PROCMGR_LOADSEGMENTS:
+	{
+		struct proc_mgr_cmd_args_load_segments src_args;
+		struct proc_mgr_load_segment *segs;
+
+		 /* Copy the full args from user-side. */
+		retval = copy_from_user((void *)&src_args,
+			(const void __user *)(args),
+			sizeof(struct proc_mgr_cmd_args_load_segments));
+		if (WARN_ON(retval != 0))
+			goto func_exit;
+		if (src_args.num_segs == 0 ||
+			src_args.num_segs > PROCMGR_MAX_LOAD_SEGMENTS) {
+			retval = -EINVAL;
+			goto func_exit;
+		}
+
+		segs = kmalloc(src_args.num_segs *
+				sizeof(struct proc_mgr_load_segment),
+				GFP_KERNEL);
+		if (segs == NULL) {
+			retval = -ENOMEM;
+			goto func_exit;
+		}
+		retval = copy_from_user((void *)segs,
+			(const void __user *)(src_args.segs),
+			src_args.num_segs *
+			sizeof(struct proc_mgr_load_segment));
+		if (WARN_ON(retval != 0)) {
+			kfree(segs);
+			goto func_exit;
+		}
+		retval = proc_mgr_load_segments(src_args.handle, segs,
+				src_args.num_segs, src_args.flags,
+				&(src_args.stats));
+		kfree(segs);
+		if (WARN_ON(retval < 0))
+			goto func_exit;
+		retval = copy_to_user((void __user *)(args),
+			(const void *)&src_args,
+			sizeof(struct proc_mgr_cmd_args_load_segments));
+		WARN_ON(retval < 0);
+	}
+	break;
+
+	case CMD_PROCMGR_GETLOADSTATS:
+	{
+		struct proc_mgr_cmd_args_get_load_stats src_args;
+
+		 /* Copy the full args from user-side. */
+		retval = copy_from_user((void *)&src_args,
+			(const void __user *)(args),
+			sizeof(struct proc_mgr_cmd_args_get_load_stats));
+		if (WARN_ON(retval != 0))
+			goto func_exit;
+		retval = proc_mgr_get_load_stats(src_args.handle,
+					&(src_args.stats));
+		if (WARN_ON(retval < 0))
+			goto func_exit;
+		retval = copy_to_user((void __user *)(args),
+			(const void *)&src_args,
+			sizeof(struct proc_mgr_cmd_args_get_load_stats));
+		WARN_ON(retval < 0);
+	}
+	break;
 	default:
 		pr_err("PROC_MGR_DRV: WRONG IOCTL !!!!\n");
 		BUG_ON(1);
@@ -700,10 +766,12 @@ static int __init proc_mgr_drv_initialize_module(void)
 
 	/*Saving the context for future use*/
 	omap_proc_dev = procmgr_pdev;
+	proc_mgr_load_init();
 
 	retval = platform_driver_register(&procmgr_driver);
 	if (!retval)
 		return retval;
+	proc_mgr_load_exit();
 err_out:
 	platform_device_put(procmgr_pdev);
 	return retval;
@@ -718,6 +786,7 @@ static void __exit proc_mgr_drv_finalize_module(void)
 	dev_dbg(&omap_proc_dev->dev, "Entering %s function\n", __func__);
 	platform_device_unregister(procmgr_pdev);
 	platform_driver_unregister(&procmgr_driver);
+	proc_mgr_load_exit();
 	dev_dbg(&omap_proc_dev->dev, "Leaving %s function\n", __func__);
 }
 
@@ -187,6 +187,16 @@ struct proc_mgr_cmd_args {
  */
 #define CMD_PROCMGR_GETBOARDREV			(PROCMGR_BASE_CMD + 31)
 
+/*
+ * Command for ProcMgr_loadSegments
+ */
+#define CMD_PROCMGR_LOADSEGMENTS		(PROCMGR_BASE_CMD + 32)
+
+/*
+ * Command for ProcMgr_getLoadStats
+ */
+#define CMD_PROCMGR_GETLOADSTATS		(PROCMGR_BASE_CMD + 33)
+
 
 
 /*  ----------------------------------------------------------------------------
@@ -488,4 +498,34 @@ struct proc_mgr_cmd_args_cpurev {
 	struct proc_mgr_cmd_args commond_args;
 	u32 *cpu_rev;
 };
+
+/*
+ * Command arguments for ProcMgr_loadSegments
+ */
+struct proc_mgr_cmd_args_load_segments {
+	struct proc_mgr_cmd_args commond_args;
+	/*Common command args */
+	void *handle;
+	/*Handle to the ProcMgr object */
+	struct proc_mgr_load_segment *segs;
+	/*Array of segments to be loaded */
+	u32 num_segs;
+	/*Number of entries in segs */
+	u32 flags;
+	/*PROC_MGR_LOAD_* flags */
+	struct proc_mgr_load_stats stats;
+	/*Return parameter: timings of the load */
+};
+
+/*
+ * Command arguments for ProcMgr_getLoadStats
+ */
+struct proc_mgr_cmd_args_get_load_stats {
+	struct proc_mgr_cmd_args commond_args;
+	/*Common command args */
+	void *handle;
+	/*Handle to the ProcMgr object */
+	struct proc_mgr_load_stats stats;
+	/*Return parameter: timings of the last load */
+};
 #endif
@@ -0,0 +1,710 @@
+/*
+ * procmgr_load.c
+ *
+ * Syslink driver support functions for TI OMAP processors.
+ *
+ * Copyright (C) 2009-2010 Texas Instruments, Inc.
+ *
+ * This package is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <linux/types.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/completion.h>
+#include <linux/dma-mapping.h>
+#include <linux/ktime.h>
+#include <linux/err.h>
+#include <asm/sizes.h>
+
+#include <plat/dma.h>
+#include <plat/iommu.h>
+#include <plat/remoteproc.h>
+
+/* Module level headers */
+#include <procmgr.h>
+#include <syslink/multiproc.h>
+
+/* ================================
+ *  Macros and types
+ * ================================
+ */
+/* Size of each of the two staging buffers the segments are copied through */
+#define PROCMGR_LOAD_CHUNK		SZ_64K
+
+/* Number of slave MMU entries written before the tlb is flushed */
+#define PROCMGR_LOAD_MAP_BATCH		16
+
+/* Time allowed for one sDMA transfer to complete */
+#define PROCMGR_LOAD_DMA_TIMEOUT	msecs_to_jiffies(1000)
+
+/*
+ * Loader state of one slave processor
+ */
+struct proc_mgr_load_object {
+	struct mutex lock;
+	/* Serializes the loads to this slave */
+	int dma_ch;
+	/* sDMA channel, -1 if the segments are copied by the CPU */
+	struct completion dma_done;
+	/* Completed by the sDMA callback */
+	u16 dma_status;
+	/* Channel status passed to the last sDMA callback */
+	bool dma_busy;
+	/* A transfer was started and not waited for yet */
+	void *staging[2];
+	/* The CPU fills one staging buffer while sDMA drains the other */
+	dma_addr_t staging_pa[2];
+	/* Bus address of each staging buffer while it is mapped */
+	u32 staging_len[2];
+	/* Mapped length of each staging buffer, 0 if not mapped */
+	int cur;
+	/* Staging buffer the CPU fills next */
+	struct proc_mgr_load_stats stats;
+	/* Timings of the last load */
+	struct {
+		u32 da;
+		u32 len;
+	} maps[PROCMGR_MAX_MEMORY_REGIONS];
+	/* Slave MMU ranges mapped by the loader, removed on detach */
+	u32 num_maps;
+	/* Number of valid entries in maps */
+};
+
+static struct proc_mgr_load_object proc_mgr_load_objs[MULTIPROC_MAXPROCESSORS];
+
+/* ================================
+ *  Internal functions
+ * ================================
+ */
+/*
+ * sDMA callback, called in interrupt context once a transfer is done.
+ */
+static void proc_mgr_load_dma_cb(int lch, u16 ch_status, void *data)
+{
+	struct proc_mgr_load_object *obj = data;
+
+	obj->dma_status = ch_status;
+	complete(&obj->dma_done);
+}
+
+/*
+ * Get the sDMA channel and the staging buffers of a slave. The CPU is
+ * used for copying if any of them cannot be had.
+ */
+static void proc_mgr_load_dma_get(struct proc_mgr_load_object *obj)
+{
+	int i;
+
+	if (obj->dma_ch >= 0)
+		return;
+	for (i = 0; i < 2; i++) {
+		if (obj->staging[i] == NULL)
+			obj->staging[i] = kmalloc(PROCMGR_LOAD_CHUNK,
+							GFP_KERNEL);
+		if (obj->staging[i] == NULL)
+			return;
+	}
+	if (omap_request_dma(OMAP_DMA_NO_DEVICE, "syslink-procmgr load",
+			proc_mgr_load_dma_cb, obj, &obj->dma_ch) < 0) {
+		pr_warn("proc_mgr_load: no sDMA channel, using the CPU\n");
+		obj->dma_ch = -1;
+	}
+}
+
+/*
+ * Wait for the transfer in flight, if any.
+ */
+static int proc_mgr_load_dma_wait(struct proc_mgr_load_object *obj)
+{
+	int retval = 0;
+
+	if (obj->dma_busy) {
+		obj->dma_busy = false;
+		if (!wait_for_completion_timeout(&obj->dma_done,
+					PROCMGR_LOAD_DMA_TIMEOUT)) {
+			pr_err("proc_mgr_load: sDMA timed out\n");
+			omap_stop_dma(obj->dma_ch);
+			retval = -ETIMEDOUT;
+		} else if (!(obj->dma_status & OMAP_DMA_BLOCK_IRQ)) {
+			pr_err("proc_mgr_load: sDMA error, status 0x%x\n",
+				obj->dma_status);
+			retval = -EIO;
+		}
+	}
+	return retval;
+}
+
+/* Give a staging buffer back to the CPU once sDMA is done with it */
+static void proc_mgr_load_unmap_staging(struct proc_mgr_load_object *obj,
+					int i)
+{
+	if (obj->staging_len[i] == 0)
+		return;
+	dma_unmap_single(NULL, obj->staging_pa[i], obj->staging_len[i],
+			DMA_TO_DEVICE);
+	obj->staging_len[i] = 0;
+}
+
+/*
+ * Wait for the transfer in flight and unmap both staging buffers.
+ */
+static int proc_mgr_load_dma_drain(struct proc_mgr_load_object *obj)
+{
+	int retval;
+
+	retval = proc_mgr_load_dma_wait(obj);
+	proc_mgr_load_unmap_staging(obj, 0);
+	proc_mgr_load_unmap_staging(obj, 1);
+	return retval;
+}
+
+/*
+ * Start one sDMA transfer of up to len bytes from src, or of zeroes if
+ * fill is set, to dst. Returns the number of bytes it covers.
+ */
+static u32 proc_mgr_load_dma_start(struct proc_mgr_load_object *obj,
+				u32 src, u32 dst, u32 len, bool fill)
+{
+	int data_type = OMAP_DMA_DATA_TYPE_S32;
+	u32 shift = 2;
+	u32 frames = 1;
+
+	/* Move the aligned part 32 bits at a time, the tail bytewise */
+	if (!((src | dst) & 3) && len >= 4)
+		len &= ~3;
+	if ((src | dst | len) & 3) {
+		data_type = OMAP_DMA_DATA_TYPE_S8;
+		shift = 0;
+	}
+	/* Zeroes are written a chunk per frame */
+	if (len > PROCMGR_LOAD_CHUNK) {
+		frames = min_t(u32, len / PROCMGR_LOAD_CHUNK, 0xffff);
+		len = PROCMGR_LOAD_CHUNK;
+	}
+
+	omap_set_dma_transfer_params(obj->dma_ch, data_type, len >> shift,
+			frames, OMAP_DMA_SYNC_ELEMENT, OMAP_DMA_NO_DEVICE, 0);
+	omap_set_dma_src_params(obj->dma_ch, 0, fill ?
+			OMAP_DMA_AMODE_CONSTANT : OMAP_DMA_AMODE_POST_INC,
+			src, 0, 0);
+	omap_set_dma_dest_params(obj->dma_ch, 0, OMAP_DMA_AMODE_POST_INC,
+			dst, 0, 0);
+	omap_set_dma_src_burst_mode(obj->dma_ch, OMAP_DMA_DATA_BURST_16);
+	omap_set_dma_dest_burst_mode(obj->dma_ch, OMAP_DMA_DATA_BURST_16);
+	omap_set_dma_color_mode(obj->dma_ch, fill ?
+			OMAP_DMA_CONSTANT_FILL : OMAP_DMA_COLOR_DIS, 0);
+
+	INIT_COMPLETION(obj->dma_done);
+	obj->dma_busy = true;
+	omap_start_dma(obj->dma_ch);
+	return len * frames;
+}
+
+/*
+ * Move len bytes to dst by sDMA. The last transfer is left in flight,
+ * so that the CPU can prepare the next chunk meanwhile.
+ */
+static int proc_mgr_load_dma_xfer(struct proc_mgr_load_object *obj,
+				u32 src, u32 dst, u32 len, bool fill)
+{
+	int retval = 0;
+	u32 bytes;
+
+	while (len > 0) {
+		retval = proc_mgr_load_dma_wait(obj);
+		if (retval < 0)
+			break;
+		bytes = proc_mgr_load_dma_start(obj, src, dst, len, fill);
+		if (!fill)
+			src += bytes;
+		dst += bytes;
+		len -= bytes;
+	}
+	return retval;
+}
+
+/*
+ * Find the memory region holding [da, da + size) in the slave address
+ * space.
+ */
+static struct proc_mgr_addr_info *proc_mgr_load_find(
+			struct proc_mgr_proc_info *info, u32 da, u32 size)
+{
+	struct proc_mgr_addr_info *entry;
+	u32 base;
+	u32 i;
+
+	for (i = 0; i < PROCMGR_MAX_MEMORY_REGIONS; i++) {
+		entry = &(info->mem_entries[i]);
+		base = entry->addr[PROC_MGR_ADDRTYPE_SLAVEVIRT];
+		if (entry->size != 0 && da >= base && size <= entry->size &&
+				da - base <= entry->size - size)
+			return entry;
+	}
+	return NULL;
+}
+
+/* MMU of a slave, to be released with iommu_put() */
+static struct iommu *proc_mgr_load_mmu(u16 proc_id)
+{
+	if (proc_id == multiproc_get_id("Tesla"))
+		return iommu_get("tesla");
+	return iommu_get("ducati");
+}
+
+/*
+ * Check how much of [da, da + len) the slave MMU maps. Returns 1 if all
+ * of it, 0 if none of it, else -EEXIST.
+ */
+static int proc_mgr_load_mapped(struct iommu *mmu, u32 da, u32 len)
+{
+	bool any = false;
+	bool all = true;
+	u32 *pgd, *pte;
+	u32 end = da + len;
+	u32 step;
+
+	while (da < end) {
+		iopgtable_lookup_entry(mmu, da, &pgd, &pte);
+		if (pte != NULL) {
+			/* second level table: one small page at a time */
+			step = SZ_4K;
+			if (*pte)
+				any = true;
+			else
+				all = false;
+		} else {
+			/* section, supersection or nothing, per megabyte */
+			step = SZ_1M - (da & (SZ_1M - 1));
+			if (*pgd)
+				any = true;
+			else
+				all = false;
+		}
+		if (da + step < da)
+			break;
+		da += step;
+	}
+	if (all)
+		return 1;
+	return any ? -EEXIST : 0;
+}
+
+/* Largest slave MMU page mapping pa at da within len bytes */
+static u32 proc_mgr_load_pgsz(u32 da, u32 pa, u32 len)
+{
+	static const u32 pagesize[] = { SZ_16M, SZ_1M, SZ_64K, SZ_4K, };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pagesize); i++)
+		if (len >= pagesize[i] && IS_ALIGNED(da | pa, pagesize[i]))
+			return pagesize[i];
+	return 0;
+}
+
+/*
+ * Map one memory region of the slave in its MMU, with the largest pages
+ * its alignment allows. A region already mapped, by the user side loader
+ * or an earlier load, is left alone; a partially mapped one is refused.
+ * The range mapped here is recorded so proc_mgr_load_unmap() can remove
+ * it. Returns the number of entries written.
+ */
+static int proc_mgr_load_map(struct proc_mgr_load_object *obj,
+			struct iommu *mmu, struct proc_mgr_addr_info *entry)
+{
+	struct iotlb_entry e[PROCMGR_LOAD_MAP_BATCH];
+	u32 da, pa, len, bytes;
+	int count = 0;
+	int retval;
+	int n = 0;
+
+	/* The physical address was stored in the user virtual one on
+	 * attach, for mmap */
+	da = entry->addr[PROC_MGR_ADDRTYPE_SLAVEVIRT];
+	pa = entry->addr[PROC_MGR_ADDRTYPE_MASTERUSRVIRT];
+	len = entry->size;
+	if (!IS_ALIGNED(da | pa | len, SZ_4K)) {
+		pr_err("proc_mgr_load: region 0x%x (0x%x) is not page "
+			"aligned\n", da, len);
+		return -EINVAL;
+	}
+	retval = proc_mgr_load_mapped(mmu, da, len);
+	if (retval < 0) {
+		pr_err("proc_mgr_load: region 0x%x (0x%x) is partly "
+			"mapped\n", da, len);
+		return retval;
+	}
+	if (retval == 1)
+		return 0;
+
+	while (len > 0) {
+		bytes = proc_mgr_load_pgsz(da, pa, len);
+		memset(&e[n], 0, sizeof(e[n]));
+		e[n].da = da;
+		e[n].pa = pa;
+		e[n].pgsz = bytes_to_iopgsz(bytes);
+		e[n].valid = 1;
+		e[n].endian = MMU_RAM_ENDIAN_LITTLE;
+		e[n].elsz = MMU_RAM_ELSZ_32;
+		n++;
+		da += bytes;
+		pa += bytes;
+		len -= bytes;
+		if (n == PROCMGR_LOAD_MAP_BATCH || len == 0) {
+			retval = iopgtable_store_entries(mmu, e, n);
+			if (retval < 0)
+				break;
+			count += n;
+			n = 0;
+		}
+	}
+	da = entry->addr[PROC_MGR_ADDRTYPE_SLAVEVIRT];
+	if (retval < 0) {
+		/* the region was unmapped, undo the part done */
+		iopgtable_clear_range(mmu, da, da + entry->size);
+		return retval;
+	}
+	if (!WARN_ON(obj->num_maps == ARRAY_SIZE(obj->maps))) {
+		obj->maps[obj->num_maps].da = da;
+		obj->maps[obj->num_maps].len = entry->size;
+		obj->num_maps++;
+	}
+	return count;
+}
+
+/*
+ * Copy one segment into the slave memory. Returns a negative value on
+ * failure, else whether sDMA was used.
+ */
+static int proc_mgr_load_copy(struct proc_mgr_load_object *obj,
+			struct proc_mgr_proc_info *info,
+			struct proc_mgr_load_segment *seg, s64 *flush_us)
+{
+	struct proc_mgr_addr_info *entry;
+	int retval = 0;
+	int cur;
+	void *dst_va;
+	u32 dst_pa;
+	u32 off;
+	u32 n;
+	ktime_t t;
+
+	/* The whole segment must lie in one region, which bounds the
+	 * writes below */
+	entry = proc_mgr_load_find(info, seg->da, seg->size);
+	if (entry == NULL) {
+		pr_err("proc_mgr_load: segment 0x%x (0x%x) is outside the "
+			"slave memory\n", seg->da, seg->size);
+		return -EINVAL;
+	}
+	off = seg->da - entry->addr[PROC_MGR_ADDRTYPE_SLAVEVIRT];
+
+	if (obj->dma_ch < 0) {
+		/* No sDMA, write it through the kernel mapping instead */
+		if (entry->addr[PROC_MGR_ADDRTYPE_MASTERKNLVIRT] == 0 ||
+			entry->addr[PROC_MGR_ADDRTYPE_MASTERKNLVIRT] == (u32)-1)
+			return -EINVAL;
+		dst_va = (void *)entry->addr[PROC_MGR_ADDRTYPE_MASTERKNLVIRT] +
+									off;
+		if (seg->buffer_size && copy_from_user(dst_va,
+				(void __user *)seg->buffer, seg->buffer_size))
+			return -EFAULT;
+		memset(dst_va + seg->buffer_size, 0,
+			seg->size - seg->buffer_size);
+		return 0;
+	}
+
+	dst_pa = entry->addr[PROC_MGR_ADDRTYPE_MASTERUSRVIRT] + off;
+	for (off = 0; off < seg->buffer_size; off += n) {
+		n = min_t(u32, seg->buffer_size - off, PROCMGR_LOAD_CHUNK);
+		cur = obj->cur;
+		/* The transfer in flight reads the other staging buffer */
+		if (copy_from_user(obj->staging[cur],
+				(void __user *)seg->buffer + off, n)) {
+			retval = -EFAULT;
+			break;
+		}
+		retval = proc_mgr_load_dma_wait(obj);
+		if (retval < 0)
+			break;
+		proc_mgr_load_unmap_staging(obj, cur ^ 1);
+
+		t = ktime_get();
+		obj->staging_pa[cur] = dma_map_single(NULL, obj->staging[cur],
+							n, DMA_TO_DEVICE);
+		obj->staging_len[cur] = n;
+		*flush_us += ktime_us_delta(ktime_get(), t);
+
+		retval = proc_mgr_load_dma_xfer(obj, obj->staging_pa[cur],
+					dst_pa + off, n, false);
+		if (retval < 0)
+			break;
+		obj->cur ^= 1;
+	}
+	if (retval == 0 && seg->size > seg->buffer_size)
+		retval = proc_mgr_load_dma_xfer(obj, 0,
+				dst_pa + seg->buffer_size,
+				seg->size - seg->buffer_size, true);
+	/* Leave the last transfer in flight only for the next segment */
+	if (retval < 0)
+		proc_mgr_load_dma_drain(obj);
+	return (retval < 0) ? retval : 1;
+}
+
+/*
+ * Release the slave from reset through its remote processor device.
+ */
+static int proc_mgr_load_start(u16 proc_id)
+{
+	struct omap_rproc *rproc;
+	int retval;
+
+	if (proc_id == multiproc_get_id("SysM3"))
+		rproc = omap_rproc_get("ducati-proc0");
+	else if (proc_id == multiproc_get_id("AppM3"))
+		rproc = omap_rproc_get("ducati-proc1");
+	else if (proc_id == multiproc_get_id("Tesla"))
+		rproc = omap_rproc_get("tesla");
+	else
+		return -EINVAL;
+	if (IS_ERR_OR_NULL(rproc))
+		return rproc ? PTR_ERR(rproc) : -ENODEV;
+
+	retval = rproc_start(rproc, NULL);
+	omap_rproc_put(rproc);
+	return retval;
+}
+
+/* ================================
+ *  APIs
+ * ================================
+ */
+/*
+ *  Function to load the segments of a slave executable.
+ *
+ * Each segment is copied from its user buffer into the slave memory and
+ * its remainder zero filled. Segments are copied by sDMA through two
+ * staging buffers, so that the CPU fetches the next chunk from user space
+ * while the previous one is being transferred. sDMA writes the physical
+ * memory, so the region of a segment is mapped in the slave MMU, with
+ * large pages, while the last transfer of the previous segment is still
+ * in flight; the regions holding no segment are mapped at the end.
+ * If PROC_MGR_LOAD_START is set in flags the slave is released from
+ * reset once all the segments are in place. The time spent in each of
+ * these phases is returned in stats, if not NULL, and kept for
+ * proc_mgr_get_load_stats().
+ */
+int proc_mgr_load_segments(void *handle, struct proc_mgr_load_segment *segs,
+			u32 num_segs, u32 flags, struct proc_mgr_load_stats *stats)
+{
+	struct proc_mgr_load_object *obj;
+	struct proc_mgr_proc_info *info;
+	struct proc_mgr_load_stats st;
+	struct proc_mgr_addr_info *seg_entry;
+	struct proc_mgr_addr_info *entry;
+	struct iommu *mmu;
+	ktime_t start, t;
+	s64 flush_us = 0;
+	s64 map_us = 0;
+	u32 mapped = 0;
+	int retval = 0;
+	u16 proc_id;
+	u32 i, r;
+
+	if (WARN_ON(handle == NULL || segs == NULL))
+		return -EINVAL;
+	if (WARN_ON(num_segs == 0 || num_segs > PROCMGR_MAX_LOAD_SEGMENTS))
+		return -EINVAL;
+	for (i = 0; i < num_segs; i++) {
+		if (segs[i].buffer_size > segs[i].size ||
+				(segs[i].buffer_size && segs[i].buffer == NULL))
+			return -EINVAL;
+	}
+
+	info = kzalloc(sizeof(struct proc_mgr_proc_info), GFP_KERNEL);
+	if (info == NULL)
+		return -ENOMEM;
+	retval = proc_mgr_get_proc_info(handle, info);
+	if (retval < 0)
+		goto exit;
+
+	proc_id = proc_mgr_get_proc_id(handle);
+	obj = &proc_mgr_load_objs[proc_id];
+	memset(&st, 0, sizeof(st));
+	st.num_segments = num_segs;
+
+	mmu = proc_mgr_load_mmu(proc_id);
+	if (IS_ERR_OR_NULL(mmu)) {
+		retval = mmu ? PTR_ERR(mmu) : -ENODEV;
+		goto exit;
+	}
+
+	if (mutex_lock_interruptible(&obj->lock)) {
+		retval = -ERESTARTSYS;
+		goto put;
+	}
+	start = ktime_get();
+
+	proc_mgr_load_dma_get(obj);
+	for (i = 0; i <= num_segs; i++) {
+		/* Map the region of the next segment, all the others once
+		 * the segments are done */
+		seg_entry = NULL;
+		if (i < num_segs)
+			seg_entry = proc_mgr_load_find(info, segs[i].da,
+							segs[i].size);
+		for (r = 0; r < PROCMGR_MAX_MEMORY_REGIONS; r++) {
+			entry = &(info->mem_entries[r]);
+			if (entry->size == 0 || (mapped & (1U << r)))
+				continue;
+			if (i < num_segs && entry != seg_entry)
+				continue;
+			t = ktime_get();
+			retval = proc_mgr_load_map(obj, mmu, entry);
+			map_us += ktime_us_delta(ktime_get(), t);
+			if (retval < 0)
+				goto drain;
+			st.num_map_entries += retval;
+			mapped |= 1U << r;
+		}
+		if (i == num_segs)
+			break;
+
+		retval = proc_mgr_load_copy(obj, info, &segs[i], &flush_us);
+		if (retval < 0)
+			goto unlock;
+		st.dma |= retval;
+		st.num_bytes += segs[i].size;
+	}
+	retval = proc_mgr_load_dma_drain(obj);
+	if (retval < 0)
+		goto unlock;
+	st.map_us = map_us;
+	st.flush_us = flush_us;
+	st.copy_us = ktime_us_delta(ktime_get(), start) - map_us - flush_us;
+
+	if (flags & PROC_MGR_LOAD_START) {
+		t = ktime_get();
+		retval = proc_mgr_load_start(proc_id);
+		st.reset_us = ktime_us_delta(ktime_get(), t);
+		if (retval < 0)
+			goto unlock;
+	}
+	st.total_us = ktime_us_delta(ktime_get(), start);
+	memcpy(&obj->stats, &st, sizeof(st));
+	if (stats != NULL)
+		memcpy(stats, &st, sizeof(st));
+
+drain:
+	if (retval < 0)
+		proc_mgr_load_dma_drain(obj);
+unlock:
+	mutex_unlock(&obj->lock);
+put:
+	iommu_put(mmu);
+exit:
+	kfree(info);
+	if (retval < 0)
+		pr_err("proc_mgr_load_segments failed, status 0x%x\n", retval);
+	return retval;
+}
+EXPORT_SYMBOL(proc_mgr_load_segments);
+
+/*
+ *  Function to remove the slave MMU entries written by
+ * proc_mgr_load_segments(). Called on detach, so that a slave attached
+ * again, after a recovery for instance, starts from its own mappings.
+ */
+void proc_mgr_load_unmap(u16 proc_id)
+{
+	struct proc_mgr_load_object *obj = &proc_mgr_load_objs[proc_id];
+	struct iommu *mmu;
+	u32 i;
+
+	mutex_lock(&obj->lock);
+	if (obj->num_maps == 0)
+		goto exit;
+	mmu = proc_mgr_load_mmu(proc_id);
+	if (IS_ERR_OR_NULL(mmu)) {
+		pr_err("proc_mgr_load_unmap: no slave MMU\n");
+		goto exit;
+	}
+	for (i = 0; i < obj->num_maps; i++)
+		iopgtable_clear_range(mmu, obj->maps[i].da,
+				obj->maps[i].da + obj->maps[i].len);
+	iommu_put(mmu);
+	obj->num_maps = 0;
+
+exit:
+	mutex_unlock(&obj->lock);
+}
+EXPORT_SYMBOL(proc_mgr_load_unmap);
+
+/*
+ *  Function that returns the phase timings of the last successful
+ * proc_mgr_load_segments() call for a slave.
+ */
+int proc_mgr_get_load_stats(void *handle, struct proc_mgr_load_stats *stats)
+{
+	struct proc_mgr_load_object *obj;
+
+	if (WARN_ON(handle == NULL || stats == NULL))
+		return -EINVAL;
+
+	obj = &proc_mgr_load_objs[proc_mgr_get_proc_id(handle)];
+	if (mutex_lock_interruptible(&obj->lock))
+		return -ERESTARTSYS;
+	memcpy(stats, &obj->stats, sizeof(*stats));
+	mutex_unlock(&obj->lock);
+	return 0;
+}
+EXPORT_SYMBOL(proc_mgr_get_load_stats);
+
+/*
+ *  Function to set up the loader state of each slave. The sDMA channel
+ * and staging buffers are only taken on the first load.
+ */
+void proc_mgr_load_init(void)
+{
+	struct proc_mgr_load_object *obj;
+	int i;
+
+	for (i = 0; i < MULTIPROC_MAXPROCESSORS; i++) {
+		obj = &proc_mgr_load_objs[i];
+		memset(obj, 0, sizeof(*obj));
+		mutex_init(&obj->lock);
+		init_completion(&obj->dma_done);
+		obj->dma_ch = -1;
+	}
+}
+
+/*
+ *  Function to release the sDMA channels and staging buffers taken by
+ * the loader.
+ */
+void proc_mgr_load_exit(void)
+{
+	struct proc_mgr_load_object *obj;
+	int i;
+
+	for (i = 0; i < MULTIPROC_MAXPROCESSORS; i++) {
+		obj = &proc_mgr_load_objs[i];
+		if (obj->dma_ch >= 0)
+			omap_free_dma(obj->dma_ch);
+		obj->dma_ch = -1;
+		kfree(obj->staging[0]);
+		kfree(obj->staging[1]);
+		obj->staging[0] = NULL;
+		obj->staging[1] = NULL;
+		mutex_destroy(&obj->lock);
+	}
+}
@@ -65,6 +65,7 @@
 
 #if defined (__linux__)
 #include "mmap.h"
+#include "env_perproc.h"
 #endif
 
 
@@ -4659,13 +4660,17 @@ IMG_INT BridgedDispatchKM(PVRSRV_PER_PROCESS_DATA * psPerProc,
 
 #if defined(__linux__)
     {
-        
-        SYS_DATA *psSysData;
-
-        SysAcquireData(&psSysData);
+        PVRSRV_ENV_PER_PROCESS_DATA *psEnvPerProc;
 
         
-        psBridgeIn = ((ENV_DATA *)psSysData->pvEnvSpecificData)->pvBridgeData;
+        psEnvPerProc = (PVRSRV_ENV_PER_PROCESS_DATA *)PVRSRVProcessPrivateData(psPerProc);
+        if(psEnvPerProc == IMG_NULL)
+        {
+            PVR_DPF((PVR_DBG_ERROR, "%s: Process private data not allocated", __FUNCTION__));
+            goto return_fault;
+        }
+
+        psBridgeIn = psEnvPerProc->pvBridgeData;
         psBridgeOut = (IMG_PVOID)((IMG_PBYTE)psBridgeIn + PVRSRV_MAX_BRIDGE_IN_SIZE);
 
         
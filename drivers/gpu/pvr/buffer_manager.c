@@ -141,7 +141,8 @@ AllocMemory (BM_CONTEXT				*pBMContext,
 		
 		pBuf->CpuPAddr.uiAddr = pMapping->CpuPAddr.uiAddr + uOffset;
 
-		if(uFlags & PVRSRV_MEM_ZERO)
+		
+		if((uFlags & PVRSRV_MEM_ZERO) && !pMapping->bZeroed)
 		{
 			if(!ZeroBuf(pBuf, pMapping, uSize, psBMHeap->ui32Attribs | uFlags))
 			{
@@ -576,6 +577,7 @@ FreeBuf (BM_BUF *pBuf, IMG_UINT32 ui32Flags, IMG_BOOL bFromAllocator)
 
 
 				PVR_ASSERT(pBuf->ui32ExportCount == 0)
+				pBuf->pMapping->bZeroed = IMG_FALSE;
 				RA_Free (pBuf->pMapping->pArena, pBuf->DevVAddr.uiAddr, IMG_FALSE);
 			}
 		}
@@ -2053,6 +2055,7 @@ BM_ImportMemory (IMG_VOID *pH,
 	pMapping->uSize = uSize;
 	pMapping->pBMHeap = pBMHeap;
 	pMapping->ui32Flags = uFlags;
+	pMapping->bZeroed = IMG_FALSE;
 
 	
 	if (pActualSize)
@@ -2181,6 +2184,9 @@ BM_ImportMemory (IMG_VOID *pH,
 		}
 
 		
+		ui32Attribs |= (pMapping->ui32Flags & PVRSRV_MEM_ZERO);
+
+		
 		if (OSAllocPages(ui32Attribs,
 						 uPSize,
 						 pBMHeap->sDevArena.ui32DataPageSize,
@@ -2195,6 +2201,7 @@ BM_ImportMemory (IMG_VOID *pH,
 
 		
 		pMapping->eCpuMemoryOrigin = hm_env;
+		pMapping->bZeroed = OSMemHandleIsZeroed(pMapping->hOSMemHandle);
 	}
 	else if(pBMHeap->ui32Attribs & PVRSRV_BACKINGSTORE_LOCALMEM_CONTIG)
 	{
@@ -59,6 +59,9 @@ struct _BM_MAPPING_
 	IMG_SIZE_T			uSize;
     IMG_HANDLE          hOSMemHandle;
 	IMG_UINT32			ui32Flags;
+
+	
+	IMG_BOOL			bZeroed;
 };
 
 typedef struct _BM_BUF_
@@ -46,7 +46,6 @@ typedef	struct _PVR_PCI_DEV_TAG
 
 typedef struct _ENV_DATA_TAG
 {
-	IMG_VOID		*pvBridgeData;
 	struct pm_dev		*psPowerDevice;
 	IMG_BOOL		bLISRInstalled;
 	IMG_BOOL		bMISRInstalled;
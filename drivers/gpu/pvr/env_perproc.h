@@ -32,11 +32,16 @@
 
 #include "services.h"
 #include "handle.h"
+#include "mutex.h"
 
 typedef struct _PVRSRV_ENV_PER_PROCESS_DATA_
 {
 	IMG_HANDLE hBlockAlloc;
 	struct proc_dir_entry *psProcDir;
+	
+	PVRSRV_LINUX_MUTEX sBridgeLock;
+	IMG_VOID *pvBridgeData;
+	IMG_VOID *pvBridgeLockState;
 #if defined(SUPPORT_DRI_DRM) && defined(PVR_SECURE_DRM_AUTH_EXPORT)
 	struct list_head sDRMAuthListHead;
 #endif
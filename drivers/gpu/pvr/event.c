@@ -251,6 +251,7 @@ PVRSRV_ERROR LinuxEventObjectSignal(IMG_HANDLE hOSEventObjectList)
 PVRSRV_ERROR LinuxEventObjectWait(IMG_HANDLE hOSEventObject, IMG_UINT32 ui32MSTimeout)
 {
 	IMG_UINT32 ui32TimeStamp;
+	IMG_HANDLE hBridgeLocks;
 	DEFINE_WAIT(sWait);
 
 	PVRSRV_LINUX_EVENT_OBJECT *psLinuxEventObject = (PVRSRV_LINUX_EVENT_OBJECT *) hOSEventObject;
@@ -267,11 +268,11 @@ PVRSRV_ERROR LinuxEventObjectWait(IMG_HANDLE hOSEventObject, IMG_UINT32 ui32MSTi
 			break;
 		}
 
-		LinuxUnLockMutex(&gPVRSRVLock);		
+		hBridgeLocks = LinuxBridgeUnlockForWait();
 
 		ui32TimeOutJiffies = (IMG_UINT32)schedule_timeout((IMG_INT32)ui32TimeOutJiffies);
 		
-		LinuxLockMutex(&gPVRSRVLock);
+		LinuxBridgeRelockAfterWait(hBridgeLocks);
 #if defined(DEBUG)
 		psLinuxEventObject->ui32Stats++;
 #endif			
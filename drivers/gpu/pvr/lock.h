@@ -27,6 +27,15 @@
 #ifndef __LOCK_H__
 #define __LOCK_H__
 
-extern PVRSRV_LINUX_MUTEX gPVRSRVLock;
+/*
+ * Services global lock.  Bridge calls that pvr_bridge_k.c does not
+ * classify, open/release and the DRM ioctls hold it exclusively; the
+ * memory management, command submission and event wait calls hold it
+ * shared and serialise on the per-process, MM and submit locks instead.
+ */
+extern PVRSRV_LINUX_RWSEM gPVRSRVLock;
+
+IMG_HANDLE LinuxBridgeUnlockForWait(IMG_VOID);
+IMG_VOID LinuxBridgeRelockAfterWait(IMG_HANDLE hBridgeLocks);
 
 #endif 
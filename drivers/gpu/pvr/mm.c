@@ -38,6 +38,11 @@
 #include <linux/slab.h>
 #include <linux/highmem.h>
 #include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/moduleparam.h>
+#include <asm/cacheflush.h>
 
 #include "img_defs.h"
 #include "services.h"
@@ -168,6 +173,26 @@ static void ProcSeqStartstopDebugMutex(struct seq_file *sfile,IMG_BOOL start);
 
 static LinuxKMemCache *psLinuxMemAreaCache;
 
+static IMG_UINT32 gPVRZeroPoolPages = 512;
+module_param(gPVRZeroPoolPages, uint, 0644);
+MODULE_PARM_DESC(gPVRZeroPoolPages, "Number of pre-zeroed pages kept for device memory allocations (default 512)");
+
+static LIST_HEAD(g_sZeroPoolList);
+static DEFINE_SPINLOCK(g_sZeroPoolLock);
+static DECLARE_WAIT_QUEUE_HEAD(g_sZeroPoolWait);
+static IMG_UINT32 g_ui32ZeroPoolCount;
+static IMG_UINT32 g_ui32ZeroPoolHits;
+static IMG_UINT32 g_ui32ZeroPoolMisses;
+static struct task_struct *g_psZeroPoolThread;
+
+static struct proc_dir_entry *g_SeqFileZeroPool;
+static void* ProcSeqNextZeroPool(struct seq_file *sfile,void* el,loff_t off);
+static void ProcSeqShowZeroPool(struct seq_file *sfile,void* el);
+static void* ProcSeqOff2ElementZeroPool(struct seq_file *sfile, loff_t off);
+
+static IMG_VOID ZeroPoolInit(IMG_VOID);
+static IMG_VOID ZeroPoolCleanup(IMG_VOID);
+
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,15))
 static IMG_VOID ReservePages(IMG_VOID *pvAddress, IMG_UINT32 ui32Length);
@@ -231,6 +256,21 @@ LinuxMMInit(IMG_VOID)
         return PVRSRV_ERROR_OUT_OF_MEMORY;
     }
 
+    g_SeqFileZeroPool = CreateProcReadEntrySeq(
+								"zero_pool",
+								NULL,
+								ProcSeqNextZeroPool,
+								ProcSeqShowZeroPool,
+								ProcSeqOff2ElementZeroPool,
+								NULL
+							   );
+    if(!g_SeqFileZeroPool)
+    {
+        return PVRSRV_ERROR_OUT_OF_MEMORY;
+    }
+
+    ZeroPoolInit();
+
     return PVRSRV_OK;
 }
 
@@ -326,6 +366,14 @@ LinuxMMCleanup(IMG_VOID)
     }
 #endif
 
+    ZeroPoolCleanup();
+
+    if(g_SeqFileZeroPool)
+    {
+        RemoveProcEntrySeq(g_SeqFileZeroPool);
+        g_SeqFileZeroPool = NULL;
+    }
+
     if(psLinuxMemAreaCache)
     {
         KMemCacheDestroyWrapper(psLinuxMemAreaCache); 
@@ -943,6 +991,174 @@ FreeIOLinuxMemArea(LinuxMemArea *psLinuxMemArea)
 }
 
 
+static IMG_VOID
+ZeroPage(struct page *psPage)
+{
+    IMG_VOID *pvPageVAddr = kmap(psPage);
+
+    memset(pvPageVAddr, 0, PAGE_SIZE);
+
+    /*
+     * The GPU and uncached user mappings bypass the CPU cache, so the
+     * zeroes must reach memory before the page is handed out.
+     */
+#if defined(__arm__)
+    dmac_flush_range(pvPageVAddr, (IMG_UINT8 *)pvPageVAddr + PAGE_SIZE);
+    outer_flush_range(page_to_phys(psPage), page_to_phys(psPage) + PAGE_SIZE);
+#endif
+
+    kunmap(psPage);
+}
+
+
+static struct page *
+ZeroPoolGetPage(IMG_VOID)
+{
+    struct page *psPage = NULL;
+
+    spin_lock(&g_sZeroPoolLock);
+    if(!list_empty(&g_sZeroPoolList))
+    {
+        psPage = list_first_entry(&g_sZeroPoolList, struct page, lru);
+        list_del(&psPage->lru);
+        g_ui32ZeroPoolCount--;
+        g_ui32ZeroPoolHits++;
+    }
+    else
+    {
+        g_ui32ZeroPoolMisses++;
+    }
+    spin_unlock(&g_sZeroPoolLock);
+
+    return psPage;
+}
+
+
+static IMG_BOOL
+ZeroPoolNeedsWork(IMG_VOID)
+{
+    return (g_ui32ZeroPoolCount != gPVRZeroPoolPages) ? IMG_TRUE : IMG_FALSE;
+}
+
+
+static int
+ZeroPoolThread(void *pvData)
+{
+    struct sched_param sParam = { .sched_priority = 0 };
+
+    PVR_UNREFERENCED_PARAMETER(pvData);
+
+    
+    sched_setscheduler(current, SCHED_IDLE, &sParam);
+
+    while(!kthread_should_stop())
+    {
+        struct page *psPage;
+
+        if(!ZeroPoolNeedsWork())
+        {
+            wait_event_interruptible(g_sZeroPoolWait,
+                                     ZeroPoolNeedsWork() || kthread_should_stop());
+            continue;
+        }
+
+        
+        if(g_ui32ZeroPoolCount > gPVRZeroPoolPages)
+        {
+            psPage = NULL;
+            spin_lock(&g_sZeroPoolLock);
+            if(!list_empty(&g_sZeroPoolList))
+            {
+                psPage = list_first_entry(&g_sZeroPoolList, struct page, lru);
+                list_del(&psPage->lru);
+                g_ui32ZeroPoolCount--;
+            }
+            spin_unlock(&g_sZeroPoolLock);
+            if(psPage)
+            {
+                __free_pages(psPage, 0);
+            }
+            continue;
+        }
+
+        psPage = alloc_pages(GFP_KERNEL | __GFP_HIGHMEM | __GFP_NORETRY | __GFP_NOWARN, 0);
+        if(!psPage)
+        {
+            
+            schedule_timeout_interruptible(HZ);
+            continue;
+        }
+
+        ZeroPage(psPage);
+
+        spin_lock(&g_sZeroPoolLock);
+        list_add(&psPage->lru, &g_sZeroPoolList);
+        g_ui32ZeroPoolCount++;
+        spin_unlock(&g_sZeroPoolLock);
+
+        cond_resched();
+    }
+
+    return 0;
+}
+
+
+static IMG_VOID
+ZeroPoolInit(IMG_VOID)
+{
+    g_psZeroPoolThread = kthread_run(ZeroPoolThread, NULL, "pvr_zero_pool");
+    if(IS_ERR(g_psZeroPoolThread))
+    {
+        PVR_DPF((PVR_DBG_WARNING, "%s: couldn't start the page zeroing thread", __FUNCTION__));
+        g_psZeroPoolThread = NULL;
+    }
+}
+
+
+static IMG_VOID
+ZeroPoolCleanup(IMG_VOID)
+{
+    struct page *psPage, *psNext;
+
+    if(g_psZeroPoolThread)
+    {
+        kthread_stop(g_psZeroPoolThread);
+        g_psZeroPoolThread = NULL;
+    }
+
+    list_for_each_entry_safe(psPage, psNext, &g_sZeroPoolList, lru)
+    {
+        list_del(&psPage->lru);
+        __free_pages(psPage, 0);
+    }
+    g_ui32ZeroPoolCount = 0;
+}
+
+
+static void* ProcSeqOff2ElementZeroPool(struct seq_file *sfile, loff_t off)
+{
+    return off ? (void*)0 : PVR_PROC_SEQ_START_TOKEN;
+}
+
+static void* ProcSeqNextZeroPool(struct seq_file *sfile,void* el,loff_t off)
+{
+    return ProcSeqOff2ElementZeroPool(sfile, off);
+}
+
+static void ProcSeqShowZeroPool(struct seq_file *sfile,void* el)
+{
+    seq_printf(sfile,
+               "Target pages   %u\n"
+               "Pooled pages   %u\n"
+               "Pool hits      %u\n"
+               "Pool misses    %u\n",
+               gPVRZeroPoolPages,
+               g_ui32ZeroPoolCount,
+               g_ui32ZeroPoolHits,
+               g_ui32ZeroPoolMisses);
+}
+
+
 LinuxMemArea *
 NewAllocPagesLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags)
 {
@@ -969,11 +1185,25 @@ NewAllocPagesLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags)
     
     for(i=0; i<(IMG_INT32)ui32PageCount; i++)
     {
+        
+        if(ui32AreaFlags & PVRSRV_MEM_ZERO)
+        {
+            pvPageList[i] = ZeroPoolGetPage();
+            if(pvPageList[i])
+            {
+                continue;
+            }
+        }
+
         pvPageList[i] = alloc_pages(GFP_KERNEL | __GFP_HIGHMEM, 0);
         if(!pvPageList[i])
         {
             goto failed_alloc_pages;
         }
+        if(ui32AreaFlags & PVRSRV_MEM_ZERO)
+        {
+            ZeroPage(pvPageList[i]);
+        }
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,15))
     	
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,0))		
@@ -1002,6 +1232,7 @@ NewAllocPagesLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags)
     psLinuxMemArea->uData.sPageList.hBlockPageList = hBlockPageList;
     psLinuxMemArea->ui32ByteSize = ui32Bytes;
     psLinuxMemArea->ui32AreaFlags = ui32AreaFlags;
+    psLinuxMemArea->bZeroed = (ui32AreaFlags & PVRSRV_MEM_ZERO) ? IMG_TRUE : IMG_FALSE;
     INIT_LIST_HEAD(&psLinuxMemArea->sMMapOffsetStructList);
 
     
@@ -1010,6 +1241,12 @@ NewAllocPagesLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags)
         psLinuxMemArea->bNeedsCacheInvalidate = IMG_TRUE;
     }
 
+    
+    if((ui32AreaFlags & PVRSRV_MEM_ZERO) && ZeroPoolNeedsWork())
+    {
+        wake_up_interruptible(&g_sZeroPoolWait);
+    }
+
 #if defined(DEBUG_LINUX_MEM_AREAS)
     DebugLinuxMemAreaRecordAdd(psLinuxMemArea, ui32AreaFlags);
 #endif
@@ -140,6 +140,9 @@ struct _LinuxMemArea {
     IMG_BOOL bNeedsCacheInvalidate;	
 
     
+    IMG_BOOL bZeroed;
+
+    
     struct list_head	sMMapItem;
 
     
@@ -133,7 +133,7 @@ static struct file_operations pvrsrv_fops =
 };
 #endif
 
-PVRSRV_LINUX_MUTEX gPVRSRVLock;
+PVRSRV_LINUX_RWSEM gPVRSRVLock;
 
 IMG_UINT32 gui32ReleasePID;
 
@@ -427,7 +427,7 @@ static int PVRSRVOpen(struct inode unref__ * pInode, struct file *pFile)
 	PVRSRV_ENV_PER_PROCESS_DATA *psEnvPerProc;
 #endif
 
-	LinuxLockMutex(&gPVRSRVLock);
+	LinuxLockRWSemExclusive(&gPVRSRVLock);
 
 	ui32PID = OSGetCurrentProcessIDKM();
 
@@ -467,7 +467,7 @@ static int PVRSRVOpen(struct inode unref__ * pInode, struct file *pFile)
 	PRIVATE_DATA(pFile) = psPrivateData;
 	iRet = 0;
 err_unlock:	
-	LinuxUnLockMutex(&gPVRSRVLock);
+	LinuxUnLockRWSemExclusive(&gPVRSRVLock);
 	return iRet;
 }
 
@@ -480,7 +480,7 @@ static int PVRSRVRelease(struct inode unref__ * pInode, struct file *pFile)
 {
 	PVRSRV_FILE_PRIVATE_DATA *psPrivateData;
 
-	LinuxLockMutex(&gPVRSRVLock);
+	LinuxLockRWSemExclusive(&gPVRSRVLock);
 
 #if defined(SUPPORT_DRI_DRM)
 	psPrivateData = (PVRSRV_FILE_PRIVATE_DATA *)pvPrivData;
@@ -507,7 +507,7 @@ static int PVRSRVRelease(struct inode unref__ * pInode, struct file *pFile)
 #endif
 	}
 
-	LinuxUnLockMutex(&gPVRSRVLock);
+	LinuxUnLockRWSemExclusive(&gPVRSRVLock);
 
 #if !defined(SUPPORT_DRI_DRM)
 	return 0;
@@ -533,7 +533,7 @@ static int __init PVRCore_Init(IMG_VOID)
 
 	PVR_TRACE(("PVRCore_Init"));
 
-	LinuxInitMutex(&gPVRSRVLock);
+	LinuxInitRWSem(&gPVRSRVLock);
 
 	if (CreateProcEntries ())
 	{
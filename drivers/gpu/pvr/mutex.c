@@ -31,6 +31,7 @@
 #else
 #include <asm/semaphore.h>
 #endif
+#include <linux/rwsem.h>
 #include <linux/module.h>
 
 #include <img_defs.h>
@@ -134,3 +135,29 @@ IMG_BOOL LinuxIsLockedMutex(PVRSRV_LINUX_MUTEX *psPVRSRVMutex)
 
 #endif 
 
+
+IMG_VOID LinuxInitRWSem(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem)
+{
+    init_rwsem(psPVRSRVRWSem);
+}
+
+IMG_VOID LinuxLockRWSemShared(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem)
+{
+    down_read(psPVRSRVRWSem);
+}
+
+IMG_VOID LinuxUnLockRWSemShared(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem)
+{
+    up_read(psPVRSRVRWSem);
+}
+
+IMG_VOID LinuxLockRWSemExclusive(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem)
+{
+    down_write(psPVRSRVRWSem);
+}
+
+IMG_VOID LinuxUnLockRWSemExclusive(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem)
+{
+    up_write(psPVRSRVRWSem);
+}
+
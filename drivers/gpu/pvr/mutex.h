@@ -34,6 +34,7 @@
 #else
 #include <asm/semaphore.h>
 #endif
+#include <linux/rwsem.h>
 
 
 
@@ -66,5 +67,18 @@ extern IMG_VOID LinuxUnLockMutex(PVRSRV_LINUX_MUTEX *psPVRSRVMutex);
 extern IMG_BOOL LinuxIsLockedMutex(PVRSRV_LINUX_MUTEX *psPVRSRVMutex);
 
 
+typedef struct rw_semaphore PVRSRV_LINUX_RWSEM;
+
+extern IMG_VOID LinuxInitRWSem(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem);
+
+extern IMG_VOID LinuxLockRWSemShared(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem);
+
+extern IMG_VOID LinuxUnLockRWSemShared(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem);
+
+extern IMG_VOID LinuxLockRWSemExclusive(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem);
+
+extern IMG_VOID LinuxUnLockRWSemExclusive(PVRSRV_LINUX_RWSEM *psPVRSRVRWSem);
+
+
 #endif 
 
@@ -58,9 +58,27 @@ typedef struct OMAPLFB_FLIP_ITEM_TAG
 	OMAP_BOOL        bFlipped;
 	OMAP_BOOL        bCmdCompleted;
 	IMG_SYS_PHYADDR* sSysAddr;
+	/* Set by the vsync ISR once the DSS has latched the flip */
+	OMAP_BOOL        bScannedOut;
+	u32              ui32Fence;
+	unsigned long    ulCommitVSync;
+	ktime_t          sQueueTime;
 
 } OMAPLFB_FLIP_ITEM;
 
+typedef struct OMAPLFB_FLIP_STATS_TAG
+{
+	unsigned long       ulFlips;
+	unsigned long       ulLateFlips;
+	unsigned long       ulDroppedFlips;
+	unsigned long       ulQueueDepth;
+	unsigned long       ulMaxQueueDepth;
+	unsigned long       ulLastLatencyUs;
+	unsigned long       ulMaxLatencyUs;
+	unsigned long long  ullTotalLatencyUs;
+
+} OMAPLFB_FLIP_STATS;
+
 typedef struct PVRPDP_SWAPCHAIN_TAG
 {
 	unsigned int                    uiSwapChainID;
@@ -73,8 +91,30 @@ typedef struct PVRPDP_SWAPCHAIN_TAG
 	OMAP_BOOL                       bFlushCommands;
 	unsigned long                   ulSetFlushStateRefCount;
 	OMAP_BOOL                       bBlanked;
-	spinlock_t*                     psSwapChainLock;
+	spinlock_t                      sSwapChainLock;
 	void*                           pvDevInfo;
+	/*
+	 * When bVSyncISR is set the flip queue is drained at each DSS
+	 * vsync instead of from the sync workqueue, and the queue indices
+	 * and items are protected by sSwapChainLock. The vsync tasklet
+	 * commits the next flip as it retires one; sFlipWork then pans the
+	 * framebuffer to ulFBSyncAddr, and the tasklet commits nothing while
+	 * bFBSyncing is set.
+	 */
+	OMAP_BOOL                       bVSyncISR;
+	OMAP_BOOL                       bFlushing;
+	OMAP_BOOL                       bVSyncStalled;
+	OMAP_BOOL                       bFBSyncPending;
+	OMAP_BOOL                       bFBSyncing;
+	unsigned long                   ulFBSyncAddr;
+	struct omap_overlay_manager*    psFlipManager;
+	u32                             ui32VSyncMask;
+	unsigned long                   ulVSyncCount;
+	struct tasklet_struct           sVSyncTasklet;
+	struct timer_list               sVSyncTimer;
+	struct work_struct              sFlipWork;
+	OMAPLFB_FLIP_STATS              sFlipStats;
+	struct dentry*                  psStatsFile;
 
 } OMAPLFB_SWAPCHAIN;
 
@@ -144,6 +184,9 @@ typedef enum _OMAP_ERROR_
 
 #define FRAMEBUFFER_COUNT		num_registered_fb
 
+/* A committed flip not latched by then falls back to the workqueue */
+#define OMAPLFB_VSYNC_TIMEOUT_MS	100
+
 #define DEBUG
 #ifdef	DEBUG
 #define	DEBUG_PRINTK(format, ...) printk(KERN_DEBUG DRIVER_PREFIX \
@@ -168,6 +211,17 @@ void OMAPLFBPresentSyncAddr(OMAPLFB_DEVINFO *psDevInfo, unsigned long aPhyAddr);
 OMAP_ERROR OMAPLFBGetLibFuncAddr(char *szFunctionName,
 	PFN_DC_GET_PVRJTABLE *ppfnFuncTable);
 void OMAPLFBFlip(OMAPLFB_SWAPCHAIN *psSwapChain, unsigned long aPhyAddr);
+OMAP_ERROR OMAPLFBInstallVSyncISR(OMAPLFB_SWAPCHAIN *psSwapChain);
+void OMAPLFBUninstallVSyncISR(OMAPLFB_SWAPCHAIN *psSwapChain);
+OMAP_BOOL OMAPLFBFlipManagerChanged(OMAPLFB_SWAPCHAIN *psSwapChain);
+OMAP_BOOL OMAPLFBFlipCommit(OMAPLFB_SWAPCHAIN *psSwapChain,
+	unsigned long aPhyAddr, u32 *pui32Fence);
+OMAP_BOOL OMAPLFBFlipScannedOut(OMAPLFB_SWAPCHAIN *psSwapChain,
+	u32 ui32Fence);
+void OMAPLFBVSyncIHandler(OMAPLFB_SWAPCHAIN *psSwapChain);
+void OMAPLFBVSyncTimeoutHandler(OMAPLFB_SWAPCHAIN *psSwapChain);
+void OMAPLFBCreateSwapChainStats(OMAPLFB_SWAPCHAIN *psSwapChain);
+void OMAPLFBRemoveSwapChainStats(OMAPLFB_SWAPCHAIN *psSwapChain);
 #ifdef LDM_PLATFORM
 void OMAPLFBDriverSuspend(void);
 void OMAPLFBDriverResume(void);
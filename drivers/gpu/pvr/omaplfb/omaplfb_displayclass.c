@@ -45,6 +45,8 @@
 
 #include <linux/string.h>
 #include <linux/notifier.h>
+#include <linux/ktime.h>
+#include <linux/interrupt.h>
 
 #include "img_defs.h"
 #include "servicesext.h"
@@ -72,6 +74,7 @@ static PFN_DC_GET_PVRJTABLE pfnGetPVRJTable = NULL;
 static OMAPLFB_DEVINFO *pDisplayDevices = NULL;
 
 static void OMAPLFBSyncIHandler(struct work_struct*);
+static void OMAPLFBFlipWorkHandler(struct work_struct*);
 
 static OMAP_ERROR ReInitDev(OMAPLFB_DEVINFO *psDevInfo);
 
@@ -167,7 +170,17 @@ static void FlushInternalSyncQueue(OMAPLFB_SWAPCHAIN *psSwapChain)
 #endif
 	OMAPLFB_FLIP_ITEM *psFlipItem;
 	unsigned long            ulMaxIndex;
+	unsigned long            ulFlags;
 	unsigned long            i;
+
+	/*
+	 * Keep the vsync handler off the queue while it is flushed, and the
+	 * flip work from panning back to a flip of it
+	 */
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+	psSwapChain->bFlushing = OMAP_TRUE;
+	psSwapChain->bFBSyncPending = OMAP_FALSE;
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
 	
 	psFlipItem = &psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex];
 	ulMaxIndex = psSwapChain->ulBufferCount - 1;
@@ -208,14 +221,19 @@ static void FlushInternalSyncQueue(OMAPLFB_SWAPCHAIN *psSwapChain)
 		
 		/* Put the state of the buffer to be used again later */
 		psFlipItem->bFlipped = OMAP_FALSE;
+		psFlipItem->bScannedOut = OMAP_FALSE;
 		psFlipItem->bCmdCompleted = OMAP_FALSE;
 		psFlipItem->bValid = OMAP_FALSE;
 		psFlipItem =
 			&psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex];
 	}
 
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
 	psSwapChain->ulInsertIndex = 0;
 	psSwapChain->ulRemoveIndex = 0;
+	psSwapChain->sFlipStats.ulQueueDepth = 0;
+	psSwapChain->bFlushing = OMAP_FALSE;
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
 }
 
 /*
@@ -807,6 +825,16 @@ static PVRSRV_ERROR CreateDCSwapChain(IMG_HANDLE hDevice,
 	psSwapChain->ulRemoveIndex = 0;
 	psSwapChain->psPVRJTable = &psDevInfo->sPVRJTable;
 	psSwapChain->pvDevInfo = (void*)psDevInfo;
+	spin_lock_init(&psSwapChain->sSwapChainLock);
+	psSwapChain->bVSyncISR = OMAP_FALSE;
+	psSwapChain->bFlushing = OMAP_FALSE;
+	psSwapChain->bVSyncStalled = OMAP_FALSE;
+	psSwapChain->bFBSyncPending = OMAP_FALSE;
+	psSwapChain->bFBSyncing = OMAP_FALSE;
+	psSwapChain->psFlipManager = NULL;
+	INIT_WORK(&psSwapChain->sFlipWork, OMAPLFBFlipWorkHandler);
+	psSwapChain->psStatsFile = NULL;
+	memset(&psSwapChain->sFlipStats, 0, sizeof(OMAPLFB_FLIP_STATS));
 
 	/*
 	 * Init the workqueue (single thread, freezable and real time)
@@ -849,6 +877,7 @@ static PVRSRV_ERROR CreateDCSwapChain(IMG_HANDLE hDevice,
 	{
 		psFlipItems[i].bValid = OMAP_FALSE;
 		psFlipItems[i].bFlipped = OMAP_FALSE;
+		psFlipItems[i].bScannedOut = OMAP_FALSE;
 		psFlipItems[i].bCmdCompleted = OMAP_FALSE;
 	}
 
@@ -879,6 +908,19 @@ static PVRSRV_ERROR CreateDCSwapChain(IMG_HANDLE hDevice,
 	psSwapChain->uiSwapChainID = psDevInfo->uiSwapChainID;
 	*pui32SwapChainID = psDevInfo->uiSwapChainID;
 
+	/*
+	 * Commit the flips from the vsync of the display where possible,
+	 * else keep synchronizing them from the workqueue
+	 */
+	mutex_lock(&psDevInfo->sSwapChainLockMutex);
+	if (OMAPLFBInstallVSyncISR(psSwapChain) == OMAP_OK)
+		psSwapChain->bVSyncISR = OMAP_TRUE;
+	else
+		DEBUG_PRINTK("Flips of display %u are synchronized from "
+			"the workqueue", psDevInfo->uDeviceID);
+	mutex_unlock(&psDevInfo->sSwapChainLockMutex);
+	OMAPLFBCreateSwapChainStats(psSwapChain);
+
 	*phSwapChain = (IMG_HANDLE)psSwapChain;
 
 	return PVRSRV_OK;
@@ -930,8 +972,13 @@ static PVRSRV_ERROR DestroyDCSwapChain(IMG_HANDLE hDevice,
 			"notification");
 	}
 
+	OMAPLFBRemoveSwapChainStats(psSwapChain);
+
 	mutex_lock(&psDevInfo->sSwapChainLockMutex);
 
+	OMAPLFBUninstallVSyncISR(psSwapChain);
+	psSwapChain->bVSyncISR = OMAP_FALSE;
+
 	FlushInternalSyncQueue(psSwapChain);
 
 	/*
@@ -1064,6 +1111,305 @@ static PVRSRV_ERROR SwapToDCSystem(IMG_HANDLE hDevice,
 	return PVRSRV_OK;
 }
 
+/*
+ * Accounts a flip that reached the display.
+ * Called with sSwapChainLock held.
+ * in: psSwapChain, psFlipItem, bLate
+ */
+static void OMAPLFBFlipStatsScannedOut(OMAPLFB_SWAPCHAIN *psSwapChain,
+	OMAPLFB_FLIP_ITEM *psFlipItem, OMAP_BOOL bLate)
+{
+	OMAPLFB_FLIP_STATS *psStats = &psSwapChain->sFlipStats;
+	unsigned long ulLatencyUs;
+
+	ulLatencyUs = (unsigned long)ktime_us_delta(ktime_get(),
+		psFlipItem->sQueueTime);
+
+	psStats->ulFlips++;
+	if (bLate)
+		psStats->ulLateFlips++;
+	psStats->ulLastLatencyUs = ulLatencyUs;
+	if (ulLatencyUs > psStats->ulMaxLatencyUs)
+		psStats->ulMaxLatencyUs = ulLatencyUs;
+	psStats->ullTotalLatencyUs += ulLatencyUs;
+}
+
+/*
+ * Unhooks the swap chain from a vsync that went away and either hooks
+ * it to the overlay manager now scanning out the framebuffer, or falls
+ * back to the sync workqueue. A flip committed but never latched is
+ * committed again.
+ * Called with sSwapChainLockMutex held.
+ * in: psSwapChain, bRebind
+ */
+static void OMAPLFBRebindVSyncISR(OMAPLFB_SWAPCHAIN *psSwapChain,
+	OMAP_BOOL bRebind)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	OMAPLFB_FLIP_ITEM *psFlipItem;
+	unsigned long ulFlags;
+
+	OMAPLFBUninstallVSyncISR(psSwapChain);
+
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+	psSwapChain->bVSyncISR = OMAP_FALSE;
+	psFlipItem = &psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex];
+	if (psFlipItem->bValid && psFlipItem->bFlipped &&
+		!psFlipItem->bScannedOut)
+	{
+		if (!bRebind)
+			psSwapChain->sFlipStats.ulDroppedFlips++;
+		psFlipItem->bFlipped = OMAP_FALSE;
+	}
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+
+	if (bRebind && OMAPLFBInstallVSyncISR(psSwapChain) == OMAP_OK)
+	{
+		psSwapChain->bVSyncISR = OMAP_TRUE;
+		return;
+	}
+
+	/* The workqueue pans the framebuffer to each flip itself */
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+	psSwapChain->bFBSyncPending = OMAP_FALSE;
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+
+	WARNING_PRINTK("Lost the vsync of display %u, flips are "
+		"synchronized from the workqueue", psDevInfo->uDeviceID);
+	queue_work(psDevInfo->sync_display_wq, &psDevInfo->sync_display_work);
+}
+
+/*
+ * Commits the flip at the head of the queue, it is latched by the DSS at
+ * the next vsync. The flip work is then left to pan the framebuffer to
+ * it, or to rebind the vsync if the DSS did not take it.
+ * Called from the vsync tasklet or process context with sSwapChainLock
+ * held.
+ * in: psSwapChain
+ */
+static void OMAPLFBCommitFlipHead(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	OMAPLFB_FLIP_ITEM *psFlipItem;
+	unsigned long aPhyAddr;
+	u32 ui32Fence;
+
+	psFlipItem = &psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex];
+	if (!psFlipItem->bValid || psFlipItem->bFlipped ||
+		psSwapChain->bFBSyncing)
+		return;
+
+	aPhyAddr = (unsigned long)psFlipItem->sSysAddr->uiAddr;
+	if (!OMAPLFBFlipCommit(psSwapChain, aPhyAddr, &ui32Fence))
+	{
+		psSwapChain->bVSyncStalled = OMAP_TRUE;
+		queue_work(psDevInfo->sync_display_wq,
+			&psSwapChain->sFlipWork);
+		return;
+	}
+
+	psFlipItem->ui32Fence = ui32Fence;
+	psFlipItem->ulCommitVSync = psSwapChain->ulVSyncCount;
+	psFlipItem->bFlipped = OMAP_TRUE;
+	mod_timer(&psSwapChain->sVSyncTimer,
+		jiffies + msecs_to_jiffies(OMAPLFB_VSYNC_TIMEOUT_MS));
+
+	psSwapChain->ulFBSyncAddr = aPhyAddr;
+	psSwapChain->bFBSyncPending = OMAP_TRUE;
+	queue_work(psDevInfo->sync_display_wq, &psSwapChain->sFlipWork);
+}
+
+/*
+ * Pans the framebuffer to the flip last committed from the vsync, so its
+ * var and the scanout position kept by the framebuffer owner match what
+ * the DSS shows. The pan applies that flip again, so the vsync tasklet
+ * commits nothing meanwhile, else an older buffer could come back; a
+ * flip it had to leave is committed here after the pan.
+ * Called with sSwapChainLockMutex held.
+ * in: psSwapChain
+ */
+static void OMAPLFBSyncFBVar(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	unsigned long ulFlags;
+	unsigned long aPhyAddr;
+
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+	if (!psSwapChain->bFBSyncPending)
+	{
+		spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+		return;
+	}
+	psSwapChain->bFBSyncPending = OMAP_FALSE;
+	psSwapChain->bFBSyncing = OMAP_TRUE;
+	aPhyAddr = psSwapChain->ulFBSyncAddr;
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+
+	OMAPLFBFlip(psSwapChain, aPhyAddr);
+
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+	psSwapChain->bFBSyncing = OMAP_FALSE;
+	OMAPLFBCommitFlipHead(psSwapChain);
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+}
+
+/*
+ * Rebinds the vsync if it stalled or moved, commits the flip at the head
+ * of the queue if the vsync tasklet did not, and pans the framebuffer to
+ * the last committed flip.
+ * Called with sSwapChainLockMutex held.
+ * in: psSwapChain
+ */
+static void OMAPLFBCommitFlipQueue(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	unsigned long ulFlags;
+	OMAP_BOOL bStalled;
+	OMAP_BOOL bChanged;
+
+	if (!psSwapChain->bVSyncISR)
+		return;
+
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+	bStalled = psSwapChain->bVSyncStalled;
+	psSwapChain->bVSyncStalled = OMAP_FALSE;
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+
+	bChanged = OMAPLFBFlipManagerChanged(psSwapChain);
+	if (bStalled || bChanged)
+	{
+		OMAPLFBRebindVSyncISR(psSwapChain, bChanged);
+		if (!psSwapChain->bVSyncISR)
+			return;
+	}
+
+	if (psSwapChain->bFlushCommands || psDevInfo->bDeviceSuspended
+#if defined(SUPPORT_DRI_DRM)
+		|| psDevInfo->bLeaveVT
+#endif
+	)
+		return;
+
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+	OMAPLFBCommitFlipHead(psSwapChain);
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+
+	OMAPLFBSyncFBVar(psSwapChain);
+}
+
+/*
+ * Pans the framebuffer to the flips committed by the vsync tasklet, and
+ * commits the one it had to leave, or checks the vsync after a timeout
+ * in: work
+ */
+static void OMAPLFBFlipWorkHandler(struct work_struct *work)
+{
+	OMAPLFB_SWAPCHAIN *psSwapChain = container_of(work, OMAPLFB_SWAPCHAIN,
+		sFlipWork);
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+
+	mutex_lock(&psDevInfo->sSwapChainLockMutex);
+	if (psDevInfo->psSwapChain == psSwapChain)
+		OMAPLFBCommitFlipQueue(psSwapChain);
+	mutex_unlock(&psDevInfo->sSwapChainLockMutex);
+}
+
+/*
+ * Retires the flip queue at each vsync of the display. The flip at the
+ * head of the queue stays on screen for its swap interval, counted from
+ * the vsync the DSS latched it at, then its command is completed and the
+ * next queued flip is committed right away.
+ * in: psSwapChain
+ */
+void OMAPLFBVSyncIHandler(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	OMAPLFB_FLIP_ITEM *psFlipItem;
+	unsigned long ulMaxIndex;
+	unsigned long ulFlags;
+	OMAP_BOOL bLate;
+
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+
+	if (psSwapChain->bFlushing || psSwapChain->bFlushCommands ||
+		psDevInfo->bDeviceSuspended
+#if defined(SUPPORT_DRI_DRM)
+		|| psDevInfo->bLeaveVT
+#endif
+	)
+		goto ExitUnlock;
+
+	psFlipItem = &psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex];
+	ulMaxIndex = psSwapChain->ulBufferCount - 1;
+
+	if (!psFlipItem->bValid || !psFlipItem->bFlipped)
+		goto ExitUnlock;
+
+	if (!psFlipItem->bScannedOut)
+	{
+		if (!OMAPLFBFlipScannedOut(psSwapChain, psFlipItem->ui32Fence))
+			goto ExitUnlock;
+
+		/* Late if it missed the vsync after its commit */
+		bLate = (psSwapChain->ulVSyncCount -
+			psFlipItem->ulCommitVSync > 1) ? OMAP_TRUE : OMAP_FALSE;
+		psFlipItem->bScannedOut = OMAP_TRUE;
+		OMAPLFBFlipStatsScannedOut(psSwapChain, psFlipItem, bLate);
+	}
+
+	psFlipItem->ulSwapInterval--;
+	if (psFlipItem->ulSwapInterval != 0)
+	{
+		mod_timer(&psSwapChain->sVSyncTimer,
+			jiffies + msecs_to_jiffies(OMAPLFB_VSYNC_TIMEOUT_MS));
+		goto ExitUnlock;
+	}
+
+	/* Mark the flip item as completed to reuse it */
+	psSwapChain->ulRemoveIndex++;
+	if (psSwapChain->ulRemoveIndex > ulMaxIndex)
+		psSwapChain->ulRemoveIndex = 0;
+	psSwapChain->sFlipStats.ulQueueDepth--;
+	psFlipItem->bScannedOut = OMAP_FALSE;
+	psFlipItem->bFlipped = OMAP_FALSE;
+	psFlipItem->bValid = OMAP_FALSE;
+
+	psSwapChain->psPVRJTable->pfnPVRSRVCmdComplete(
+		(IMG_HANDLE)psFlipItem->hCmdComplete,
+		IMG_TRUE);
+
+	/* Nothing is in flight until the next flip is committed */
+	del_timer(&psSwapChain->sVSyncTimer);
+
+	OMAPLFBCommitFlipHead(psSwapChain);
+
+ExitUnlock:
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+}
+
+/*
+ * No vsync retired the flip in flight in time, the display stopped or
+ * moved. The flip work hooks the swap chain to the new vsync or falls
+ * back to the workqueue.
+ * in: psSwapChain
+ */
+void OMAPLFBVSyncTimeoutHandler(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	OMAPLFB_FLIP_ITEM *psFlipItem;
+	unsigned long ulFlags;
+
+	/* A timeout only matters if a flip is still in flight */
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+	psFlipItem = &psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex];
+	if (psFlipItem->bValid && psFlipItem->bFlipped)
+	{
+		psSwapChain->bVSyncStalled = OMAP_TRUE;
+		queue_work(psDevInfo->sync_display_wq,
+			&psSwapChain->sFlipWork);
+	}
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+}
+
 /*
  * Handles the synchronization with the display
  * in: work
@@ -1075,11 +1421,13 @@ static void OMAPLFBSyncIHandler(struct work_struct *work)
 	OMAPLFB_FLIP_ITEM *psFlipItem;
 	OMAPLFB_SWAPCHAIN *psSwapChain;
 	unsigned long ulMaxIndex;
+	unsigned long ulFlags;
 
 	mutex_lock(&psDevInfo->sSwapChainLockMutex);
 
 	psSwapChain = psDevInfo->psSwapChain;
-	if (!psSwapChain || psSwapChain->bFlushCommands 
+	if (!psSwapChain || psSwapChain->bFlushCommands ||
+		psSwapChain->bVSyncISR
 #if defined(SUPPORT_DRI_DRM)
 		|| psDevInfo->bLeaveVT
 #endif
@@ -1094,15 +1442,25 @@ static void OMAPLFBSyncIHandler(struct work_struct *work)
 		/* Update display */
 		OMAPLFBPresentSync(psDevInfo, psFlipItem);
 
+		spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+		if (psFlipItem->bFlipped == OMAP_FALSE)
+			OMAPLFBFlipStatsScannedOut(psSwapChain, psFlipItem,
+				OMAP_FALSE);
+		spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+
 		psFlipItem->ulSwapInterval--;
 		psFlipItem->bFlipped = OMAP_TRUE;
 
 		if (psFlipItem->ulSwapInterval == 0) {
 
 			/* Mark the flip item as completed to reuse it */
+			spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
 			psSwapChain->ulRemoveIndex++;
 			if (psSwapChain->ulRemoveIndex > ulMaxIndex)
 				psSwapChain->ulRemoveIndex = 0;
+			psSwapChain->sFlipStats.ulQueueDepth--;
+			spin_unlock_irqrestore(&psSwapChain->sSwapChainLock,
+				ulFlags);
 			psFlipItem->bCmdCompleted = OMAP_FALSE;
 			psFlipItem->bFlipped = OMAP_FALSE;
 			psFlipItem->bValid = OMAP_FALSE;
@@ -1146,6 +1504,8 @@ static IMG_BOOL ProcessFlip(IMG_HANDLE  hCmdCookie,
 #if defined(SYS_USING_INTERRUPTS)
 	OMAPLFB_FLIP_ITEM* psFlipItem;
 	unsigned long ulMaxIndex;
+	unsigned long ulFlags;
+	OMAP_BOOL bIdle;
 #endif
 
 	if(!hCmdCookie || !pvData)
@@ -1187,6 +1547,10 @@ static IMG_BOOL ProcessFlip(IMG_HANDLE  hCmdCookie,
 
 		psSwapChain->bFlushCommands == OMAP_TRUE)
 	{
+		/* The flip work must not pan back to an older flip */
+		spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+		psSwapChain->bFBSyncPending = OMAP_FALSE;
+		spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
 #endif
 		OMAPLFBFlip(psSwapChain,
 			(unsigned long)psBuffer->sSysAddr.uiAddr);
@@ -1197,6 +1561,8 @@ static IMG_BOOL ProcessFlip(IMG_HANDLE  hCmdCookie,
 		goto ExitTrueUnlock;
 	}
 
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+
 	psFlipItem = &psSwapChain->psFlipItems[psSwapChain->ulInsertIndex];
 
 	if(psFlipItem->bValid == OMAP_FALSE)
@@ -1204,27 +1570,58 @@ static IMG_BOOL ProcessFlip(IMG_HANDLE  hCmdCookie,
 		/* Mark the flip item as not flipped */
 		ulMaxIndex = psSwapChain->ulBufferCount - 1;
 		psFlipItem->bFlipped = OMAP_FALSE;
+		psFlipItem->bScannedOut = OMAP_FALSE;
 
 		/*
-		 * The buffer is queued here, must be consumed by the workqueue
+		 * The buffer is queued here, must be consumed by the vsync
+		 * handler or the workqueue
 		 */
 		psFlipItem->hCmdComplete = (OMAP_HANDLE)hCmdCookie;
 		psFlipItem->ulSwapInterval =
 			(unsigned long)psFlipCmd->ui32SwapInterval;
 		psFlipItem->sSysAddr = &psBuffer->sSysAddr;
+		psFlipItem->sQueueTime = ktime_get();
 		psFlipItem->bValid = OMAP_TRUE;
 
 		psSwapChain->ulInsertIndex++;
 		if(psSwapChain->ulInsertIndex > ulMaxIndex)
 			psSwapChain->ulInsertIndex = 0;
 
-		/* Give work to the workqueue to sync with the display */
-		queue_work(psDevInfo->sync_display_wq, &psDevInfo->sync_display_work);
+		psSwapChain->sFlipStats.ulQueueDepth++;
+		if (psSwapChain->sFlipStats.ulQueueDepth >
+			psSwapChain->sFlipStats.ulMaxQueueDepth)
+			psSwapChain->sFlipStats.ulMaxQueueDepth =
+				psSwapChain->sFlipStats.ulQueueDepth;
+
+		bIdle = (psFlipItem ==
+			&psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex]) ?
+			OMAP_TRUE : OMAP_FALSE;
+
+		spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+
+		/* An idle swap chain gets back to the vsync if it can */
+		if (bIdle && !psSwapChain->bVSyncISR &&
+			OMAPLFBInstallVSyncISR(psSwapChain) == OMAP_OK)
+			psSwapChain->bVSyncISR = OMAP_TRUE;
+
+		/*
+		 * A flip queued behind none is committed right away, to be
+		 * latched at the next vsync, else give work to the workqueue
+		 * to sync with the display
+		 */
+		if (psSwapChain->bVSyncISR)
+			OMAPLFBCommitFlipQueue(psSwapChain);
+		else
+			queue_work(psDevInfo->sync_display_wq,
+				&psDevInfo->sync_display_work);
 
 		goto ExitTrueUnlock;
-	} else
-		WARNING_PRINTK("Dropping frame! %p index %lu is the flip "
-			"queue full?", psFlipItem, psSwapChain->ulInsertIndex);
+	}
+
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+
+	WARNING_PRINTK("Dropping frame! %p index %lu is the flip "
+		"queue full?", psFlipItem, psSwapChain->ulInsertIndex);
 
 	mutex_unlock(&psDevInfo->sSwapChainLockMutex);
 	return IMG_FALSE;
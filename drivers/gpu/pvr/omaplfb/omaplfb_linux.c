@@ -37,6 +37,12 @@
 
 #include <linux/version.h>
 #include <linux/fb.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/interrupt.h>
+#include <linux/timer.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <asm/io.h>
 
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,32))
@@ -310,6 +316,304 @@ void OMAPLFBPresentSyncAddr(OMAPLFB_DEVINFO *psDevInfo,
 	}
 }
 
+/*
+ * Vsync interrupt of the overlay manager scanning out the swap chain.
+ * The DSS retires its apply fences from its own vsync handler, which
+ * may be called after this one, so the flip queue is looked at from a
+ * tasklet run once all the handlers of the interrupt are done.
+ * in: arg, mask
+ */
+static void OMAPLFBVSyncISR(void *arg, u32 mask)
+{
+	OMAPLFB_SWAPCHAIN *psSwapChain = (OMAPLFB_SWAPCHAIN *)arg;
+
+	psSwapChain->ulVSyncCount++;
+	tasklet_schedule(&psSwapChain->sVSyncTasklet);
+}
+
+static void OMAPLFBVSyncTasklet(unsigned long data)
+{
+	OMAPLFBVSyncIHandler((OMAPLFB_SWAPCHAIN *)data);
+}
+
+static void OMAPLFBVSyncTimeout(unsigned long data)
+{
+	OMAPLFBVSyncTimeoutHandler((OMAPLFB_SWAPCHAIN *)data);
+}
+
+/*
+ * Returns whether the overlay scans out from the framebuffer memory
+ * in: psDevInfo, overlay
+ */
+static OMAP_BOOL OMAPLFBOverlayOnFB(OMAPLFB_DEVINFO *psDevInfo,
+	struct omap_overlay *overlay)
+{
+	unsigned long fb_base = psDevInfo->sFBInfo.sSysAddr.uiAddr;
+	struct omap_overlay_info overlay_info;
+
+	overlay->get_overlay_info(overlay, &overlay_info);
+
+	if (!overlay_info.enabled || overlay_info.paddr < fb_base ||
+		overlay_info.paddr >= fb_base + psDevInfo->sFBInfo.ulFBSize)
+		return OMAP_FALSE;
+
+	return OMAP_TRUE;
+}
+
+/*
+ * Returns the overlay manager of an active, automatically updated
+ * display scanning out the framebuffer, or NULL if there is none
+ * in: psDevInfo
+ */
+static struct omap_overlay_manager *OMAPLFBFindFlipManager(
+	OMAPLFB_DEVINFO *psDevInfo)
+{
+	struct omap_overlay_manager *manager;
+	struct omap_overlay *overlay;
+	int i;
+
+	for (i = 0; i < omap_dss_get_num_overlays(); i++)
+	{
+		overlay = omap_dss_get_overlay(i);
+		if (!overlay || !overlay->manager || !overlay->manager->device)
+			continue;
+		if (!OMAPLFBOverlayOnFB(psDevInfo, overlay))
+			continue;
+		if (dss_ovl_manually_updated(overlay))
+			return NULL;
+
+		manager = overlay->manager;
+		if (manager->device->state != OMAP_DSS_DISPLAY_ACTIVE ||
+			!manager->apply_async || !manager->fence_done)
+			return NULL;
+
+		return manager;
+	}
+
+	return NULL;
+}
+
+/*
+ * Hooks the swap chain to the vsync interrupt of the overlay manager
+ * scanning out the framebuffer. Manually updated displays have no vsync
+ * to pace the flips, they keep using the sync workqueue.
+ * Called with sSwapChainLockMutex held.
+ * in: psSwapChain
+ */
+OMAP_ERROR OMAPLFBInstallVSyncISR(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	struct omap_overlay_manager *manager;
+
+	manager = OMAPLFBFindFlipManager(psDevInfo);
+	if (!manager)
+		return OMAP_ERROR_GENERIC;
+
+	switch (manager->id)
+	{
+		case OMAP_DSS_CHANNEL_LCD:
+			psSwapChain->ui32VSyncMask = DISPC_IRQ_VSYNC;
+			break;
+		case OMAP_DSS_CHANNEL_LCD2:
+			psSwapChain->ui32VSyncMask = DISPC_IRQ_VSYNC2;
+			break;
+		case OMAP_DSS_CHANNEL_DIGIT:
+			psSwapChain->ui32VSyncMask = DISPC_IRQ_EVSYNC_EVEN |
+				DISPC_IRQ_EVSYNC_ODD;
+			break;
+		default:
+			return OMAP_ERROR_GENERIC;
+	}
+
+	psSwapChain->psFlipManager = manager;
+	psSwapChain->ulVSyncCount = 0;
+	psSwapChain->bVSyncStalled = OMAP_FALSE;
+	tasklet_init(&psSwapChain->sVSyncTasklet, OMAPLFBVSyncTasklet,
+		(unsigned long)psSwapChain);
+	setup_timer(&psSwapChain->sVSyncTimer, OMAPLFBVSyncTimeout,
+		(unsigned long)psSwapChain);
+	if (omap_dispc_register_isr(OMAPLFBVSyncISR, psSwapChain,
+		psSwapChain->ui32VSyncMask))
+	{
+		psSwapChain->psFlipManager = NULL;
+		return OMAP_ERROR_CANT_REGISTER_CALLBACK;
+	}
+
+	DEBUG_PRINTK("Flips of display %u are committed from the %s vsync",
+		psDevInfo->uDeviceID, manager->name);
+
+	return OMAP_OK;
+}
+
+/*
+ * Unhooks the swap chain from the vsync interrupt
+ * Called with sSwapChainLockMutex held.
+ * in: psSwapChain
+ */
+void OMAPLFBUninstallVSyncISR(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	if (!psSwapChain->psFlipManager)
+		return;
+
+	omap_dispc_unregister_isr(OMAPLFBVSyncISR, psSwapChain,
+		psSwapChain->ui32VSyncMask);
+	del_timer_sync(&psSwapChain->sVSyncTimer);
+	tasklet_kill(&psSwapChain->sVSyncTasklet);
+	psSwapChain->psFlipManager = NULL;
+}
+
+/*
+ * Returns whether the framebuffer moved away from the overlay manager
+ * the swap chain is hooked to, or its display stopped
+ * in: psSwapChain
+ */
+OMAP_BOOL OMAPLFBFlipManagerChanged(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+
+	return OMAPLFBFindFlipManager(psDevInfo) != psSwapChain->psFlipManager ?
+		OMAP_TRUE : OMAP_FALSE;
+}
+
+/*
+ * Points the overlays of the hooked manager that scan out the framebuffer
+ * at a flip and queues their configuration, to be latched by the DSS at
+ * the next vsync. Does not sleep, so flips are committed from the vsync
+ * tasklet; the framebuffer var is brought in line later with OMAPLFBFlip.
+ * Returns OMAP_FALSE if the configuration could not be queued.
+ * Called with sSwapChainLock held.
+ * in: psSwapChain, aPhyAddr
+ * out: pui32Fence
+ */
+OMAP_BOOL OMAPLFBFlipCommit(OMAPLFB_SWAPCHAIN *psSwapChain,
+	unsigned long aPhyAddr, u32 *pui32Fence)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	struct omap_overlay_manager *manager = psSwapChain->psFlipManager;
+	unsigned long fb_base = psDevInfo->sFBInfo.sSysAddr.uiAddr;
+	unsigned long fb_offset = aPhyAddr - fb_base;
+	OMAP_BOOL bUpdated = OMAP_FALSE;
+	int i;
+
+	for (i = 0; i < manager->num_overlays; i++)
+	{
+		struct omap_overlay *overlay = manager->overlays[i];
+		struct omap_overlay_info overlay_info;
+		unsigned long ulBufferOffset;
+
+		if (overlay->manager != manager ||
+			!OMAPLFBOverlayOnFB(psDevInfo, overlay))
+			continue;
+
+		overlay->get_overlay_info(overlay, &overlay_info);
+
+		/* Keep the panning of the overlay inside its buffer */
+		ulBufferOffset = (overlay_info.paddr - fb_base) %
+			psDevInfo->sFBInfo.ulRoundedBufferSize;
+
+		overlay_info.paddr = aPhyAddr + ulBufferOffset;
+		overlay_info.vaddr = (void __iomem *)
+			((unsigned long)psDevInfo->sFBInfo.sCPUVAddr +
+			fb_offset + ulBufferOffset);
+		if (overlay->set_overlay_info(overlay, &overlay_info))
+			continue;
+
+		bUpdated = OMAP_TRUE;
+	}
+
+	if (!bUpdated)
+		return OMAP_FALSE;
+
+	return manager->apply_async(manager, pui32Fence) ?
+		OMAP_FALSE : OMAP_TRUE;
+}
+
+/*
+ * Returns whether the configuration of a flip is in use by the DSS
+ * in: psSwapChain, ui32Fence
+ */
+OMAP_BOOL OMAPLFBFlipScannedOut(OMAPLFB_SWAPCHAIN *psSwapChain,
+	u32 ui32Fence)
+{
+	struct omap_overlay_manager *manager = psSwapChain->psFlipManager;
+
+	return manager->fence_done(manager, ui32Fence) ? OMAP_TRUE : OMAP_FALSE;
+}
+
+#if defined(CONFIG_DEBUG_FS)
+static int OMAPLFBSwapChainStatsShow(struct seq_file *s, void *unused)
+{
+	OMAPLFB_SWAPCHAIN *psSwapChain = s->private;
+	OMAPLFB_FLIP_STATS sStats;
+	unsigned long ulFlags;
+
+	spin_lock_irqsave(&psSwapChain->sSwapChainLock, ulFlags);
+	sStats = psSwapChain->sFlipStats;
+	spin_unlock_irqrestore(&psSwapChain->sSwapChainLock, ulFlags);
+
+	seq_printf(s, "vsync isr\t\t%s\n",
+		psSwapChain->bVSyncISR ? "yes" : "no");
+	seq_printf(s, "flips\t\t\t%lu\n", sStats.ulFlips);
+	seq_printf(s, "late flips\t\t%lu\n", sStats.ulLateFlips);
+	seq_printf(s, "dropped flips\t\t%lu\n", sStats.ulDroppedFlips);
+	seq_printf(s, "queue depth\t\t%lu\n", sStats.ulQueueDepth);
+	seq_printf(s, "max queue depth\t\t%lu\n", sStats.ulMaxQueueDepth);
+	seq_printf(s, "last latency us\t\t%lu\n", sStats.ulLastLatencyUs);
+	seq_printf(s, "max latency us\t\t%lu\n", sStats.ulMaxLatencyUs);
+	seq_printf(s, "avg latency us\t\t%llu\n", sStats.ulFlips ?
+		div_u64(sStats.ullTotalLatencyUs, sStats.ulFlips) : 0);
+
+	return 0;
+}
+
+static int OMAPLFBSwapChainStatsOpen(struct inode *inode, struct file *file)
+{
+	return single_open(file, OMAPLFBSwapChainStatsShow, inode->i_private);
+}
+
+static const struct file_operations OMAPLFBSwapChainStatsFops = {
+	.open		= OMAPLFBSwapChainStatsOpen,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * Creates the debugfs statistics file of a swap chain
+ * in: psSwapChain
+ */
+void OMAPLFBCreateSwapChainStats(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	char szName[32];
+
+	snprintf(szName, sizeof(szName), DRVNAME "%u_swapchain%u",
+		psDevInfo->uDeviceID, psSwapChain->uiSwapChainID);
+	psSwapChain->psStatsFile = debugfs_create_file(szName, S_IRUGO,
+		NULL, psSwapChain, &OMAPLFBSwapChainStatsFops);
+	if (IS_ERR(psSwapChain->psStatsFile))
+		psSwapChain->psStatsFile = NULL;
+}
+
+/*
+ * Removes the debugfs statistics file of a swap chain
+ * in: psSwapChain
+ */
+void OMAPLFBRemoveSwapChainStats(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	debugfs_remove(psSwapChain->psStatsFile);
+	psSwapChain->psStatsFile = NULL;
+}
+#else
+void OMAPLFBCreateSwapChainStats(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+}
+
+void OMAPLFBRemoveSwapChainStats(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+}
+#endif /* defined(CONFIG_DEBUG_FS) */
+
 #if defined(LDM_PLATFORM)
 
 static volatile OMAP_BOOL bDeviceSuspended;
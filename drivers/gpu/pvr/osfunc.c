@@ -333,6 +333,22 @@ OSMemHandleToCpuPAddr(IMG_VOID *hOSMemHandle, IMG_UINT32 ui32ByteOffset)
 }
 
 
+IMG_BOOL
+OSMemHandleIsZeroed(IMG_HANDLE hOSMemHandle)
+{
+    LinuxMemArea *psLinuxMemArea = (LinuxMemArea *)hOSMemHandle;
+
+    PVR_ASSERT(psLinuxMemArea);
+
+    if(psLinuxMemArea->eAreaType != LINUX_MEM_AREA_ALLOC_PAGES)
+    {
+        return IMG_FALSE;
+    }
+
+    return psLinuxMemArea->bZeroed;
+}
+
+
 
 IMG_VOID OSMemCopy(IMG_VOID *pvDst, IMG_VOID *pvSrc, IMG_UINT32 ui32Size)
 {
@@ -439,17 +455,6 @@ PVRSRV_ERROR OSInitEnvData(IMG_PVOID *ppvEnvSpecificData)
         return eError;
     }
 
-    eError = OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP, PVRSRV_MAX_BRIDGE_IN_SIZE + PVRSRV_MAX_BRIDGE_OUT_SIZE, 
-                    &psEnvData->pvBridgeData, IMG_NULL,
-                    "Bridge Data");
-    if (eError != PVRSRV_OK)
-    {
-        OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(ENV_DATA), psEnvData, IMG_NULL);
-		
-        return eError;
-    }
-
-
     
     psEnvData->bMISRInstalled = IMG_FALSE;
     psEnvData->bLISRInstalled = IMG_FALSE;
@@ -468,9 +473,6 @@ PVRSRV_ERROR OSDeInitEnvData(IMG_PVOID pvEnvSpecificData)
     PVR_ASSERT(!psEnvData->bMISRInstalled);
     PVR_ASSERT(!psEnvData->bLISRInstalled);
 
-    OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, PVRSRV_MAX_BRIDGE_IN_SIZE + PVRSRV_MAX_BRIDGE_OUT_SIZE, psEnvData->pvBridgeData, IMG_NULL);
-    psEnvData->pvBridgeData = IMG_NULL;
-
     OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(ENV_DATA), pvEnvSpecificData, IMG_NULL);
 	
 
@@ -1035,6 +1037,23 @@ IMG_BOOL OSIsResourceLocked (PVRSRV_RESOURCE *psResource, IMG_UINT32 ui32ID)
 }
 
 
+IMG_VOID OSAtomicSetBits(IMG_UINT32 *pui32Value, IMG_UINT32 ui32Bits)
+{
+    IMG_UINT32 ui32Old;
+
+    do
+    {
+        ui32Old = *(volatile IMG_UINT32 *)pui32Value;
+    } while (cmpxchg(pui32Value, ui32Old, ui32Old | ui32Bits) != ui32Old);
+}
+
+
+IMG_UINT32 OSAtomicClearAll(IMG_UINT32 *pui32Value)
+{
+    return xchg(pui32Value, 0);
+}
+
+
 #if !defined(SYS_CUSTOM_POWERLOCK_WRAP)
 PVRSRV_ERROR OSPowerLockWrap (IMG_VOID)
 {
@@ -28,6 +28,7 @@
 #include "osperproc.h"
 
 #include "env_perproc.h"
+#include "env_data.h"
 #include "proc.h"
 
 extern IMG_UINT32 gui32ReleasePID;
@@ -57,6 +58,24 @@ PVRSRV_ERROR OSPerProcessPrivateDataInit(IMG_HANDLE *phOsPrivateData)
 
 	psEnvPerProc->hBlockAlloc = hBlockAlloc;
 
+	
+	eError = OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
+				PVRSRV_MAX_BRIDGE_IN_SIZE + PVRSRV_MAX_BRIDGE_OUT_SIZE,
+				&psEnvPerProc->pvBridgeData,
+				IMG_NULL,
+				"Bridge Data");
+	if (eError != PVRSRV_OK)
+	{
+		PVR_DPF((PVR_DBG_ERROR, "%s: Couldn't allocate bridge data (%d)", __FUNCTION__, eError));
+		OSFreeMem(PVRSRV_OS_NON_PAGEABLE_HEAP,
+				sizeof(PVRSRV_ENV_PER_PROCESS_DATA),
+				psEnvPerProc,
+				hBlockAlloc);
+		*phOsPrivateData = IMG_NULL;
+		return eError;
+	}
+
+	LinuxInitMutex(&psEnvPerProc->sBridgeLock);
 
 	LinuxMMapPerProcessConnect(psEnvPerProc);
 
@@ -86,6 +105,11 @@ PVRSRV_ERROR OSPerProcessPrivateDataDeInit(IMG_HANDLE hOsPrivateData)
 
 	RemovePerProcessProcDir(psEnvPerProc);
 
+	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
+			PVRSRV_MAX_BRIDGE_IN_SIZE + PVRSRV_MAX_BRIDGE_OUT_SIZE,
+			psEnvPerProc->pvBridgeData,
+			IMG_NULL);
+
 	eError = OSFreeMem(PVRSRV_OS_NON_PAGEABLE_HEAP,
 				sizeof(PVRSRV_ENV_PER_PROCESS_DATA),
 				hOsPrivateData,
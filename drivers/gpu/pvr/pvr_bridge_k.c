@@ -35,13 +35,16 @@
 #include "private_data.h"
 #include "linkage.h"
 #include "pvr_bridge_km.h"
+#include "env_perproc.h"
+#include "lock.h"
+
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #if defined(SUPPORT_DRI_DRM)
 #include <drm/drmP.h>
 #include "pvr_drm.h"
-#if defined(PVR_SECURE_DRM_AUTH_EXPORT)
-#include "env_perproc.h"
-#endif
 #endif
 
 #if defined(SUPPORT_VGX)
@@ -70,7 +73,63 @@ static void ProcSeqStartstopBridgeStats(struct seq_file *sfile,IMG_BOOL start);
 
 #endif
 
-extern PVRSRV_LINUX_MUTEX gPVRSRVLock;
+typedef enum _PVRSRV_BRIDGE_LOCK_CLASS_
+{
+	PVRSRV_BRIDGE_LOCK_GLOBAL = 0,
+	PVRSRV_BRIDGE_LOCK_PROCESS,
+	PVRSRV_BRIDGE_LOCK_MM,
+	PVRSRV_BRIDGE_LOCK_SUBMIT,
+	PVRSRV_BRIDGE_LOCK_CLASS_COUNT
+} PVRSRV_BRIDGE_LOCK_CLASS;
+
+typedef struct _PVRSRV_BRIDGE_LOCK_STATS_
+{
+	const IMG_CHAR	*pszName;
+	IMG_UINT32	ui32Count;
+	IMG_UINT64	ui64WaitTotalNs;
+	IMG_UINT64	ui64WaitMaxNs;
+	IMG_UINT64	ui64HoldTotalNs;
+	IMG_UINT64	ui64HoldMaxNs;
+} PVRSRV_BRIDGE_LOCK_STATS;
+
+typedef struct _PVRSRV_BRIDGE_LOCK_TIME_
+{
+	IMG_UINT64	ui64WaitNs;
+	IMG_UINT64	ui64AcquiredNs;
+} PVRSRV_BRIDGE_LOCK_TIME;
+
+/*
+ * Locks held by one bridge call.  GLOBAL calls hold gPVRSRVLock
+ * exclusively and nothing else; the other classes hold it shared, then
+ * the calling process' bridge lock, then the MM or submit lock.  MM calls
+ * from different processes still serialise on one lock, as BM contexts
+ * share the kernel and shared heaps and their page tables.
+ */
+typedef struct _PVRSRV_BRIDGE_LOCK_STATE_
+{
+	PVRSRV_BRIDGE_LOCK_CLASS	eClass;
+	PVRSRV_LINUX_MUTEX		*psProcessLock;
+	PVRSRV_BRIDGE_LOCK_TIME		sGlobal;
+	PVRSRV_BRIDGE_LOCK_TIME		sProcess;
+	PVRSRV_BRIDGE_LOCK_TIME		sClass;
+} PVRSRV_BRIDGE_LOCK_STATE;
+
+static PVRSRV_LINUX_MUTEX gsBridgeMMLock;
+static PVRSRV_LINUX_MUTEX gsBridgeSubmitLock;
+
+static PVRSRV_BRIDGE_LOCK_STATS gasBridgeLockStats[PVRSRV_BRIDGE_LOCK_CLASS_COUNT] =
+{
+	{ "global" },
+	{ "process" },
+	{ "mm" },
+	{ "submit" },
+};
+static DEFINE_SPINLOCK(gsBridgeLockStatsLock);
+
+static struct proc_dir_entry *g_ProcBridgeLocks;
+static void* ProcSeqNextBridgeLocks(struct seq_file *sfile,void* el,loff_t off);
+static void ProcSeqShowBridgeLocks(struct seq_file *sfile,void* el);
+static void* ProcSeqOff2ElementBridgeLocks(struct seq_file * sfile, loff_t off);
 
 #if defined(SUPPORT_MEMINFO_IDS)
 static IMG_UINT64 ui64Stamp;
@@ -79,6 +138,20 @@ static IMG_UINT64 ui64Stamp;
 PVRSRV_ERROR
 LinuxBridgeInit(IMG_VOID)
 {
+	LinuxInitMutex(&gsBridgeMMLock);
+	LinuxInitMutex(&gsBridgeSubmitLock);
+
+	g_ProcBridgeLocks = CreateProcReadEntrySeq("bridge_locks",
+											   NULL,
+											   ProcSeqNextBridgeLocks,
+											   ProcSeqShowBridgeLocks,
+											   ProcSeqOff2ElementBridgeLocks,
+											   NULL);
+	if(!g_ProcBridgeLocks)
+	{
+		return PVRSRV_ERROR_OUT_OF_MEMORY;
+	}
+
 #if defined(DEBUG_BRIDGE_KM)
 	{
 		g_ProcBridgeStats = CreateProcReadEntrySeq(
@@ -104,6 +177,242 @@ LinuxBridgeDeInit(IMG_VOID)
 #if defined(DEBUG_BRIDGE_KM)
     RemoveProcEntrySeq(g_ProcBridgeStats);
 #endif
+    RemoveProcEntrySeq(g_ProcBridgeLocks);
+}
+
+
+static void* ProcSeqOff2ElementBridgeLocks(struct seq_file *sfile, loff_t off)
+{
+	if(!off)
+	{
+		return PVR_PROC_SEQ_START_TOKEN;
+	}
+
+	if(off > PVRSRV_BRIDGE_LOCK_CLASS_COUNT)
+	{
+		return (void*)0;
+	}
+
+	return (void*)&gasBridgeLockStats[off-1];
+}
+
+static void* ProcSeqNextBridgeLocks(struct seq_file *sfile,void* el,loff_t off)
+{
+	return ProcSeqOff2ElementBridgeLocks(sfile,off);
+}
+
+static void ProcSeqShowBridgeLocks(struct seq_file *sfile,void* el)
+{
+	PVRSRV_BRIDGE_LOCK_STATS sStats;
+
+	if(el == PVR_PROC_SEQ_START_TOKEN)
+	{
+		seq_printf(sfile, "%-8s %10s %14s %12s %14s %12s\n",
+				   "Lock", "Count", "Wait Total us", "Wait Max us",
+				   "Hold Total us", "Hold Max us");
+		return;
+	}
+
+	spin_lock(&gsBridgeLockStatsLock);
+	sStats = *(PVRSRV_BRIDGE_LOCK_STATS *)el;
+	spin_unlock(&gsBridgeLockStatsLock);
+
+	seq_printf(sfile, "%-8s %10u %14llu %12llu %14llu %12llu\n",
+			   sStats.pszName,
+			   sStats.ui32Count,
+			   (unsigned long long)div_u64(sStats.ui64WaitTotalNs, NSEC_PER_USEC),
+			   (unsigned long long)div_u64(sStats.ui64WaitMaxNs, NSEC_PER_USEC),
+			   (unsigned long long)div_u64(sStats.ui64HoldTotalNs, NSEC_PER_USEC),
+			   (unsigned long long)div_u64(sStats.ui64HoldMaxNs, NSEC_PER_USEC));
+}
+
+
+static PVRSRV_BRIDGE_LOCK_CLASS BridgeLockClass(IMG_UINT32 ui32BridgeCmd)
+{
+#if defined(PDUMP)
+	/* The PDump stream relies on every bridge call being serialised. */
+	PVR_UNREFERENCED_PARAMETER(ui32BridgeCmd);
+	return PVRSRV_BRIDGE_LOCK_GLOBAL;
+#else
+	switch(ui32BridgeCmd)
+	{
+		case PVRSRV_BRIDGE_ALLOC_DEVICEMEM:
+		case PVRSRV_BRIDGE_FREE_DEVICEMEM:
+		case PVRSRV_BRIDGE_MHANDLE_TO_MMAP_DATA:
+		case PVRSRV_BRIDGE_RELEASE_MMAP_DATA:
+			return PVRSRV_BRIDGE_LOCK_MM;
+
+#if defined(SUPPORT_SGX)
+		case PVRSRV_BRIDGE_SGX_DOKICK:
+#if defined(TRANSFER_QUEUE)
+		case PVRSRV_BRIDGE_SGX_SUBMITTRANSFER:
+#endif
+#if defined(SGX_FEATURE_2D_HARDWARE)
+		case PVRSRV_BRIDGE_SGX_SUBMIT2D:
+#endif
+#endif
+		case PVRSRV_BRIDGE_SWAP_DISPCLASS_TO_BUFFER:
+		case PVRSRV_BRIDGE_SWAP_DISPCLASS_TO_SYSTEM:
+			return PVRSRV_BRIDGE_LOCK_SUBMIT;
+
+		case PVRSRV_BRIDGE_EVENT_OBJECT_WAIT:
+			return PVRSRV_BRIDGE_LOCK_PROCESS;
+
+		default:
+			return PVRSRV_BRIDGE_LOCK_GLOBAL;
+	}
+#endif
+}
+
+static INLINE IMG_UINT64 BridgeLockTimeNs(IMG_VOID)
+{
+	return (IMG_UINT64)ktime_to_ns(ktime_get());
+}
+
+static IMG_VOID BridgeLockTimeStart(PVRSRV_BRIDGE_LOCK_TIME *psTime, IMG_UINT64 ui64RequestNs)
+{
+	psTime->ui64AcquiredNs = BridgeLockTimeNs();
+	psTime->ui64WaitNs = psTime->ui64AcquiredNs - ui64RequestNs;
+}
+
+static IMG_VOID BridgeLockTimeEnd(PVRSRV_BRIDGE_LOCK_CLASS eClass, PVRSRV_BRIDGE_LOCK_TIME *psTime)
+{
+	PVRSRV_BRIDGE_LOCK_STATS *psStats = &gasBridgeLockStats[eClass];
+	IMG_UINT64 ui64HoldNs = BridgeLockTimeNs() - psTime->ui64AcquiredNs;
+
+	spin_lock(&gsBridgeLockStatsLock);
+	psStats->ui32Count++;
+	psStats->ui64WaitTotalNs += psTime->ui64WaitNs;
+	if(psTime->ui64WaitNs > psStats->ui64WaitMaxNs)
+	{
+		psStats->ui64WaitMaxNs = psTime->ui64WaitNs;
+	}
+	psStats->ui64HoldTotalNs += ui64HoldNs;
+	if(ui64HoldNs > psStats->ui64HoldMaxNs)
+	{
+		psStats->ui64HoldMaxNs = ui64HoldNs;
+	}
+	spin_unlock(&gsBridgeLockStatsLock);
+}
+
+static PVRSRV_LINUX_MUTEX *BridgeClassLock(PVRSRV_BRIDGE_LOCK_CLASS eClass)
+{
+	switch(eClass)
+	{
+		case PVRSRV_BRIDGE_LOCK_MM:
+			return &gsBridgeMMLock;
+		case PVRSRV_BRIDGE_LOCK_SUBMIT:
+			return &gsBridgeSubmitLock;
+		default:
+			return IMG_NULL;
+	}
+}
+
+static IMG_VOID BridgeLockGlobal(PVRSRV_BRIDGE_LOCK_STATE *psState)
+{
+	IMG_UINT64 ui64RequestNs = BridgeLockTimeNs();
+
+	if(psState->eClass == PVRSRV_BRIDGE_LOCK_GLOBAL)
+	{
+		LinuxLockRWSemExclusive(&gPVRSRVLock);
+		BridgeLockTimeStart(&psState->sGlobal, ui64RequestNs);
+	}
+	else
+	{
+		LinuxLockRWSemShared(&gPVRSRVLock);
+	}
+}
+
+static IMG_VOID BridgeUnlockGlobal(PVRSRV_BRIDGE_LOCK_STATE *psState)
+{
+	if(psState->eClass == PVRSRV_BRIDGE_LOCK_GLOBAL)
+	{
+		BridgeLockTimeEnd(PVRSRV_BRIDGE_LOCK_GLOBAL, &psState->sGlobal);
+		LinuxUnLockRWSemExclusive(&gPVRSRVLock);
+	}
+	else
+	{
+		LinuxUnLockRWSemShared(&gPVRSRVLock);
+	}
+}
+
+static IMG_VOID BridgeLockProcess(PVRSRV_BRIDGE_LOCK_STATE *psState)
+{
+	PVRSRV_LINUX_MUTEX *psClassLock = BridgeClassLock(psState->eClass);
+	IMG_UINT64 ui64RequestNs;
+
+	if(psState->psProcessLock == IMG_NULL)
+	{
+		return;
+	}
+
+	ui64RequestNs = BridgeLockTimeNs();
+	LinuxLockMutex(psState->psProcessLock);
+	BridgeLockTimeStart(&psState->sProcess, ui64RequestNs);
+
+	if(psClassLock != IMG_NULL)
+	{
+		ui64RequestNs = BridgeLockTimeNs();
+		LinuxLockMutex(psClassLock);
+		BridgeLockTimeStart(&psState->sClass, ui64RequestNs);
+	}
+}
+
+static IMG_VOID BridgeUnlockProcess(PVRSRV_BRIDGE_LOCK_STATE *psState)
+{
+	PVRSRV_LINUX_MUTEX *psClassLock = BridgeClassLock(psState->eClass);
+
+	if(psState->psProcessLock == IMG_NULL)
+	{
+		return;
+	}
+
+	if(psClassLock != IMG_NULL)
+	{
+		BridgeLockTimeEnd(psState->eClass, &psState->sClass);
+		LinuxUnLockMutex(psClassLock);
+	}
+
+	BridgeLockTimeEnd(PVRSRV_BRIDGE_LOCK_PROCESS, &psState->sProcess);
+	LinuxUnLockMutex(psState->psProcessLock);
+}
+
+IMG_HANDLE LinuxBridgeUnlockForWait(IMG_VOID)
+{
+	PVRSRV_ENV_PER_PROCESS_DATA *psEnvPerProc;
+	PVRSRV_BRIDGE_LOCK_STATE *psState;
+
+	psEnvPerProc = (PVRSRV_ENV_PER_PROCESS_DATA *)PVRSRVPerProcessPrivateData(OSGetCurrentProcessIDKM());
+	if(psEnvPerProc == IMG_NULL || psEnvPerProc->pvBridgeLockState == IMG_NULL)
+	{
+		return IMG_NULL;
+	}
+
+	psState = (PVRSRV_BRIDGE_LOCK_STATE *)psEnvPerProc->pvBridgeLockState;
+	psEnvPerProc->pvBridgeLockState = IMG_NULL;
+
+	BridgeUnlockProcess(psState);
+	BridgeUnlockGlobal(psState);
+
+	return (IMG_HANDLE)psState;
+}
+
+IMG_VOID LinuxBridgeRelockAfterWait(IMG_HANDLE hBridgeLocks)
+{
+	PVRSRV_ENV_PER_PROCESS_DATA *psEnvPerProc;
+	PVRSRV_BRIDGE_LOCK_STATE *psState = (PVRSRV_BRIDGE_LOCK_STATE *)hBridgeLocks;
+
+	if(psState == IMG_NULL)
+	{
+		return;
+	}
+
+	BridgeLockGlobal(psState);
+	BridgeLockProcess(psState);
+
+	/* The ioctl holds the file, so the process data is still there. */
+	psEnvPerProc = (PVRSRV_ENV_PER_PROCESS_DATA *)PVRSRVPerProcessPrivateData(OSGetCurrentProcessIDKM());
+	psEnvPerProc->pvBridgeLockState = psState;
 }
 
 #if defined(DEBUG_BRIDGE_KM)
@@ -112,11 +421,11 @@ static void ProcSeqStartstopBridgeStats(struct seq_file *sfile,IMG_BOOL start)
 {
 	if(start) 
 	{
-		LinuxLockMutex(&gPVRSRVLock);
+		LinuxLockRWSemExclusive(&gPVRSRVLock);
 	}
 	else
 	{
-		LinuxUnLockMutex(&gPVRSRVLock);
+		LinuxUnLockRWSemExclusive(&gPVRSRVLock);
 	}
 }
 
@@ -200,10 +509,10 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 	PVRSRV_BRIDGE_PACKAGE *psBridgePackageKM;
 	IMG_UINT32 ui32PID = OSGetCurrentProcessIDKM();
 	PVRSRV_PER_PROCESS_DATA *psPerProc;
+	PVRSRV_ENV_PER_PROCESS_DATA *psEnvPerProc = IMG_NULL;
+	PVRSRV_BRIDGE_LOCK_STATE sLockState;
 	IMG_INT err = -EFAULT;
 
-	LinuxLockMutex(&gPVRSRVLock);
-
 #if defined(SUPPORT_DRI_DRM)
 	psBridgePackageKM = (PVRSRV_BRIDGE_PACKAGE *)arg;
 	PVR_ASSERT(psBridgePackageKM != IMG_NULL);
@@ -217,7 +526,7 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 		PVR_DPF((PVR_DBG_ERROR, "%s: Received invalid pointer to function arguments",
 				 __FUNCTION__));
 
-		goto unlock_and_return;
+		return err;
 	}
 	
 	
@@ -227,25 +536,48 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 					  sizeof(PVRSRV_BRIDGE_PACKAGE))
 	  != PVRSRV_OK)
 	{
-		goto unlock_and_return;
+		return err;
 	}
 #endif
 
 	cmd = psBridgePackageKM->ui32BridgeID;
+
+	sLockState.eClass = BridgeLockClass(cmd);
+	sLockState.psProcessLock = IMG_NULL;
+
+	BridgeLockGlobal(&sLockState);
 	
 	if(cmd != PVRSRV_BRIDGE_CONNECT_SERVICES)
 	{
-		PVRSRV_ERROR eError;
+		if(sLockState.eClass == PVRSRV_BRIDGE_LOCK_GLOBAL)
+		{
+			PVRSRV_ERROR eError;
 
-		eError = PVRSRVLookupHandle(KERNEL_HANDLE_BASE,
-									(IMG_PVOID *)&psPerProc,
-									psBridgePackageKM->hKernelServices,
-									PVRSRV_HANDLE_TYPE_PERPROC_DATA);
-		if(eError != PVRSRV_OK)
+			eError = PVRSRVLookupHandle(KERNEL_HANDLE_BASE,
+										(IMG_PVOID *)&psPerProc,
+										psBridgePackageKM->hKernelServices,
+										PVRSRV_HANDLE_TYPE_PERPROC_DATA);
+			if(eError != PVRSRV_OK)
+			{
+				PVR_DPF((PVR_DBG_ERROR, "%s: Invalid kernel services handle (%d)",
+						 __FUNCTION__, eError));
+				goto unlock_and_return;
+			}
+		}
+		else
 		{
-			PVR_DPF((PVR_DBG_ERROR, "%s: Invalid kernel services handle (%d)",
-					 __FUNCTION__, eError));
-			goto unlock_and_return;
+			/*
+			 * An MM call from another process may be changing
+			 * KERNEL_HANDLE_BASE, so look the caller up by PID.
+			 */
+			psPerProc = PVRSRVPerProcessData(ui32PID);
+			if(psPerProc == IMG_NULL ||
+			   psPerProc->hPerProcData != psBridgePackageKM->hKernelServices)
+			{
+				PVR_DPF((PVR_DBG_ERROR, "%s: Invalid kernel services handle",
+						 __FUNCTION__));
+				goto unlock_and_return;
+			}
 		}
 
 		if(psPerProc->ui32PID != ui32PID)
@@ -268,6 +600,20 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 		}
 	}
 
+	psEnvPerProc = (PVRSRV_ENV_PER_PROCESS_DATA *)PVRSRVProcessPrivateData(psPerProc);
+	if(psEnvPerProc == IMG_NULL)
+	{
+		PVR_DPF((PVR_DBG_ERROR, "%s: Process private data not allocated", __FUNCTION__));
+		goto unlock_and_return;
+	}
+
+	if(sLockState.eClass != PVRSRV_BRIDGE_LOCK_GLOBAL)
+	{
+		sLockState.psProcessLock = &psEnvPerProc->sBridgeLock;
+	}
+	BridgeLockProcess(&sLockState);
+	psEnvPerProc->pvBridgeLockState = &sLockState;
+
 	psBridgePackageKM->ui32BridgeID = PVRSRV_GET_BRIDGE_ID(psBridgePackageKM->ui32BridgeID);
 
 	switch(cmd)
@@ -326,22 +672,12 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 		{
 			PVRSRV_FILE_PRIVATE_DATA *psPrivateData;
 			int authenticated = pFile->authenticated;
-			PVRSRV_ENV_PER_PROCESS_DATA *psEnvPerProc;
 
 			if (authenticated)
 			{
 				break;
 			}
 
-			
-			psEnvPerProc = (PVRSRV_ENV_PER_PROCESS_DATA *)PVRSRVProcessPrivateData(psPerProc);
-			if (psEnvPerProc == IMG_NULL)
-			{
-				PVR_DPF((PVR_DBG_ERROR, "%s: Process private data not allocated", __FUNCTION__));
-				err = -EFAULT;
-				goto unlock_and_return;
-			}
-
 			list_for_each_entry(psPrivateData, &psEnvPerProc->sDRMAuthListHead, sDRMAuthListItem)
 			{
 				struct drm_file *psDRMFile = psPrivateData->psDRMFile;
@@ -412,6 +748,11 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 	}
 
 unlock_and_return:
-	LinuxUnLockMutex(&gPVRSRVLock);
+	if(psEnvPerProc != IMG_NULL)
+	{
+		psEnvPerProc->pvBridgeLockState = IMG_NULL;
+	}
+	BridgeUnlockProcess(&sLockState);
+	BridgeUnlockGlobal(&sLockState);
 	return err;
 }
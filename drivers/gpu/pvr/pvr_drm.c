@@ -278,7 +278,7 @@ PVRDRMUnprivCmd(struct drm_device *dev, void *arg, struct drm_file *pFile)
 {
 	int ret = 0;
 
-	LinuxLockMutex(&gPVRSRVLock);
+	LinuxLockRWSemExclusive(&gPVRSRVLock);
 
 	if (arg == NULL)
 	{
@@ -302,7 +302,7 @@ PVRDRMUnprivCmd(struct drm_device *dev, void *arg, struct drm_file *pFile)
 
 	}
 
-	LinuxUnLockMutex(&gPVRSRVLock);
+	LinuxUnLockRWSemExclusive(&gPVRSRVLock);
 
 	return ret;
 }
@@ -313,11 +313,11 @@ PVRDRM_Display_ioctl(struct drm_device *dev, void *arg, struct drm_file *pFile)
 {
 	int res;
 
-	LinuxLockMutex(&gPVRSRVLock);
+	LinuxLockRWSemExclusive(&gPVRSRVLock);
 
 	res = PVR_DRM_MAKENAME(DISPLAY_CONTROLLER, _Ioctl)(dev, arg, pFile);
 
-	LinuxUnLockMutex(&gPVRSRVLock);
+	LinuxUnLockRWSemExclusive(&gPVRSRVLock);
 
 	return res;
 }
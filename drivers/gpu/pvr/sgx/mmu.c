@@ -302,7 +302,7 @@ DisableHostAccess (MMU_CONTEXT *psMMUContext)
 static IMG_VOID MMU_InvalidateSystemLevelCache(PVRSRV_SGXDEV_INFO *psDevInfo)
 {
 	#if defined(SGX_FEATURE_MP)
-	psDevInfo->ui32CacheControl |= SGXMKIF_CC_INVAL_BIF_SL;
+	OSAtomicSetBits(&psDevInfo->ui32CacheControl, SGXMKIF_CC_INVAL_BIF_SL);
 	#else
 	
 	PVR_UNREFERENCED_PARAMETER(psDevInfo);
@@ -312,7 +312,7 @@ static IMG_VOID MMU_InvalidateSystemLevelCache(PVRSRV_SGXDEV_INFO *psDevInfo)
 
 IMG_VOID MMU_InvalidateDirectoryCache(PVRSRV_SGXDEV_INFO *psDevInfo)
 {
-	psDevInfo->ui32CacheControl |= SGXMKIF_CC_INVAL_BIF_PD;
+	OSAtomicSetBits(&psDevInfo->ui32CacheControl, SGXMKIF_CC_INVAL_BIF_PD);
 	#if defined(SGX_FEATURE_SYSTEM_CACHE)
 	MMU_InvalidateSystemLevelCache(psDevInfo);
 	#endif 
@@ -321,7 +321,7 @@ IMG_VOID MMU_InvalidateDirectoryCache(PVRSRV_SGXDEV_INFO *psDevInfo)
 
 static IMG_VOID MMU_InvalidatePageTableCache(PVRSRV_SGXDEV_INFO *psDevInfo)
 {
-	psDevInfo->ui32CacheControl |= SGXMKIF_CC_INVAL_BIF_PT;
+	OSAtomicSetBits(&psDevInfo->ui32CacheControl, SGXMKIF_CC_INVAL_BIF_PT);
 	#if defined(SGX_FEATURE_SYSTEM_CACHE)
 	MMU_InvalidateSystemLevelCache(psDevInfo);
 	#endif 
@@ -197,7 +197,7 @@ PVRSRV_ERROR SGXScheduleCCBCommand(PVRSRV_DEVICE_NODE	*psDeviceNode,
 	
 	if (ui32CacheMasks[0] || ui32CacheMasks[1] || ui32CacheMasks[2] || ui32CacheMasks[3])
 	{
-		psDevInfo->ui32CacheControl |= SGXMKIF_CC_INVAL_BIF_PD;
+		OSAtomicSetBits(&psDevInfo->ui32CacheControl, SGXMKIF_CC_INVAL_BIF_PD);
 	}
 #endif
 
@@ -330,17 +330,14 @@ PVRSRV_ERROR SGXScheduleCCBCommand(PVRSRV_DEVICE_NODE	*psDeviceNode,
 	}
 
 	
-	psCommandData->ui32CacheControl = psDevInfo->ui32CacheControl;
+	psCommandData->ui32CacheControl = OSAtomicClearAll(&psDevInfo->ui32CacheControl);
 
 #if defined(PDUMP)
 	
-	psDevInfo->sPDContext.ui32CacheControl |= psDevInfo->ui32CacheControl;
+	psDevInfo->sPDContext.ui32CacheControl |= psCommandData->ui32CacheControl;
 #endif
 
 	
-	psDevInfo->ui32CacheControl = 0;
-
-	
 	*psSGXCommand = *psCommandData;
 
 	if (eCmdType >= SGXMKIF_CMD_MAX)
@@ -689,9 +686,9 @@ IMG_VOID SGXCleanupRequest(PVRSRV_DEVICE_NODE	*psDeviceNode,
 	
 	
 #if defined(SGX_FEATURE_SYSTEM_CACHE)
-	psDevInfo->ui32CacheControl |= (SGXMKIF_CC_INVAL_BIF_SL | SGXMKIF_CC_INVAL_DATA);
+	OSAtomicSetBits(&psDevInfo->ui32CacheControl, SGXMKIF_CC_INVAL_BIF_SL | SGXMKIF_CC_INVAL_DATA);
 #else
-	psDevInfo->ui32CacheControl |= SGXMKIF_CC_INVAL_DATA;
+	OSAtomicSetBits(&psDevInfo->ui32CacheControl, SGXMKIF_CC_INVAL_DATA);
 #endif
 }
 
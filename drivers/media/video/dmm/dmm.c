@@ -25,8 +25,12 @@
 #include <linux/io.h>              /* ioremap() */
 #include <linux/errno.h>
 #include <linux/slab.h>
+#include <linux/interrupt.h>
+#include <linux/dma-mapping.h>
+#include <linux/sched.h>
 
 #include <mach/dmm.h>
+#include <mach/irqs.h>
 
 #undef __DEBUG__
 #define BITS_32(in_NbBits) ((((u32)1 << in_NbBits) - 1) | ((u32)1 << in_NbBits))
@@ -61,15 +65,11 @@ static struct platform_driver dmm_driver_ldm = {
 	.remove = NULL,
 };
 
-s32 dmm_pat_refill(struct dmm *dmm, struct pat *pd, enum pat_mode mode)
+static s32 dmm_pat_refill_manual(struct dmm *dmm, struct pat *pd)
 {
 	void __iomem *r = NULL;
 	u32 v = -1, w = -1;
 
-	/* Only manual refill supported */
-	if (mode != MANUAL)
-		return -EFAULT;
-
 	/*
 	 * Check that the DMM_PAT_STATUS register
 	 * has not reported an error.
@@ -209,6 +209,246 @@ s32 dmm_pat_refill(struct dmm *dmm, struct pat *pd, enum pat_mode mode)
 
 	return 0;
 }
+
+/* (must have lock) start refilling the oldest queued chain if idle */
+static void dmm_pat_kick(struct dmm *dmm)
+{
+	struct dmm_chain *c;
+
+	if (dmm->busy || dmm->c_tail == dmm->c_head)
+		return;
+
+	c = &dmm->chain[dmm->c_tail % DMM_PAT_MAX_CHAINS];
+	dmm->busy = true;
+
+	/* clear out any pending transaction, then point engine at chain */
+	__raw_writel(0, dmm->base + DMM_PAT_DESCR__0);
+	__raw_writel(dmm->descr_pa + c->first * sizeof(*dmm->descr),
+		     dmm->base + DMM_PAT_DESCR__0);
+}
+
+/*
+ * (must have lock) retire the chain being refilled.  Errors are collected
+ * over all chains of a refill and recorded against the sequence number of
+ * its last chain, which is what the caller waits on.
+ */
+static void dmm_pat_retire(struct dmm *dmm, s32 err)
+{
+	struct dmm_chain *c = &dmm->chain[dmm->c_tail % DMM_PAT_MAX_CHAINS];
+	struct dmm_fail *f;
+
+	if (err && !dmm->req_err)
+		dmm->req_err = err;
+	if (c->last && dmm->req_err) {
+		f = &dmm->fail[dmm->n_fail++ % DMM_PAT_MAX_FAIL];
+		f->seq = c->seq;
+		f->err = dmm->req_err;
+		dmm->req_err = 0;
+	}
+
+	dmm->d_free += c->count;
+	dmm->done = c->seq;
+	dmm->c_tail++;
+	dmm->busy = false;
+}
+
+static irqreturn_t dmm_pat_isr(int irq, void *data)
+{
+	struct dmm *dmm = data;
+	u32 status;
+
+	status = __raw_readl(dmm->base + DMM_PAT_IRQSTATUS);
+	if (!(status & (DMM_PAT_IRQ_FILL_LST0 | DMM_PAT_IRQ_ERR0)))
+		return IRQ_NONE;
+	__raw_writel(status, dmm->base + DMM_PAT_IRQSTATUS);
+
+	if (status & DMM_PAT_IRQ_ERR0)
+		printk(KERN_ERR "dmm: PAT refill error (0x%08x)\n", status);
+
+	spin_lock(&dmm->lock);
+	if (dmm->busy) {
+		dmm_pat_retire(dmm, status & DMM_PAT_IRQ_ERR0 ? -EIO : 0);
+		dmm_pat_kick(dmm);
+	}
+	spin_unlock(&dmm->lock);
+
+	wake_up_all(&dmm->wait);
+	return IRQ_HANDLED;
+}
+
+/* check if there is room for a chain of n descriptors */
+static bool dmm_pat_has_room(struct dmm *dmm, u16 n)
+{
+	unsigned long flags;
+	bool room;
+
+	spin_lock_irqsave(&dmm->lock, flags);
+	room = dmm->d_free >= n &&
+	       dmm->c_head - dmm->c_tail < DMM_PAT_MAX_CHAINS;
+	spin_unlock_irqrestore(&dmm->lock, flags);
+	return room;
+}
+
+static bool dmm_pat_is_done(struct dmm *dmm, u32 seq)
+{
+	unsigned long flags;
+	bool done;
+
+	spin_lock_irqsave(&dmm->lock, flags);
+	done = (s32) (dmm->done - seq) >= 0;
+	spin_unlock_irqrestore(&dmm->lock, flags);
+	return done;
+}
+
+/* drop all queued chains after the engine stopped responding */
+static void dmm_pat_abort(struct dmm *dmm)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dmm->lock, flags);
+	__raw_writel(0, dmm->base + DMM_PAT_DESCR__0);
+	while (dmm->c_tail != dmm->c_head)
+		dmm_pat_retire(dmm, -ETIMEDOUT);
+	spin_unlock_irqrestore(&dmm->lock, flags);
+
+	wake_up_all(&dmm->wait);
+}
+
+/* queue up to DMM_PAT_RING_SIZE descriptors as one chain */
+static s32 dmm_pat_queue(struct dmm *dmm, struct pat **pd, u16 n, bool last,
+			 u32 *seq)
+{
+	struct dmm_chain *c;
+	struct pat_descr *d = NULL;
+	unsigned long flags;
+	u16 i, ix;
+
+	for (;;) {
+		if (!wait_event_timeout(dmm->wait, dmm_pat_has_room(dmm, n),
+				msecs_to_jiffies(DMM_PAT_TIMEOUT_MS))) {
+			printk(KERN_ERR "dmm: PAT refill engine stuck\n");
+			dmm_pat_abort(dmm);
+		}
+
+		spin_lock_irqsave(&dmm->lock, flags);
+		if (dmm->d_free >= n &&
+		    dmm->c_head - dmm->c_tail < DMM_PAT_MAX_CHAINS)
+			break;
+		spin_unlock_irqrestore(&dmm->lock, flags);
+	}
+
+	c = &dmm->chain[dmm->c_head % DMM_PAT_MAX_CHAINS];
+	c->first = dmm->d_head;
+	c->count = n;
+	c->last = last;
+
+	/* copy the descriptors into the ring and link them */
+	for (i = 0; i < n; i++, *pd = (*pd)->next) {
+		ix = (c->first + i) % DMM_PAT_RING_SIZE;
+		if (d)
+			d->next_pa = dmm->descr_pa + ix * sizeof(*d);
+		d = dmm->descr + ix;
+		d->area = (*pd)->area;
+		d->ctrl = (*pd)->ctrl;
+		d->data = (*pd)->data;
+	}
+	d->next_pa = 0;
+	wmb();
+
+	dmm->d_head = (c->first + n) % DMM_PAT_RING_SIZE;
+	dmm->d_free -= n;
+	c->seq = *seq = ++dmm->seq;
+	dmm->c_head++;
+
+	dmm_pat_kick(dmm);
+	spin_unlock_irqrestore(&dmm->lock, flags);
+	return 0;
+}
+
+s32 dmm_pat_refill_async(struct dmm *dmm, struct pat *desc, u32 *seq)
+{
+	struct pat *pd;
+	s32 res = 0;
+	u32 n;
+
+	*seq = 0;
+
+	/* without the PAT interrupt, refill synchronously */
+	if (dmm->irq < 0) {
+		for (pd = desc; pd && !res; pd = pd->next)
+			res = dmm_pat_refill_manual(dmm, pd);
+		return res;
+	}
+
+	/*
+	 * split long lists into chains that fit in the ring; the chains of
+	 * one refill are queued back to back so that their errors can be
+	 * collected on retirement
+	 */
+	mutex_lock(&dmm->q_mtx);
+	while (desc && !res) {
+		for (n = 0, pd = desc; pd && n < DMM_PAT_RING_SIZE; n++)
+			pd = pd->next;
+		res = dmm_pat_queue(dmm, &desc, n, !pd, seq);
+	}
+	mutex_unlock(&dmm->q_mtx);
+	return res;
+}
+EXPORT_SYMBOL(dmm_pat_refill_async);
+
+s32 dmm_pat_sync(struct dmm *dmm, u32 seq)
+{
+	unsigned long flags;
+	s32 res = 0;
+	u32 i;
+
+	if (dmm->irq < 0 || !seq)
+		return 0;
+
+	if (!wait_event_timeout(dmm->wait, dmm_pat_is_done(dmm, seq),
+				msecs_to_jiffies(DMM_PAT_TIMEOUT_MS))) {
+		printk(KERN_ERR "dmm: PAT refill timed out\n");
+		dmm_pat_abort(dmm);
+	}
+
+	/* report any error seen by the engine on this refill */
+	spin_lock_irqsave(&dmm->lock, flags);
+	for (i = 0; i < DMM_PAT_MAX_FAIL; i++) {
+		if (dmm->fail[i].err && dmm->fail[i].seq == seq) {
+			res = dmm->fail[i].err;
+			dmm->fail[i].err = 0;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&dmm->lock, flags);
+	return res;
+}
+EXPORT_SYMBOL(dmm_pat_sync);
+
+s32 dmm_pat_refill(struct dmm *dmm, struct pat *pd, enum pat_mode mode)
+{
+	struct pat single;
+	u32 seq;
+	s32 res;
+
+	if (mode == AUTO) {
+		res = dmm_pat_refill_async(dmm, pd, &seq);
+		return res ? : dmm_pat_sync(dmm, seq);
+	}
+
+	if (dmm->irq < 0)
+		return dmm_pat_refill_manual(dmm, pd);
+
+	/*
+	 * Manual refill polls the raw interrupt status, which the PAT
+	 * interrupt handler clears.  Once the interrupt is installed, queue
+	 * the single descriptor on the engine and wait for its completion.
+	 */
+	single = *pd;
+	single.next = NULL;
+	res = dmm_pat_refill_async(dmm, &single, &seq);
+	return res ? : dmm_pat_sync(dmm, seq);
+}
 EXPORT_SYMBOL(dmm_pat_refill);
 
 static s32 dmm_open(struct inode *ip, struct file *filp)
@@ -239,7 +479,7 @@ struct dmm *dmm_pat_init(u32 id)
 		return NULL;
 	}
 
-	dmm = kmalloc(sizeof(*dmm), GFP_KERNEL);
+	dmm = kzalloc(sizeof(*dmm), GFP_KERNEL);
 	if (!dmm)
 		return NULL;
 
@@ -256,6 +496,34 @@ struct dmm *dmm_pat_init(u32 id)
 	__raw_writel(0x88888888, dmm->base + DMM_TILER_OR__0);
 	__raw_writel(0x88888888, dmm->base + DMM_TILER_OR__1);
 
+	spin_lock_init(&dmm->lock);
+	mutex_init(&dmm->q_mtx);
+	init_waitqueue_head(&dmm->wait);
+	dmm->d_free = DMM_PAT_RING_SIZE;
+	dmm->irq = -1;
+
+	/* set up the descriptor-chained refill engine if possible */
+	dmm->descr = dma_alloc_coherent(NULL, DMM_PAT_RING_SIZE *
+					sizeof(*dmm->descr), &dmm->descr_pa,
+					GFP_KERNEL);
+	if (!dmm->descr) {
+		printk(KERN_WARNING "dmm: no PAT ring, using MANUAL refill\n");
+		return dmm;
+	}
+
+	__raw_writel(0xFFFFFFFF, dmm->base + DMM_PAT_IRQSTATUS);
+	if (request_irq(OMAP44XX_IRQ_DMM, dmm_pat_isr, 0, "dmm", dmm)) {
+		printk(KERN_WARNING "dmm: no PAT irq, using MANUAL refill\n");
+		dma_free_coherent(NULL, DMM_PAT_RING_SIZE *
+				  sizeof(*dmm->descr), dmm->descr,
+				  dmm->descr_pa);
+		dmm->descr = NULL;
+		return dmm;
+	}
+	dmm->irq = OMAP44XX_IRQ_DMM;
+	__raw_writel(DMM_PAT_IRQ_FILL_LST0 | DMM_PAT_IRQ_ERR0,
+		     dmm->base + DMM_PAT_IRQENABLE_SET);
+
 	return dmm;
 }
 EXPORT_SYMBOL(dmm_pat_init);
@@ -268,6 +536,15 @@ EXPORT_SYMBOL(dmm_pat_init);
 void dmm_pat_release(struct dmm *dmm)
 {
 	if (dmm) {
+		if (dmm->irq >= 0) {
+			__raw_writel(DMM_PAT_IRQ_FILL_LST0 | DMM_PAT_IRQ_ERR0,
+				     dmm->base + DMM_PAT_IRQENABLE_CLR);
+			free_irq(dmm->irq, dmm);
+		}
+		if (dmm->descr)
+			dma_free_coherent(NULL, DMM_PAT_RING_SIZE *
+					  sizeof(*dmm->descr), dmm->descr,
+					  dmm->descr_pa);
 		iounmap(dmm->base);
 		kfree(dmm);
 	}
@@ -27,6 +27,9 @@ struct tmm {
 	u32 *(*get)    (struct tmm *tmm, s32 num_pages);
 	void (*free)   (struct tmm *tmm, u32 *pages);
 	s32  (*map)    (struct tmm *tmm, struct pat_area area, u32 page_pa);
+	s32  (*map_async) (struct tmm *tmm, u32 n, struct pat_area *areas,
+			   u32 *page_pa, u32 *cookie);
+	s32  (*sync)   (struct tmm *tmm, u32 cookie);
 	void (*deinit) (struct tmm *tmm);
 };
 
@@ -66,6 +69,42 @@ s32 tmm_map(struct tmm *tmm, struct pat_area area, u32 page_pa)
 	return -ENODEV;
 }
 
+/**
+ * Queue programming of several areas of the physical address translator.
+ * The page lists must remain valid until tmm_sync() returns for the cookie.
+ * @param n       number of areas
+ * @param areas   PAT areas
+ * @param page_pa physical address of the page list for each area
+ * @param cookie  where to store the cookie to pass to tmm_sync()
+ */
+static inline
+s32 tmm_map_async(struct tmm *tmm, u32 n, struct pat_area *areas,
+		  u32 *page_pa, u32 *cookie)
+{
+	s32 res = 0;
+
+	*cookie = 0;
+	if (tmm && tmm->map_async && tmm->pvt)
+		return tmm->map_async(tmm, n, areas, page_pa, cookie);
+
+	/* fall back to mapping each area synchronously */
+	while (n-- && !res)
+		res = tmm_map(tmm, *areas++, *page_pa++);
+	return res;
+}
+
+/**
+ * Wait for areas queued by tmm_map_async() to be programmed.
+ * @param cookie  cookie returned by tmm_map_async()
+ */
+static inline
+s32 tmm_sync(struct tmm *tmm, u32 cookie)
+{
+	if (tmm && tmm->sync && tmm->pvt)
+		return tmm->sync(tmm, cookie);
+	return 0;
+}
+
 /**
  * Checks whether tiler memory manager supports mapping
  */
@@ -21,22 +21,41 @@
 #include <linux/mutex.h>
 #include <linux/list.h>
 #include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
 
 #include "tmm.h"
 
 /**
- * Number of pages to allocate when
- * refilling the free page stack.
+ * Pages are allocated in blocks of 2^REFILL_ORDER pages
+ * (when possible) and split when refilling the free page stack.
  */
-#define MAX 16
+#define REFILL_ORDER 4
 #define DMM_PAGE 0x1000
 
+/* Number of PAT descriptors to chain per refill request */
+#define MAX_CHAIN 8
+
 /* Max pages in free page stack */
 #define PAGE_CAP (256 * 128)
 
 /* Number of pages currently allocated */
 static unsigned long count;
 
+/* Free page stack watermarks for the background refill */
+static uint pool_low = 256;
+module_param(pool_low, uint, 0644);
+MODULE_PARM_DESC(pool_low, "Refill the free page stack in the background "
+		 "when it falls below this many pages");
+
+static uint pool_high = 1024;
+module_param(pool_high, uint, 0644);
+MODULE_PARM_DESC(pool_high, "Number of free pages the background refill "
+		 "keeps ready");
+
 /**
   * Used to keep track of mem per
   * dmm_get_pages call.
@@ -58,6 +77,20 @@ struct mem {
 	u32 pa;
 };
 
+/**
+ * Free page stack statistics
+ */
+struct pool_stats {
+	u32 hits;		/* requests served from the free page stack */
+	u32 misses;		/* requests that had to allocate pages */
+	u64 miss_ns;		/* time spent allocating for them */
+	u32 refills;		/* background refills */
+	u64 refill_ns;		/* time spent in background refills */
+	u64 refill_max_ns;	/* longest background refill */
+	u32 blocks;		/* 2^REFILL_ORDER page blocks allocated */
+	u32 singles;		/* single pages allocated as a fallback */
+};
+
 /**
  * TMM PAT private structure
  */
@@ -67,6 +100,10 @@ struct dmm_mem {
 	struct mem used_list;
 	struct mutex mtx;
 	struct dmm *dmm;
+	u32 num_free;			/* pages in the free page stack */
+	struct work_struct refill;	/* background refill */
+	struct pool_stats stats;
+	struct dentry *dbgfs;
 };
 
 static void dmm_free_fast_list(struct fast *fast)
@@ -87,39 +124,97 @@ static void dmm_free_fast_list(struct fast *fast)
 	}
 }
 
-static u32 fill_page_stack(struct mem *mem, struct mutex *mtx)
+/**
+ * Add at least n cache-flushed pages to the free page stack.  Pages are
+ * allocated and flushed a whole block at a time, which costs much less
+ * than doing so for each page.  Called without the mutex.
+ */
+static s32 fill_page_stack(struct dmm_mem *pvt, u32 n)
 {
-	s32 i = 0;
 	struct mem *m = NULL;
-
-	for (i = 0; i < MAX; i++) {
-		m = kmalloc(sizeof(*m), GFP_KERNEL);
-		if (!m)
-			return -ENOMEM;
-		memset(m, 0x0, sizeof(*m));
-
-		m->pg = alloc_page(GFP_KERNEL | GFP_DMA);
-		if (!m->pg) {
-			kfree(m);
-			return -ENOMEM;
+	void *va = NULL;
+	u32 i, num, got = 0, blocks = 0, singles = 0;
+	s32 res = 0;
+	LIST_HEAD(list);
+
+	while (got < n && !res) {
+		num = 1 << REFILL_ORDER;
+		va = alloc_pages_exact(num * DMM_PAGE, GFP_KERNEL | GFP_DMA |
+				       __GFP_NORETRY | __GFP_NOWARN);
+		if (va) {
+			blocks++;
+		} else {
+			/* memory is fragmented, fall back to single pages */
+			num = 1;
+			va = (void *) __get_free_page(GFP_KERNEL | GFP_DMA);
+			if (!va) {
+				res = -ENOMEM;
+				break;
+			}
+			singles++;
 		}
 
-		m->pa = page_to_phys(m->pg);
-
 		/**
 		 * Note: we need to flush the cache
 		 * entry for each page we allocate.
 		*/
-		dmac_flush_range((void *)page_address(m->pg),
-					(void *)page_address(m->pg) + DMM_PAGE);
-		outer_flush_range(m->pa, m->pa + DMM_PAGE);
-
-		mutex_lock(mtx);
-		count++;
-		list_add(&m->list, &mem->list);
-		mutex_unlock(mtx);
+		dmac_flush_range(va, va + num * DMM_PAGE);
+		outer_flush_range(virt_to_phys(va),
+				  virt_to_phys(va) + num * DMM_PAGE);
+
+		/* the block was split, so its pages are freed one by one */
+		for (i = 0; i < num; i++) {
+			m = kmalloc(sizeof(*m), GFP_KERNEL);
+			if (!m) {
+				for (; i < num; i++)
+					free_page((unsigned long) va +
+						  i * DMM_PAGE);
+				res = -ENOMEM;
+				break;
+			}
+			m->pg = virt_to_page(va + i * DMM_PAGE);
+			m->pa = page_to_phys(m->pg);
+			list_add(&m->list, &list);
+			got++;
+		}
 	}
-	return 0x0;
+
+	mutex_lock(&pvt->mtx);
+	list_splice(&list, &pvt->free_list.list);
+	pvt->num_free += got;
+	count += got;
+	pvt->stats.blocks += blocks;
+	pvt->stats.singles += singles;
+	mutex_unlock(&pvt->mtx);
+	return res;
+}
+
+/* keep the free page stack between the watermarks */
+static void tmm_pat_refill(struct work_struct *work)
+{
+	struct dmm_mem *pvt = container_of(work, struct dmm_mem, refill);
+	u64 t = sched_clock();
+	u32 n = 0;
+
+	mutex_lock(&pvt->mtx);
+	if (pvt->num_free < pool_high)
+		n = pool_high - pvt->num_free;
+	if (count + n > PAGE_CAP)
+		n = count < PAGE_CAP ? PAGE_CAP - count : 0;
+	mutex_unlock(&pvt->mtx);
+
+	if (!n)
+		return;
+
+	fill_page_stack(pvt, n);
+
+	t = sched_clock() - t;
+	mutex_lock(&pvt->mtx);
+	pvt->stats.refills++;
+	pvt->stats.refill_ns += t;
+	if (t > pvt->stats.refill_max_ns)
+		pvt->stats.refill_max_ns = t;
+	mutex_unlock(&pvt->mtx);
 }
 
 static void dmm_free_page_stack(struct mem *mem)
@@ -140,6 +235,9 @@ static void tmm_pat_deinit(struct tmm *tmm)
 {
 	struct dmm_mem *pvt = (struct dmm_mem *) tmm->pvt;
 
+	debugfs_remove_recursive(pvt->dbgfs);
+	cancel_work_sync(&pvt->refill);
+
 	mutex_lock(&pvt->mtx);
 	dmm_free_fast_list(&pvt->fast_list);
 	dmm_free_page_stack(&pvt->free_list);
@@ -149,37 +247,29 @@ static void tmm_pat_deinit(struct tmm *tmm)
 
 static u32 *tmm_pat_get_pages(struct tmm *tmm, s32 n)
 {
-	s32 i = 0;
-	struct list_head *pos = NULL, *q = NULL;
+	s32 i = 0, res;
 	struct mem *m = NULL;
 	struct fast *f = NULL;
 	struct dmm_mem *pvt = (struct dmm_mem *) tmm->pvt;
+	bool missed;
+	u64 t;
 
 	if (n <= 0 || n > 0x8000)
 		return NULL;
 
-	if (list_empty_careful(&pvt->free_list.list))
-		if (fill_page_stack(&pvt->free_list, &pvt->mtx))
-			return NULL;
-
-	f = kmalloc(sizeof(*f), GFP_KERNEL);
+	f = kzalloc(sizeof(*f), GFP_KERNEL);
 	if (!f)
 		return NULL;
-	memset(f, 0x0, sizeof(*f));
 
 	/* array of mem struct pointers */
 	f->mem = kmalloc(n * sizeof(*f->mem), GFP_KERNEL);
-	if (!f->mem) {
-		kfree(f); return NULL;
-	}
-	memset(f->mem, 0x0, n * sizeof(*f->mem));
+	if (!f->mem)
+		goto cleanup;
 
 	/* array of physical addresses */
 	f->pa = kmalloc(n * sizeof(*f->pa), GFP_KERNEL);
-	if (!f->pa) {
-		kfree(f->mem); kfree(f); return NULL;
-	}
-	memset(f->pa, 0x0, n * sizeof(*f->pa));
+	if (!f->pa)
+		goto cleanup;
 
 	/*
 	 * store the number of mem structs so that we
@@ -187,47 +277,46 @@ static u32 *tmm_pat_get_pages(struct tmm *tmm, s32 n)
 	 */
 	f->num = n;
 
-	for (i = 0; i < n; i++) {
-		if (list_empty_careful(&pvt->free_list.list))
-			if (fill_page_stack(&pvt->free_list, &pvt->mtx))
-				goto cleanup;
-
-		mutex_lock(&pvt->mtx);
-		pos = NULL;
-		q = NULL;
-		m = NULL;
-
-		/*
-		 * remove one mem struct from the free list and
-		 * add the address to the fast struct mem array
-		 */
-		list_for_each_safe(pos, q, &pvt->free_list.list) {
-			m = list_entry(pos, struct mem, list);
-			list_del(pos);
-			break;
-		}
+	mutex_lock(&pvt->mtx);
+	missed = pvt->num_free < n;
+	while (pvt->num_free < n) {
+		/* the background refill fell behind, allocate right away */
+		i = n - pvt->num_free;
 		mutex_unlock(&pvt->mtx);
 
-		if (m != NULL) {
-			f->mem[i] = m;
-			f->pa[i] = m->pa;
-		} else {
+		t = sched_clock();
+		res = fill_page_stack(pvt, i);
+		t = sched_clock() - t;
+
+		mutex_lock(&pvt->mtx);
+		pvt->stats.miss_ns += t;
+		if (res) {
+			mutex_unlock(&pvt->mtx);
 			goto cleanup;
 		}
 	}
 
-	mutex_lock(&pvt->mtx);
+	/* move the pages from the free page stack in one go */
+	for (i = 0; i < n; i++) {
+		m = list_first_entry(&pvt->free_list.list, struct mem, list);
+		list_del(&m->list);
+		f->mem[i] = m;
+		f->pa[i] = m->pa;
+	}
+	pvt->num_free -= n;
+	if (missed)
+		pvt->stats.misses++;
+	else
+		pvt->stats.hits++;
+
 	list_add(&f->list, &pvt->fast_list.list);
+
+	if (pvt->num_free < pool_low)
+		schedule_work(&pvt->refill);
 	mutex_unlock(&pvt->mtx);
 
-	if (f != NULL)
-		return f->pa;
+	return f->pa;
 cleanup:
-	for (; i > 0; i--) {
-		mutex_lock(&pvt->mtx);
-		list_add(&f->mem[i - 1]->list, &pvt->free_list.list);
-		mutex_unlock(&pvt->mtx);
-	}
 	kfree(f->pa);
 	kfree(f->mem);
 	kfree(f);
@@ -252,6 +341,7 @@ static void tmm_pat_free_pages(struct tmm *tmm, u32 *list)
 					list_add(
 					&((struct mem *)f->mem[i])->list,
 					&pvt->free_list.list);
+					pvt->num_free++;
 				} else {
 					__free_page(
 						((struct mem *)f->mem[i])->pg);
@@ -268,25 +358,103 @@ static void tmm_pat_free_pages(struct tmm *tmm, u32 *list)
 	mutex_unlock(&pvt->mtx);
 }
 
+static void tmm_pat_fill_desc(struct pat *pat_desc, struct pat_area area,
+			      u32 page_pa, struct pat *next)
+{
+	memset(pat_desc, 0, sizeof(*pat_desc));
+	pat_desc->ctrl.dir = 0;
+	pat_desc->ctrl.ini = 0;
+	pat_desc->ctrl.lut_id = 0;
+	pat_desc->ctrl.start = 1;
+	pat_desc->ctrl.sync = 0;
+	pat_desc->area = area;
+	pat_desc->next = next;
+
+	/* must be a 16-byte aligned physical address */
+	pat_desc->data = page_pa;
+}
+
 static s32 tmm_pat_map(struct tmm *tmm, struct pat_area area, u32 page_pa)
 {
 	struct dmm_mem *pvt = (struct dmm_mem *) tmm->pvt;
-	struct pat pat_desc = {0};
+	struct pat pat_desc;
 
 	/* send pat descriptor to dmm driver */
-	pat_desc.ctrl.dir = 0;
-	pat_desc.ctrl.ini = 0;
-	pat_desc.ctrl.lut_id = 0;
-	pat_desc.ctrl.start = 1;
-	pat_desc.ctrl.sync = 0;
-	pat_desc.area = area;
-	pat_desc.next = NULL;
+	tmm_pat_fill_desc(&pat_desc, area, page_pa, NULL);
+	return dmm_pat_refill(pvt->dmm, &pat_desc, AUTO);
+}
 
-	/* must be a 16-byte aligned physical address */
-	pat_desc.data = page_pa;
-	return dmm_pat_refill(pvt->dmm, &pat_desc, MANUAL);
+static s32 tmm_pat_map_async(struct tmm *tmm, u32 n, struct pat_area *areas,
+			     u32 *page_pa, u32 *cookie)
+{
+	struct dmm_mem *pvt = (struct dmm_mem *) tmm->pvt;
+	struct pat pat_desc[MAX_CHAIN];
+	s32 res = 0;
+	u32 i, c;
+
+	/*
+	 * Chain the descriptors, the dmm driver copies them into its ring.
+	 * Chains complete in order, so waiting for the last one suffices.
+	 * Descriptors are kept on the stack as this can be called while
+	 * reclaiming tiler memory.
+	 */
+	while (n && !res) {
+		c = min(n, (u32) MAX_CHAIN);
+		for (i = 0; i < c; i++)
+			tmm_pat_fill_desc(pat_desc + i, areas[i], page_pa[i],
+					  i + 1 < c ? pat_desc + i + 1 : NULL);
+
+		res = dmm_pat_refill_async(pvt->dmm, pat_desc, cookie);
+		areas += c;
+		page_pa += c;
+		n -= c;
+	}
+	return res;
+}
+
+static s32 tmm_pat_sync(struct tmm *tmm, u32 cookie)
+{
+	struct dmm_mem *pvt = (struct dmm_mem *) tmm->pvt;
+
+	return dmm_pat_sync(pvt->dmm, cookie);
+}
+
+static int tmm_pat_pool_show(struct seq_file *s, void *unused)
+{
+	struct dmm_mem *pvt = s->private;
+	struct pool_stats st;
+	u32 num_free;
+
+	mutex_lock(&pvt->mtx);
+	st = pvt->stats;
+	num_free = pvt->num_free;
+	mutex_unlock(&pvt->mtx);
+
+	seq_printf(s, "free pages: %u (low %u, high %u), allocated %lu\n",
+		   num_free, pool_low, pool_high, count);
+	seq_printf(s, "hits: %u\nmisses: %u (%llu us allocating)\n",
+		   st.hits, st.misses, div_u64(st.miss_ns, 1000));
+	seq_printf(s, "refills: %u (avg %llu us, max %llu us)\n", st.refills,
+		   st.refills ?
+		   div_u64(div_u64(st.refill_ns, st.refills), 1000) : 0,
+		   div_u64(st.refill_max_ns, 1000));
+	seq_printf(s, "allocated: %u blocks of %u pages, %u single pages\n",
+		   st.blocks, 1 << REFILL_ORDER, st.singles);
+	return 0;
+}
+
+static int tmm_pat_pool_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tmm_pat_pool_show, inode->i_private);
 }
 
+static const struct file_operations tmm_pat_pool_fops = {
+	.open = tmm_pat_pool_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 struct tmm *tmm_pat_init(u32 pat_id)
 {
 	struct tmm *tmm = NULL;
@@ -304,11 +472,23 @@ struct tmm *tmm_pat_init(u32 pat_id)
 		INIT_LIST_HEAD(&pvt->used_list.list);
 		INIT_LIST_HEAD(&pvt->fast_list.list);
 		mutex_init(&pvt->mtx);
+		INIT_WORK(&pvt->refill, tmm_pat_refill);
+		pvt->num_free = 0;
+		memset(&pvt->stats, 0, sizeof(pvt->stats));
 
 		count = 0;
-		if (list_empty_careful(&pvt->free_list.list))
-			if (fill_page_stack(&pvt->free_list, &pvt->mtx))
-				goto error;
+		if (fill_page_stack(pvt, 1 << REFILL_ORDER)) {
+			dmm_free_page_stack(&pvt->free_list);
+			goto error;
+		}
+
+		/* fill up to the high watermark in the background */
+		schedule_work(&pvt->refill);
+
+		pvt->dbgfs = debugfs_create_dir("tmm_pat", NULL);
+		if (!IS_ERR_OR_NULL(pvt->dbgfs))
+			debugfs_create_file("pool", S_IRUGO, pvt->dbgfs, pvt,
+					    &tmm_pat_pool_fops);
 
 		/* public data */
 		tmm->pvt = pvt;
@@ -316,6 +496,8 @@ struct tmm *tmm_pat_init(u32 pat_id)
 		tmm->get = tmm_pat_get_pages;
 		tmm->free = tmm_pat_free_pages;
 		tmm->map = tmm_pat_map;
+		tmm->map_async = tmm_pat_map_async;
+		tmm->sync = tmm_pat_sync;
 
 		return tmm;
 	}
@@ -39,6 +39,8 @@
 #include <linux/irq.h>
 #include <linux/videodev2.h>
 #include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
 
 #ifndef CONFIG_ARCH_OMAP4
 #include <media/videobuf-dma-sg.h>
@@ -417,6 +419,21 @@ static void omap_vout_release_vrfb(struct omap_vout_device *vout)
 	}
 }
 #endif
+/*
+ * Return true if the buffer is in TILER space, or in a 2D TILER container.
+ * TILER 1D (page mode) and non-TILER buffers are linear, and are fetched
+ * by the DSS without TILER rotation.
+ */
+static inline int is_tiler_addr(u32 addr)
+{
+	return addr >= TILVIEW_8BIT && addr < TILVIEW_END;
+}
+
+static inline int is_tiler_2d_addr(u32 addr)
+{
+	return addr >= TILVIEW_8BIT && addr < TILVIEW_PAGE;
+}
+
 /*
  * Return true if rotation is 90 or 270
  */
@@ -645,6 +662,162 @@ static void omap_vout_free_tiler_buffers(struct omap_vout_device *vout)
 	omap_vout_tiler_buffer_free(vout, vout->buffer_allocated, 0);
 	vout->buffer_allocated = 0;
 }
+
+/* Unmap the userptr buffers of the given indices from TILER */
+static void omap_vout_uptr_free(struct omap_vout_device *vout,
+				unsigned int count, unsigned int startindex)
+{
+	int i;
+
+	if (startindex + count > VIDEO_MAX_FRAME)
+		count = VIDEO_MAX_FRAME - startindex;
+
+	for (i = startindex; i < startindex + count; i++) {
+		if (vout->uptr[i].tiler_addr)
+			tiler_free(vout->uptr[i].tiler_addr);
+		vout->uptr[i].tiler_addr = 0;
+		vout->uptr[i].uaddr = 0;
+		vout->uptr[i].size = 0;
+		vout->uptr[i].pages = NULL;
+	}
+}
+
+/* pinned pages of a userptr buffer, exported to TILER for mapping */
+struct omap_vout_pages {
+	struct tiler_pa_info pa;
+	struct page *pages[0];	/* followed by the physical addresses */
+};
+
+/*
+ * Return true if the user buffer at this index is already mapped.  The
+ * user address must still be backed by the pages pinned for the mapping:
+ * after a munmap and mmap at the same address it is mapped anew.
+ */
+static int omap_vout_uptr_cached(struct omap_vout_device *vout,
+				 struct videobuf_buffer *vb)
+{
+	struct omap_vout_uptr *uptr = &vout->uptr[vb->i];
+	unsigned long start = vb->baddr & PAGE_MASK;
+	struct page *pages[16];
+	u32 i, j, n;
+	int got, same = 1;
+
+	if (!uptr->tiler_addr || uptr->uaddr != vb->baddr ||
+	    uptr->size != vout->pix.sizeimage)
+		return 0;
+
+	n = uptr->pages->pa.num_pg;
+	down_read(&current->mm->mmap_sem);
+	for (i = 0; i < n && same; i += got) {
+		got = get_user_pages(current, current->mm,
+				     start + i * PAGE_SIZE,
+				     min_t(u32, n - i, ARRAY_SIZE(pages)),
+				     0, 0, pages, NULL);
+		if (got <= 0) {
+			same = 0;
+			break;
+		}
+		for (j = 0; j < got; j++) {
+			if (pages[j] != uptr->pages->pages[i + j])
+				same = 0;
+			page_cache_release(pages[j]);
+		}
+	}
+	up_read(&current->mm->mmap_sem);
+
+	return same;
+}
+
+/* TILER calls this once the block mapping the pages is freed */
+static void omap_vout_uptr_release(struct tiler_pa_info *pa)
+{
+	struct omap_vout_pages *p = container_of(pa, struct omap_vout_pages,
+						 pa);
+	u32 i;
+
+	for (i = 0; i < pa->num_pg; i++)
+		page_cache_release(p->pages[i]);
+	kfree(p);
+}
+
+/* Pin the pages of a user buffer, and export them to TILER */
+static int omap_vout_uptr_export(unsigned long uaddr, u32 size, u32 *handle,
+				 struct omap_vout_pages **pages)
+{
+	struct omap_vout_pages *p;
+	u32 n = PAGE_ALIGN((uaddr & ~PAGE_MASK) + size) >> PAGE_SHIFT;
+	int got, ret;
+
+	p = kmalloc(sizeof(*p) + n * (sizeof(*p->pages) + sizeof(u32)),
+		    GFP_KERNEL);
+	if (!p)
+		return -ENOMEM;
+	p->pa.mem = (u32 *) (p->pages + n);
+	p->pa.release = omap_vout_uptr_release;
+
+	/* the DSS only reads the buffer */
+	down_read(&current->mm->mmap_sem);
+	got = get_user_pages(current, current->mm, uaddr & PAGE_MASK, n,
+			     0, 0, p->pages, NULL);
+	up_read(&current->mm->mmap_sem);
+
+	p->pa.num_pg = got > 0 ? got : 0;
+	if (got != n) {
+		omap_vout_uptr_release(&p->pa);
+		return -EFAULT;
+	}
+
+	for (n = 0; n < p->pa.num_pg; n++)
+		p->pa.mem[n] = page_to_phys(p->pages[n]);
+
+	/* only we map the export, so no process may map it */
+	ret = tiler_export_pa(&p->pa, 0, handle);
+	if (ret)
+		omap_vout_uptr_release(&p->pa);
+	else
+		*pages = p;
+	return ret;
+}
+
+/*
+ * Map a linear userptr buffer into a TILER 1D block, so that the DSS can
+ * fetch it directly.  The user pages are pinned once here, and stay
+ * pinned until the buffer is unmapped by REQBUFS or close, so the same
+ * user buffer can be queued again without any copy, pinning or TILER
+ * mapping.  The pages are exported to TILER only while the block is
+ * mapped: the block keeps them until it is freed, and then hands them
+ * back to be unpinned.
+ */
+static int omap_vout_uptr_map(struct omap_vout_device *vout,
+			      struct videobuf_buffer *vb)
+{
+	struct omap_vout_uptr *uptr = &vout->uptr[vb->i];
+	u32 size = vout->pix.sizeimage;
+	struct omap_vout_pages *pages;
+	u32 tiler_addr, handle;
+	int ret;
+
+	/* another buffer is queued at this index, drop the old mapping */
+	omap_vout_uptr_free(vout, 1, vb->i);
+
+	ret = omap_vout_uptr_export(vb->baddr, size, &handle, &pages);
+	if (!ret) {
+		ret = tiler_map_pa(handle, 0, current->tgid, &tiler_addr);
+		tiler_unexport_pa(handle);
+	}
+	if (ret) {
+		v4l2_err(&vout->vid_dev->v4l2_dev,
+			"failed to map userptr buffer %d into tiler (%d)\n",
+			vb->i, ret);
+		return ret;
+	}
+
+	uptr->tiler_addr = tiler_addr;
+	uptr->uaddr = vb->baddr;
+	uptr->size = size;
+	uptr->pages = pages;
+	return 0;
+}
 #endif	/* ifdef CONFIG_ARCH_OMAP4 */
 
 /* Convert V4L2 rotation to DSS rotation
@@ -803,7 +976,18 @@ static int omap_vout_calculate_offset(struct omap_vout_device *vout, int idx)
 	/* :TODO: change v4l2 to send TSPtr as tiled addresses to DSS2 */
 	addr = tiler_get_natural_addr(vout->queued_buf_addr[idx]);
 
-	if (OMAP_DSS_COLOR_NV12 == vout->dss_mode) {
+	if (!is_tiler_2d_addr(addr)) {
+		/* linear buffers have a bytesperline stride, NV12 UV too */
+		line_length = pix->bytesperline;
+		if (OMAP_DSS_COLOR_NV12 == vout->dss_mode) {
+			*cropped_offset = line_length * crop->top + crop->left;
+			*cropped_uv_offset = line_length * (crop->top >> 1)
+				+ (crop->left & ~1);
+		} else {
+			*cropped_offset =
+				line_length * crop->top + crop->left * ps;
+		}
+	} else if (OMAP_DSS_COLOR_NV12 == vout->dss_mode) {
 		*cropped_offset = tiler_stride(addr) * crop->top + crop->left;
 		uv_addr = tiler_get_natural_addr(
 			vout->queued_buf_uv_addr[idx]);
@@ -954,6 +1138,11 @@ int omapvid_setup_overlay(struct omap_vout_device *vout,
 			info.rotation_type = OMAP_DSS_ROT_VRFB;
 			info.screen_width = 2048;
 		}
+	} else if (!is_tiler_2d_addr(info.paddr)) {
+		/* linear buffer, only mirroring is possible */
+		info.rotation = 0;
+		info.rotation_type = OMAP_DSS_ROT_DMA;
+		info.screen_width = vout->pix.bytesperline / vout->bpp;
 	} else {
 		info.rotation_type = OMAP_DSS_ROT_TILER;
 		info.screen_width = pixwidth;
@@ -1082,7 +1271,13 @@ int omapvid_apply_changes(struct omap_vout_device *vout)
 		if (!ovl->manager || !ovl->manager->device)
 			return -EINVAL;
 		dev = ovl->manager->device;
-		ovl->manager->apply(ovl->manager);
+		if (i == 0 && ovl->manager->apply_async) {
+			vout->apply_mgr = ovl->manager;
+			ovl->manager->apply_async(ovl->manager,
+					&vout->apply_fence);
+		} else {
+			ovl->manager->apply(ovl->manager);
+		}
 #ifndef CONFIG_FB_OMAP2_FORCE_AUTO_UPDATE
 		if (dss_ovl_manually_updated(ovl)) {
 			/* we only keep the last frame on manual-upd panels */
@@ -1207,6 +1402,16 @@ static int omapvid_process_frame(struct omap_vout_device *vout)
 	return ret;
 }
 
+/* returns true once the HW uses the configuration of next_frm */
+static bool next_frame_latched(struct omap_vout_device *vout)
+{
+	struct omap_overlay_manager *mgr = vout->vid_info.overlays[0]->manager;
+
+	if (!mgr || mgr != vout->apply_mgr)
+		return true;
+	return mgr->fence_done(mgr, vout->apply_fence);
+}
+
 /* returns true if there is no next frame */
 static bool next_frame(struct omap_vout_device *vout)
 {
@@ -1352,7 +1557,10 @@ intlace:
 		} else
 			printk(KERN_ERR "Failed to get allocate work struct\n");
 	} else {
-		/* process frame here for auto update screens */
+		/* process frame here for auto update screens. The applies
+		 * are queued, so keep cur_frm until next_frm is in use */
+		if (!next_frame_latched(vout))
+			goto vout_isr_err;
 		if (process && next_frame(vout))
 			goto vout_isr_err;
 		omapvid_process_frame(vout);
@@ -1520,6 +1728,7 @@ static u32 omap_tiler_virt_to_phys(void *ptr)
 			}
 		}
 	}
+	return 0;
 }
 
 /*
@@ -1657,17 +1866,46 @@ static int omap_vout_buffer_prepare(struct videobuf_queue *q,
 		vout->queued_buf_uv_addr[vb->i] = (u8 *) vout->buf_phy_uv_addr[vb->i];
 	}
 	if (V4L2_MEMORY_USERPTR == vb->memory) {
-		int offset;
+		struct omap_vout_uptr *uptr = &vout->uptr[vb->i];
+		u32 addr;
+		int offset, ret, cached;
+
 		if (0 == vb->baddr)
 			return -EINVAL;
-		/* Physical address */
-		vout->queued_buf_addr[vb->i] =
-			(u8 *)omap_tiler_virt_to_phys((void *) vb->baddr);
 
-		if (V4L2_PIX_FMT_NV12 == vout->pix.pixelformat) {
-			offset = vout->pix.height * vout->pix.bytesperline;
-			vout->queued_buf_uv_addr[vb->i] = (u8 *)omap_tiler_virt_to_phys((u8*)vb->baddr + offset);
+		/* buffers of another TILER client are used as they are */
+		addr = 0;
+		cached = omap_vout_uptr_cached(vout, vb);
+		if (!cached)
+			addr = omap_tiler_virt_to_phys((void *) vb->baddr);
+		if (is_tiler_2d_addr(addr)) {
+			vout->queued_buf_addr[vb->i] = (u8 *) addr;
+			if (V4L2_PIX_FMT_NV12 == vout->pix.pixelformat) {
+				offset = vout->pix.height *
+					vout->pix.bytesperline;
+				vout->queued_buf_uv_addr[vb->i] = (u8 *)
+					omap_tiler_virt_to_phys(
+						(u8 *) vb->baddr + offset);
+			}
+			return 0;
 		}
+
+		/* TILER 1D is linear, other buffers are mapped into it */
+		if (vout->rotation)
+			return -EINVAL;
+		if (!is_tiler_addr(addr)) {
+			if (!cached) {
+				ret = omap_vout_uptr_map(vout, vb);
+				if (ret)
+					return ret;
+			}
+			addr = uptr->tiler_addr + (vb->baddr & ~PAGE_MASK);
+		}
+
+		vout->queued_buf_addr[vb->i] = (u8 *) addr;
+		if (V4L2_PIX_FMT_NV12 == vout->pix.pixelformat)
+			vout->queued_buf_uv_addr[vb->i] = (u8 *) addr +
+				vout->pix.bytesperline * vout->pix.height;
 	}
 
 #endif
@@ -1925,6 +2163,7 @@ static int omap_vout_release(struct file *file)
 	omap_vout_free_allbuffers(vout);
 #else
 	omap_vout_free_tiler_buffers(vout);
+	omap_vout_uptr_free(vout, VIDEO_MAX_FRAME, 0);
 #endif
 	videobuf_mmap_free(q);
 
@@ -2649,6 +2888,9 @@ static int vidioc_reqbufs(struct file *file, void *fh,
 			}
 			vout->buffer_allocated = 0;
 		}
+#ifdef CONFIG_ARCH_OMAP4
+		omap_vout_uptr_free(vout, VIDEO_MAX_FRAME, 0);
+#endif
 	}
 
 	/*store the memory type in data structure */
@@ -2837,6 +3079,7 @@ static int vidioc_streamon(struct file *file, void *fh, enum v4l2_buf_type i)
 	vout->streaming = 1;
 
 	vout->first_int = 1;
+	vout->apply_mgr = NULL;
 
 	addr = (unsigned long) vout->queued_buf_addr[vout->cur_frm->i]
 		+ vout->cropped_offset[vout->cur_frm->i];
@@ -80,6 +80,21 @@ struct omap2video_device {
 	struct omap_overlay_manager *managers[MAX_MANAGERS];
 };
 
+struct omap_vout_pages;
+
+/*
+ * userptr buffer mapped into a TILER 1D block.  The mapping is made on
+ * the first QBUF of a buffer index and reused for as long as the
+ * application queues the same user buffer at that index, and the user
+ * address is still backed by the pages pinned for it.
+ */
+struct omap_vout_uptr {
+	unsigned long uaddr;	/* user space address of the buffer */
+	u32 size;		/* mapped size of the buffer in bytes */
+	u32 tiler_addr;		/* TILER system space address, 0 if unmapped */
+	struct omap_vout_pages *pages;	/* pages pinned for the mapping */
+};
+
 /* manual update work */
 struct omap_vout_work {
 	struct omap_vout_device *vout;
@@ -115,6 +130,9 @@ struct omap_vout_device {
 	u8 *queued_buf_uv_addr[VIDEO_MAX_FRAME];
 	enum omap_color_mode dss_mode;
 
+	/* userptr buffers mapped into TILER, cached per buffer index */
+	struct omap_vout_uptr uptr[VIDEO_MAX_FRAME];
+
 	/* we don't allow to request new buffer when old buffers are
 	 * still mmaped
 	 */
@@ -155,6 +173,9 @@ struct omap_vout_device {
 	int ps, vr_ps, line_length, first_int, field_id;
 	enum v4l2_memory memory;
 	struct videobuf_buffer *cur_frm, *next_frm;
+	/* manager and fence of the last apply, done once next_frm is shown */
+	struct omap_overlay_manager *apply_mgr;
+	u32 apply_fence;
 	struct list_head dma_queue;
 	u8 *queued_buf_addr[VIDEO_MAX_FRAME];
 	u32 cropped_offset[VIDEO_MAX_FRAME];
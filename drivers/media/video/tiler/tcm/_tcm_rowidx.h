@@ -0,0 +1,49 @@
+/*
+ * _tcm_rowidx.h
+ *
+ * Row indexed tiler container manager private structures.
+ *
+ * Copyright (C) 2009-2010 Texas Instruments, Inc.
+ *
+ * This package is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef _TCM_ROWIDX_H_
+#define _TCM_ROWIDX_H_
+
+#include "tcm.h"
+
+/*
+ * Area info kept
+ */
+struct rowidx_area {
+	struct tcm_area area;
+	struct list_head list;
+};
+
+/*
+ * The container is kept as a bitmap of busy slots with the rows stored
+ * back to back, so that a 1D area is a run of bits in the bitmap and a 2D
+ * area is a run of bits in each of its rows.  For each row the longest run
+ * of free slots is also kept, so that rows that cannot hold an area are
+ * skipped without looking at the bitmap.
+ */
+struct rowidx_pvt {
+	u16 width;
+	u16 height;
+	u16 words;		/* longs per row */
+	struct list_head res;	/* all allocations */
+	struct mutex mtx;
+	struct tcm_pt div_pt;	/* divider point splitting container */
+	unsigned long *map;	/* busy slots */
+	u16 *max_run;		/* longest free run in each row */
+	unsigned long *mask;	/* union of the rows being checked */
+};
+
+#endif /* _TCM_ROWIDX_H_ */
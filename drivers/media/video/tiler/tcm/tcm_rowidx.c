@@ -0,0 +1,423 @@
+/*
+ * tcm_rowidx.c
+ *
+ * Row indexed tiler container manager: 2D and 1D allocation (reservation)
+ * algorithm using per-row free-run indexes and bitmaps of busy slots.
+ *
+ * Copyright (C) 2009-2010 Texas Instruments, Inc.
+ *
+ * This package is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ */
+#include <linux/slab.h>
+#include <linux/bitmap.h>
+
+#include "_tcm_rowidx.h"
+#include "tcm_rowidx.h"
+
+#define TCM_ALG_NAME "tcm_rowidx"
+#include "tcm_utils.h"
+
+#define ALIGN_DOWN(value, align) ((value) & ~((align) - 1))
+
+/*********************************************
+ *	Bitmap helpers
+ *********************************************/
+
+static inline unsigned long *row(struct rowidx_pvt *pvt, u16 y)
+{
+	return pvt->map + y * pvt->words;
+}
+
+/* recalculate the longest free run of rows y0..y1 */
+static void update_max_run(struct rowidx_pvt *pvt, u16 y0, u16 y1)
+{
+	unsigned long *r;
+	u16 x, b, max;
+
+	for (; y0 <= y1; y0++) {
+		r = row(pvt, y0);
+		max = 0;
+		x = find_next_zero_bit(r, pvt->width, 0);
+		while (x < pvt->width) {
+			b = find_next_bit(r, pvt->width, x);
+			if (b - x > max)
+				max = b - x;
+			if (b >= pvt->width)
+				break;
+			x = find_next_zero_bit(r, pvt->width, b);
+		}
+		pvt->max_run[y0] = max;
+	}
+}
+
+/* mark or clear the slots of an area */
+static void fill_area(struct rowidx_pvt *pvt, struct tcm_area *area,
+		      bool busy)
+{
+	u16 y;
+	u32 start, n;
+
+	if (area->is2d) {
+		n = area->p1.x - area->p0.x + 1;
+		for (y = area->p0.y; y <= area->p1.y; y++) {
+			if (busy)
+				bitmap_set(row(pvt, y), area->p0.x, n);
+			else
+				bitmap_clear(row(pvt, y), area->p0.x, n);
+		}
+	} else {
+		start = area->p0.x + area->p0.y * pvt->width;
+		n = area->p1.x + area->p1.y * pvt->width - start + 1;
+		if (busy)
+			bitmap_set(pvt->map, start, n);
+		else
+			bitmap_clear(pvt->map, start, n);
+	}
+	update_max_run(pvt, area->p0.y, area->p1.y);
+}
+
+/* (in mask) union of busy slots in rows y..y+h-1 */
+static void or_rows(struct rowidx_pvt *pvt, u16 y, u16 h)
+{
+	unsigned long *r = row(pvt, y);
+	u16 i;
+
+	memcpy(pvt->mask, r, pvt->words * sizeof(*r));
+	while (--h) {
+		r += pvt->words;
+		for (i = 0; i < pvt->words; i++)
+			pvt->mask[i] |= r[i];
+	}
+}
+
+/* leftmost aligned start of w free slots in mask within x0..x1, or -1 */
+static s32 first_fit_in_mask(struct rowidx_pvt *pvt, u16 x0, u16 x1, u16 w,
+			     u16 stride)
+{
+	u32 x = bitmap_find_next_zero_area(pvt->mask, x1 + 1, x0, w,
+					   stride - 1);
+	return x + w <= x1 + 1 ? x : -1;
+}
+
+/* rightmost aligned start of w free slots in mask within x0..x1, or -1 */
+static s32 last_fit_in_mask(struct rowidx_pvt *pvt, u16 x0, u16 x1, u16 w,
+			    u16 stride)
+{
+	s32 x;
+	u32 b;
+
+	if (x1 + 1 < x0 + w)
+		return -1;
+
+	x = ALIGN_DOWN(x1 + 1 - w, stride);
+	while (x >= x0) {
+		b = find_next_bit(pvt->mask, x + w, x);
+		if (b >= x + w)
+			return x;
+		/* the area must end before this busy slot */
+		if (b < x0 + w)
+			break;
+		x = ALIGN_DOWN(b - w, stride);
+	}
+	return -1;
+}
+
+/**
+ * Find a w x h area in a field of the container, scanning from top to
+ * bottom, and from left to right or right to left.
+ *
+ * Rows whose longest free run is shorter than w are skipped, and the busy
+ * slots of the candidate rows are merged a word at a time, so the cost
+ * does not depend on how the free space is fragmented within a row.
+ */
+static s32 scan_field(struct rowidx_pvt *pvt, u16 w, u16 h, u16 stride,
+		      struct tcm_area *field, bool l2r, struct tcm_area *area)
+{
+	u16 y, good = 0;
+	s32 x;
+
+	if (w > field->p1.x - field->p0.x + 1 ||
+	    h > field->p1.y - field->p0.y + 1)
+		return -ENOSPC;
+
+	for (y = field->p0.y; y <= field->p1.y; y++) {
+		/* count consecutive rows that may hold w free slots */
+		if (pvt->max_run[y] < w) {
+			good = 0;
+			continue;
+		}
+		if (++good < h)
+			continue;
+
+		/* rows y-h+1..y are candidates */
+		or_rows(pvt, y - h + 1, h);
+		x = l2r ? first_fit_in_mask(pvt, field->p0.x, field->p1.x, w,
+					    stride) :
+			  last_fit_in_mask(pvt, field->p0.x, field->p1.x, w,
+					   stride);
+		if (x >= 0) {
+			assign(area, x, y - h + 1, x + w - 1, y);
+			return 0;
+		}
+	}
+	return -ENOSPC;
+}
+
+/* return 1 + the highest slot below pos that is busy (or free), 0 if none */
+static u32 prev_slot(unsigned long *map, u32 pos, bool busy)
+{
+	unsigned long word;
+	u32 base;
+
+	while (pos) {
+		base = (pos - 1) & ~(BITS_PER_LONG - 1);
+		word = busy ? map[base / BITS_PER_LONG] :
+			      ~map[base / BITS_PER_LONG];
+		if (pos - base < BITS_PER_LONG)
+			word &= (1UL << (pos - base)) - 1;
+		if (word)
+			return base + __fls(word) + 1;
+		pos = base;
+	}
+	return 0;
+}
+
+/* find the highest run of n free slots in the container, a word at a time */
+static s32 scan_one_dim(struct rowidx_pvt *pvt, u32 n, struct tcm_area *area)
+{
+	u32 start, end = pvt->width * pvt->height;
+
+	while ((end = prev_slot(pvt->map, end, false))) {
+		start = prev_slot(pvt->map, end, true);
+		if (end - start >= n) {
+			start = end - n;
+			assign(area, start % pvt->width, start / pvt->width,
+			       (end - 1) % pvt->width, (end - 1) / pvt->width);
+			return 0;
+		}
+		end = start;
+	}
+	return -ENOSPC;
+}
+
+/*********************************************
+ *	TCM API - Row indexed implementation
+ *********************************************/
+
+static s32 rowidx_reserve_2d(struct tcm *tcm, u16 h, u16 w, u8 align,
+			     struct tcm_area *area)
+{
+	struct rowidx_pvt *pvt = (struct rowidx_pvt *)tcm->pvt;
+	struct rowidx_area *elem;
+	struct tcm_area field = {0};
+	/* we only support 1, 32 and 64 as alignment */
+	u16 stride = align <= 1 ? 1 : align <= 32 ? 32 : 64;
+	s32 ret;
+
+	area->is2d = true;
+
+	/* align must be 2 power */
+	if (align & (align - 1) || align > 64)
+		return -EINVAL;
+
+	elem = kmalloc(sizeof(*elem), GFP_KERNEL);
+	if (!elem)
+		return -ENOMEM;
+
+	mutex_lock(&(pvt->mtx));
+
+	/*
+	 * Same layout as SiTA: aligned areas are placed from the top left,
+	 * unaligned areas from the top right, preferably within the
+	 * division point, and 1D areas from the bottom.
+	 */
+	if (stride > 1) {
+		assign(&field, 0, 0, pvt->div_pt.x - 1, pvt->div_pt.y - 1);
+		ret = scan_field(pvt, w, h, stride, &field, true, area);
+	} else {
+		assign(&field, pvt->div_pt.x, 0, pvt->width - 1,
+		       pvt->div_pt.y - 1);
+		ret = scan_field(pvt, w, h, stride, &field, false, area);
+	}
+
+	if (ret) {
+		/* scan the entire container if nothing found */
+		assign(&field, 0, 0, pvt->width - 1, pvt->height - 1);
+		ret = scan_field(pvt, w, h, stride, &field, stride > 1, area);
+	}
+
+	if (!ret) {
+		PA(2, "reserved 2d", area);
+		area->tcm = tcm;
+		fill_area(pvt, area, true);
+		elem->area = *area;
+		list_add_tail(&elem->list, &pvt->res);
+	} else {
+		kfree(elem);
+	}
+
+	mutex_unlock(&(pvt->mtx));
+	return ret;
+}
+
+static s32 rowidx_reserve_1d(struct tcm *tcm, u32 slots,
+			     struct tcm_area *area)
+{
+	struct rowidx_pvt *pvt = (struct rowidx_pvt *)tcm->pvt;
+	struct rowidx_area *elem;
+	s32 ret;
+
+	area->is2d = false;
+
+	elem = kmalloc(sizeof(*elem), GFP_KERNEL);
+	if (!elem)
+		return -ENOMEM;
+
+	mutex_lock(&(pvt->mtx));
+	ret = scan_one_dim(pvt, slots, area);
+	if (!ret) {
+		PA(2, "reserved 1d", area);
+		area->tcm = tcm;
+		fill_area(pvt, area, true);
+		elem->area = *area;
+		list_add_tail(&elem->list, &pvt->res);
+	} else {
+		kfree(elem);
+	}
+	mutex_unlock(&(pvt->mtx));
+	return ret;
+}
+
+static s32 rowidx_free(struct tcm *tcm, struct tcm_area *area)
+{
+	struct rowidx_pvt *pvt = (struct rowidx_pvt *)tcm->pvt;
+	struct rowidx_area *elem;
+	s32 ret = -ENOENT;
+
+	mutex_lock(&(pvt->mtx));
+	list_for_each_entry(elem, &pvt->res, list) {
+		if (elem->area.p0.x == area->p0.x &&
+		    elem->area.p0.y == area->p0.y &&
+		    elem->area.p1.x == area->p1.x &&
+		    elem->area.p1.y == area->p1.y) {
+			fill_area(pvt, &elem->area, false);
+			list_del(&elem->list);
+			kfree(elem);
+			ret = 0;
+			break;
+		}
+	}
+	mutex_unlock(&(pvt->mtx));
+	return ret;
+}
+
+static s32 rowidx_get_parent(struct tcm *tcm, struct tcm_pt *pt,
+			     struct tcm_area *parent)
+{
+	struct rowidx_pvt *pvt = (struct rowidx_pvt *)tcm->pvt;
+	struct rowidx_area *elem;
+	s32 res = -ENOENT;
+
+	mutex_lock(&(pvt->mtx));
+	if (test_bit(pt->x + pt->y * pvt->width, pvt->map)) {
+		list_for_each_entry(elem, &pvt->res, list) {
+			if (__tcm_is_in(pt, &elem->area)) {
+				*parent = elem->area;
+				res = 0;
+				break;
+			}
+		}
+	}
+	if (res)
+		memset(parent, 0, sizeof(*parent));
+	mutex_unlock(&(pvt->mtx));
+
+	return res;
+}
+
+static void rowidx_deinit(struct tcm *tcm)
+{
+	struct rowidx_pvt *pvt = (struct rowidx_pvt *)tcm->pvt;
+	struct rowidx_area *elem, *elem_;
+
+	if (pvt) {
+		list_for_each_entry_safe(elem, elem_, &pvt->res, list) {
+			list_del(&elem->list);
+			kfree(elem);
+		}
+		mutex_destroy(&(pvt->mtx));
+		kfree(pvt->map);
+		kfree(pvt->max_run);
+		kfree(pvt->mask);
+		kfree(pvt);
+	}
+	kfree(tcm);
+}
+
+struct tcm *rowidx_init(u16 width, u16 height, struct tcm_pt *attr)
+{
+	struct tcm *tcm = NULL;
+	struct rowidx_pvt *pvt = NULL;
+
+	/* rows must start on a word boundary */
+	if (width == 0 || height == 0 || width % BITS_PER_LONG)
+		return NULL;
+
+	tcm = kzalloc(sizeof(*tcm), GFP_KERNEL);
+	pvt = kzalloc(sizeof(*pvt), GFP_KERNEL);
+	if (!tcm || !pvt)
+		goto error;
+
+	pvt->width = width;
+	pvt->height = height;
+	pvt->words = BITS_TO_LONGS(width);
+	pvt->map = kzalloc(pvt->words * height * sizeof(*pvt->map),
+			   GFP_KERNEL);
+	pvt->max_run = kmalloc(height * sizeof(*pvt->max_run), GFP_KERNEL);
+	pvt->mask = kmalloc(pvt->words * sizeof(*pvt->mask), GFP_KERNEL);
+	if (!pvt->map || !pvt->max_run || !pvt->mask)
+		goto error;
+
+	INIT_LIST_HEAD(&pvt->res);
+	mutex_init(&(pvt->mtx));
+	update_max_run(pvt, 0, height - 1);
+
+	if (attr && attr->x <= width && attr->y <= height) {
+		pvt->div_pt.x = attr->x;
+		pvt->div_pt.y = attr->y;
+	} else {
+		/* Defaulting to 3:1 ratio on width for 2D area split */
+		/* Defaulting to 3:1 ratio on height for 2D and 1D split */
+		pvt->div_pt.x = (width * 3) / 4;
+		pvt->div_pt.y = (height * 3) / 4;
+	}
+
+	/* Updating the pointers to the row indexed implementation APIs */
+	tcm->height = height;
+	tcm->width = width;
+	tcm->reserve_2d = rowidx_reserve_2d;
+	tcm->reserve_1d = rowidx_reserve_1d;
+	tcm->get_parent = rowidx_get_parent;
+	tcm->free = rowidx_free;
+	tcm->deinit = rowidx_deinit;
+	tcm->pvt = (void *)pvt;
+	return tcm;
+
+error:
+	if (pvt) {
+		kfree(pvt->map);
+		kfree(pvt->max_run);
+		kfree(pvt->mask);
+	}
+	kfree(tcm);
+	kfree(pvt);
+	return NULL;
+}
+EXPORT_SYMBOL(rowidx_init);
@@ -0,0 +1,41 @@
+/*
+ * tcm_rowidx.h
+ *
+ * Row indexed tiler container manager interface.
+ *
+ * Copyright (C) 2009-2010 Texas Instruments, Inc.
+ *
+ * This package is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef TCM_ROWIDX_H_
+#define TCM_ROWIDX_H_
+
+#include "tcm.h"
+
+/**
+ * Create a row indexed tiler container manager.
+ *
+ * This uses the same container layout as SiTA, but finds free space
+ * using per-row free-run indexes and word-wide bitmap operations
+ * instead of testing each slot.
+ *
+ * @param width  Container width (must be a multiple of BITS_PER_LONG)
+ * @param height Container height
+ * @param attr   preferred division point between 64-aligned
+ *  		 allocation (top left), 32-aligned allocations
+ *  		 (top right), and page mode allocations (bottom)
+ *
+ * @return TCM instance
+ */
+struct tcm *rowidx_init(u16 width, u16 height, struct tcm_pt *attr);
+
+TCM_INIT(rowidx_init, struct tcm_pt);
+
+#endif /* TCM_ROWIDX_H_ */
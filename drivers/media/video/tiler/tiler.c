@@ -31,12 +31,18 @@
 #include <linux/dma-mapping.h>
 #include <linux/pagemap.h>         /* page_cache_release() */
 #include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/bitmap.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
 
 #include <mach/tiler.h>
 #include <mach/dmm.h>
 #include "../dmm/tmm.h"
 #include "tiler_def.h"
 #include "tcm/tcm_sita.h"	/* Algo Specific header */
+#include "tcm/tcm_rowidx.h"
 
 #include <linux/syscalls.h>
 
@@ -65,6 +71,7 @@ struct process_info {
 	u32 refs;			/* open tiler devices, 0 for processes
 					   tracked via kernel APIs */
 	bool kernel;			/* tracking kernel objects */
+	struct mutex mtx;		/* protects bufs */
 };
 
 /* per group info (within a process) */
@@ -73,6 +80,7 @@ struct gid_info {
 	struct list_head areas;		/* all areas in this pid/gid */
 	struct list_head reserved;	/* areas pre-reserved */
 	struct list_head onedim;	/* all 1D areas in this pid/gid */
+	struct list_head cached;	/* freed blocks kept for recycling */
 	u32 gid;			/* group ID */
 	struct process_info *pi;	/* parent */
 };
@@ -81,6 +89,8 @@ static struct list_head blocks;
 static struct list_head procs;
 static struct list_head orphan_areas;
 static struct list_head orphan_onedim;
+static struct list_head exports;
+static u32 export_handle;
 
 struct area_info {
 	struct list_head by_gid;	/* areas in this pid/gid */
@@ -89,6 +99,17 @@ struct area_info {
 
 	struct tcm_area area;		/* area details */
 	struct gid_info *gi;		/* link to parent, if still alive */
+	bool moving;			/* being moved by compaction */
+	u32 pass;			/* last compaction pass that tried it */
+};
+
+/* a page set exported by another driver (see tiler_export_pa) */
+struct pa_export {
+	struct list_head list;		/* exports */
+	struct tiler_pa_info *pa;
+	u32 handle;
+	pid_t pid;			/* process that may map it, 0 if none */
+	u32 refs;			/* the export and the blocks mapping it */
 };
 
 struct mem_info {
@@ -96,11 +117,20 @@ struct mem_info {
 	u32 sys_addr;          /* system space (L3) tiler addr */
 	u32 num_pg;            /* number of pages in page-list */
 	u32 usr;               /* user space address */
-	u32 *pg_ptr;           /* list of mapped struct page pointers */
+	struct page **pg_ptr;  /* list of pinned user pages */
+	struct pa_export *pa;  /* exported pages mapped by this block */
 	struct tcm_area area;
 	u32 *mem;              /* list of alloced phys addresses */
 	u32 refs;              /* number of times referenced */
 	bool alloced;			/* still alloced */
+	bool mapped;			/* mem is published and in the PAT */
+
+	/* allocation parameters (recycle cache key) */
+	enum tiler_fmt fmt;
+	u32 width, height;
+	u16 align, offs;
+	bool in_cache;			/* in recycle cache */
+	unsigned long cached;		/* jiffies when put in recycle cache */
 
 	struct list_head by_area;	/* blocks in the same area / 1D */
 	void *parent;			/* area info for 2D, else group info */
@@ -119,12 +149,61 @@ static s32 tiler_minor;
 static struct tiler_dev *tiler_device;
 static struct class *tilerdev_class;
 static u32 id;
-static struct mutex mtx;
 static struct tcm *tcm[TILER_FORMATS];
 static struct tmm *tmm[TILER_FORMATS];
 static u32 *dmac_va;
 static dma_addr_t dmac_pa;
 
+/*
+ * Locking
+ *
+ * mtx protects the bookkeeping of the container: the process, group, area
+ * and block lists, block references and the recycle cache.  It is held only
+ * to update these.  Slots are reserved and freed under the container
+ * manager's own lock, and pages are allocated and freed and the PAT is
+ * programmed outside of mtx: _m_free() unlinks blocks and queues them on
+ * the zombies list, and unlock_and_release() releases them after dropping
+ * mtx.  Compaction holds the area it moves and drops mtx to program the PAT.
+ *
+ * pi->mtx protects the registered buffers of a process, and nests outside
+ * of mtx.  Groups are changed along with their areas and blocks, so they
+ * are protected by mtx.
+ *
+ * compact_mtx serialises compaction, and nests outside of mtx.
+ *
+ * dmac_mtx protects dmac_va, and nests inside of mtx.
+ */
+static struct mutex mtx;
+static struct mutex dmac_mtx;
+static struct list_head zombies;	/* unlinked blocks to release */
+
+/* lock contention statistics, see debugfs tiler/locks */
+struct tiler_lock_stat {
+	atomic_t acquired;
+	atomic_t contended;
+	atomic64_t wait_ns;		/* time spent waiting for the lock */
+};
+
+static struct tiler_lock_stat mtx_stat, pi_mtx_stat, dmac_mtx_stat;
+
+static void mutex_lock_stat(struct mutex *m, struct tiler_lock_stat *st)
+{
+	u64 t;
+
+	if (!mutex_trylock(m)) {
+		t = sched_clock();
+		mutex_lock(m);
+		atomic_inc(&st->contended);
+		atomic64_add(sched_clock() - t, &st->wait_ns);
+	}
+	atomic_inc(&st->acquired);
+}
+
+/* an area is programmed in at most 3 slices */
+#define TILER_MAX_SLICES 3
+/* page list entries, with room for aligning each slice */
+#define DMAC_SIZE (TILER_WIDTH * TILER_HEIGHT + 4 * TILER_MAX_SLICES)
+
 static u32 *dummy_mem;
 static u32 dummy_pa;
 
@@ -284,7 +363,7 @@ static void print_allocation_map(bool color)
 	}
 
 	/* get all allocations */
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
 
 	list_for_each_entry(mi, &blocks, global) {
 		if (mi->area.is2d) {
@@ -335,6 +414,67 @@ error:
 	kfree(nice);
 }
 
+/* container fragmentation */
+struct tiler_frag {
+	u32 free;			/* free slots */
+	u32 run;			/* longest free 1D run */
+	u16 rect_w, rect_h;		/* largest free rectangle */
+	u32 areas, idle;		/* 2D areas, and those that can move */
+	u32 onedim;			/* 1D blocks */
+};
+
+/* mark the slots of an area as busy in an occupancy map */
+static void fill_busy(unsigned long *busy, struct tcm_area *a)
+{
+	u16 y;
+
+	if (!a->is2d) {
+		bitmap_set(busy, a->p0.y * TILER_WIDTH + a->p0.x,
+			   tcm_sizeof(*a));
+		return;
+	}
+	for (y = a->p0.y; y <= a->p1.y; y++)
+		bitmap_set(busy, y * TILER_WIDTH + a->p0.x, tcm_awidth(*a));
+}
+
+/**
+ * Find the free space of an occupancy map: the number of free slots, the
+ * longest free 1D run, and the largest free rectangle.  The rectangle is
+ * found a row at a time from the height of free slots above each column,
+ * using a stack of columns with increasing heights.
+ */
+static void get_frag(unsigned long *busy, u16 *hist, u16 *stack,
+		     struct tiler_frag *f)
+{
+	u32 x, y, run = 0, n, h, w;
+
+	memset(hist, 0, (TILER_WIDTH + 1) * sizeof(*hist));
+	for (y = 0; y < TILER_HEIGHT; y++) {
+		for (x = 0; x < TILER_WIDTH; x++) {
+			if (test_bit(y * TILER_WIDTH + x, busy)) {
+				hist[x] = run = 0;
+				continue;
+			}
+			hist[x]++;
+			f->free++;
+			if (++run > f->run)
+				f->run = run;
+		}
+
+		/* hist[TILER_WIDTH] is always 0, and empties the stack */
+		for (x = n = 0; x <= TILER_WIDTH; stack[n++] = x++) {
+			while (n && hist[stack[n - 1]] >= hist[x]) {
+				h = hist[stack[--n]];
+				w = n ? x - stack[n - 1] - 1 : x;
+				if (w * h > f->rect_w * f->rect_h) {
+					f->rect_w = w;
+					f->rect_h = h;
+				}
+			}
+		}
+	}
+}
+
 static uint tiler_alloc_debug;
 static int tiler_alloc_debug_set(const char *val, struct kernel_param *kp)
 {
@@ -349,13 +489,39 @@ static int tiler_alloc_debug_set(const char *val, struct kernel_param *kp)
 module_param_call(alloc_debug, tiler_alloc_debug_set, param_get_uint,
 					&tiler_alloc_debug, 0644);
 
+/*
+ * Recycle cache: freed blocks allocated by the tiler are kept reserved and
+ * mapped in their group for up to cache_ms, so that an allocation with the
+ * same format, size and alignment can reuse them without touching the
+ * container or the PAT.
+ */
+static uint cache_ms = 1000;
+module_param(cache_ms, uint, 0644);
+MODULE_PARM_DESC(cache_ms, "Time to keep freed blocks for recycling (ms)");
+
+static uint cache_max_pages = 4096;
+module_param(cache_max_pages, uint, 0644);
+MODULE_PARM_DESC(cache_max_pages, "Max number of pages in recycled blocks");
+
+static u32 cache_pages;		/* pages in cached blocks */
+static u32 cache_hits, cache_misses;
+module_param(cache_hits, uint, 0444);
+module_param(cache_misses, uint, 0444);
+
+static struct delayed_work cache_work;
+static struct work_struct release_work;	/* releases blocks for reclaim */
+
+static char *tcm_alg = "sita";
+module_param(tcm_alg, charp, 0444);
+MODULE_PARM_DESC(tcm_alg, "Container manager algorithm (sita or rowidx)");
+
 /* get process info, and increment refs for device tracking */
 static struct process_info *__get_pi(pid_t pid, bool kernel)
 {
 	struct process_info *pi;
 
 	/* find process context */
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
 	list_for_each_entry(pi, &procs, list) {
 		if (pi->pid == pid && pi->kernel == kernel)
 			goto done;
@@ -369,6 +535,7 @@ static struct process_info *__get_pi(pid_t pid, bool kernel)
 	memset(pi, 0, sizeof(*pi));
 	pi->pid = pid;
 	pi->kernel = kernel;
+	mutex_init(&pi->mtx);
 	INIT_LIST_HEAD(&pi->groups);
 	INIT_LIST_HEAD(&pi->bufs);
 	list_add(&pi->list, &procs);
@@ -398,7 +565,7 @@ static struct area_info *area_new(u16 width, u16 height, u16 align,
 	}
 
 	ai->gi = gi;
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
 	list_add_tail(&ai->by_gid, &gi->areas);
 	mutex_unlock(&mtx);
 	return ai;
@@ -550,7 +717,7 @@ static struct mem_info *get_2d_area(u16 w, u16 h, u16 align, u16 offs, u16 band,
 	/* allocate map info */
 
 	/* see if there is available prereserved space */
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
 	list_for_each_entry(mi, &gi->reserved, global) {
 		if (mi->area.tcm == tcm &&
 		    tcm_aheight(mi->area) == h &&
@@ -581,9 +748,9 @@ static struct mem_info *get_2d_area(u16 w, u16 h, u16 align, u16 offs, u16 band,
 
 	/* see if allocation fits in one of the existing areas */
 	/* this sets x, ai and before */
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
 	list_for_each_entry(ai, &gi->areas, by_gid) {
-		if (ai->area.tcm == tcm &&
+		if (ai->area.tcm == tcm && !ai->moving &&
 		    tcm_aheight(ai->area) == h) {
 			x = _m_blk_find_fit(w, align, offs, ai, &before);
 			if (x) {
@@ -606,7 +773,7 @@ static struct mem_info *get_2d_area(u16 w, u16 h, u16 align, u16 offs, u16 band,
 	ai = area_new(ALIGN(w + offs, max(band, align)), h,
 		      max(band, align), tcm, gi);
 	if (ai) {
-		mutex_lock(&mtx);
+		mutex_lock_stat(&mtx, &mtx_stat);
 		_m_add2area(mi, ai, ai->area.p0.x + offs,
 			     ai->area.p0.x + offs + w - 1,
 			     &ai->blocks);
@@ -632,12 +799,14 @@ static void _m_try_free_group(struct gid_info *gi)
 {
 	if (gi && list_empty(&gi->areas) && list_empty(&gi->onedim)) {
 		WARN_ON(!list_empty(&gi->reserved));
+		WARN_ON(!list_empty(&gi->cached));
 		list_del(&gi->by_pid);
 
 		/* if group is tracking kernel objects, we may free even
 		   the process info */
 		if (gi->pi->kernel && list_empty(&gi->pi->groups)) {
 			list_del(&gi->pi->list);
+			mutex_destroy(&gi->pi->mtx);
 			kfree(gi->pi);
 		}
 
@@ -645,48 +814,232 @@ static void _m_try_free_group(struct gid_info *gi)
 	}
 }
 
-static void clear_pat(struct tmm *tmm, struct tcm_area *area)
+/**
+ * Program the PAT for all slices of an area.  The page lists for the slices
+ * are laid out in dmac_va one after the other, and queued on the PAT refill
+ * engine as a single chain.
+ *
+ * @param tmm	Tiler memory manager
+ * @param area	Area to program
+ * @param ptr	List of page addresses for the whole area, or NULL
+ * @param pages	List of pages for the whole area, used if ptr is NULL.  If
+ *		both are NULL, the area is pointed to the dummy page.
+ */
+static s32 program_pat(struct tmm *tmm, struct tcm_area *area, u32 *ptr,
+		       struct page **pages)
 {
-	struct pat_area p_area = {0};
+	struct pat_area p_area[TILER_MAX_SLICES];
+	u32 page_pa[TILER_MAX_SLICES];
 	struct tcm_area slice, area_s;
-	int i;
+	u32 n = 0, offs = 0, cookie, i, size;
+	s32 res;
 
+	mutex_lock_stat(&dmac_mtx, &dmac_mtx_stat);
 	tcm_for_each_slice(slice, *area, area_s) {
-		p_area.x0 = slice.p0.x;
-		p_area.y0 = slice.p0.y;
-		p_area.x1 = slice.p1.x;
-		p_area.y1 = slice.p1.y;
-
-		for (i = 0; i<tcm_sizeof(slice); i++) {
-			dmac_va[i] = dummy_pa;
+		memset(p_area + n, 0, sizeof(*p_area));
+		p_area[n].x0 = slice.p0.x;
+		p_area[n].y0 = slice.p0.y;
+		p_area[n].x1 = slice.p1.x;
+		p_area[n].y1 = slice.p1.y;
+
+		/* page lists must be at 16-byte aligned physical addresses */
+		offs = ALIGN(offs, 16 / sizeof(*dmac_va));
+		size = tcm_sizeof(slice);
+		if (ptr) {
+			memcpy(dmac_va + offs, ptr, sizeof(*ptr) * size);
+			ptr += size;
+		} else if (pages) {
+			for (i = 0; i < size; i++)
+				dmac_va[offs + i] = page_to_phys(*pages++);
+		} else {
+			for (i = 0; i < size; i++)
+				dmac_va[offs + i] = dummy_pa;
 		}
+		page_pa[n++] = dmac_pa + offs * sizeof(*dmac_va);
+		offs += size;
+	}
 
-		tmm_map(tmm, p_area, dmac_pa);
+	res = tmm_map_async(tmm, n, p_area, page_pa, &cookie);
+	if (!res)
+		res = tmm_sync(tmm, cookie);
+	mutex_unlock(&dmac_mtx);
+
+	return res;
+}
+
+static void clear_pat(struct tmm *tmm, struct tcm_area *area)
+{
+	program_pat(tmm, area, NULL, NULL);
+}
+
+/* (must have mutex) get group of a block, or NULL if orphaned */
+static inline struct gid_info *_m_blk_gi(struct mem_info *mi)
+{
+	if (mi->area.is2d)
+		return mi->parent ? ((struct area_info *) mi->parent)->gi :
+									NULL;
+	return mi->parent;
+}
+
+/* (must have mutex) keep an unreferenced block in its group's recycle
+   cache, returns true if the block was cached */
+static bool _m_cache_put(struct mem_info *mi)
+{
+	struct gid_info *gi = _m_blk_gi(mi);
+
+	/* only cache tiler allocated blocks of live groups */
+	if (!cache_ms || !mi->mem || !gi || !(gi->pi->refs || gi->pi->kernel))
+		return false;
+
+	if (mi->in_cache)
+		return true;
+
+	if (cache_pages + mi->num_pg > cache_max_pages)
+		return false;
+
+	mi->in_cache = true;
+	mi->cached = jiffies;
+	list_move(&mi->global, &gi->cached);
+	cache_pages += mi->num_pg;
+	schedule_delayed_work(&cache_work, msecs_to_jiffies(cache_ms));
+	return true;
+}
+
+/* (must have mutex) reuse a cached block matching the allocation */
+static struct mem_info *_m_cache_get(struct gid_info *gi, enum tiler_fmt fmt,
+				     u32 width, u32 height, u16 align, u16 offs)
+{
+	struct mem_info *mi;
+
+	list_for_each_entry(mi, &gi->cached, global) {
+		if (mi->fmt == fmt && mi->width == width &&
+		    mi->height == height && mi->align == align &&
+		    mi->offs == offs) {
+			list_move(&mi->global, &blocks);
+			cache_pages -= mi->num_pg;
+			mi->in_cache = false;
+			mi->alloced = true;
+			mi->refs++;
+			cache_hits++;
+			return mi;
+		}
 	}
+	cache_misses++;
+	return NULL;
 }
 
-/* (must have mutex) free block and any freed areas */
-static s32 _m_free(struct mem_info *mi)
+/*
+ * (must have mutex) take all blocks of a group out of the recycle cache.
+ * They keep no references, so they are freed along with the group.
+ */
+static void _m_cache_flush(struct gid_info *gi)
 {
-	struct area_info *ai = NULL;
-	struct page *page = NULL;
-	s32 res = 0;
-	u32 i;
+	struct mem_info *mi, *mi_;
 
-	/* release memory */
-	if (mi->pg_ptr) {
-		for (i = 0; i < mi->num_pg; i++) {
-			page = (struct page *)mi->pg_ptr[i];
-			if (page) {
-				if (!PageReserved(page))
-					SetPageDirty(page);
-				page_cache_release(page);
+	list_for_each_entry_safe(mi, mi_, &gi->cached, global) {
+		list_move(&mi->global, &blocks);
+		cache_pages -= mi->num_pg;
+		mi->in_cache = false;
+	}
+}
+
+static void _m_free(struct mem_info *mi);
+static void unlock_and_release(void);
+
+/**
+ * Release cached blocks.
+ *
+ * @param pages	Number of pages to release, or 0 to release all
+ *		blocks that have been cached for longer than cache_ms.
+ *
+ * @return number of pages released
+ *
+ * (must have mutex)
+ */
+static u32 _m_cache_release(u32 pages)
+{
+	struct process_info *pi, *pi_;
+	struct gid_info *gi, *gi_;
+	struct mem_info *mi, *mi_;
+	unsigned long expiry = msecs_to_jiffies(cache_ms);
+	u32 released = 0;
+
+	/* freeing the last block may free the group and process */
+	list_for_each_entry_safe(pi, pi_, &procs, list) {
+		list_for_each_entry_safe(gi, gi_, &pi->groups, by_pid) {
+			/* blocks are cached most recent first */
+			list_for_each_entry_safe_reverse(mi, mi_, &gi->cached,
+								global) {
+				if (pages ? released >= pages :
+				    time_before(jiffies, mi->cached + expiry))
+					break;
+				released += mi->num_pg;
+				_m_free(mi);
 			}
+			if (pages && released >= pages)
+				return released;
 		}
-		kfree(mi->pg_ptr);
-	} else if (mi->mem) {
-		tmm_free(TMM_SS(mi->sys_addr), mi->mem);
 	}
+	return released;
+}
+
+static void cache_expire(struct work_struct *work)
+{
+	mutex_lock_stat(&mtx, &mtx_stat);
+	_m_cache_release(0);
+	if (cache_pages)
+		schedule_delayed_work(&cache_work, msecs_to_jiffies(cache_ms));
+	unlock_and_release();
+}
+
+static int cache_shrink(struct shrinker *shrinker, int nr_to_scan,
+								gfp_t gfp_mask)
+{
+	int left;
+
+	/* we may be reclaiming on behalf of a tiler allocation */
+	if (!mutex_trylock(&mtx))
+		return nr_to_scan ? -1 : 0;
+
+	if (nr_to_scan)
+		_m_cache_release(nr_to_scan);
+	left = cache_pages;
+	mutex_unlock(&mtx);
+
+	/*
+	 * releasing a block takes the PAT and page pool locks, which the
+	 * allocation we are reclaiming for may hold, so leave it to a worker
+	 */
+	if (nr_to_scan)
+		schedule_work(&release_work);
+
+	return left;
+}
+
+static void release_zombies(struct work_struct *work)
+{
+	mutex_lock_stat(&mtx, &mtx_stat);
+	unlock_and_release();
+}
+
+static struct shrinker cache_shrinker = {
+	.shrink = cache_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+/**
+ * Free a block and any freed area: unlink them, and queue them to be
+ * released by unlock_and_release().  Their container slots stay reserved
+ * until then.
+ *
+ * (must have mutex)
+ */
+static void _m_free(struct mem_info *mi)
+{
+	struct area_info *ai = NULL;
+
+	if (mi->in_cache)
+		cache_pages -= mi->num_pg;
 
 	/* safe deletion as list may not have been assigned */
 	if (mi->global.next)
@@ -706,34 +1059,92 @@ static s32 _m_free(struct mem_info *mi)
 					mi->area.p0.y, mi->area.p1.y,
 					ai->area.p0.x, ai->area.p1.x,
 					ai->area.p0.y, ai->area.p1.y);
-			clear_pat(TMM_SS(mi->sys_addr), &ai->area);
-			res = tcm_free(&ai->area);
 			list_del(&ai->by_gid);
 			/* try to remove parent if it became empty */
 			_m_try_free_group(ai->gi);
-			kfree(ai);
-			ai = NULL;
-		} else if (tiler_alloc_debug & 1)
-			printk(KERN_ERR "(-2d (%d-%d,%d-%d) in (%d-%d,%d-%d) remaining)\n",
-				mi->area.p0.x, mi->area.p1.x,
-				mi->area.p0.y, mi->area.p1.y,
-				ai->area.p0.x, ai->area.p1.x,
-				ai->area.p0.y, ai->area.p1.y);
-
+			ai->gi = NULL;
+		} else {
+			if (tiler_alloc_debug & 1)
+				printk(KERN_ERR "(-2d (%d-%d,%d-%d) in (%d-%d,%d-%d) remaining)\n",
+					mi->area.p0.x, mi->area.p1.x,
+					mi->area.p0.y, mi->area.p1.y,
+					ai->area.p0.x, ai->area.p1.x,
+					ai->area.p0.y, ai->area.p1.y);
+			/* the area stays with its other blocks */
+			mi->parent = NULL;
+		}
 	} else {
 		if (tiler_alloc_debug & 1)
 			printk(KERN_ERR "(-1d: %d,%d..%d,%d)\n",
 				mi->area.p0.x, mi->area.p0.y,
 				mi->area.p1.x, mi->area.p1.y);
-		/* remove 1D area */
-		clear_pat(TMM_SS(mi->sys_addr), &mi->area);
-		res = tcm_free(&mi->area);
 		/* try to remove parent if it became empty */
 		_m_try_free_group(mi->parent);
+		mi->parent = NULL;
 	}
 
+	/* the exporter is only called back for its last reference */
+	if (mi->pa && --mi->pa->refs)
+		mi->pa = NULL;
+
+	list_add_tail(&mi->global, &zombies);
+}
+
+/* hand exported pages back to their owner once unused */
+static void release_export(struct pa_export *e)
+{
+	e->pa->release(e->pa);
+	kfree(e);
+}
+
+/* release the memory and the container slots of an unlinked block */
+static void release_block(struct mem_info *mi)
+{
+	struct area_info *ai = mi->area.is2d ? mi->parent : NULL;
+	struct tmm *tmm = TMM_SS(mi->sys_addr);
+	struct tcm_area *area = ai ? &ai->area : &mi->area;
+	struct page *page = NULL;
+	u32 i;
+
+	/* unmap freed areas before releasing their memory */
+	if (ai || !mi->area.is2d)
+		clear_pat(tmm, area);
+
+	/* release memory */
+	if (mi->pg_ptr) {
+		for (i = 0; i < mi->num_pg; i++) {
+			page = mi->pg_ptr[i];
+			if (page) {
+				if (!PageReserved(page))
+					SetPageDirty(page);
+				page_cache_release(page);
+			}
+		}
+		kfree(mi->pg_ptr);
+	} else if (mi->mem) {
+		tmm_free(tmm, mi->mem);
+	} else if (mi->pa) {
+		release_export(mi->pa);
+	}
+
+	if ((ai || !mi->area.is2d) && tcm_free(area))
+		printk(KERN_ERR "error while removing tiler block\n");
+
+	kfree(ai);
 	kfree(mi);
-	return res;
+}
+
+/* drop mtx, then release the blocks freed under it */
+static void unlock_and_release(void)
+{
+	struct mem_info *mi, *mi_;
+	LIST_HEAD(list);
+
+	list_splice_init(&zombies, &list);
+	mutex_unlock(&mtx);
+
+	list_for_each_entry_safe(mi, mi_, &list, global)
+		release_block(mi);
 }
 
 /* (must have mutex) returns true if block was freed */
@@ -743,8 +1154,8 @@ static bool _m_chk_ref(struct mem_info *mi)
 	if (mi->refs)
 		return 0;
 
-	if (_m_free(mi))
-		printk(KERN_ERR "error while removing tiler block\n");
+	if (!_m_cache_put(mi))
+		_m_free(mi);
 
 	return 1;
 }
@@ -784,7 +1195,8 @@ static s32 register_buf(struct __buf_info *_b, struct process_info *pi)
 	if (num > TILER_MAX_NUM_BLOCKS)
 		return -EINVAL;
 
-	mutex_lock(&mtx);
+	mutex_lock_stat(&pi->mtx, &pi_mtx_stat);
+	mutex_lock_stat(&mtx, &mtx_stat);
 
 	/* find each block */
 	list_for_each_entry(mi, &blocks, global) {
@@ -813,11 +1225,12 @@ static s32 register_buf(struct __buf_info *_b, struct process_info *pi)
 	}
 
 	mutex_unlock(&mtx);
+	mutex_unlock(&pi->mtx);
 
 	return remain ? -EACCES : 0;
 }
 
-/* must have mutex */
+/* must have mutex, and pi->mtx of the owner if it has the device open */
 static void _m_unregister_buf(struct __buf_info *_b)
 {
 	u32 i;
@@ -846,7 +1259,8 @@ static int tiler_notify_event(int event, void *data)
  * orphaned lists to avoid issues if a new process is created
  * with the same pid.
  *
- * (must have mutex)
+ * (must have mutex; pi->mtx is not needed as the process no longer
+ * has the device open)
  */
 static void _m_free_process_info(struct process_info *pi)
 {
@@ -865,6 +1279,10 @@ static void _m_free_process_info(struct process_info *pi)
 
 	WARN_ON(!list_empty(&pi->bufs));
 
+	/* cached blocks must not outlive the process */
+	list_for_each_entry(gi, &pi->groups, by_pid)
+		_m_cache_flush(gi);
+
 	/* free all allocated blocks, and remove unreferenced ones */
 	list_for_each_entry_safe(gi, gi_, &pi->groups, by_pid) {
 
@@ -907,6 +1325,7 @@ static void _m_free_process_info(struct process_info *pi)
 
 	WARN_ON(!list_empty(&pi->groups));
 	list_del(&pi->list);
+	mutex_destroy(&pi->mtx);
 	kfree(pi);
 }
 
@@ -990,17 +1409,405 @@ static struct gid_info *_m_get_gi(struct process_info *pi, u32 gid)
 	INIT_LIST_HEAD(&gi->areas);
 	INIT_LIST_HEAD(&gi->onedim);
 	INIT_LIST_HEAD(&gi->reserved);
+	INIT_LIST_HEAD(&gi->cached);
 	gi->pi = pi;
 	gi->gid = gid;
 	list_add(&gi->by_pid, &pi->groups);
 	return gi;
 }
 
+/*
+ * Compaction: the PAT maps container slots to physical pages, so a block can
+ * be moved in the container by reprogramming the PAT without copying its
+ * contents.  When a 2D allocation fails, or when requested via debugfs, idle
+ * 2D areas are moved up in the container (2D areas are packed from the top)
+ * to consolidate the free space.
+ */
+static bool compact_live;
+module_param(compact_live, bool, 0644);
+MODULE_PARM_DESC(compact_live, "Also move allocated kernel blocks that are "
+		 "not in a registered buffer (holders are notified)");
+
+static u32 compact_runs, compact_moved, compact_slots, compact_rescued;
+static u32 compact_pass;		/* areas are tried once per pass */
+static struct mutex compact_mtx;	/* one compaction at a time */
+
+/*
+ * (must have mutex) returns true if no-one relies on the block's address,
+ * not counting the held references taken by _m_area_hold()
+ */
+static bool _m_blk_idle(struct mem_info *mi, u32 held)
+{
+	struct gid_info *gi = _m_blk_gi(mi);
+	u32 refs = mi->refs - held;
+
+	/* we can only remap blocks whose page list we keep, and only once
+	   their allocation has published it and programmed the PAT */
+	if (!mi->mem || !mi->mapped)
+		return false;
+
+	/* unreferenced blocks (see _m_chk_ref) are in the recycle cache */
+	if (!refs)
+		return true;
+
+	/* blocks that are only referenced by their allocation; only kernel
+	   users can follow the move via the notifier */
+	return compact_live && mi->alloced && refs == 1 && gi &&
+							gi->pi->kernel;
+}
+
+/* (must have mutex) */
+static bool _m_area_idle(struct area_info *ai, u32 held)
+{
+	struct mem_info *mi;
+
+	if (list_empty(&ai->blocks))
+		return false;
+
+	list_for_each_entry(mi, &ai->blocks, by_area)
+		if (!_m_blk_idle(mi, held))
+			return false;
+	return true;
+}
+
+/*
+ * (must have mutex) keep the blocks of an area from being reused, freed or
+ * joined by new blocks while it is moved
+ */
+static void _m_area_hold(struct area_info *ai)
+{
+	struct mem_info *mi;
+
+	ai->moving = true;
+	list_for_each_entry(mi, &ai->blocks, by_area) {
+		if (mi->in_cache) {
+			list_move(&mi->global, &blocks);
+			cache_pages -= mi->num_pg;
+			mi->in_cache = false;
+		}
+		mi->refs++;
+	}
+}
+
+/* (must have mutex) drop the references taken by _m_area_hold() */
+static void _m_area_unhold(struct area_info *ai)
+{
+	struct mem_info *mi, *mi_;
+
+	ai->moving = false;
+	list_for_each_entry_safe(mi, mi_, &ai->blocks, by_area)
+		_m_dec_ref(mi);
+}
+
+/**
+ * Move an idle area up in the container.  Its blocks are mapped at the new
+ * position before their holders are notified, and the old position is only
+ * cleared afterwards, so both addresses are valid during the notification.
+ * The PAT is programmed and the holders are notified without mtx, so that
+ * they can call back into the tiler, with the area held meanwhile.  It is
+ * only moved if it is still idle once the new position is mapped.
+ *
+ * @return true if the area was moved
+ *
+ * (must have mutex, which is dropped and retaken)
+ */
+static bool _m_area_move(struct area_info *ai)
+{
+	struct tcm_area old = ai->area, area, a;
+	struct tiler_block_move *moves;
+	struct tmm *tmm = NULL;
+	struct mem_info *mi;
+	u16 x, y, band, b_align, b_offs, align = 1;
+	s32 dx, dy;
+	u32 i, n = 0;
+	bool moved = false;
+
+	/* blocks stay aligned if they move by a multiple of their band */
+	list_for_each_entry(mi, &ai->blocks, by_area) {
+		b_align = b_offs = 0;
+		if (!__analize_area(TILER_GET_ACC_MODE(mi->sys_addr), 1, 1,
+				    &x, &y, &band, &b_align, &b_offs))
+			align = max(align, band);
+		tmm = TMM_SS(mi->sys_addr);
+		n++;
+	}
+
+	/* the moves are sent once mtx is released */
+	moves = kmalloc(n * sizeof(*moves), GFP_KERNEL);
+	if (!moves)
+		return false;
+
+	if (tcm_reserve_2d(old.tcm, tcm_awidth(old), tcm_aheight(old), align,
+			   &area)) {
+		kfree(moves);
+		return false;
+	}
+
+	dx = area.p0.x - old.p0.x;
+	dy = area.p0.y - old.p0.y;
+	if (dy >= 0 || (dx & (align - 1))) {
+		tcm_free(&area);
+		kfree(moves);
+		return false;
+	}
+
+	_m_area_hold(ai);
+	mutex_unlock(&mtx);
+
+	/* map the blocks at their new position */
+	list_for_each_entry(mi, &ai->blocks, by_area) {
+		a = mi->area;
+		a.p0.x += dx;
+		a.p1.x += dx;
+		a.p0.y += dy;
+		a.p1.y += dy;
+		if (program_pat(tmm, &a, mi->mem, NULL))
+			goto unmap;
+	}
+
+	mutex_lock_stat(&mtx, &mtx_stat);
+
+	/* someone may have started using a block meanwhile */
+	if (!_m_area_idle(ai, 1)) {
+		mutex_unlock(&mtx);
+		goto unmap;
+	}
+
+	ai->area = area;
+	n = 0;
+	list_for_each_entry(mi, &ai->blocks, by_area) {
+		mi->area.p0.x += dx;
+		mi->area.p1.x += dx;
+		mi->area.p0.y += dy;
+		mi->area.p1.y += dy;
+		moves[n].pid = ai->gi ? ai->gi->pi->pid : 0;
+		moves[n].gid = ai->gi ? ai->gi->gid : 0;
+		moves[n].old_ssptr = mi->sys_addr;
+		mi->sys_addr = __get_alias_addr(TILER_GET_ACC_MODE(mi->sys_addr),
+						mi->area.p0.x, mi->area.p0.y);
+		moves[n].new_ssptr = mi->sys_addr;
+		if (mi->refs > 1)
+			n++;
+		compact_slots += tcm_sizeof(mi->area);
+	}
+
+	if (tiler_alloc_debug & 1)
+		printk(KERN_ERR "(>2d (%d-%d,%d-%d) to (%d-%d,%d-%d))\n",
+			old.p0.x, old.p1.x, old.p0.y, old.p1.y,
+			area.p0.x, area.p1.x, area.p0.y, area.p1.y);
+
+	compact_moved++;
+	mutex_unlock(&mtx);
+
+	/* the old position stays mapped until the holders are told */
+	for (i = 0; i < n; i++)
+		tiler_notify_event(TILER_BLOCK_MOVED, &moves[i]);
+
+	/* no block refers to the old position any more */
+	area = old;
+	moved = true;
+
+unmap:
+	/* the unused position, or the blocks mapped so far */
+	clear_pat(tmm, &area);
+	tcm_free(&area);
+
+	kfree(moves);
+
+	mutex_lock_stat(&mtx, &mtx_stat);
+	_m_area_unhold(ai);
+	return moved;
+}
+
+/* (must have mutex) find an idle area that has not been tried this pass */
+static struct area_info *_m_compact_next(void)
+{
+	struct process_info *pi;
+	struct gid_info *gi;
+	struct area_info *ai;
+
+	list_for_each_entry(pi, &procs, list)
+		list_for_each_entry(gi, &pi->groups, by_pid)
+			list_for_each_entry(ai, &gi->areas, by_gid)
+				if (ai->pass != compact_pass &&
+				    _m_area_idle(ai, 0))
+					return ai;
+	return NULL;
+}
+
+/* move idle areas up, returns the number of areas moved */
+static u32 tiler_compact(void)
+{
+	struct area_info *ai;
+	u32 moved = 0, n;
+
+	mutex_lock(&compact_mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
+
+	/* every move brings an area higher, so this terminates */
+	do {
+		n = 0;
+		compact_pass++;
+		while ((ai = _m_compact_next())) {
+			ai->pass = compact_pass;
+			n += _m_area_move(ai);
+		}
+		moved += n;
+	} while (n);
+
+	compact_runs++;
+	unlock_and_release();
+	mutex_unlock(&compact_mtx);
+	return moved;
+}
+
+/* debugfs: fragmentation and lock statistics, and a trigger to compact */
+static struct dentry *dbgfs;
+
+/* (must have mutex) */
+static void _m_area_stats(unsigned long *busy, struct list_head *areas,
+			  struct list_head *onedim, struct tiler_frag *f)
+{
+	struct area_info *ai;
+	struct mem_info *mi;
+
+	list_for_each_entry(ai, areas, by_gid) {
+		fill_busy(busy, &ai->area);
+		f->areas++;
+		f->idle += _m_area_idle(ai, 0);
+	}
+	list_for_each_entry(mi, onedim, by_area) {
+		fill_busy(busy, &mi->area);
+		f->onedim++;
+	}
+}
+
+static int tiler_frag_show(struct seq_file *s, void *unused)
+{
+	struct process_info *pi;
+	struct gid_info *gi;
+	struct tiler_frag f;
+	unsigned long *busy;
+	u16 *hist;
+	u32 rect;
+
+	busy = kzalloc(BITS_TO_LONGS(TILER_WIDTH * TILER_HEIGHT) *
+						sizeof(*busy), GFP_KERNEL);
+	hist = kmalloc(2 * (TILER_WIDTH + 1) * sizeof(*hist), GFP_KERNEL);
+	if (!busy || !hist) {
+		kfree(busy);
+		kfree(hist);
+		return -ENOMEM;
+	}
+	memset(&f, 0, sizeof(f));
+
+	mutex_lock_stat(&mtx, &mtx_stat);
+	list_for_each_entry(pi, &procs, list)
+		list_for_each_entry(gi, &pi->groups, by_pid)
+			_m_area_stats(busy, &gi->areas, &gi->onedim, &f);
+	_m_area_stats(busy, &orphan_areas, &orphan_onedim, &f);
+	mutex_unlock(&mtx);
+
+	get_frag(busy, hist, hist + TILER_WIDTH + 1, &f);
+	rect = f.rect_w * f.rect_h;
+
+	seq_printf(s, "container:       %u slots, %u free\n",
+		   TILER_WIDTH * TILER_HEIGHT, f.free);
+	seq_printf(s, "largest free 2D: %ux%u (%u slots)\n", f.rect_w, f.rect_h,
+		   rect);
+	seq_printf(s, "longest free 1D: %u slots\n", f.run);
+	seq_printf(s, "fragmentation:   %u%%\n",
+		   f.free ? 100 - rect * 100 / f.free : 0);
+	seq_printf(s, "2D areas:        %u (%u idle)\n", f.areas, f.idle);
+	seq_printf(s, "1D blocks:       %u\n", f.onedim);
+	seq_printf(s, "recycle cache:   %u pages\n", cache_pages);
+	seq_printf(s, "compaction:      %u runs, %u areas (%u slots) moved, "
+		   "%u allocations rescued\n", compact_runs, compact_moved,
+		   compact_slots, compact_rescued);
+
+	kfree(busy);
+	kfree(hist);
+	return 0;
+}
+
+static int tiler_frag_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tiler_frag_show, inode->i_private);
+}
+
+static const struct file_operations tiler_frag_fops = {
+	.open		= tiler_frag_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t tiler_compact_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	tiler_compact();
+	return count;
+}
+
+static const struct file_operations tiler_compact_fops = {
+	.write		= tiler_compact_write,
+};
+
+static void show_lock_stat(struct seq_file *s, const char *name,
+			   struct tiler_lock_stat *st)
+{
+	seq_printf(s, "%-10s %10u %10u %12llu\n", name,
+		   atomic_read(&st->acquired), atomic_read(&st->contended),
+		   (unsigned long long) div_u64(atomic64_read(&st->wait_ns),
+						NSEC_PER_USEC));
+}
+
+static int tiler_locks_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "%-10s %10s %10s %12s\n", "lock", "acquired",
+		   "contended", "waited(us)");
+	show_lock_stat(s, "mtx", &mtx_stat);
+	show_lock_stat(s, "pi->mtx", &pi_mtx_stat);
+	show_lock_stat(s, "dmac_mtx", &dmac_mtx_stat);
+	return 0;
+}
+
+static int tiler_locks_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tiler_locks_show, inode->i_private);
+}
+
+static void reset_lock_stat(struct tiler_lock_stat *st)
+{
+	atomic_set(&st->acquired, 0);
+	atomic_set(&st->contended, 0);
+	atomic64_set(&st->wait_ns, 0);
+}
+
+/* writing anything resets the statistics */
+static ssize_t tiler_locks_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	reset_lock_stat(&mtx_stat);
+	reset_lock_stat(&pi_mtx_stat);
+	reset_lock_stat(&dmac_mtx_stat);
+	return count;
+}
+
+static const struct file_operations tiler_locks_fops = {
+	.open		= tiler_locks_open,
+	.read		= seq_read,
+	.write		= tiler_locks_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct mem_info *__get_area(enum tiler_fmt fmt, u32 width, u32 height,
 				   u16 align, u16 offs, struct gid_info *gi)
 {
 	u16 x, y, band;
 	struct mem_info *mi = NULL;
+	bool rescued = false;
 
 	/* calculate dimensions, band, offs and alignment in slots */
 	if (__analize_area(fmt, width, height, &x, &y, &band, &align, &offs))
@@ -1021,15 +1828,23 @@ static struct mem_info *__get_area(enum tiler_fmt fmt, u32 width, u32 height,
 			printk(KERN_ERR "(+1d: %d,%d..%d,%d)\n",
 				mi->area.p0.x, mi->area.p0.y,
 				mi->area.p1.x, mi->area.p1.y);
-		mutex_lock(&mtx);
+		mutex_lock_stat(&mtx, &mtx_stat);
 		mi->parent = gi;
 		list_add(&mi->by_area, &gi->onedim);
 	} else {
 		mi = get_2d_area(x, y, align, offs, band, gi, TCM(fmt));
+
+		/* try again after making room */
+		if (!mi && tiler_compact()) {
+			mi = get_2d_area(x, y, align, offs, band, gi,
+								TCM(fmt));
+			rescued = mi != NULL;
+		}
 		if (!mi)
 			return NULL;
 
-		mutex_lock(&mtx);
+		mutex_lock_stat(&mtx, &mtx_stat);
+		compact_rescued += rescued;
 	}
 
 	list_add(&mi->global, &blocks);
@@ -1051,13 +1866,13 @@ static s32 tiler_mmap(struct file *filp, struct vm_area_struct *vma)
 
 	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
 
-	mutex_lock(&mtx);
+	mutex_lock_stat(&pi->mtx, &pi_mtx_stat);
 	list_for_each(pos, &pi->bufs) {
 		_b = list_entry(pos, struct __buf_info, by_pid);
 		if ((vma->vm_pgoff << PAGE_SHIFT) == _b->buf_info.offset)
 			break;
 	}
-	mutex_unlock(&mtx);
+	mutex_unlock(&pi->mtx);
 	if (!_b)
 		return -ENXIO;
 
@@ -1101,37 +1916,14 @@ static s32 tiler_mmap(struct file *filp, struct vm_area_struct *vma)
 
 static s32 refill_pat(struct tmm *tmm, struct tcm_area *area, u32 *ptr)
 {
-	s32 res = 0;
-	struct pat_area p_area = {0};
-	struct tcm_area slice, area_s;
-
-	tcm_for_each_slice(slice, *area, area_s) {
-		p_area.x0 = slice.p0.x;
-		p_area.y0 = slice.p0.y;
-		p_area.x1 = slice.p1.x;
-		p_area.y1 = slice.p1.y;
-
-		memcpy(dmac_va, ptr, sizeof(*ptr) * tcm_sizeof(slice));
-		ptr += tcm_sizeof(slice);
-
-		if (tmm_map(tmm, p_area, dmac_pa)) {
-			res = -EFAULT;
-			break;
-		}
-	}
-
-	return res;
+	return program_pat(tmm, area, ptr, NULL) ? -EFAULT : 0;
 }
 
 static s32 map_block(enum tiler_fmt fmt, u32 width, u32 height, u32 gid,
 			struct process_info *pi, u32 *sys_addr, u32 usr_addr)
 {
-	u32 i = 0, tmp = -1, *mem = NULL;
-	u8 write = 0;
-	s32 res = -ENOMEM;
+	s32 res = -ENOMEM, n;
 	struct mem_info *mi = NULL;
-	struct page *page = NULL;
-	struct task_struct *curr_task = current;
 	struct mm_struct *mm = current->mm;
 	struct vm_area_struct *vma = NULL;
 	struct gid_info *gi = NULL;
@@ -1145,7 +1937,7 @@ static s32 map_block(enum tiler_fmt fmt, u32 width, u32 height, u32 gid,
 		return -EPERM;
 
 	/* get group context */
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
 	gi = _m_get_gi(pi, gid);
 	mutex_unlock(&mtx);
 
@@ -1155,7 +1947,7 @@ static s32 map_block(enum tiler_fmt fmt, u32 width, u32 height, u32 gid,
 	/* reserve area in tiler container */
 	mi = __get_area(fmt, width, height, 0, 0, gi);
 	if (!mi) {
-		mutex_lock(&mtx);
+		mutex_lock_stat(&mtx, &mtx_stat);
 		_m_try_free_group(gi);
 		mutex_unlock(&mtx);
 		return -ENOMEM;
@@ -1163,20 +1955,8 @@ static s32 map_block(enum tiler_fmt fmt, u32 width, u32 height, u32 gid,
 
 	*sys_addr = mi->sys_addr;
 	mi->usr = usr_addr;
-
-	/* allocate pages */
 	mi->num_pg = tcm_sizeof(mi->area);
 
-	mem = kmalloc(mi->num_pg * sizeof(*mem), GFP_KERNEL);
-	if (!mem)
-		goto done;
-	memset(mem, 0x0, sizeof(*mem) * mi->num_pg);
-
-	mi->pg_ptr = kmalloc(mi->num_pg * sizeof(*mi->pg_ptr), GFP_KERNEL);
-	if (!mi->pg_ptr)
-		goto done;
-	memset(mi->pg_ptr, 0x0, sizeof(*mi->pg_ptr) * mi->num_pg);
-
 	/*
 	 * Important Note: usr_addr is mapped from user
 	 * application process to current process - it must lie
@@ -1185,61 +1965,59 @@ static s32 map_block(enum tiler_fmt fmt, u32 width, u32 height, u32 gid,
 	 */
 	down_read(&mm->mmap_sem);
 	vma = find_vma(mm, mi->usr);
-	res = -EFAULT;
+	if (!vma || mi->usr < vma->vm_start) {
+		printk(KERN_ERR "Failed to get the vma region for "
+			"user buffer.\n");
+		res = -EFAULT;
+		goto fault;
+	}
 
 	/*
-	 * It is observed that under some circumstances, the user
-	 * buffer is spread across several vmas, so loop through
-	 * and check if the entire user buffer is covered.
+	 * Memory of another driver (e.g. a frame buffer or video carveout)
+	 * has no pages we could hold on to, so it could be freed while still
+	 * mapped.  Such drivers can share it via tiler_export_pa().
 	 */
-	while ((vma) && (mi->usr + width > vma->vm_end)) {
-		/* jump to the next VMA region */
-		vma = find_vma(mm, vma->vm_end + 1);
-	}
-	if (!vma) {
-		printk(KERN_ERR "Failed to get the vma region for "
-			"user buffer.\n");
+	if (vma->vm_flags & (VM_IO | VM_PFNMAP)) {
+		res = -EFAULT;
 		goto fault;
 	}
 
-	if (vma->vm_flags & (VM_WRITE | VM_MAYWRITE))
-		write = 1;
+	/* pin the whole buffer at once */
+	mi->pg_ptr = kzalloc(mi->num_pg * sizeof(*mi->pg_ptr), GFP_KERNEL);
+	if (!mi->pg_ptr)
+		goto fault;
 
-	tmp = mi->usr;
-	for (i = 0; i < mi->num_pg; i++) {
-		if (get_user_pages(curr_task, mm, tmp, 1, write, 1, &page,
-									NULL)) {
-			if (page_count(page) < 1) {
-				printk(KERN_ERR "Bad page count from"
-							"get_user_pages()\n");
-			}
-			mi->pg_ptr[i] = (u32)page;
-			mem[i] = page_to_phys(page);
-			tmp += PAGE_SIZE;
-		} else {
-			printk(KERN_ERR "get_user_pages() failed\n");
-			goto fault;
-		}
+	/*
+	 * It is observed that under some circumstances, the user
+	 * buffer is spread across several vmas.  get_user_pages
+	 * walks all of them, and fails on any memory it cannot pin.
+	 */
+	n = get_user_pages(current, mm, mi->usr, mi->num_pg,
+			   !!(vma->vm_flags & (VM_WRITE | VM_MAYWRITE)),
+			   1, mi->pg_ptr, NULL);
+	if (n != mi->num_pg) {
+		printk(KERN_ERR "get_user_pages() failed\n");
+		res = -EFAULT;
+		goto fault;
 	}
 	up_read(&mm->mmap_sem);
 
 	/* Ensure the data reaches to main memory before PAT refill */
 	wmb();
 
-	if (refill_pat(TMM(fmt), &mi->area, mem))
-		goto fault;
-
-	res = 0;
+	/* program the PAT straight from the page list */
+	res = program_pat(TMM(fmt), &mi->area, NULL, mi->pg_ptr) ?
+								-EFAULT : 0;
 	goto done;
 fault:
 	up_read(&mm->mmap_sem);
 done:
 	if (res) {
-		mutex_lock(&mtx);
+		/* this also releases the pages pinned so far */
+		mutex_lock_stat(&mtx, &mtx_stat);
 		_m_free(mi);
-		mutex_unlock(&mtx);
+		unlock_and_release();
 	}
-	kfree(mem);
 	return res;
 }
 
@@ -1259,6 +2037,126 @@ s32 tiler_map(enum tiler_fmt fmt, u32 width, u32 height, u32 *sys_addr,
 }
 EXPORT_SYMBOL(tiler_map);
 
+s32 tiler_export_pa(struct tiler_pa_info *pa, pid_t pid, u32 *handle)
+{
+	struct pa_export *e;
+
+	if (!pa || !pa->mem || !pa->release || !pa->num_pg ||
+	    pa->num_pg > TILER_WIDTH * TILER_HEIGHT)
+		return -EINVAL;
+
+	e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return -ENOMEM;
+
+	e->pa = pa;
+	e->pid = pid;
+	e->refs = 1;
+
+	mutex_lock_stat(&mtx, &mtx_stat);
+	/* 0 is never a valid handle */
+	if (!++export_handle)
+		++export_handle;
+	*handle = e->handle = export_handle;
+	list_add(&e->list, &exports);
+	mutex_unlock(&mtx);
+	return 0;
+}
+EXPORT_SYMBOL(tiler_export_pa);
+
+/* (must have mutex) find an export by handle */
+static struct pa_export *_m_find_export(u32 handle)
+{
+	struct pa_export *e;
+
+	list_for_each_entry(e, &exports, list)
+		if (e->handle == handle)
+			return e;
+	return NULL;
+}
+
+void tiler_unexport_pa(u32 handle)
+{
+	struct pa_export *e;
+
+	mutex_lock_stat(&mtx, &mtx_stat);
+	e = _m_find_export(handle);
+	if (e) {
+		list_del(&e->list);
+		if (--e->refs)
+			e = NULL;
+	}
+	mutex_unlock(&mtx);
+
+	if (e)
+		release_export(e);
+}
+EXPORT_SYMBOL(tiler_unexport_pa);
+
+/*
+ * Map exported pages into a 1D block.  The PAT is programmed straight from
+ * the exporter's address list, and the block keeps the export referenced
+ * until it is freed.  User space may only map exports made for its process.
+ */
+static s32 map_pa(u32 handle, u32 gid, struct process_info *pi, u32 *sys_addr,
+		  u32 *len, bool user)
+{
+	struct pa_export *e;
+	struct mem_info *mi;
+	struct gid_info *gi = NULL;
+	bool last;
+
+	if (!pi || !tmm_can_map(TMM(TILFMT_PAGE)))
+		return -EPERM;
+
+	/* get the export and the group context */
+	mutex_lock_stat(&mtx, &mtx_stat);
+	e = _m_find_export(handle);
+	if (e && user && e->pid != pi->pid)
+		e = NULL;
+	if (e) {
+		e->refs++;
+		gi = _m_get_gi(pi, gid);
+	}
+	mutex_unlock(&mtx);
+
+	if (!e)
+		return -ENOENT;
+
+	mi = gi ? __get_area(TILFMT_PAGE, e->pa->num_pg * PAGE_SIZE, 1, 0, 0,
+			     gi) : NULL;
+	if (!mi) {
+		mutex_lock_stat(&mtx, &mtx_stat);
+		if (gi)
+			_m_try_free_group(gi);
+		last = !--e->refs;
+		mutex_unlock(&mtx);
+		if (last)
+			release_export(e);
+		return -ENOMEM;
+	}
+
+	mi->pa = e;
+	mi->num_pg = e->pa->num_pg;
+	*sys_addr = mi->sys_addr;
+	if (len)
+		*len = mi->num_pg * PAGE_SIZE;
+
+	if (refill_pat(TMM(TILFMT_PAGE), &mi->area, e->pa->mem)) {
+		mutex_lock_stat(&mtx, &mtx_stat);
+		_m_free(mi);
+		unlock_and_release();
+		return -EFAULT;
+	}
+	return 0;
+}
+
+s32 tiler_map_pa(u32 handle, u32 gid, pid_t pid, u32 *sys_addr)
+{
+	return map_pa(handle, gid, __get_pi(pid, true), sys_addr, NULL, false);
+}
+EXPORT_SYMBOL(tiler_map_pa);
+
 static s32 free_block(u32 sys_addr, struct process_info *pi)
 {
 	struct gid_info *gi = NULL;
@@ -1266,7 +2164,7 @@ static s32 free_block(u32 sys_addr, struct process_info *pi)
 	struct mem_info *mi = NULL;
 	s32 res = -ENOENT;
 
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
 
 	/* find block in process list and free it */
 	list_for_each_entry(gi, &pi->groups, by_pid) {
@@ -1293,7 +2191,7 @@ static s32 free_block(u32 sys_addr, struct process_info *pi)
 	}
 
 done:
-	mutex_unlock(&mtx);
+	unlock_and_release();
 
 	/* for debugging, we can set the PAT entries to DMM_LISA_MAP__0 */
 	return res;
@@ -1304,7 +2202,7 @@ s32 tiler_free(u32 sys_addr)
 	struct mem_info *mi;
 	s32 res = -ENOENT;
 
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
 
 	/* find block in global list and free it */
 	list_for_each_entry(mi, &blocks, global) {
@@ -1314,7 +2212,7 @@ s32 tiler_free(u32 sys_addr)
 			break;
 		}
 	}
-	mutex_unlock(&mtx);
+	unlock_and_release();
 
 	/* for debugging, we can set the PAT entries to DMM_LISA_MAP__0 */
 	return res;
@@ -1458,6 +2356,21 @@ static s32 tiler_ioctl(struct inode *ip, struct file *filp, u32 cmd,
 				&block_info.ssptr, (u32)block_info.ptr))
 			return -ENOMEM;
 
+		if (copy_to_user((void __user *)arg, &block_info,
+					sizeof(block_info)))
+			return -EFAULT;
+		break;
+	case TILIOC_PABUF:
+		if (copy_from_user(&block_info, (void __user *)arg,
+					sizeof(block_info)))
+			return -EFAULT;
+
+		r = map_pa((u32)block_info.ptr, 0, pi, &block_info.ssptr,
+			   &block_info.dim.len, true);
+		if (r)
+			return r;
+
+		block_info.fmt = TILFMT_PAGE;
 		if (copy_to_user((void __user *)arg, &block_info,
 					sizeof(block_info)))
 			return -EFAULT;
@@ -1467,21 +2380,21 @@ static s32 tiler_ioctl(struct inode *ip, struct file *filp, u32 cmd,
 					sizeof(buf_info)))
 			return -EFAULT;
 
-		mutex_lock(&mtx);
+		mutex_lock_stat(&pi->mtx, &pi_mtx_stat);
 		list_for_each_entry(_b, &pi->bufs, by_pid) {
 			if (buf_info.offset == _b->buf_info.offset) {
 				if (copy_to_user((void __user *)arg,
 					&_b->buf_info,
 					sizeof(_b->buf_info))) {
-					mutex_unlock(&mtx);
+					mutex_unlock(&pi->mtx);
 					return -EFAULT;
 				} else {
-					mutex_unlock(&mtx);
+					mutex_unlock(&pi->mtx);
 					return 0;
 				}
 			}
 		}
-		mutex_unlock(&mtx);
+		mutex_unlock(&pi->mtx);
 		return -EFAULT;
 		break;
 	case TILIOC_RBUF:
@@ -1503,7 +2416,11 @@ static s32 tiler_ioctl(struct inode *ip, struct file *filp, u32 cmd,
 
 		if (copy_to_user((void __user *)arg, &_b->buf_info,
 					sizeof(_b->buf_info))) {
+			mutex_lock_stat(&pi->mtx, &pi_mtx_stat);
+			mutex_lock_stat(&mtx, &mtx_stat);
 			_m_unregister_buf(_b);
+			unlock_and_release();
+			mutex_unlock(&pi->mtx);
 			return -EFAULT;
 		}
 		break;
@@ -1512,16 +2429,18 @@ static s32 tiler_ioctl(struct inode *ip, struct file *filp, u32 cmd,
 					sizeof(buf_info)))
 			return -EFAULT;
 
-		mutex_lock(&mtx);
 		/* buffer registration is per process */
+		mutex_lock_stat(&pi->mtx, &pi_mtx_stat);
 		list_for_each_entry(_b, &pi->bufs, by_pid) {
 			if (buf_info.offset == _b->buf_info.offset) {
+				mutex_lock_stat(&mtx, &mtx_stat);
 				_m_unregister_buf(_b);
-				mutex_unlock(&mtx);
+				unlock_and_release();
+				mutex_unlock(&pi->mtx);
 				return 0;
 			}
 		}
-		mutex_unlock(&mtx);
+		mutex_unlock(&pi->mtx);
 		return -EFAULT;
 		break;
 	case TILIOC_QUERY_BLK:
@@ -1548,51 +2467,75 @@ static s32 alloc_block(enum tiler_fmt fmt, u32 width, u32 height,
 {
 	struct mem_info *mi = NULL;
 	struct gid_info *gi = NULL;
+	u32 *mem;
+	s32 res;
 
 	/* only support up to page alignment */
 	if (align > PAGE_SIZE || offs > align || !pi)
 		return -EINVAL;
 
-	/* get group context */
-	mutex_lock(&mtx);
+	/* get group context, and see if we can recycle a freed block */
+	mutex_lock_stat(&mtx, &mtx_stat);
 	gi = _m_get_gi(pi, gid);
+	mi = gi ? _m_cache_get(gi, fmt, width, height, align, offs) : NULL;
+	if (mi)
+		*sys_addr = mi->sys_addr;
 	mutex_unlock(&mtx);
 
 	if (!gi)
 		return -ENOMEM;
 
+	if (mi)
+		return 0;
+
 	/* reserve area in tiler container */
 	mi = __get_area(fmt, width, height, align, offs, gi);
 	if (!mi) {
-		mutex_lock(&mtx);
+		mutex_lock_stat(&mtx, &mtx_stat);
 		_m_try_free_group(gi);
 		mutex_unlock(&mtx);
 		return -ENOMEM;
 	}
 
-	*sys_addr = mi->sys_addr;
+	mi->fmt = fmt;
+	mi->width = width;
+	mi->height = height;
+	mi->align = align;
+	mi->offs = offs;
 
 	/* allocate and map if mapping is supported */
 	if (tmm_can_map(TMM(fmt))) {
 		mi->num_pg = tcm_sizeof(mi->area);
 
-		mi->mem = tmm_get(TMM(fmt), mi->num_pg);
-		if (!mi->mem)
+		mem = tmm_get(TMM(fmt), mi->num_pg);
+		if (!mem)
 			goto cleanup;
 
 		/* Ensure the data reaches to main memory before PAT refill */
 		wmb();
 
 		/* program PAT */
-		if (refill_pat(TMM(fmt), &mi->area, mi->mem))
-			goto cleanup;
+		res = refill_pat(TMM(fmt), &mi->area, mem);
+
+		/* publish the pages, the block may be compacted from now on */
+		mutex_lock_stat(&mtx, &mtx_stat);
+		mi->mem = mem;
+		mi->mapped = !res;
+		if (res)
+			goto free;
+		*sys_addr = mi->sys_addr;
+		mutex_unlock(&mtx);
+		return 0;
 	}
+
+	*sys_addr = mi->sys_addr;
 	return 0;
 
 cleanup:
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
+free:
 	_m_free(mi);
-	mutex_unlock(&mtx);
+	unlock_and_release();
 	return -ENOMEM;
 
 }
@@ -1694,7 +2637,15 @@ static void __exit tiler_exit(void)
 	struct process_info *pi = NULL, *pi_ = NULL;
 	int i, j;
 
-	mutex_lock(&mtx);
+	debugfs_remove_recursive(dbgfs);
+	unregister_shrinker(&cache_shrinker);
+	cancel_delayed_work_sync(&cache_work);
+	flush_work(&release_work);
+
+	mutex_lock_stat(&mtx, &mtx_stat);
+
+	/* stop caching blocks, cached blocks are freed with their process */
+	cache_ms = 0;
 
 	/* free all process data */
 	list_for_each_entry_safe(pi, pi_, &procs, list)
@@ -1706,10 +2657,14 @@ static void __exit tiler_exit(void)
 	WARN_ON(!list_empty(&orphan_onedim));
 	WARN_ON(!list_empty(&orphan_areas));
 
-	mutex_unlock(&mtx);
+	/* exporters should have withdrawn their pages by now */
+	WARN_ON(!list_empty(&exports));
 
-	dma_free_coherent(NULL, TILER_WIDTH * TILER_HEIGHT * sizeof(*dmac_va),
-							dmac_va, dmac_pa);
+	unlock_and_release();
+
+	dma_free_coherent(NULL, DMAC_SIZE * sizeof(*dmac_va), dmac_va,
+								dmac_pa);
+	mutex_destroy(&dmac_mtx);
 
 	/* close containers only once */
 	for (i = TILFMT_8BIT; i <= TILFMT_MAX; i++) {
@@ -1724,6 +2679,7 @@ static void __exit tiler_exit(void)
 		tmm_deinit(TMM(i));
 	}
 
+	mutex_destroy(&compact_mtx);
 	mutex_destroy(&mtx);
 	platform_driver_unregister(&tiler_driver_ldm);
 	cdev_del(&tiler_device->cdev);
@@ -1749,12 +2705,12 @@ static s32 tiler_release(struct inode *ip, struct file *filp)
 {
 	struct process_info *pi = filp->private_data;
 
-	mutex_lock(&mtx);
+	mutex_lock_stat(&mtx, &mtx_stat);
 	/* free resources if last device in this process */
 	if (0 == --pi->refs)
 		_m_free_process_info(pi);
 
-	mutex_unlock(&mtx);
+	unlock_and_release();
 
 	return 0x0;
 }
@@ -1772,7 +2728,7 @@ static s32 __init tiler_init(void)
 	s32 r = -1;
 	struct device *device = NULL;
 	struct tcm_pt div_pt;
-	struct tcm *sita = NULL;
+	struct tcm *sita = NULL;	/* container manager */
 	struct tmm *tmm_pat = NULL;
 	struct tcm_area area = {0};
 
@@ -1783,15 +2739,19 @@ static s32 __init tiler_init(void)
 	  * Array of physical pages for PAT programming, which must be a 16-byte
 	  * aligned physical address
 	*/
-	dmac_va = dma_alloc_coherent(NULL, TILER_WIDTH * TILER_HEIGHT *
-					sizeof(*dmac_va), &dmac_pa, GFP_ATOMIC);
+	dmac_va = dma_alloc_coherent(NULL, DMAC_SIZE * sizeof(*dmac_va),
+							&dmac_pa, GFP_ATOMIC);
 	if (!dmac_va)
 		return -ENOMEM;
+	mutex_init(&dmac_mtx);
 
 	/* Allocate tiler container manager (we share 1 on OMAP4) */
 	div_pt.x = TILER_WIDTH;   /* hardcoded default */
 	div_pt.y = (3 * TILER_HEIGHT) / 4;
-	sita = sita_init(TILER_WIDTH, TILER_HEIGHT, (void *)&div_pt);
+	if (!strcmp(tcm_alg, "rowidx"))
+		sita = rowidx_init(TILER_WIDTH, TILER_HEIGHT, &div_pt);
+	else
+		sita = sita_init(TILER_WIDTH, TILER_HEIGHT, (void *)&div_pt);
 
 	TCM_SET(TILFMT_8BIT, sita);
 	TCM_SET(TILFMT_16BIT, sita);
@@ -1842,12 +2802,28 @@ static s32 __init tiler_init(void)
 	r = platform_driver_register(&tiler_driver_ldm);
 
 	mutex_init(&mtx);
+	mutex_init(&compact_mtx);
 	INIT_LIST_HEAD(&blocks);
 	INIT_LIST_HEAD(&procs);
 	INIT_LIST_HEAD(&orphan_areas);
 	INIT_LIST_HEAD(&orphan_onedim);
+	INIT_LIST_HEAD(&zombies);
+	INIT_LIST_HEAD(&exports);
 	BLOCKING_INIT_NOTIFIER_HEAD(&tiler_device->notifier);
 	id = 0xda7a000;
+	INIT_DELAYED_WORK(&cache_work, cache_expire);
+	INIT_WORK(&release_work, release_zombies);
+	register_shrinker(&cache_shrinker);
+
+	dbgfs = debugfs_create_dir("tiler", NULL);
+	if (!IS_ERR_OR_NULL(dbgfs)) {
+		debugfs_create_file("fragmentation", S_IRUGO, dbgfs, NULL,
+							&tiler_frag_fops);
+		debugfs_create_file("compact", S_IWUSR, dbgfs, NULL,
+							&tiler_compact_fops);
+		debugfs_create_file("locks", S_IRUGO | S_IWUSR, dbgfs, NULL,
+							&tiler_locks_fops);
+	}
 
 	/* Dummy page for filling unused entries in dmm (dmac_va):
 	 */
@@ -1869,8 +2845,8 @@ error:
 		kfree(tiler_device);
 		tcm_deinit(sita);
 		tmm_deinit(tmm_pat);
-		dma_free_coherent(NULL, TILER_WIDTH * TILER_HEIGHT *
-					sizeof(*dmac_va), dmac_va, dmac_pa);
+		dma_free_coherent(NULL, DMAC_SIZE * sizeof(*dmac_va),
+							dmac_va, dmac_pa);
 	}
 
 	return r;
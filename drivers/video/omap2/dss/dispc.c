@@ -270,6 +270,11 @@ struct omap_dispc_isr_data {
 #define REG_FLD_MOD(idx, val, start, end)				\
 	dispc_write_reg(idx, FLD_MOD(dispc_read_reg(idx), val, start, end))
 
+/* plane registers: read from the shadow copy, written only if changed */
+#define PLANE_REG_FLD_MOD(idx, val, start, end)				\
+	dispc_write_reg_diff(idx, FLD_MOD(dispc_read_reg_shadow(idx),	\
+				val, start, end))
+
 #define IS_VIDEO_PIPELINE(plane) \
 	((plane == OMAP_DSS_VIDEO1) || (plane == OMAP_DSS_VIDEO2) \
 		|| (plane == OMAP_DSS_VIDEO3))
@@ -344,6 +349,15 @@ static struct {
 
 	u32		ctx[DISPC_SZ_REGS / sizeof(u32)];
 
+	/* Copy of the registers as last written. Plane setup only writes
+	 * the registers whose value changed, and skips the FIR coefficients
+	 * altogether when the plane already uses the same tables. */
+	u32		shadow[DISPC_SZ_REGS / sizeof(u32)];
+	DECLARE_BITMAP(shadow_valid, DISPC_SZ_REGS / sizeof(u32));
+	const s8	*fir_coef[DISPC_NUM_PIPELINES][2][2];
+	u32		plane_writes;
+	u32		plane_writes_skipped;
+
 #ifdef CONFIG_OMAP2_DSS_COLLECT_IRQ_STATS
 	spinlock_t irq_stats_lock;
 	struct dispc_irq_stats irq_stats;
@@ -356,6 +370,8 @@ static void _omap_dispc_set_irqs(void);
 
 static inline void dispc_write_reg(const struct dispc_reg idx, u32 val)
 {
+	dispc.shadow[idx.idx / sizeof(u32)] = val;
+	__set_bit(idx.idx / sizeof(u32), dispc.shadow_valid);
 	__raw_writel(val, dispc.base + idx.idx);
 }
 
@@ -364,6 +380,38 @@ static inline u32 dispc_read_reg(const struct dispc_reg idx)
 	return __raw_readl(dispc.base + idx.idx);
 }
 
+/* Only for registers the HW does not change by itself */
+static inline u32 dispc_read_reg_shadow(const struct dispc_reg idx)
+{
+	u32 val;
+
+	if (test_bit(idx.idx / sizeof(u32), dispc.shadow_valid))
+		return dispc.shadow[idx.idx / sizeof(u32)];
+
+	val = dispc_read_reg(idx);
+	dispc.shadow[idx.idx / sizeof(u32)] = val;
+	__set_bit(idx.idx / sizeof(u32), dispc.shadow_valid);
+	return val;
+}
+
+static inline void dispc_write_reg_diff(const struct dispc_reg idx, u32 val)
+{
+	dispc.plane_writes++;
+	if (test_bit(idx.idx / sizeof(u32), dispc.shadow_valid) &&
+			dispc.shadow[idx.idx / sizeof(u32)] == val) {
+		dispc.plane_writes_skipped++;
+		return;
+	}
+	dispc_write_reg(idx, val);
+}
+
+/* The registers lost their values, forget the shadow copy */
+static void dispc_invalidate_shadow(void)
+{
+	bitmap_zero(dispc.shadow_valid, DISPC_SZ_REGS / sizeof(u32));
+	memset(dispc.fir_coef, 0, sizeof(dispc.fir_coef));
+}
+
 static inline u8 calc_tiler_orientation(u8 rotation, u8 mir)
 {
 	static u8 orientation;
@@ -763,6 +811,8 @@ void dispc_save_context(void)
 
 void dispc_restore_context(void)
 {
+	dispc_invalidate_shadow();
+
 	RR(SYSCONFIG);
 	/*RR(IRQENABLE);*/
 	/*RR(CONTROL);*/
@@ -1283,11 +1333,29 @@ static void _dispc_write_firv2_reg(enum omap_plane plane, int reg, u32 value)
 		dispc_write_reg(DISPC_VID_V3_WB_FIR_COEF_V2(1, reg), value);
 }
 
+/* Does the plane already use the FIR tables hfir and vfir. bank is 0 for the
+ * luma/RGB coefficients, 1 for the chroma ones. */
+static bool dispc_fir_coef_cached(enum omap_plane plane, int bank,
+				  const s8 *hfir, const s8 *vfir)
+{
+	const s8 **coef = dispc.fir_coef[plane][bank];
+
+	if (coef[0] == hfir && coef[1] == vfir)
+		return true;
+
+	coef[0] = hfir;
+	coef[1] = vfir;
+	return false;
+}
+
 static void _dispc_set_scale_coef(enum omap_plane plane, const s8 *hfir,
 				  const s8 *vfir, int three_taps)
 {
 	int i;
 
+	if (dispc_fir_coef_cached(plane, 0, hfir, vfir))
+		return;
+
 	for (i = 0; i < 8; i++, hfir++, vfir++) {
 		u32 h, hv, v;
 		h = ((hfir[0] & 0xFF) | ((hfir[8] << 8) & 0xFF00) |
@@ -1373,32 +1441,32 @@ static void _dispc_set_vid_color_conv_coef(enum omap_plane plane,
 	switch (plane) {
 	case OMAP_DSS_VIDEO1:
 	case OMAP_DSS_VIDEO2:
-		dispc_write_reg(DISPC_VID_CONV_COEF(plane-1, 0),
+		dispc_write_reg_diff(DISPC_VID_CONV_COEF(plane-1, 0),
 			CVAL(conv->coef.rcr, conv->coef.ry));
-		dispc_write_reg(DISPC_VID_CONV_COEF(plane-1, 1),
+		dispc_write_reg_diff(DISPC_VID_CONV_COEF(plane-1, 1),
 			CVAL(conv->coef.gy, conv->coef.rcb));
-		dispc_write_reg(DISPC_VID_CONV_COEF(plane-1, 2),
+		dispc_write_reg_diff(DISPC_VID_CONV_COEF(plane-1, 2),
 			CVAL(conv->coef.gcb, conv->coef.gcr));
-		dispc_write_reg(DISPC_VID_CONV_COEF(plane-1, 3),
+		dispc_write_reg_diff(DISPC_VID_CONV_COEF(plane-1, 3),
 			CVAL(conv->coef.bcr, conv->coef.by));
-		dispc_write_reg(DISPC_VID_CONV_COEF(plane-1, 4),
+		dispc_write_reg_diff(DISPC_VID_CONV_COEF(plane-1, 4),
 			CVAL(0, conv->coef.bcb));
-		REG_FLD_MOD(DISPC_VID_ATTRIBUTES(plane-1),
+		PLANE_REG_FLD_MOD(DISPC_VID_ATTRIBUTES(plane-1),
 			conv->full_range, 11, 11);
 		break;
 #ifdef CONFIG_ARCH_OMAP4
 	case OMAP_DSS_VIDEO3:
-		dispc_write_reg(DISPC_VID_V3_WB_CONV_COEF(0, 0),
+		dispc_write_reg_diff(DISPC_VID_V3_WB_CONV_COEF(0, 0),
 			CVAL(conv->coef.rcr, conv->coef.ry));
-		dispc_write_reg(DISPC_VID_V3_WB_CONV_COEF(0, 1),
+		dispc_write_reg_diff(DISPC_VID_V3_WB_CONV_COEF(0, 1),
 			CVAL(conv->coef.gy, conv->coef.rcb));
-		dispc_write_reg(DISPC_VID_V3_WB_CONV_COEF(0, 2),
+		dispc_write_reg_diff(DISPC_VID_V3_WB_CONV_COEF(0, 2),
 			CVAL(conv->coef.gcb, conv->coef.gcr));
-		dispc_write_reg(DISPC_VID_V3_WB_CONV_COEF(0, 3),
+		dispc_write_reg_diff(DISPC_VID_V3_WB_CONV_COEF(0, 3),
 			CVAL(conv->coef.bcr, conv->coef.by));
-		dispc_write_reg(DISPC_VID_V3_WB_CONV_COEF(0, 4),
+		dispc_write_reg_diff(DISPC_VID_V3_WB_CONV_COEF(0, 4),
 			CVAL(0,	conv->coef.bcb));
-		REG_FLD_MOD(DISPC_VID_V3_WB_ATTRIBUTES(0),
+		PLANE_REG_FLD_MOD(DISPC_VID_V3_WB_ATTRIBUTES(0),
 			conv->full_range, 11, 11);
 		break;
 #endif
@@ -1447,7 +1515,7 @@ static void _dispc_set_plane_ba0(enum omap_plane plane, u32 paddr)
 		ba0_reg[4] = DISPC_VID_V3_WB_BA0(1);	/* WB pipeline*/
 	}
 
-	dispc_write_reg(ba0_reg[plane], paddr);
+	dispc_write_reg_diff(ba0_reg[plane], paddr);
 }
 
 static void _dispc_set_plane_ba1(enum omap_plane plane, u32 paddr)
@@ -1460,7 +1528,7 @@ static void _dispc_set_plane_ba1(enum omap_plane plane, u32 paddr)
 		ba1_reg[4] = DISPC_VID_V3_WB_BA1(1);	/* WB pipeline*/
 	}
 
-	dispc_write_reg(ba1_reg[plane], paddr);
+	dispc_write_reg_diff(ba1_reg[plane], paddr);
 }
 
 static void _dispc_set_plane_ba_uv0(enum omap_plane plane, u32 paddr)
@@ -1473,7 +1541,7 @@ static void _dispc_set_plane_ba_uv0(enum omap_plane plane, u32 paddr)
 
 	BUG_ON(plane == OMAP_DSS_GFX);
 
-	dispc_write_reg(ba_uv0_reg[plane - 1], paddr);
+	dispc_write_reg_diff(ba_uv0_reg[plane - 1], paddr);
 	/* plane - 1 => no UV_BA for GFX*/
 
 }
@@ -1487,7 +1555,7 @@ static void _dispc_set_plane_ba_uv1(enum omap_plane plane, u32 paddr)
 
 	BUG_ON(plane == OMAP_DSS_GFX);
 
-	dispc_write_reg(ba_uv1_reg[plane - 1], paddr);
+	dispc_write_reg_diff(ba_uv1_reg[plane - 1], paddr);
 	/* plane - 1 => no UV_BA for GFX*/
 }
 
@@ -1501,7 +1569,7 @@ static void _dispc_set_plane_pos(enum omap_plane plane, int x, int y)
 	if (cpu_is_omap44xx())
 		pos_reg[3] = DISPC_VID_VID3_POSITION;	/* VID 3 pipeline*/
 
-	dispc_write_reg(pos_reg[plane], val);
+	dispc_write_reg_diff(pos_reg[plane], val);
 }
 
 static void _dispc_set_pic_size(enum omap_plane plane, int width, int height)
@@ -1514,7 +1582,7 @@ static void _dispc_set_pic_size(enum omap_plane plane, int width, int height)
 		siz_reg[3] = DISPC_VID_V3_WB_PICTURE_SIZE(0); /* VID3 pipeline*/
 		siz_reg[4] = DISPC_VID_V3_WB_PICTURE_SIZE(1); /* WB pipeline*/
 	}
-	dispc_write_reg(siz_reg[plane], val);
+	dispc_write_reg_diff(siz_reg[plane], val);
 }
 
 static void _dispc_set_vid_size(enum omap_plane plane, int width, int height)
@@ -1530,7 +1598,7 @@ static void _dispc_set_vid_size(enum omap_plane plane, int width, int height)
 	BUG_ON(plane == OMAP_DSS_GFX);
 
 	val = FLD_VAL(height - 1, 26, 16) | FLD_VAL(width - 1, 10, 0);
-	dispc_write_reg(vsi_reg[plane-1], val);
+	dispc_write_reg_diff(vsi_reg[plane-1], val);
 }
 
 static void _dispc_setup_global_alpha(enum omap_plane plane, u8 global_alpha)
@@ -1542,13 +1610,13 @@ static void _dispc_setup_global_alpha(enum omap_plane plane, u8 global_alpha)
 		return;
 
 	if (plane == OMAP_DSS_GFX)
-		REG_FLD_MOD(DISPC_GLOBAL_ALPHA, global_alpha, 7, 0);
+		PLANE_REG_FLD_MOD(DISPC_GLOBAL_ALPHA, global_alpha, 7, 0);
 	else if (plane == OMAP_DSS_VIDEO2)
-		REG_FLD_MOD(DISPC_GLOBAL_ALPHA, global_alpha, 23, 16);
+		PLANE_REG_FLD_MOD(DISPC_GLOBAL_ALPHA, global_alpha, 23, 16);
 	else if (plane == OMAP_DSS_VIDEO1)
-		REG_FLD_MOD(DISPC_GLOBAL_ALPHA, global_alpha, 15, 8);
+		PLANE_REG_FLD_MOD(DISPC_GLOBAL_ALPHA, global_alpha, 15, 8);
 	else if (plane == OMAP_DSS_VIDEO3)
-		REG_FLD_MOD(DISPC_GLOBAL_ALPHA, global_alpha, 31, 24);
+		PLANE_REG_FLD_MOD(DISPC_GLOBAL_ALPHA, global_alpha, 31, 24);
 
 }
 
@@ -1561,7 +1629,7 @@ static void _dispc_set_pix_inc(enum omap_plane plane, s32 inc)
 		ri_reg[3] = DISPC_VID_V3_WB_PIXEL_INC(0);
 		ri_reg[4] = DISPC_VID_V3_WB_PIXEL_INC(1);	/* WB pipeline*/
 	}
-	dispc_write_reg(ri_reg[plane], inc);
+	dispc_write_reg_diff(ri_reg[plane], inc);
 }
 
 static void _dispc_set_row_inc(enum omap_plane plane, s32 inc)
@@ -1574,7 +1642,7 @@ static void _dispc_set_row_inc(enum omap_plane plane, s32 inc)
 		ri_reg[4] = DISPC_VID_V3_WB_ROW_INC(1);	/* WB pipeline*/
 	}
 
-	dispc_write_reg(ri_reg[plane], inc);
+	dispc_write_reg_diff(ri_reg[plane], inc);
 }
 
 static void _dispc_set_color_mode(enum omap_plane plane,
@@ -1651,7 +1719,7 @@ static void _dispc_set_color_mode(enum omap_plane plane,
 		}
 	}
 
-	REG_FLD_MOD(dispc_reg_att[plane], m, 4, 1);
+	PLANE_REG_FLD_MOD(dispc_reg_att[plane], m, 4, 1);
 }
 
 static void _dispc_set_channel_out(enum omap_plane plane,
@@ -1675,7 +1743,7 @@ static void _dispc_set_channel_out(enum omap_plane plane,
 		return;
 	}
 
-	val = dispc_read_reg(dispc_reg_att[plane]);
+	val = dispc_read_reg_shadow(dispc_reg_att[plane]);
 	if (cpu_is_omap44xx()) {
 		switch (channel) {
 
@@ -1700,7 +1768,7 @@ static void _dispc_set_channel_out(enum omap_plane plane,
 	} else {
 		val = FLD_MOD(val, channel, shift, shift);
 	}
-	dispc_write_reg(dispc_reg_att[plane], val);
+	dispc_write_reg_diff(dispc_reg_att[plane], val);
 }
 
 static void _dispc_set_wb_channel_out(enum omap_plane plane)
@@ -1722,11 +1790,11 @@ static void _dispc_set_wb_channel_out(enum omap_plane plane)
 		return;
 	}
 
-	val = dispc_read_reg(dispc_reg_att[plane]);
+	val = dispc_read_reg_shadow(dispc_reg_att[plane]);
 	val = FLD_MOD(val, 0, shift, shift);
 	val = FLD_MOD(val, 3, 31, 30);
 
-	dispc_write_reg(dispc_reg_att[plane], val);
+	dispc_write_reg_diff(dispc_reg_att[plane], val);
 }
 
 void dispc_set_burst_size(enum omap_plane plane,
@@ -1819,9 +1887,9 @@ static void _dispc_enable_vid_color_conv(enum omap_plane plane, bool enable)
 
 	BUG_ON(plane == OMAP_DSS_GFX);
 
-	val = dispc_read_reg(dispc_reg_att[plane]);
+	val = dispc_read_reg_shadow(dispc_reg_att[plane]);
 	val = FLD_MOD(val, enable, 9, 9);
-	dispc_write_reg(dispc_reg_att[plane], val);
+	dispc_write_reg_diff(dispc_reg_att[plane], val);
 }
 
 void dispc_enable_replication(enum omap_plane plane, bool enable)
@@ -1963,7 +2031,7 @@ static void _dispc_set_fir(enum omap_plane plane, int hinc, int vinc)
 		val = FLD_VAL(vinc, 27, 16) | FLD_VAL(hinc, 11, 0);
 	else
 		val = FLD_VAL(vinc, 28, 16) | FLD_VAL(hinc, 12, 0);
-	dispc_write_reg(fir_reg[plane-1], val);
+	dispc_write_reg_diff(fir_reg[plane-1], val);
 }
 
 static void _dispc_set_vid_accu0(enum omap_plane plane, int haccu, int vaccu)
@@ -1982,7 +2050,7 @@ static void _dispc_set_vid_accu0(enum omap_plane plane, int haccu, int vaccu)
 	else
 		val = FLD_VAL(vaccu, 25, 16) | FLD_VAL(haccu, 9, 0);
 
-	dispc_write_reg(ac0_reg[plane-1], val);
+	dispc_write_reg_diff(ac0_reg[plane-1], val);
 }
 
 static void _dispc_set_vid_accu1(enum omap_plane plane, int haccu, int vaccu)
@@ -2001,7 +2069,7 @@ static void _dispc_set_vid_accu1(enum omap_plane plane, int haccu, int vaccu)
 	else
 		val = FLD_VAL(vaccu, 25, 16) | FLD_VAL(haccu, 9, 0);
 
-	dispc_write_reg(ac1_reg[plane-1], val);
+	dispc_write_reg_diff(ac1_reg[plane-1], val);
 }
 
 static void _dispc_set_fir2(enum omap_plane plane, int hinc, int vinc)
@@ -2020,7 +2088,7 @@ static void _dispc_set_fir2(enum omap_plane plane, int hinc, int vinc)
 
 	val = FLD_VAL(vinc, 28, 16) | FLD_VAL(hinc, 12, 0);
 
-	dispc_write_reg(fir_reg[plane-1], val);
+	dispc_write_reg_diff(fir_reg[plane-1], val);
 }
 
 static void _dispc_set_vid_accu2_0(enum omap_plane plane, int haccu, int vaccu)
@@ -2035,7 +2103,7 @@ static void _dispc_set_vid_accu2_0(enum omap_plane plane, int haccu, int vaccu)
 	BUG_ON(plane == OMAP_DSS_GFX);
 
 	val = FLD_VAL(vaccu, 26, 16) | FLD_VAL(haccu, 10, 0);
-	dispc_write_reg(ac0_reg[plane-1], val);
+	dispc_write_reg_diff(ac0_reg[plane-1], val);
 }
 
 static void _dispc_set_vid_accu2_1(enum omap_plane plane, int haccu, int vaccu)
@@ -2050,7 +2118,7 @@ static void _dispc_set_vid_accu2_1(enum omap_plane plane, int haccu, int vaccu)
 	BUG_ON(plane == OMAP_DSS_GFX);
 
 	val = FLD_VAL(vaccu, 26, 16) | FLD_VAL(haccu, 10, 0);
-	dispc_write_reg(ac1_reg[plane-1], val);
+	dispc_write_reg_diff(ac1_reg[plane-1], val);
 }
 
 static const s8 fir5_zero[] = {
@@ -2240,7 +2308,7 @@ static void _dispc_set_scaling(enum omap_plane plane,
 	_dispc_set_scale_coef(plane, hfir, vfir, three_taps);
 	_dispc_set_fir(plane, fir_hinc, fir_vinc);
 
-	l = dispc_read_reg(dispc_reg_att[plane]);
+	l = dispc_read_reg_shadow(dispc_reg_att[plane]);
 
 	if (!cpu_is_omap44xx()) {
 		l &= ~((0x0f << 5) | (0x3 << 21));
@@ -2253,7 +2321,7 @@ static void _dispc_set_scaling(enum omap_plane plane,
 
 	l |= three_taps ? 0 : (1 << 21);
 
-	dispc_write_reg(dispc_reg_att[plane], l);
+	dispc_write_reg_diff(dispc_reg_att[plane], l);
 
 	/*
 	 * field 0 = even field = bottom field
@@ -2304,7 +2372,11 @@ static void _dispc_set_scaling_uv(enum omap_plane plane,
 		vfir = fir3_m8;
 		}
 
-	for (i = 0; i < 8; i++, hfir++, vfir++) {
+	if (dispc_fir_coef_cached(plane, 1, hfir, vfir))
+		i = 8;
+	else
+		i = 0;
+	for (; i < 8; i++, hfir++, vfir++) {
 		u32 h, hv, v;
 		h = ((hfir[0] & 0xFF) | ((hfir[8] << 8) & 0xFF00) |
 			 ((hfir[16] << 16) & 0xFF0000) |
@@ -2322,14 +2394,14 @@ static void _dispc_set_scaling_uv(enum omap_plane plane,
 	}
 	/* set chroma resampling. Not applicable for WB plane*/
 	if (plane != OMAP_DSS_WB)
-		REG_FLD_MOD(DISPC_VID_ATTRIBUTES2(plane - 1),
+		PLANE_REG_FLD_MOD(DISPC_VID_ATTRIBUTES2(plane - 1),
 			(fir_hinc || fir_vinc) ? 1 : 0, 8, 8);
 
 	/* set H scaling */
-	REG_FLD_MOD(dispc_reg_att[plane], fir_hinc ? 1 : 0, 5, 5);
+	PLANE_REG_FLD_MOD(dispc_reg_att[plane], fir_hinc ? 1 : 0, 5, 5);
 
 	/* set V scaling */
-	REG_FLD_MOD(dispc_reg_att[plane], fir_vinc ? 1 : 0, 6, 6);
+	PLANE_REG_FLD_MOD(dispc_reg_att[plane], fir_vinc ? 1 : 0, 6, 6);
 
 	_dispc_set_fir2(plane, fir_hinc, fir_vinc);
 
@@ -2375,21 +2447,24 @@ static void _dispc_set_rotation_attrs(enum omap_plane plane, u8 rotation,
 			break;
 		}
 
-		REG_FLD_MOD(dispc_reg_att[plane], vidrot, 13, 12);
+		PLANE_REG_FLD_MOD(dispc_reg_att[plane], vidrot, 13, 12);
 
 		if (!cpu_is_omap44xx()) {
 			if (rotation == OMAP_DSS_ROT_90 ||
 					rotation == OMAP_DSS_ROT_270)
-				REG_FLD_MOD(dispc_reg_att[plane], 0x1, 18, 18);
+				PLANE_REG_FLD_MOD(dispc_reg_att[plane],
+						0x1, 18, 18);
 			else
-				REG_FLD_MOD(dispc_reg_att[plane], 0x0, 18, 18);
+				PLANE_REG_FLD_MOD(dispc_reg_att[plane],
+						0x0, 18, 18);
 		}
 	} else {
 		if (!cpu_is_omap44xx()) {
-			REG_FLD_MOD(dispc_reg_att[plane], 0, 13, 12);
-			REG_FLD_MOD(dispc_reg_att[plane], 0, 18, 18);
+			PLANE_REG_FLD_MOD(dispc_reg_att[plane], 0, 13, 12);
+			PLANE_REG_FLD_MOD(dispc_reg_att[plane], 0, 18, 18);
 		} else {
-			REG_FLD_MOD(dispc_reg_att[plane], rotation, 13, 12);
+			PLANE_REG_FLD_MOD(dispc_reg_att[plane],
+					rotation, 13, 12);
 		}
 	}
 
@@ -2397,9 +2472,11 @@ static void _dispc_set_rotation_attrs(enum omap_plane plane, u8 rotation,
 		if (color_mode == OMAP_DSS_COLOR_NV12) {
 			/* DOUBLESTRIDE : 0 for 90-, 270-; 1 for 0- and 180- */
 			if (rotation == 1 || rotation == 3)
-				REG_FLD_MOD(dispc_reg_att[plane], 0x0, 22, 22);
+				PLANE_REG_FLD_MOD(dispc_reg_att[plane],
+						0x0, 22, 22);
 			else
-				REG_FLD_MOD(dispc_reg_att[plane], 0x1, 22, 22);
+				PLANE_REG_FLD_MOD(dispc_reg_att[plane],
+						0x1, 22, 22);
 		}
 	}
 }
@@ -3182,17 +3259,18 @@ static int _dispc_setup_plane(enum omap_plane plane,
 		 * half of interlaced buffer on progressive display
 		 */
 		if ((ilace & OMAP_FLAG_IBUF) && !(ilace & OMAP_FLAG_IDEV)) {
-			dispc_write_reg(DISPC_VID_BA1(plane - 1),
+			dispc_write_reg_diff(DISPC_VID_BA1(plane - 1),
 							paddr + offset1);
 			/* UV offset is 1/2 Y offset for even offsets */
 			if (puv_addr)
-				dispc_write_reg(DISPC_VID_BA_UV1(plane - 1),
+				dispc_write_reg_diff(
+						DISPC_VID_BA_UV1(plane - 1),
 						puv_addr + offset1 / 2);
 		}
 		DSSDBG("rotated addresses: 0x%0x, 0x%0x\n",
 							paddr, puv_addr);
 		/* set BURSTTYPE if rotation is non-zero */
-		REG_FLD_MOD(dispc_reg_att[plane], 0x1, 29, 29);
+		PLANE_REG_FLD_MOD(dispc_reg_att[plane], 0x1, 29, 29);
 #endif
 	} else if (rotation_type == OMAP_DSS_ROT_DMA) {
 		calc_dma_rotation_offset(rotation, mirror,
@@ -3273,7 +3351,8 @@ static int _dispc_setup_plane(enum omap_plane plane,
 			scale_uv && scale_y);
 		if (!scale_uv || (!scale_x && !scale_y))
 			/* :TRICKY: set chroma resampling for RGB formats */
-			REG_FLD_MOD(DISPC_VID_ATTRIBUTES2(plane - 1), 0, 8, 8);
+			PLANE_REG_FLD_MOD(DISPC_VID_ATTRIBUTES2(plane - 1),
+					0, 8, 8);
 	}
 		_dispc_set_scaling(plane, width, height,
 				   out_width, out_height,
@@ -4063,6 +4142,9 @@ void dispc_dump_regs(struct seq_file *s)
 
 	dss_clk_enable(DSS_CLK_ICK | DSS_CLK_FCK1);
 
+	seq_printf(s, "plane register writes %u, skipped %u\n\n",
+			dispc.plane_writes, dispc.plane_writes_skipped);
+
 	DUMPREG(DISPC_REVISION);
 	DUMPREG(DISPC_SYSCONFIG);
 	DUMPREG(DISPC_SYSSTATUS);
@@ -28,6 +28,7 @@
 #include <linux/platform_device.h>
 #include <linux/spinlock.h>
 #include <linux/jiffies.h>
+#include <linux/wait.h>
 
 #include <plat/display.h>
 #include <plat/cpu.h>
@@ -453,11 +454,42 @@ struct manager_cache_data {
 	bool enlarge_update_area;
 };
 
+/*
+ * A manager can have DSS_APPLY_QUEUE_LEN configurations applied while the
+ * one in dss_cache waits for the GO bit of the previous one to clear. They
+ * are moved to dss_cache one per VSYNC by dss_apply_irq_handler(). When the
+ * queue is full, a new configuration replaces the last queued one.
+ *
+ * Each apply returns a fence, a per manager sequence number, which is done
+ * once its configuration (or a later one) is in use by the HW.
+ */
+#define DSS_APPLY_QUEUE_LEN	3
+
+struct dss_apply_slot {
+	/* dirty is set for the overlays and manager changed in the slot */
+	struct overlay_cache_data overlay_cache[4];
+	struct manager_cache_data manager_cache;
+	u32 fence;
+};
+
+struct dss_apply_queue {
+	struct dss_apply_slot slot[DSS_APPLY_QUEUE_LEN];
+	int head;
+	int count;
+
+	u32 last_fence;		/* last fence returned by an apply */
+	u32 cache_fence;	/* fence of the configuration in dss_cache */
+	u32 shadow_fence;	/* fence in the shadow registers */
+	u32 done_fence;		/* fence in use by the HW */
+	wait_queue_head_t wait;
+};
+
 static struct {
 	spinlock_t lock;
 	struct overlay_cache_data overlay_cache[4];
 	struct manager_cache_data manager_cache[3];
 	struct writeback_cache_data writeback_cache;
+	struct dss_apply_queue apply_queue[3];
 
 	bool irq_enabled;
 } dss_cache;
@@ -542,6 +574,58 @@ static int dss_mgr_wait_for_vsync(struct omap_overlay_manager *mgr)
 	return omap_dispc_wait_for_irq_interruptible_timeout(irq, timeout);
 }
 
+static bool dss_mgr_fence_done(struct omap_overlay_manager *mgr, u32 fence)
+{
+	struct dss_apply_queue *q = &dss_cache.apply_queue[mgr->id];
+	unsigned long flags;
+	bool done;
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	done = (s32)(q->done_fence - fence) >= 0;
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	return done;
+}
+
+static int dss_mgr_wait_fence(struct omap_overlay_manager *mgr, u32 fence)
+{
+	unsigned long timeout = msecs_to_jiffies(500);
+	long r;
+
+	r = wait_event_interruptible_timeout(
+			dss_cache.apply_queue[mgr->id].wait,
+			dss_mgr_fence_done(mgr, fence), timeout);
+	if (r < 0)
+		return r;
+
+	if (r == 0) {
+		DSSERR("mgr(%d)->wait_for_fence(%u) timeout\n", mgr->id,
+				fence);
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+/* Wait until the configurations queued behind dss_cache are in use, so that
+ * the dirty flags of the cache reflect the last apply */
+static int dss_mgr_wait_for_queue(struct omap_overlay_manager *mgr)
+{
+	struct dss_apply_queue *q = &dss_cache.apply_queue[mgr->id];
+	unsigned long flags;
+	u32 fence;
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	if (!q->count) {
+		spin_unlock_irqrestore(&dss_cache.lock, flags);
+		return 0;
+	}
+	fence = q->last_fence;
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	return dss_mgr_wait_fence(mgr, fence);
+}
+
 static int dss_mgr_wait_for_go(struct omap_overlay_manager *mgr)
 {
 	unsigned long timeout = msecs_to_jiffies(500);
@@ -575,6 +659,10 @@ static int dss_mgr_wait_for_go(struct omap_overlay_manager *mgr)
 		}
 	}
 
+	r = dss_mgr_wait_for_queue(mgr);
+	if (r)
+		return r;
+
 	mc = &dss_cache.manager_cache[mgr->id];
 	i = 0;
 	while (1) {
@@ -655,6 +743,10 @@ int dss_mgr_wait_for_go_ovl(struct omap_overlay *ovl)
 		}
 	}
 
+	r = dss_mgr_wait_for_queue(ovl->manager);
+	if (r)
+		return r;
+
 	oc = &dss_cache.overlay_cache[ovl->id];
 	i = 0;
 	while (1) {
@@ -1052,6 +1144,9 @@ static int configure_dispc(void)
 		if (!mgr_go[i])
 			continue;
 
+		dss_cache.apply_queue[i].shadow_fence =
+				dss_cache.apply_queue[i].cache_fence;
+
 		/* We don't need GO with manual update display. LCD iface will
 		 * always be turned off after frame, and new settings will be
 		 * taken in to use at next update */
@@ -1256,6 +1351,108 @@ void dss_start_update(struct omap_dss_device *dssdev)
 	dssdev->manager->enable(dssdev->manager);
 }
 
+/* Does the cache hold changes of the manager not yet in shadow registers */
+static bool dss_mgr_cache_dirty(int channel)
+{
+	const int num_ovls = ARRAY_SIZE(dss_cache.overlay_cache);
+	struct overlay_cache_data *oc;
+	int i;
+
+	if (dss_cache.manager_cache[channel].dirty)
+		return true;
+
+	for (i = 0; i < num_ovls; ++i) {
+		oc = &dss_cache.overlay_cache[i];
+		if (oc->dirty && oc->channel == channel)
+			return true;
+	}
+
+	return false;
+}
+
+/* Called when the GO bit of the manager is clear: whatever was in the
+ * shadow registers is in use, and so is the cache if it had no changes */
+static void dss_mgr_retire(int channel)
+{
+	struct dss_apply_queue *q = &dss_cache.apply_queue[channel];
+	u32 fence;
+
+	fence = dss_mgr_cache_dirty(channel) ? q->shadow_fence : q->cache_fence;
+	if (fence == q->done_fence)
+		return;
+
+	q->done_fence = fence;
+	wake_up_all(&q->wait);
+}
+
+/* Move the first queued configuration of the manager to the cache */
+static void dss_mgr_dequeue(int channel)
+{
+	struct dss_apply_queue *q = &dss_cache.apply_queue[channel];
+	const int num_ovls = ARRAY_SIZE(dss_cache.overlay_cache);
+	struct dss_apply_slot *slot = &q->slot[q->head];
+	struct overlay_cache_data *oc;
+	struct manager_cache_data *mc;
+	bool shadow_dirty;
+	int i;
+
+	for (i = 0; i < num_ovls; ++i) {
+		if (!slot->overlay_cache[i].dirty)
+			continue;
+		oc = &dss_cache.overlay_cache[i];
+		shadow_dirty = oc->shadow_dirty;
+		*oc = slot->overlay_cache[i];
+		oc->shadow_dirty = shadow_dirty;
+	}
+
+	if (slot->manager_cache.dirty) {
+		mc = &dss_cache.manager_cache[channel];
+		shadow_dirty = mc->shadow_dirty;
+		*mc = slot->manager_cache;
+		mc->shadow_dirty = shadow_dirty;
+	}
+
+	q->cache_fence = slot->fence;
+	q->head = (q->head + 1) % DSS_APPLY_QUEUE_LEN;
+	q->count--;
+}
+
+/* Get a slot for a new configuration of the manager, starting from the
+ * last configuration applied to it */
+static struct dss_apply_slot *dss_mgr_enqueue(int channel)
+{
+	struct dss_apply_queue *q = &dss_cache.apply_queue[channel];
+	const int num_ovls = ARRAY_SIZE(dss_cache.overlay_cache);
+	struct dss_apply_slot *slot;
+	struct dss_apply_slot *prev;
+	int i;
+
+	/* queue full, the last configuration is replaced */
+	if (q->count == DSS_APPLY_QUEUE_LEN)
+		return &q->slot[(q->head + q->count - 1) % DSS_APPLY_QUEUE_LEN];
+
+	slot = &q->slot[(q->head + q->count) % DSS_APPLY_QUEUE_LEN];
+	if (q->count) {
+		prev = &q->slot[(q->head + q->count - 1) %
+				DSS_APPLY_QUEUE_LEN];
+		memcpy(slot->overlay_cache, prev->overlay_cache,
+				sizeof(slot->overlay_cache));
+		slot->manager_cache = prev->manager_cache;
+	} else {
+		memcpy(slot->overlay_cache, dss_cache.overlay_cache,
+				sizeof(slot->overlay_cache));
+		slot->manager_cache = dss_cache.manager_cache[channel];
+	}
+
+	for (i = 0; i < num_ovls; ++i)
+		slot->overlay_cache[i].dirty = false;
+	slot->manager_cache.dirty = false;
+
+	q->count++;
+
+	return slot;
+}
+
 static void dss_apply_irq_handler(void *data, u32 mask)
 {
 	struct manager_cache_data *mc;
@@ -1282,18 +1479,33 @@ static void dss_apply_irq_handler(void *data, u32 mask)
 			mc->shadow_dirty = false;
 	}
 
+	/* move the next queued configurations to the cache */
+	for (i = 0; i < num_mgrs; ++i) {
+		if (mgr_busy[i])
+			continue;
+		dss_mgr_retire(i);
+		if (dss_cache.apply_queue[i].count &&
+				!dss_mgr_cache_dirty(i))
+			dss_mgr_dequeue(i);
+	}
+
 	r = configure_dispc();
-	if (r == 1)
-		goto end;
 
 	/* re-read busy flags */
-	mgr_busy[0] = dispc_go_busy(0);
-	mgr_busy[1] = dispc_go_busy(1);
+	for (i = 0; i < num_mgrs; ++i) {
+		mgr_busy[i] = dispc_go_busy(i);
+		if (!mgr_busy[i])
+			dss_mgr_retire(i);
+	}
+
+	if (r == 1)
+		goto end;
 
 	/* keep running as long as there are busy managers, so that
-	 * we can collect overlay-applied information */
+	 * we can collect overlay-applied information, or queued
+	 * configurations */
 	for (i = 0; i < num_mgrs; ++i) {
-		if (mgr_busy[i])
+		if (mgr_busy[i] || dss_cache.apply_queue[i].count)
 			goto end;
 	}
 
@@ -1307,26 +1519,27 @@ end:
 	spin_unlock(&dss_cache.lock);
 }
 
-static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
+/* Is the cache of an overlay updated by an apply of the manager: it is
+ * attached to the manager, or it is shown by the manager but detached */
+static bool dss_ovl_of_mgr(struct omap_overlay *ovl,
+		struct overlay_cache_data *oc, struct omap_overlay_manager *mgr)
+{
+	if (ovl->manager)
+		return ovl->manager == mgr;
+
+	return oc->enabled && oc->channel == mgr->id;
+}
+
+/* Fill the overlay caches ocs and the manager cache mc with the info of the
+ * manager and of its overlays */
+static void dss_mgr_fill_cache(struct omap_overlay_manager *mgr,
+		struct overlay_cache_data *ocs, struct manager_cache_data *mc)
 {
 	struct overlay_cache_data *oc;
-	struct manager_cache_data *mc;
 	int i;
 	struct omap_overlay *ovl;
-	int num_planes_enabled = 0;
 	bool use_fifomerge;
-	unsigned long flags;
-	int r;
 	struct writeback_cache_data *wbc;
-	DSSDBG("omap_dss_mgr_apply(%s)\n", mgr->name);
-
-	if (!dss_get_mainclk_state()) {
-		DSSERR("mainclk disabled while trying"
-			"mgr_apply, returning\n");
-		return 0;
-	}
-
-	spin_lock_irqsave(&dss_cache.lock, flags);
 
 	if (cpu_is_omap44xx())
 		wbc = &dss_cache.writeback_cache;
@@ -1339,7 +1552,10 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 		if (!(ovl->caps & OMAP_DSS_OVL_CAP_DISPC))
 			continue;
 
-		oc = &dss_cache.overlay_cache[ovl->id];
+		oc = &ocs[ovl->id];
+
+		if (!dss_ovl_of_mgr(ovl, oc, mgr))
+			continue;
 
 		if (cpu_is_omap44xx() && wbc->enabled &&
 			omap_dss_check_wb(wbc, i, -1)) {
@@ -1354,11 +1570,8 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 			continue;
 		}
 
-		if (!ovl->info_dirty) {
-			if (oc->enabled)
-				++num_planes_enabled;
+		if (!ovl->info_dirty)
 			continue;
-		}
 
 		dssdev = ovl->manager->device;
 
@@ -1409,31 +1622,16 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 		oc->enabled = true;
 
 		oc->manual_update = dssdev_manually_updated(dssdev);
-
-		++num_planes_enabled;
 	}
 
-	/* Configure managers */
-	list_for_each_entry(mgr, &manager_list, list) {
-		struct omap_dss_device *dssdev;
-
-		if (!(mgr->caps & OMAP_DSS_OVL_MGR_CAP_DISPC))
-			continue;
-
-		mc = &dss_cache.manager_cache[mgr->id];
-
-		if (mgr->device_changed) {
-			mgr->device_changed = false;
-			mgr->info_dirty  = true;
-		}
-
-		if (!mgr->info_dirty)
-			continue;
-
-		if (!mgr->device)
-			continue;
+	/* Configure manager */
+	if (mgr->device_changed) {
+		mgr->device_changed = false;
+		mgr->info_dirty  = true;
+	}
 
-		dssdev = mgr->device;
+	if (mgr->info_dirty && mgr->device) {
+		struct omap_dss_device *dssdev = mgr->device;
 
 		mgr->info_dirty = false;
 		mc->dirty = true;
@@ -1475,12 +1673,15 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 		if (!(ovl->caps & OMAP_DSS_OVL_CAP_DISPC))
 			continue;
 
+		if (ovl->manager != mgr)
+			continue;
+
 		if (cpu_is_omap44xx() && wbc->enabled &&
 			omap_dss_check_wb(wbc, i, -1)) {
 			continue;
 		}
 
-		oc = &dss_cache.overlay_cache[ovl->id];
+		oc = &ocs[ovl->id];
 
 		if (!oc->enabled)
 			continue;
@@ -1512,8 +1713,42 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 			BUG();
 		}
 	}
+}
 
-	r = 0;
+/* Apply the info of the manager and of its overlays to the cache, or queue
+ * them if the cache still holds changes waiting for the GO bit. Manual
+ * update displays only keep the last frame, so they are never queued.
+ * Returns the fence of the configuration. */
+static u32 dss_mgr_apply_locked(struct omap_overlay_manager *mgr)
+{
+	struct dss_apply_queue *q = &dss_cache.apply_queue[mgr->id];
+	struct dss_apply_slot *slot;
+	bool manual_upd;
+
+	manual_upd = mgr->device &&
+		(mgr->device->caps & OMAP_DSS_DISPLAY_CAP_MANUAL_UPDATE);
+
+	if (!manual_upd && (q->count || dss_mgr_cache_dirty(mgr->id))) {
+		slot = dss_mgr_enqueue(mgr->id);
+		dss_mgr_fill_cache(mgr, slot->overlay_cache,
+				&slot->manager_cache);
+		slot->fence = ++q->last_fence;
+	} else {
+		dss_mgr_fill_cache(mgr, dss_cache.overlay_cache,
+				&dss_cache.manager_cache[mgr->id]);
+		q->cache_fence = ++q->last_fence;
+	}
+
+	return q->last_fence;
+}
+
+/* Write the cache to the HW where possible and keep the apply irq handler
+ * running until all is in use */
+static int dss_apply_commit(void)
+{
+	const int num_mgrs = MAX_DSS_MANAGERS;
+	int r = 0;
+	int i;
 
 	if (!dss_cache.irq_enabled) {
 		r = omap_dispc_register_isr(dss_apply_irq_handler, NULL,
@@ -1524,11 +1759,83 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 	}
 	configure_dispc();
 
+	for (i = 0; i < num_mgrs; ++i) {
+		if (!dispc_go_busy(i))
+			dss_mgr_retire(i);
+	}
+
+	return r;
+}
+
+static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
+{
+	unsigned long flags;
+	int r;
+	DSSDBG("omap_dss_mgr_apply(%s)\n", mgr->name);
+
+	if (!dss_get_mainclk_state()) {
+		DSSERR("mainclk disabled while trying"
+			"mgr_apply, returning\n");
+		return 0;
+	}
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+
+	list_for_each_entry(mgr, &manager_list, list) {
+		if (!(mgr->caps & OMAP_DSS_OVL_MGR_CAP_DISPC))
+			continue;
+
+		dss_mgr_apply_locked(mgr);
+	}
+
+	r = dss_apply_commit();
+
 	spin_unlock_irqrestore(&dss_cache.lock, flags);
 
 	return r;
 }
 
+/* Apply the info of the manager and of its overlays without waiting for the
+ * previous configuration to be in use. The returned fence can be polled with
+ * fence_done() or waited for with wait_for_fence(). */
+static int omap_dss_mgr_apply_async(struct omap_overlay_manager *mgr,
+		u32 *fence)
+{
+	unsigned long flags;
+	int r;
+	DSSDBG("omap_dss_mgr_apply_async(%s)\n", mgr->name);
+
+	if (!dss_get_mainclk_state()) {
+		DSSERR("mainclk disabled while trying"
+			"mgr_apply, returning\n");
+		return -EBUSY;
+	}
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+
+	*fence = dss_mgr_apply_locked(mgr);
+	r = dss_apply_commit();
+
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	return r;
+}
+
+static int dss_mgr_wait_for_fence(struct omap_overlay_manager *mgr, u32 fence)
+{
+	struct omap_dss_device *dssdev = mgr->device;
+
+	if (!dssdev || dssdev->state != OMAP_DSS_DISPLAY_ACTIVE)
+		return 0;
+
+	/* manual update displays are never queued, their configuration is in
+	 * use once the update started with it is done */
+	if (dssdev->caps & OMAP_DSS_DISPLAY_CAP_MANUAL_UPDATE)
+		return dss_mgr_wait_for_go(mgr);
+
+	return dss_mgr_wait_fence(mgr, fence);
+}
+
 int omap_dss_wb_apply(struct omap_overlay_manager *mgr, struct omap_writeback *wb)
 {
 	struct overlay_cache_data *oc;
@@ -1763,6 +2070,8 @@ int dss_init_overlay_managers(struct platform_device *pdev)
 	int i, r;
 
 	spin_lock_init(&dss_cache.lock);
+	for (i = 0; i < ARRAY_SIZE(dss_cache.apply_queue); ++i)
+		init_waitqueue_head(&dss_cache.apply_queue[i].wait);
 
 	INIT_LIST_HEAD(&manager_list);
 
@@ -1805,6 +2114,9 @@ int dss_init_overlay_managers(struct platform_device *pdev)
 		mgr->set_device = &omap_dss_set_device;
 		mgr->unset_device = &omap_dss_unset_device;
 		mgr->apply = &omap_dss_mgr_apply;
+		mgr->apply_async = &omap_dss_mgr_apply_async;
+		mgr->fence_done = &dss_mgr_fence_done;
+		mgr->wait_for_fence = &dss_mgr_wait_for_fence;
 		mgr->set_manager_info = &omap_dss_mgr_set_info;
 		mgr->get_manager_info = &omap_dss_mgr_get_info;
 		mgr->wait_for_go = &dss_mgr_wait_for_go;
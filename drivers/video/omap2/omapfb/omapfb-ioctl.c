@@ -142,8 +142,7 @@ static int omapfb_setup_plane(struct fb_info *fbi, struct omapfb_plane_info *pi)
 			goto undo;
 	}
 
-	if (ovl->manager)
-		ovl->manager->apply(ovl->manager);
+	omapfb_overlay_apply(ofbi, 0);
 
 	/* Release the locks in a specific order to keep lockdep happy */
 	if (old_rg->id > new_rg->id) {
@@ -582,7 +581,14 @@ static int omapfb_wait_for_go(struct fb_info *fbi)
 
 	for (i = 0; i < ofbi->num_overlays; ++i) {
 		struct omap_overlay *ovl = ofbi->overlays[i];
-		r = ovl->wait_for_go(ovl);
+		struct omap_overlay_manager *mgr = ofbi->apply_mgr[i];
+
+		/* wait only for our own apply, not for the frames other
+		 * clients queued after it */
+		if (mgr && mgr == ovl->manager && mgr->wait_for_fence)
+			r = mgr->wait_for_fence(mgr, ofbi->apply_fence[i]);
+		else
+			r = ovl->wait_for_go(ovl);
 		if (r)
 			break;
 	}
@@ -1048,8 +1048,8 @@ int omapfb_apply_changes(struct fb_info *fbi, int init)
 		if (ofbi->region->size == 0) {
 			/* the fb is not available. disable the overlay */
 			omapfb_overlay_enable(ovl, 0);
-			if (!init && ovl->manager)
-				ovl->manager->apply(ovl->manager);
+			if (!init)
+				omapfb_overlay_apply(ofbi, i);
 			continue;
 		}
 
@@ -1101,8 +1101,8 @@ int omapfb_apply_changes(struct fb_info *fbi, int init)
 		if (r)
 			goto err;
 
-		if (!init && ovl->manager)
-			ovl->manager->apply(ovl->manager);
+		if (!init)
+			omapfb_overlay_apply(ofbi, i);
 	}
 	return 0;
 err:
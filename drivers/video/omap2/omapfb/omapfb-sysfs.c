@@ -284,6 +284,8 @@ static ssize_t store_overlays(struct device *dev, struct device_attribute *attr,
 		for (t = i + 1; t < ofbi->num_overlays; t++) {
 			ofbi->rotation[t-1] = ofbi->rotation[t];
 			ofbi->overlays[t-1] = ofbi->overlays[t];
+			ofbi->apply_mgr[t-1] = ofbi->apply_mgr[t];
+			ofbi->apply_fence[t-1] = ofbi->apply_fence[t];
 		}
 
 		ofbi->num_overlays--;
@@ -307,6 +309,7 @@ static ssize_t store_overlays(struct device *dev, struct device_attribute *attr,
 		if (found)
 			continue;
 		ofbi->rotation[ofbi->num_overlays] = 0;
+		ofbi->apply_mgr[ofbi->num_overlays] = NULL;
 		ofbi->overlays[ofbi->num_overlays++] = ovl;
 
 		added = true;
@@ -70,6 +70,9 @@ struct omapfb_info {
 	u8 rotation[OMAPFB_MAX_OVL_PER_FB];
 	bool mirror;
 	bool fit_to_screen;
+	/* manager and fence of the last apply of each overlay */
+	struct omap_overlay_manager *apply_mgr[OMAPFB_MAX_OVL_PER_FB];
+	u32 apply_fence[OMAPFB_MAX_OVL_PER_FB];
 };
 
 struct omapfb2_device {
@@ -164,6 +167,21 @@ static inline int omapfb_overlay_enable(struct omap_overlay *ovl,
 	return ovl->set_overlay_info(ovl, &info);
 }
 
+/* queue the configuration of overlay i of the fb and keep its fence for
+ * OMAPFB_WAITFORGO */
+static inline int omapfb_overlay_apply(struct omapfb_info *ofbi, int i)
+{
+	struct omap_overlay_manager *mgr = ofbi->overlays[i]->manager;
+
+	if (!mgr)
+		return 0;
+	if (!mgr->apply_async)
+		return mgr->apply(mgr);
+
+	ofbi->apply_mgr[i] = mgr;
+	return mgr->apply_async(mgr, &ofbi->apply_fence[i]);
+}
+
 static inline struct omapfb2_mem_region *
 omapfb_get_mem_region(struct omapfb2_mem_region *rg)
 {
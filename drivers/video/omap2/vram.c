@@ -30,6 +30,7 @@
 #include <linux/debugfs.h>
 #include <linux/jiffies.h>
 #include <linux/module.h>
+#include <linux/rbtree.h>
 
 #include <asm/setup.h>
 
@@ -62,11 +63,26 @@ struct vram_alloc {
 	struct list_head list;
 	unsigned long paddr;
 	unsigned pages;
+	/* set if the owner lets the allocation be moved, see
+	 * omap_vram_set_migratable() */
+	const struct omap_vram_migrate_ops *ops;
+	void *data;
+};
+
+/* a free range of a region. Free extents are kept both in address order,
+ * to merge them on free, and in a tree sorted by size, for best fit */
+struct vram_extent {
+	struct list_head list;
+	struct rb_node node;
+	unsigned long paddr;
+	unsigned pages;
 };
 
 struct vram_region {
 	struct list_head list;
 	struct list_head alloc_list;
+	struct list_head free_list;
+	struct rb_root free_tree;
 	unsigned long paddr;
 	unsigned pages;
 };
@@ -74,6 +90,12 @@ struct vram_region {
 static DEFINE_MUTEX(region_mutex);
 static LIST_HEAD(region_list);
 
+static struct {
+	unsigned migrations;
+	unsigned failed_migrations;
+	unsigned long migrated_bytes;
+} vram_stats;
+
 static inline int region_mem_type(unsigned long paddr)
 {
 	if (paddr >= OMAP2_SRAM_START &&
@@ -83,19 +105,185 @@ static inline int region_mem_type(unsigned long paddr)
 		return OMAP_VRAM_MEMTYPE_SDRAM;
 }
 
+static inline unsigned long vram_extent_end(struct vram_extent *ve)
+{
+	return ve->paddr + (ve->pages << PAGE_SHIFT);
+}
+
+static void vram_extent_index(struct vram_region *vr, struct vram_extent *ve)
+{
+	struct rb_node **p = &vr->free_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct vram_extent *e;
+
+	while (*p) {
+		parent = *p;
+		e = rb_entry(parent, struct vram_extent, node);
+
+		if (ve->pages < e->pages ||
+				(ve->pages == e->pages && ve->paddr < e->paddr))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&ve->node, parent, p);
+	rb_insert_color(&ve->node, &vr->free_tree);
+}
+
+static void vram_extent_unindex(struct vram_region *vr,
+		struct vram_extent *ve)
+{
+	rb_erase(&ve->node, &vr->free_tree);
+}
+
+/* smallest free extent of at least pages, the lowest one of equal ones */
+static struct vram_extent *vram_extent_best_fit(struct vram_region *vr,
+		unsigned pages)
+{
+	struct rb_node *n = vr->free_tree.rb_node;
+	struct vram_extent *best = NULL;
+	struct vram_extent *ve;
+
+	while (n) {
+		ve = rb_entry(n, struct vram_extent, node);
+
+		if (ve->pages >= pages) {
+			best = ve;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+
+	return best;
+}
+
+/* Return [paddr, paddr + pages) to the free extents of a region, merging it
+ * with its neighbours. spare is used for a new extent if the range cannot be
+ * merged, and freed otherwise. */
+static void vram_extent_add(struct vram_region *vr, unsigned long paddr,
+		unsigned pages, struct vram_extent *spare)
+{
+	struct vram_extent *prev = NULL;
+	struct vram_extent *next = NULL;
+	struct vram_extent *ve;
+	unsigned long end = paddr + (pages << PAGE_SHIFT);
+
+	list_for_each_entry(ve, &vr->free_list, list) {
+		if (ve->paddr > paddr) {
+			next = ve;
+			break;
+		}
+		prev = ve;
+	}
+
+	if (prev && vram_extent_end(prev) == paddr) {
+		vram_extent_unindex(vr, prev);
+		prev->pages += pages;
+
+		if (next && vram_extent_end(prev) == next->paddr) {
+			vram_extent_unindex(vr, next);
+			prev->pages += next->pages;
+			list_del(&next->list);
+			kfree(next);
+		}
+
+		vram_extent_index(vr, prev);
+	} else if (next && end == next->paddr) {
+		vram_extent_unindex(vr, next);
+		next->paddr = paddr;
+		next->pages += pages;
+		vram_extent_index(vr, next);
+	} else {
+		spare->paddr = paddr;
+		spare->pages = pages;
+
+		if (next)
+			list_add_tail(&spare->list, &next->list);
+		else
+			list_add_tail(&spare->list, &vr->free_list);
+
+		vram_extent_index(vr, spare);
+		spare = NULL;
+	}
+
+	kfree(spare);
+}
+
+/* Remove [paddr, paddr + pages) from the free extent ve holding it. spare is
+ * used if the extent has to be split, and freed otherwise. It may be NULL if
+ * paddr is the start of the extent. */
+static void vram_extent_take(struct vram_region *vr, struct vram_extent *ve,
+		unsigned long paddr, unsigned pages, struct vram_extent *spare)
+{
+	unsigned long end = paddr + (pages << PAGE_SHIFT);
+	unsigned long ve_end = vram_extent_end(ve);
+
+	vram_extent_unindex(vr, ve);
+
+	if (end < ve_end && paddr > ve->paddr) {
+		spare->paddr = end;
+		spare->pages = (ve_end - end) >> PAGE_SHIFT;
+		list_add(&spare->list, &ve->list);
+		vram_extent_index(vr, spare);
+		spare = NULL;
+
+		ve->pages = (paddr - ve->paddr) >> PAGE_SHIFT;
+	} else if (end < ve_end) {
+		ve->paddr = end;
+		ve->pages = (ve_end - end) >> PAGE_SHIFT;
+	} else if (paddr > ve->paddr) {
+		ve->pages = (paddr - ve->paddr) >> PAGE_SHIFT;
+	} else {
+		list_del(&ve->list);
+		kfree(ve);
+		ve = NULL;
+	}
+
+	if (ve)
+		vram_extent_index(vr, ve);
+
+	kfree(spare);
+}
+
+static unsigned long vram_region_free_bytes(struct vram_region *vr)
+{
+	struct vram_extent *ve;
+	unsigned long free = 0;
+
+	list_for_each_entry(ve, &vr->free_list, list)
+		free += ve->pages << PAGE_SHIFT;
+
+	return free;
+}
+
 static struct vram_region *omap_vram_create_region(unsigned long paddr,
 		unsigned pages)
 {
 	struct vram_region *rm;
+	struct vram_extent *ve;
 
 	rm = kzalloc(sizeof(*rm), GFP_KERNEL);
+	ve = kzalloc(sizeof(*ve), GFP_KERNEL);
 
-	if (rm) {
-		INIT_LIST_HEAD(&rm->alloc_list);
-		rm->paddr = paddr;
-		rm->pages = pages;
+	if (rm == NULL || ve == NULL) {
+		kfree(rm);
+		kfree(ve);
+		return NULL;
 	}
 
+	INIT_LIST_HEAD(&rm->alloc_list);
+	INIT_LIST_HEAD(&rm->free_list);
+	rm->free_tree = RB_ROOT;
+	rm->paddr = paddr;
+	rm->pages = pages;
+
+	if (pages)
+		vram_extent_add(rm, paddr, pages, ve);
+	else
+		kfree(ve);
+
 	return rm;
 }
 
@@ -107,13 +295,24 @@ static void omap_vram_free_region(struct vram_region *vr)
 }
 #endif
 
+static void vram_alloc_insert(struct vram_region *vr, struct vram_alloc *new)
+{
+	struct vram_alloc *va;
+
+	list_for_each_entry(va, &vr->alloc_list, list) {
+		if (va->paddr > new->paddr)
+			break;
+	}
+
+	list_add_tail(&new->list, &va->list);
+}
+
 static struct vram_alloc *omap_vram_create_allocation(struct vram_region *vr,
 		unsigned long paddr, unsigned pages)
 {
-	struct vram_alloc *va;
 	struct vram_alloc *new;
 
-	new = kzalloc(sizeof(*va), GFP_KERNEL);
+	new = kzalloc(sizeof(*new), GFP_KERNEL);
 
 	if (!new)
 		return NULL;
@@ -121,12 +320,7 @@ static struct vram_alloc *omap_vram_create_allocation(struct vram_region *vr,
 	new->paddr = paddr;
 	new->pages = pages;
 
-	list_for_each_entry(va, &vr->alloc_list, list) {
-		if (va->paddr > new->paddr)
-			break;
-	}
-
-	list_add_tail(&new->list, &va->list);
+	vram_alloc_insert(vr, new);
 
 	return new;
 }
@@ -170,28 +364,35 @@ int omap_vram_free(unsigned long paddr, size_t size)
 {
 	struct vram_region *rm;
 	struct vram_alloc *alloc;
-	unsigned start, end;
+	struct vram_extent *spare;
+	unsigned long start, end;
 
 	DBG("free mem paddr %08lx size %d\n", paddr, size);
 
 	size = PAGE_ALIGN(size);
 
+	spare = kzalloc(sizeof(*spare), GFP_KERNEL);
+	if (spare == NULL)
+		return -ENOMEM;
+
 	mutex_lock(&region_mutex);
 
 	list_for_each_entry(rm, &region_list, list) {
 		list_for_each_entry(alloc, &rm->alloc_list, list) {
 			start = alloc->paddr;
-			end = alloc->paddr + (alloc->pages >> PAGE_SHIFT);
+			end = alloc->paddr + (alloc->pages << PAGE_SHIFT);
 
-			if (start >= paddr && end < paddr + size)
+			if (start >= paddr && end <= paddr + size)
 				goto found;
 		}
 	}
 
 	mutex_unlock(&region_mutex);
+	kfree(spare);
 	return -EINVAL;
 
 found:
+	vram_extent_add(rm, alloc->paddr, alloc->pages, spare);
 	omap_vram_free_allocation(alloc);
 
 	mutex_unlock(&region_mutex);
@@ -202,7 +403,8 @@ EXPORT_SYMBOL(omap_vram_free);
 static int _omap_vram_reserve(unsigned long paddr, unsigned pages)
 {
 	struct vram_region *rm;
-	struct vram_alloc *alloc;
+	struct vram_extent *ve;
+	struct vram_extent *spare;
 	size_t size;
 
 	size = pages << PAGE_SHIFT;
@@ -220,31 +422,33 @@ static int _omap_vram_reserve(unsigned long paddr, unsigned pages)
 		if (start > paddr || end < paddr + size - 1)
 			continue;
 
-		DBG("block ok, checking allocs\n");
+		DBG("block ok, checking free extents\n");
 
-		list_for_each_entry(alloc, &rm->alloc_list, list) {
-			end = alloc->paddr - 1;
-
-			if (start <= paddr && end >= paddr + size - 1)
+		list_for_each_entry(ve, &rm->free_list, list) {
+			if (ve->paddr <= paddr &&
+					vram_extent_end(ve) >= paddr + size)
 				goto found;
-
-			start = alloc->paddr + (alloc->pages << PAGE_SHIFT);
 		}
+	}
 
-		end = rm->paddr + (rm->pages << PAGE_SHIFT) - 1;
+	return -ENOMEM;
 
-		if (!(start <= paddr && end >= paddr + size - 1))
-			continue;
 found:
-		DBG("found area start %lx, end %lx\n", start, end);
+	DBG("found area start %lx, end %lx\n", ve->paddr,
+			vram_extent_end(ve) - 1);
 
-		if (omap_vram_create_allocation(rm, paddr, pages) == NULL)
-			return -ENOMEM;
+	spare = kzalloc(sizeof(*spare), GFP_KERNEL);
+	if (spare == NULL)
+		return -ENOMEM;
 
-		return 0;
+	if (omap_vram_create_allocation(rm, paddr, pages) == NULL) {
+		kfree(spare);
+		return -ENOMEM;
 	}
 
-	return -ENOMEM;
+	vram_extent_take(rm, ve, paddr, pages, spare);
+
+	return 0;
 }
 
 int omap_vram_reserve(unsigned long paddr, size_t size)
@@ -273,7 +477,8 @@ static void _omap_vram_dma_cb(int lch, u16 ch_status, void *data)
 	complete(compl);
 }
 
-static int _omap_vram_clear(u32 paddr, unsigned pages)
+/* clear the pages at dst if fill is set, else copy them from src */
+static int _omap_vram_dma(u32 dst, u32 src, unsigned pages, bool fill)
 {
 	struct completion compl;
 	unsigned elem_count;
@@ -287,7 +492,8 @@ static int _omap_vram_clear(u32 paddr, unsigned pages)
 			_omap_vram_dma_cb,
 			&compl, &lch);
 	if (r) {
-		pr_err("VRAM: request_dma failed for memory clear\n");
+		pr_err("VRAM: request_dma failed for memory %s\n",
+				fill ? "clear" : "copy");
 		return -EBUSY;
 	}
 
@@ -300,15 +506,24 @@ static int _omap_vram_clear(u32 paddr, unsigned pages)
 			0, 0);
 
 	omap_set_dma_dest_params(lch, 0, OMAP_DMA_AMODE_POST_INC,
-			paddr, 0, 0);
+			dst, 0, 0);
 
-	omap_set_dma_color_mode(lch, OMAP_DMA_CONSTANT_FILL, 0x000000);
+	if (fill) {
+		omap_set_dma_color_mode(lch, OMAP_DMA_CONSTANT_FILL, 0x000000);
+	} else {
+		omap_set_dma_src_params(lch, 0, OMAP_DMA_AMODE_POST_INC,
+				src, 0, 0);
+		omap_set_dma_src_burst_mode(lch, OMAP_DMA_DATA_BURST_16);
+		omap_set_dma_dest_burst_mode(lch, OMAP_DMA_DATA_BURST_16);
+		omap_set_dma_color_mode(lch, OMAP_DMA_COLOR_DIS, 0);
+	}
 
 	omap_start_dma(lch);
 
 	if (wait_for_completion_timeout(&compl, msecs_to_jiffies(1000)) == 0) {
 		omap_stop_dma(lch);
-		pr_err("VRAM: dma timeout while clearing memory\n");
+		pr_err("VRAM: dma timeout while %s memory\n",
+				fill ? "clearing" : "copying");
 		r = -EIO;
 		goto err;
 	}
@@ -320,49 +535,166 @@ err:
 	return r;
 }
 
-static int _omap_vram_alloc(int mtype, unsigned pages, unsigned long *paddr)
+static int _omap_vram_clear(u32 paddr, unsigned pages)
+{
+	return _omap_vram_dma(paddr, 0, pages, true);
+}
+
+static int _omap_vram_copy(u32 dst, u32 src, unsigned pages)
+{
+	return _omap_vram_dma(dst, src, pages, false);
+}
+
+/* Move an allocation to the start of the free extent ve, below it. The owner
+ * stops using the memory in prepare() and is given the new address in
+ * done(). */
+static int vram_migrate(struct vram_region *vr, struct vram_alloc *va,
+		struct vram_extent *ve)
+{
+	unsigned long old_paddr = va->paddr;
+	unsigned long new_paddr = ve->paddr;
+	struct vram_extent *spare;
+	int r;
+
+	spare = kzalloc(sizeof(*spare), GFP_KERNEL);
+	if (spare == NULL)
+		return -ENOMEM;
+
+	r = va->ops->prepare(va->data);
+	if (r)
+		goto err;
+
+	r = _omap_vram_copy(new_paddr, old_paddr, va->pages);
+	if (r) {
+		va->ops->done(va->data, old_paddr);
+		goto err;
+	}
+
+	DBG("migrated %lx to %lx, %d pages\n", old_paddr, new_paddr,
+			va->pages);
+
+	vram_extent_take(vr, ve, new_paddr, va->pages, NULL);
+	vram_extent_add(vr, old_paddr, va->pages, spare);
+
+	list_del(&va->list);
+	va->paddr = new_paddr;
+	vram_alloc_insert(vr, va);
+
+	va->ops->done(va->data, new_paddr);
+
+	vram_stats.migrations++;
+	vram_stats.migrated_bytes += va->pages << PAGE_SHIFT;
+
+	return 0;
+err:
+	kfree(spare);
+	vram_stats.failed_migrations++;
+
+	return r;
+}
+
+/* Move the migratable allocations of a region, from the top, down into the
+ * lowest free extents fitting them until a free extent of pages exists */
+static int vram_compact_region(struct vram_region *vr, unsigned pages)
+{
+	struct vram_alloc *va, *tmp;
+	struct vram_extent *ve;
+
+	list_for_each_entry_safe_reverse(va, tmp, &vr->alloc_list, list) {
+		if (vram_extent_best_fit(vr, pages))
+			return 0;
+
+		if (va->ops == NULL)
+			continue;
+
+		list_for_each_entry(ve, &vr->free_list, list) {
+			if (ve->paddr > va->paddr)
+				break;
+
+			if (ve->pages >= va->pages) {
+				vram_migrate(vr, va, ve);
+				break;
+			}
+		}
+	}
+
+	return vram_extent_best_fit(vr, pages) ? 0 : -ENOMEM;
+}
+
+static int vram_compact(int mtype, unsigned pages)
 {
 	struct vram_region *rm;
-	struct vram_alloc *alloc;
 
 	list_for_each_entry(rm, &region_list, list) {
-		unsigned long start, end;
+		if (region_mem_type(rm->paddr) != mtype)
+			continue;
 
+		if (vram_region_free_bytes(rm) < pages << PAGE_SHIFT)
+			continue;
+
+		if (vram_compact_region(rm, pages) == 0)
+			return 0;
+	}
+
+	return -ENOMEM;
+}
+
+/* smallest free extent of at least pages over the regions of mtype */
+static struct vram_extent *vram_best_fit(int mtype, unsigned pages,
+		struct vram_region **region)
+{
+	struct vram_region *rm;
+	struct vram_extent *ve;
+	struct vram_extent *best = NULL;
+
+	list_for_each_entry(rm, &region_list, list) {
 		DBG("checking region %lx %d\n", rm->paddr, rm->pages);
 
 		if (region_mem_type(rm->paddr) != mtype)
 			continue;
 
-		start = rm->paddr;
+		ve = vram_extent_best_fit(rm, pages);
+		if (ve == NULL)
+			continue;
 
-		list_for_each_entry(alloc, &rm->alloc_list, list) {
-			end = alloc->paddr;
+		if (best == NULL || ve->pages < best->pages) {
+			best = ve;
+			*region = rm;
+		}
+	}
 
-			if (end - start >= pages << PAGE_SHIFT)
-				goto found;
+	return best;
+}
 
-			start = alloc->paddr + (alloc->pages << PAGE_SHIFT);
-		}
+static int _omap_vram_alloc(int mtype, unsigned pages, unsigned long *paddr)
+{
+	struct vram_region *rm;
+	struct vram_extent *ve;
+	unsigned long start;
 
-		end = rm->paddr + (rm->pages << PAGE_SHIFT);
-found:
-		if (end - start < pages << PAGE_SHIFT)
-			continue;
+	ve = vram_best_fit(mtype, pages, &rm);
 
-		DBG("found %lx, end %lx\n", start, end);
+	/* free space is there but fragmented, try moving allocations */
+	if (ve == NULL && vram_compact(mtype, pages) == 0)
+		ve = vram_best_fit(mtype, pages, &rm);
 
-		alloc = omap_vram_create_allocation(rm, start, pages);
-		if (alloc == NULL)
-			return -ENOMEM;
+	if (ve == NULL)
+		return -ENOMEM;
 
-		*paddr = start;
+	start = ve->paddr;
 
-		_omap_vram_clear(start, pages);
+	DBG("found %lx, end %lx\n", start, vram_extent_end(ve));
 
-		return 0;
-	}
+	if (omap_vram_create_allocation(rm, start, pages) == NULL)
+		return -ENOMEM;
 
-	return -ENOMEM;
+	vram_extent_take(rm, ve, start, pages, NULL);
+
+	*paddr = start;
+
+	_omap_vram_clear(start, pages);
+
+	return 0;
 }
 
 int omap_vram_alloc(int mtype, size_t size, unsigned long *paddr)
@@ -387,12 +719,44 @@ int omap_vram_alloc(int mtype, size_t size, unsigned long *paddr)
 }
 EXPORT_SYMBOL(omap_vram_alloc);
 
+/*
+ * Let the VRAM manager move the allocation at paddr to defragment the free
+ * memory, or pin it again if ops is NULL. The callbacks are called with the
+ * VRAM manager locked and must not call back into it.
+ */
+int omap_vram_set_migratable(unsigned long paddr,
+		const struct omap_vram_migrate_ops *ops, void *data)
+{
+	struct vram_region *rm;
+	struct vram_alloc *alloc;
+
+	mutex_lock(&region_mutex);
+
+	list_for_each_entry(rm, &region_list, list) {
+		list_for_each_entry(alloc, &rm->alloc_list, list) {
+			if (alloc->paddr == paddr)
+				goto found;
+		}
+	}
+
+	mutex_unlock(&region_mutex);
+	return -EINVAL;
+
+found:
+	alloc->ops = ops;
+	alloc->data = data;
+
+	mutex_unlock(&region_mutex);
+	return 0;
+}
+EXPORT_SYMBOL(omap_vram_set_migratable);
+
 void omap_vram_get_info(unsigned long *vram,
 		unsigned long *free_vram,
 		unsigned long *largest_free_block)
 {
 	struct vram_region *vr;
-	struct vram_alloc *va;
+	struct vram_extent *ve;
 
 	*vram = 0;
 	*free_vram = 0;
@@ -402,23 +766,15 @@ void omap_vram_get_info(unsigned long *vram,
 
 	list_for_each_entry(vr, &region_list, list) {
 		unsigned free;
-		unsigned long pa;
 
-		pa = vr->paddr;
 		*vram += vr->pages << PAGE_SHIFT;
 
-		list_for_each_entry(va, &vr->alloc_list, list) {
-			free = va->paddr - pa;
+		list_for_each_entry(ve, &vr->free_list, list) {
+			free = ve->pages << PAGE_SHIFT;
 			*free_vram += free;
 			if (free > *largest_free_block)
 				*largest_free_block = free;
-			pa = va->paddr + (va->pages << PAGE_SHIFT);
 		}
-
-		free = vr->paddr + (vr->pages << PAGE_SHIFT) - pa;
-		*free_vram += free;
-		if (free > *largest_free_block)
-			*largest_free_block = free;
 	}
 
 	mutex_unlock(&region_mutex);
@@ -465,6 +821,82 @@ static const struct file_operations vram_debug_fops = {
 	.release        = single_release,
 };
 
+#define VRAM_FRAG_BUCKETS	8
+
+static int vram_frag_show(struct seq_file *s, void *unused)
+{
+	struct vram_region *vr;
+	struct vram_extent *ve;
+	struct vram_alloc *va;
+	unsigned buckets[VRAM_FRAG_BUCKETS];
+	unsigned long free, largest;
+	unsigned extents, allocs, migratable;
+	int i;
+
+	mutex_lock(&region_mutex);
+
+	list_for_each_entry(vr, &region_list, list) {
+		free = 0;
+		largest = 0;
+		extents = 0;
+		allocs = 0;
+		migratable = 0;
+		memset(buckets, 0, sizeof(buckets));
+
+		list_for_each_entry(ve, &vr->free_list, list) {
+			free += ve->pages << PAGE_SHIFT;
+			if (ve->pages << PAGE_SHIFT > largest)
+				largest = ve->pages << PAGE_SHIFT;
+			extents++;
+			/* 1, 2-3, 4-7, ... pages, the last bucket is open */
+			i = min(fls(ve->pages) - 1, VRAM_FRAG_BUCKETS - 1);
+			buckets[i]++;
+		}
+
+		list_for_each_entry(va, &vr->alloc_list, list) {
+			allocs++;
+			if (va->ops)
+				migratable++;
+		}
+
+		seq_printf(s, "%08lx-%08lx\n", vr->paddr,
+				vr->paddr + (vr->pages << PAGE_SHIFT) - 1);
+		seq_printf(s, "    allocations %u (%u migratable)\n", allocs,
+				migratable);
+		seq_printf(s, "    free %lu bytes in %u extents, largest %lu\n",
+				free, extents, largest);
+		/* share of the free memory not in the largest extent */
+		seq_printf(s, "    fragmentation %lu%%\n",
+				free ? 100 - largest * 100 / free : 0);
+		seq_printf(s, "    free extents by pages:");
+		for (i = 0; i < VRAM_FRAG_BUCKETS; i++)
+			seq_printf(s, " %u%s:%u", 1 << i,
+					i == VRAM_FRAG_BUCKETS - 1 ? "+" : "",
+					buckets[i]);
+		seq_printf(s, "\n");
+	}
+
+	seq_printf(s, "migrations %u (%lu bytes), failed %u\n",
+			vram_stats.migrations, vram_stats.migrated_bytes,
+			vram_stats.failed_migrations);
+
+	mutex_unlock(&region_mutex);
+
+	return 0;
+}
+
+static int vram_frag_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vram_frag_show, inode->i_private);
+}
+
+static const struct file_operations vram_frag_fops = {
+	.open           = vram_frag_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static int __init omap_vram_create_debugfs(void)
 {
 	struct dentry *d;
@@ -474,6 +906,11 @@ static int __init omap_vram_create_debugfs(void)
 	if (IS_ERR(d))
 		return PTR_ERR(d);
 
+	d = debugfs_create_file("vram_frag", S_IRUGO, NULL,
+			NULL, &vram_frag_fops);
+	if (IS_ERR(d))
+		return PTR_ERR(d);
+
 	return 0;
 }
 #endif
@@ -0,0 +1,95 @@
+/*
+ * bitmap.h -- bitmap subset of <linux/bitmap.h> for user space.
+ */
+
+#ifndef _TCM_SHIM_BITMAP_H
+#define _TCM_SHIM_BITMAP_H
+
+#include "kernel.h"
+
+#define BITS_PER_LONG		(8 * sizeof(long))
+#define BITS_TO_LONGS(nr)	(((nr) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define BIT_WORD(nr)		((nr) / BITS_PER_LONG)
+#define BIT_MASK(nr)		(1UL << ((nr) % BITS_PER_LONG))
+
+static inline int test_bit(unsigned long nr, const unsigned long *addr)
+{
+	return (addr[BIT_WORD(nr)] & BIT_MASK(nr)) != 0;
+}
+
+static inline unsigned long __fls(unsigned long word)
+{
+	return BITS_PER_LONG - 1 - __builtin_clzl(word);
+}
+
+static inline unsigned long __find_next(const unsigned long *addr,
+					unsigned long size,
+					unsigned long offset, unsigned long inv)
+{
+	unsigned long word;
+
+	while (offset < size) {
+		word = addr[BIT_WORD(offset)] ^ inv;
+		word &= ~0UL << (offset % BITS_PER_LONG);
+		if (word) {
+			offset = offset - offset % BITS_PER_LONG +
+				 __builtin_ctzl(word);
+			return offset < size ? offset : size;
+		}
+		offset = offset - offset % BITS_PER_LONG + BITS_PER_LONG;
+	}
+	return size;
+}
+
+static inline unsigned long find_next_bit(const unsigned long *addr,
+					  unsigned long size,
+					  unsigned long offset)
+{
+	return __find_next(addr, size, offset, 0);
+}
+
+static inline unsigned long find_next_zero_bit(const unsigned long *addr,
+					       unsigned long size,
+					       unsigned long offset)
+{
+	return __find_next(addr, size, offset, ~0UL);
+}
+
+static inline void bitmap_set(unsigned long *map, unsigned long start,
+			      unsigned long nr)
+{
+	while (nr--) {
+		map[BIT_WORD(start)] |= BIT_MASK(start);
+		start++;
+	}
+}
+
+static inline void bitmap_clear(unsigned long *map, unsigned long start,
+				unsigned long nr)
+{
+	while (nr--) {
+		map[BIT_WORD(start)] &= ~BIT_MASK(start);
+		start++;
+	}
+}
+
+static inline unsigned long bitmap_find_next_zero_area(unsigned long *map,
+		unsigned long size, unsigned long start, unsigned int nr,
+		unsigned long align_mask)
+{
+	unsigned long index, end, i;
+again:
+	index = find_next_zero_bit(map, size, start);
+	index = __ALIGN_MASK(index, align_mask);
+	end = index + nr;
+	if (end > size)
+		return end;
+	i = find_next_bit(map, end, index);
+	if (i < end) {
+		start = i + 1;
+		goto again;
+	}
+	return index;
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * kernel.h -- minimal kernel API used by the TILER container managers,
+ * so that they can be built and exercised in user space.
+ */
+
+#ifndef _TCM_SHIM_KERNEL_H
+#define _TCM_SHIM_KERNEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef uint64_t u64;
+
+#define KERN_ERR	""
+#define KERN_NOTICE	""
+#define KERN_INFO	""
+#define KERN_DEBUG	""
+#define printk		printf
+
+#define EXPORT_SYMBOL(sym)
+
+#define GFP_KERNEL	0
+#define kmalloc(size, flags)	malloc(size)
+#define kzalloc(size, flags)	calloc(1, size)
+#define kfree(ptr)		free(ptr)
+
+struct mutex {
+	int locked;
+};
+#define mutex_init(m)		((m)->locked = 0)
+#define mutex_destroy(m)	do { } while (0)
+#define mutex_lock(m)		((m)->locked++)
+#define mutex_unlock(m)		((m)->locked--)
+
+#define __ALIGN_MASK(x, mask)	(((x) + (mask)) & ~(mask))
+#define ALIGN(x, a)		__ALIGN_MASK(x, (typeof(x))(a) - 1)
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#endif
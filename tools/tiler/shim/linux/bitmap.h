@@ -0,0 +1 @@
+#include "../bitmap.h"
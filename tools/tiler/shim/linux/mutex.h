@@ -0,0 +1,2 @@
+#include "../kernel.h"
+#include "../list.h"
@@ -0,0 +1,314 @@
+/*
+ * tcm_replay.c -- replay TILER container allocation traces against the
+ * container managers in user space, and report allocation latency and
+ * container fragmentation for each of them.
+ *
+ * Copyright (C) 2010 Texas Instruments, Inc.
+ *
+ * This package is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Trace format, one operation per line ('#' starts a comment):
+ *
+ *   2 <id> <width> <height> <align>	reserve a 2D area (in slots)
+ *   1 <id> <slots>			reserve a 1D area
+ *   f <id>				free the area reserved as <id>
+ *
+ * Usage:
+ *   tcm_replay [-w width] [-h height] <trace>
+ *   tcm_replay -g <ops> [-s seed]	write a synthetic trace to stdout
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include "tcm.h"
+#include "tcm_sita.h"
+#include "tcm_rowidx.h"
+
+#define MAX_IDS 65536
+
+struct op {
+	char type;		/* '1', '2' or 'f' */
+	u32 id;
+	u16 w, h, align;
+	u32 slots;
+};
+
+struct stats {
+	u64 ns[3];		/* total time: 1D, 2D, free */
+	u64 max_ns[3];		/* slowest operation */
+	u32 count[3];
+	u32 failed[2];		/* failed 1D, 2D reservations */
+	u32 used, peak;		/* slots in use */
+};
+
+struct alg {
+	const char *name;
+	struct tcm *(*init)(u16 width, u16 height, struct tcm_pt *attr);
+};
+
+static struct alg algs[] = {
+	{ "sita", sita_init },
+	{ "rowidx", rowidx_init },
+};
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void account(struct stats *s, int kind, u64 ns)
+{
+	s->ns[kind] += ns;
+	s->count[kind]++;
+	if (ns > s->max_ns[kind])
+		s->max_ns[kind] = ns;
+}
+
+/* largest free rectangle (histogram method) and longest free 1D run */
+static void fragmentation(struct tcm *tcm, u32 *free_slots, u32 *rect,
+			  u32 *run)
+{
+	struct tcm_area parent;
+	struct tcm_pt pt;
+	u16 *hist = calloc(tcm->width, sizeof(*hist));
+	u32 r = 0, i, j, w;
+
+	*free_slots = *rect = *run = 0;
+	for (pt.y = 0; pt.y < tcm->height; pt.y++) {
+		for (pt.x = 0; pt.x < tcm->width; pt.x++) {
+			if (tcm_get_parent(tcm, &pt, &parent)) {
+				hist[pt.x]++;
+				(*free_slots)++;
+				if (++r > *run)
+					*run = r;
+			} else {
+				hist[pt.x] = 0;
+				r = 0;
+			}
+		}
+		/* largest rectangle with its bottom on this row */
+		for (i = 0; i < tcm->width; i++) {
+			w = 0;
+			for (j = i; j < tcm->width && hist[j] >= hist[i]; j++)
+				w++;
+			for (j = i; j-- > 0 && hist[j] >= hist[i];)
+				w++;
+			if (w * hist[i] > *rect)
+				*rect = w * hist[i];
+		}
+	}
+	free(hist);
+}
+
+static void replay(struct alg *alg, struct op *ops, u32 n, u16 width,
+		   u16 height)
+{
+	static const char *kind[] = { "1D", "2D", "free" };
+	struct tcm_pt div_pt = { width, (3 * height) / 4 };
+	struct tcm_area *areas = calloc(MAX_IDS, sizeof(*areas));
+	struct stats s;
+	struct tcm *tcm;
+	u32 i, free_slots, rect, run;
+	u64 t;
+	s32 res;
+
+	memset(&s, 0, sizeof(s));
+	tcm = alg->init(width, height, &div_pt);
+	if (!tcm || !areas) {
+		fprintf(stderr, "%s: could not create container\n", alg->name);
+		exit(1);
+	}
+
+	for (i = 0; i < n; i++) {
+		struct op *o = ops + i;
+		struct tcm_area *a = areas + o->id;
+
+		t = now_ns();
+		switch (o->type) {
+		case '1':
+			res = tcm_reserve_1d(tcm, o->slots, a);
+			account(&s, 0, now_ns() - t);
+			if (res)
+				s.failed[0]++;
+			break;
+		case '2':
+			res = tcm_reserve_2d(tcm, o->w, o->h, o->align, a);
+			account(&s, 1, now_ns() - t);
+			if (res)
+				s.failed[1]++;
+			break;
+		default:
+			if (!a->tcm)
+				continue;
+			s.used -= tcm_sizeof(*a);
+			tcm_free(a);
+			account(&s, 2, now_ns() - t);
+			continue;
+		}
+		if (!res) {
+			s.used += tcm_sizeof(*a);
+			if (s.used > s.peak)
+				s.peak = s.used;
+		}
+	}
+
+	fragmentation(tcm, &free_slots, &rect, &run);
+
+	printf("%s:\n", alg->name);
+	for (i = 0; i < 3; i++)
+		printf("  %-4s %7u ops, avg %7llu ns, max %8llu ns\n", kind[i],
+		       s.count[i],
+		       s.count[i] ? (unsigned long long) s.ns[i] / s.count[i] : 0,
+		       (unsigned long long) s.max_ns[i]);
+	printf("  failed: %u 1D, %u 2D; peak use %u of %u slots\n",
+	       s.failed[0], s.failed[1], s.peak, width * height);
+	printf("  at end: %u free slots, largest free rectangle %u, "
+	       "longest 1D run %u, fragmentation %u%%\n", free_slots, rect, run,
+	       free_slots ? 100 - rect * 100 / free_slots : 0);
+
+	for (i = 0; i < MAX_IDS; i++)
+		tcm_free(areas + i);
+	tcm_deinit(tcm);
+	free(areas);
+}
+
+static u32 read_trace(FILE *f, struct op **ops)
+{
+	char line[128];
+	u32 n = 0, size = 1024;
+	struct op o;
+	unsigned int id, a, b, c;
+
+	*ops = malloc(size * sizeof(**ops));
+	while (*ops && fgets(line, sizeof(line), f)) {
+		memset(&o, 0, sizeof(o));
+		if (sscanf(line, " 2 %u %u %u %u", &id, &a, &b, &c) == 4) {
+			o.type = '2';
+			o.w = a;
+			o.h = b;
+			o.align = c;
+		} else if (sscanf(line, " 1 %u %u", &id, &a) == 2) {
+			o.type = '1';
+			o.slots = a;
+		} else if (sscanf(line, " f %u", &id) == 1) {
+			o.type = 'f';
+		} else {
+			continue;
+		}
+		if (id >= MAX_IDS) {
+			fprintf(stderr, "id %u out of range\n", id);
+			continue;
+		}
+		o.id = id;
+		if (n == size)
+			*ops = realloc(*ops, (size *= 2) * sizeof(**ops));
+		(*ops)[n++] = o;
+	}
+	return *ops ? n : 0;
+}
+
+/*
+ * Synthetic media workload: NV12 frames (8-bit luma with 16-bit chroma of
+ * the same slot width and half height), 32-bit RGB surfaces, and 1D
+ * buffers, freed in random order.
+ */
+static void generate(u32 ops, unsigned int seed)
+{
+	static const u16 widths[] = { 3, 6, 12, 23, 30, 45, 60 };
+	u32 live[1024], nlive = 0, id = 0, i, k;
+	u16 w, h;
+
+	srand(seed);
+	printf("# synthetic trace, seed %u\n", seed);
+	for (i = 0; i < ops; i++) {
+		if (nlive && (nlive >= 200 || rand() % 100 < 50)) {
+			k = rand() % nlive;
+			printf("f %u\n", live[k]);
+			live[k] = live[--nlive];
+			continue;
+		}
+		id = (id + 1) % MAX_IDS;
+		switch (rand() % 4) {
+		case 0:
+		case 1:
+			w = widths[rand() % 7];
+			h = (w * 9 + 15) / 16 + 1;
+			printf("2 %u %u %u 64\n", id, w, h);
+			live[nlive++] = id;
+			id = (id + 1) % MAX_IDS;
+			printf("2 %u %u %u 32\n", id, w, (h + 1) / 2);
+			break;
+		case 2:
+			w = widths[rand() % 7] * 2;
+			printf("2 %u %u %u %u\n", id, w, w * 9 / 16 + 1,
+			       rand() % 2 ? 1 : 64);
+			break;
+		default:
+			printf("1 %u %u\n", id, 1 + rand() % 512);
+			break;
+		}
+		live[nlive++] = id;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int width = 256, height = 128, seed = 1, gen = 0;
+	struct op *ops;
+	FILE *f;
+	u32 n, i;
+	int c;
+
+	while ((c = getopt(argc, argv, "w:h:g:s:")) != -1) {
+		switch (c) {
+		case 'w':
+			width = atoi(optarg);
+			break;
+		case 'h':
+			height = atoi(optarg);
+			break;
+		case 'g':
+			gen = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (gen) {
+		generate(gen, seed);
+		return 0;
+	}
+
+	if (optind != argc - 1)
+		goto usage;
+
+	f = strcmp(argv[optind], "-") ? fopen(argv[optind], "r") : stdin;
+	if (!f) {
+		perror(argv[optind]);
+		return 1;
+	}
+	n = read_trace(f, &ops);
+	if (f != stdin)
+		fclose(f);
+
+	printf("%u operations on a %ux%u container\n", n, width, height);
+	for (i = 0; i < sizeof(algs) / sizeof(*algs); i++)
+		replay(algs + i, ops, n, width, height);
+	free(ops);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-w width] [-h height] <trace|->\n"
+			"       %s -g <ops> [-s seed]\n", argv[0], argv[0]);
+	return 1;
+}